@@ -20,6 +20,7 @@
  */
 #import "GNSMenuBar.h"
 #include "cocoa_menu_item.h"
+#include "menu_sync.h"
 
 @implementation GNSMenuBar
 
@@ -51,18 +52,7 @@
 
 - (void) resync
 {
-  cocoa_menu_item_add_submenu(GTK_MENU_SHELL(gtk_menubar), self, TRUE, FALSE);
-    if (help_menu && 
-	[help_menu menu] == self &&
-	[self indexOfItem: (NSMenuItem*)help_menu] < [self numberOfItems] - 1) {
-    [self removeItem: (NSMenuItem*)help_menu];
-    [self addItem: (NSMenuItem*)help_menu];
-  }
-  if ([window_menu menu] == self &&
-      [self indexOfItem: (NSMenuItem*)window_menu] != [self numberOfItems] - 2) {
-    [self removeItem: (NSMenuItem*)window_menu];
-    [self insertItem: (NSMenuItem*)window_menu atIndex: [self numberOfItems] - 1];
-    }
+  menu_sync_menubar (GTK_WIDGET (gtk_menubar), self);
 }
 
 - (GtkMenuBar*) menuBar
@@ -70,8 +60,14 @@
   return gtk_menubar;
 }
 
+- (void) setMenuBar: (GtkMenuBar*) menubar
+{
+  gtk_menubar = menubar;
+}
+
 - (void) setAppMenu: (GNSMenuItem*) menu_item
 {
+  cocoa_menu_item_unindex_menu ([app_menu submenu]);
   [app_menu release];
   app_menu = menu_item;
   [app_menu retain];
@@ -83,6 +79,7 @@
 
 - (void) setWindowsMenu: (GNSMenuItem*) menu_item 
 {
+  cocoa_menu_item_unindex_menu ([window_menu submenu]);
   [window_menu release];
   window_menu = menu_item;
   [window_menu retain];
@@ -112,6 +109,8 @@
     if (list && list->data)
       g_list_free(list->data);
   }
+  cocoa_menu_item_unindex_menu ([app_menu submenu]);
+  cocoa_menu_item_unindex_menu ([window_menu submenu]);
   [app_menu release];
   [window_menu release];
   [help_menu release];
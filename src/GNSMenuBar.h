@@ -83,6 +83,14 @@
 -(void) resync;
 
 - (GtkMenuBar*) menuBar;
+/**
+ * setMenuBar:
+ * @menubar: The GtkMenuBar to sync with from now on
+ *
+ * For a menubar shared between windows, when another window's
+ * GtkMenuBar takes over.
+ */
+- (void) setMenuBar: (GtkMenuBar*) menubar;
 - (void) setAppMenu: (GNSMenuItem*) menu_item;
 - (GNSMenuItem*) appMenu;
 - (void) setWindowsMenu: (GNSMenuItem*) menu_item;
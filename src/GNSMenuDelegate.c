@@ -0,0 +1,57 @@
+/* --- objc-mode --- */
+/* GTK+ Integration with platform-specific application-wide features 
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#import "GNSMenuDelegate.h"
+#include "menu_sync.h"
+#include "menu_update.h"
+
+@implementation GNSMenuDelegate
+
+- (id) initWithMenuShell: (GtkMenuShell*) shell menu: (NSMenu*) cocoa_menu
+{
+  self = [super init];
+  if (self) {
+    menu_shell = shell;
+    g_object_add_weak_pointer (G_OBJECT (menu_shell), (gpointer*) &menu_shell);
+    menu = cocoa_menu;
+    [menu retain];
+    [menu setDelegate: self];
+  }
+  return self;
+}
+
+- (void) menuNeedsUpdate: (NSMenu*) cocoa_menu
+{
+  menu_update_flush ();
+  if (menu_shell)
+    menu_sync_menu_will_open (GTK_WIDGET (menu_shell));
+}
+
+- (void) dealloc
+{
+  if (menu_shell)
+    g_object_remove_weak_pointer (G_OBJECT (menu_shell), (gpointer*) &menu_shell);
+  if ([menu delegate] == self)
+    [menu setDelegate: nil];
+  [menu release];
+  [super dealloc];
+}
+@end
@@ -0,0 +1,68 @@
+/* --- objc-mode --- */
+/* GTK+ Integration with platform-specific application-wide features 
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#import <Cocoa/Cocoa.h>
+#include <gtk/gtk.h>
+
+/**
+ * SECTION:GNSMenuDelegate
+ * @short_description: NSMenu delegate for submenus built on demand
+ * @title: GNSMenuDelegate
+ * @stability: Private
+ *
+ * When submenus are built lazily (see
+ * gtk_osxapplication_set_lazy_submenus()) each one starts out as an
+ * empty NSMenu with one of these as its delegate. Cocoa tells the
+ * delegate when the menu is about to be displayed or searched for a
+ * key equivalent, and the delegate fills it in from its GtkMenuShell.
+ */
+#if MAC_OS_X_VERSION_MAX_ALLOWED >= 1060
+@interface GNSMenuDelegate : NSObject <NSMenuDelegate>
+#else
+@interface GNSMenuDelegate : NSObject
+#endif
+{
+@private
+  GtkMenuShell *menu_shell;
+  NSMenu *menu;
+}
+
+/**
+ * initWithMenuShell:
+ * @shell: The GtkMenuShell that @cocoa_menu mirrors
+ * @cocoa_menu: The NSMenu to be the delegate of
+ *
+ * Create a delegate and install it on @cocoa_menu. The GtkMenuShell
+ * is held weakly; the NSMenu is retained until the delegate goes
+ * away, when the delegate removes itself.
+ */
+- (id) initWithMenuShell: (GtkMenuShell*) shell menu: (NSMenu*) cocoa_menu;
+
+/**
+ * menuNeedsUpdate:
+ * @cocoa_menu: The menu about to be shown
+ *
+ * Build or resync @cocoa_menu from the GtkMenuShell.
+ */
+- (void) menuNeedsUpdate: (NSMenu*) cocoa_menu;
+
+- (void) dealloc;
+@end
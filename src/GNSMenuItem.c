@@ -22,18 +22,9 @@
  */
 #import "GNSMenuItem.h"
 #import "GNSMenuBar.h"
-
-static gboolean
-idle_call_activate (ClosureData *action)
-{
-//    g_value_init(&args, GTK_TYPE_MENU_ITEM);
-  GValue arg = {0};
-  g_value_init(&arg, G_TYPE_POINTER);
-  g_value_set_pointer(&arg, action->data);
-  g_closure_invoke(action->closure, NULL, 1, &arg, 0);
-//  gtk_menu_item_activate ((GtkMenuItem*) data);
-  return FALSE;
-}
+#include "menu_activate.h"
+#include "menu_state.h"
+#include "menu_stats.h"
 
 @implementation GNSMenuItem
 
@@ -51,15 +42,31 @@ idle_call_activate (ClosureData *action)
     g_closure_sink(closure);
     action.closure = closure;
     action.data = ptr;
-    accel_closure = NULL;
-    notUsed = NO;
+    menu_stats_get ()->native_items++;
   }
   return self;
 }
 
+- (void) dealloc
+{
+  /* Separators come from +separatorItem and were never counted */
+  if (action.closure)
+    menu_stats_get ()->native_items--;
+  [super dealloc];
+}
+
+- (void) setActionClosure:(GClosure*) closure
+{
+  g_closure_ref (closure);
+  g_closure_sink (closure);
+  if (action.closure)
+    g_closure_unref (action.closure);
+  action.closure = closure;
+}
+
 - (void) activate:(id) sender
 {
-    g_idle_add ((GSourceFunc)idle_call_activate, &action);
+  menu_activate_queue (action.closure, action.data);
 }
 
 - (BOOL) isHidden
@@ -89,27 +96,13 @@ idle_call_activate (ClosureData *action)
     if (index < 0) index = 0;
     if (index > maxIndex) index = maxIndex;
     [inMenu insertItem: self atIndex: index];
+    menu_state_invalidate_all ();
     [(GNSMenuBar*)[NSApp mainMenu] resync];
   }
   [self release];
 #endif
 }
 
-- (void) mark
-{
-  notUsed = YES;
-}
-
-- (void) unmark
-{
-  notUsed = NO;
-}
-
-- (BOOL) isMarked
-{
-  return notUsed;
-}
-
 - (void) removeFromMenu: (NSMenu*) old_menu {
 #if !(MAC_OS_X_VERSION_MIN_REQUIRED > MAC_OS_X_VERSION_10_4)
     if (old_menu != inMenu && old_menu != [self menu])
@@ -36,22 +36,17 @@ typedef struct {
  * @stability: private
  *
  * Wrapper class around NSMenuItem providing an
- * action function which puts invocation of the provided GClosure onto
- * the gtk idle queue. 
+ * action function which hands invocation of the provided GClosure to
+ * the activation dispatcher (see menu_activate.h).
  */
 @interface GNSMenuItem : NSMenuItem
 {
-@public
-  //accel_closure is manipulated directly by
-  //cocoa_menu_item_update_accel_closure()
-  GClosure *accel_closure; 
 @private
   /// action_closure is the closure invoked when the menu item is
   /// activated (usually by clicking on it).
   ClosureData action;
   // The hidden parameter was introduced in 10.5; for earlier OSX
   // versions we need to emulate it.
-  BOOL notUsed;
 #if !(MAC_OS_X_VERSION_MIN_REQUIRED > MAC_OS_X_VERSION_10_4)
   BOOL hidden;
   uint index;
@@ -79,17 +74,24 @@ typedef struct {
  * activate:
  * @sender: The GtkWidget originating the activation. Passed to the closure
  *
- * Overrides the superclass function and puts (indirectly) the
- * action_closure on the idle queue.
+ * Overrides the superclass function and queues the action_closure
+ * with menu_activate_queue(), which runs it according to the
+ * application's activation mode.
  */
 
 - (void) activate:(id) sender;
 
+/**
+ * setActionClosure:
+ * @closure: The new closure to invoke on activation
+ *
+ * Replace the closure passed to initWithTitle:aGClosure:andPointer:,
+ * for when the item is handed over to another GtkMenuItem.
+ */
+- (void) setActionClosure:(GClosure*) closure;
+
 - (BOOL) isHidden;
 - (void) setHidden: (BOOL) shouldHide;
-- (void) mark;
-- (void) unmark;
-- (BOOL) isMarked;
 - (void) removeFromMenu: (NSMenu*) old_menu;
 
 @end
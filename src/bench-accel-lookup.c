@@ -0,0 +1,200 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/*
+ * Times the accelerator half of a full menubar sync: for every item
+ * in a menubar, find its accel label's closure and resolve it to a
+ * GtkAccelKey, the way menu_sync_item_update_accelerator() does.
+ * That's done with the gtk_accel_group_find() scan the sync used to
+ * make and with menu_accel_lookup(), for menubars with 500, 5,000 and
+ * 50,000 accelerators. The scan is quadratic, so it's skipped above
+ * --scan-limit.
+ *
+ * Output is one line per scenario of whitespace-separated key=value
+ * pairs.
+ */
+
+#include <gtk/gtk.h>
+#if GTK_CHECK_VERSION(2,90,7)
+#include <gdk/gdkkeysyms-compat.h>
+#else
+#include <gdk/gdkkeysyms.h>
+#endif
+#include <stdio.h>
+#include "getlabel.h"
+#include "menu_accel.h"
+#include "menu_stats.h"
+
+#define ITEMS_PER_MENU 100
+
+static gint n_rounds = 3;
+static gint scan_limit = 5000;
+
+static GOptionEntry entries[] = {
+  { "rounds", 'r', 0, G_OPTION_ARG_INT, &n_rounds,
+    "Number of syncs to time for each menubar", "N" },
+  { "scan-limit", 's', 0, G_OPTION_ARG_INT, &scan_limit,
+    "Largest menubar to time the linear scan on", "N" },
+  { NULL }
+};
+
+static const GdkModifierType modifiers[] = {
+  GDK_CONTROL_MASK,
+  GDK_CONTROL_MASK | GDK_SHIFT_MASK,
+  GDK_MOD1_MASK,
+  GDK_MOD1_MASK | GDK_SHIFT_MASK,
+  GDK_CONTROL_MASK | GDK_MOD1_MASK,
+  GDK_META_MASK,
+  GDK_META_MASK | GDK_SHIFT_MASK,
+  GDK_META_MASK | GDK_CONTROL_MASK
+};
+
+static void
+noop (void)
+{
+}
+
+static gboolean
+accel_find_func (GtkAccelKey *key, GClosure *closure, gpointer data)
+{
+  return (GClosure *) data == closure;
+}
+
+static GtkWidget *
+build_menubar (GtkAccelGroup *accel_group, gint n_accels)
+{
+  GtkWidget *menubar = g_object_ref_sink (gtk_menu_bar_new ());
+  GtkWidget *menu = NULL;
+  gint i;
+
+  for (i = 0; i < n_accels; i++) {
+    GtkWidget *item, *label;
+    GClosure *closure;
+
+    if (i % ITEMS_PER_MENU == 0) {
+      GtkWidget *top = gtk_menu_item_new_with_label ("Menu");
+      menu = gtk_menu_new ();
+      gtk_menu_item_set_submenu (GTK_MENU_ITEM (top), menu);
+      gtk_menu_shell_append (GTK_MENU_SHELL (menubar), top);
+    }
+    item = gtk_menu_item_new_with_label ("Item");
+    label = gtk_bin_get_child (GTK_BIN (item));
+    closure = g_cclosure_new (G_CALLBACK (noop), NULL, NULL);
+    gtk_accel_group_connect (accel_group, GDK_a + i % 26,
+			     modifiers[(i / 26) % G_N_ELEMENTS (modifiers)],
+			     GTK_ACCEL_VISIBLE, closure);
+    gtk_accel_label_set_accel_closure (GTK_ACCEL_LABEL (label), closure);
+    gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+  }
+  return menubar;
+}
+
+/* Resolve the accelerator of every item below @shell */
+static guint
+sync_accels (GtkWidget *shell, gboolean indexed)
+{
+  GList *children = gtk_container_get_children (GTK_CONTAINER (shell));
+  GList *l;
+  guint found = 0;
+
+  for (l = children; l; l = l->next) {
+    GtkWidget *item = (GtkWidget*) l->data;
+    GtkWidget *submenu = gtk_menu_item_get_submenu (GTK_MENU_ITEM (item));
+    GtkWidget *label;
+    GClosure *closure = NULL;
+    GtkAccelKey *key;
+
+    if (submenu) {
+      found += sync_accels (submenu, indexed);
+      continue;
+    }
+    get_menu_label_text (item, &label);
+    if (!GTK_IS_ACCEL_LABEL (label))
+      continue;
+    g_object_get (label, "accel-closure", &closure, NULL);
+    if (!closure)
+      continue;
+    if (indexed)
+      key = menu_accel_lookup (closure);
+    else
+      key = gtk_accel_group_find (gtk_accel_group_from_accel_closure (closure),
+				  accel_find_func, closure);
+    if (key && key->accel_key)
+      ++found;
+    g_closure_unref (closure);
+  }
+  g_list_free (children);
+  return found;
+}
+
+static void
+run (gint n_accels, gboolean indexed)
+{
+  GtkAccelGroup *accel_group = gtk_accel_group_new ();
+  GtkWidget *menubar = build_menubar (accel_group, n_accels);
+  GTimer *timer = g_timer_new ();
+  guint found = 0;
+  gint round;
+
+  menu_stats_reset ();
+  g_timer_start (timer);
+  for (round = 0; round < n_rounds; round++)
+    found = sync_accels (menubar, indexed);
+  g_timer_stop (timer);
+
+  printf ("scenario=%s accels=%d found=%u ns_per_sync=%.0f"
+	  " ns_per_item=%.1f index_builds=%u\n",
+	  indexed ? "hash-index" : "group-scan", n_accels, found,
+	  g_timer_elapsed (timer, NULL) * 1e9 / n_rounds,
+	  g_timer_elapsed (timer, NULL) * 1e9 / n_rounds / n_accels,
+	  menu_stats_get ()->accel_index_builds);
+
+  g_timer_destroy (timer);
+  gtk_widget_destroy (menubar);
+  g_object_unref (menubar);
+  g_object_unref (accel_group);
+}
+
+int
+main (int argc, char **argv)
+{
+  static const gint sizes[] = { 500, 5000, 50000 };
+  GOptionContext *context;
+  GError *error = NULL;
+  guint i;
+
+  context = g_option_context_new ("- benchmark accelerator lookup in a sync");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++) {
+    if (sizes[i] <= scan_limit)
+      run (sizes[i], FALSE);
+    run (sizes[i], TRUE);
+  }
+  return 0;
+}
@@ -0,0 +1,192 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/*
+ * Loads an accel map which changes the accelerator of every item in
+ * a large menu, first with the old arrangement of one accel-changed
+ * handler per menu item, then with the per-group closure index in
+ * menu_accel.c, and reports the time and handler calls per changed
+ * accelerator.
+ *
+ * Output is one line per scenario of whitespace-separated key=value
+ * pairs.
+ */
+
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include "getlabel.h"
+#include "menu_accel.h"
+#include "menu_stats.h"
+
+static gint n_items = 2000;
+static gint n_rounds = 5;
+static guint64 handler_calls = 0;
+static guint64 item_updates = 0;
+
+static GOptionEntry entries[] = {
+  { "items", 'i', 0, G_OPTION_ARG_INT, &n_items,
+    "Number of menu items and accel map entries", "N" },
+  { "rounds", 'r', 0, G_OPTION_ARG_INT, &n_rounds,
+    "Number of times to load each of the two maps", "N" },
+  { NULL }
+};
+
+static void
+noop (void)
+{
+}
+
+/* What each item used to connect to its group's accel-changed */
+static void
+per_item_accel_changed (GtkAccelGroup   *accel_group,
+			guint            keyval,
+			GdkModifierType  modifier,
+			GClosure        *accel_closure,
+			GtkWidget       *widget)
+{
+  GtkWidget *label;
+  GClosure *closure = NULL;
+
+  ++handler_calls;
+  get_menu_label_text (widget, &label);
+  if (gtk_accel_group_from_accel_closure (accel_closure) != accel_group)
+    return;
+  if (!GTK_IS_ACCEL_LABEL (label))
+    return;
+  g_object_get (label, "accel-closure", &closure, NULL);
+  if (closure == accel_closure)
+    ++item_updates;
+  if (closure)
+    g_closure_unref (closure);
+}
+
+static void
+indexed_accel_changed (GtkWidget *menu_item)
+{
+  ++item_updates;
+}
+
+static gchar *
+write_map (const gchar *modifier)
+{
+  gchar *filename;
+  FILE *file;
+  gint fd, i;
+
+  fd = g_file_open_tmp ("bench-accel-map-XXXXXX", &filename, NULL);
+  file = fdopen (fd, "w");
+  for (i = 0; i < n_items; i++)
+    fprintf (file, "(gtk_accel_path \"<Bench>/item-%d\" \"%sF%d\")\n",
+	     i, modifier, i % 12 + 1);
+  fclose (file);
+  return filename;
+}
+
+static GtkWidget *
+build_menu (GtkAccelGroup *accel_group, gboolean indexed)
+{
+  GtkWidget *menu = g_object_ref_sink (gtk_menu_new ());
+  gint i;
+
+  for (i = 0; i < n_items; i++) {
+    gchar *path = g_strdup_printf ("<Bench>/item-%d", i);
+    GtkWidget *item = gtk_menu_item_new_with_label (path);
+    GtkWidget *label = gtk_bin_get_child (GTK_BIN (item));
+    GClosure *closure = g_cclosure_new (G_CALLBACK (noop), NULL, NULL);
+
+    gtk_accel_map_add_entry (path, 0, 0);
+    gtk_accel_group_connect_by_path (accel_group, path, closure);
+    gtk_accel_label_set_accel_closure (GTK_ACCEL_LABEL (label), closure);
+    gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+    if (indexed)
+      menu_accel_watch (item, closure, indexed_accel_changed);
+    else
+      g_signal_connect_object (accel_group, "accel-changed",
+			       G_CALLBACK (per_item_accel_changed),
+			       item, (GConnectFlags) 0);
+    g_free (path);
+  }
+  return menu;
+}
+
+static void
+run (const gchar *scenario, gboolean indexed,
+     const gchar *map_a, const gchar *map_b)
+{
+  GtkAccelGroup *accel_group = gtk_accel_group_new ();
+  GtkWidget *menu = build_menu (accel_group, indexed);
+  GTimer *timer = g_timer_new ();
+  guint64 ops = (guint64) n_items * n_rounds * 2;
+  gint round;
+
+  menu_stats_reset ();
+  handler_calls = 0;
+  item_updates = 0;
+  g_timer_start (timer);
+  for (round = 0; round < n_rounds; round++) {
+    gtk_accel_map_load (map_a);
+    gtk_accel_map_load (map_b);
+  }
+  g_timer_stop (timer);
+  if (indexed)
+    handler_calls = menu_stats_get ()->accel_changes;
+
+  printf ("scenario=%s items=%d ops=%" G_GUINT64_FORMAT " ns_per_op=%.1f"
+	  " handler_calls_per_op=%.2f item_updates_per_op=%.2f\n",
+	  scenario, n_items, ops, g_timer_elapsed (timer, NULL) * 1e9 / ops,
+	  (double) handler_calls / ops, (double) item_updates / ops);
+
+  g_timer_destroy (timer);
+  gtk_widget_destroy (menu);
+  g_object_unref (menu);
+  g_object_unref (accel_group);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  gchar *map_a, *map_b;
+
+  context = g_option_context_new ("- benchmark accel map loading");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+
+  map_a = write_map ("<Control>");
+  map_b = write_map ("<Control><Shift>");
+
+  run ("per-item-handlers", FALSE, map_a, map_b);
+  run ("per-group-index", TRUE, map_a, map_b);
+
+  g_unlink (map_a);
+  g_unlink (map_b);
+  g_free (map_a);
+  g_free (map_b);
+  return 0;
+}
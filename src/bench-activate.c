@@ -0,0 +1,164 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/*
+ * Measures how long a menu item chosen from the menubar waits for its
+ * handler while the main loop is busy. Each round loads the main loop
+ * with a redraw handler and a default priority handler standing in
+ * for I/O, each of which spins for a while every time it runs, then
+ * chooses an item twice, the way Cocoa would. The second choice
+ * should be coalesced into the first. Every activation mode is run
+ * in turn.
+ *
+ * Output is one line per scenario of whitespace-separated key=value
+ * pairs.
+ */
+
+#include <gtk/gtk.h>
+#include <stdio.h>
+#include "menu_activate.h"
+#include "menu_stats.h"
+
+static gint n_rounds = 20;
+static gint n_busy = 20;
+static gint redraw_us = 2000;
+static gint io_us = 2000;
+
+static GOptionEntry entries[] = {
+  { "rounds", 'r', 0, G_OPTION_ARG_INT, &n_rounds,
+    "Number of activations", "N" },
+  { "busy", 'b', 0, G_OPTION_ARG_INT, &n_busy,
+    "Number of times each load handler runs per round", "N" },
+  { "redraw-us", 0, 0, G_OPTION_ARG_INT, &redraw_us,
+    "Time each redraw takes", "US" },
+  { "io-us", 0, 0, G_OPTION_ARG_INT, &io_us,
+    "Time each I/O callback takes", "US" },
+  { NULL }
+};
+
+typedef struct {
+  gint remaining;
+  gint spin_us;
+} Load;
+
+typedef struct {
+  guint64 chosen_ns;
+  guint64 total_ns;
+  guint64 max_ns;
+  guint activated;
+} Round;
+
+static void
+spin (gint us)
+{
+  guint64 until = menu_stats_now_ns () + (guint64) us * 1000;
+
+  while (menu_stats_now_ns () < until)
+    ;
+}
+
+static gboolean
+load_cb (gpointer data)
+{
+  Load *load = data;
+
+  spin (load->spin_us);
+  return --load->remaining > 0;
+}
+
+static void
+activate_cb (gpointer instance, gpointer data)
+{
+  Round *round = data;
+  guint64 ns = menu_stats_now_ns () - round->chosen_ns;
+
+  round->total_ns += ns;
+  if (ns > round->max_ns)
+    round->max_ns = ns;
+  round->activated++;
+}
+
+static void
+run (GtkOSXApplicationActivationMode mode, const gchar *name)
+{
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  Round round = { 0 };
+  GClosure *closure;
+  gint i;
+
+  closure = g_cclosure_new (G_CALLBACK (activate_cb), &round, NULL);
+  g_closure_set_marshal (closure, g_cclosure_marshal_VOID__VOID);
+  g_closure_ref (closure);
+  g_closure_sink (closure);
+
+  menu_activate_set_mode (mode);
+  menu_stats_reset ();
+  for (i = 0; i < n_rounds; i++) {
+    Load redraw = { n_busy, redraw_us }, io = { n_busy, io_us };
+    guint activated = round.activated;
+
+    g_idle_add_full (GDK_PRIORITY_REDRAW, load_cb, &redraw, NULL);
+    g_idle_add_full (G_PRIORITY_DEFAULT, load_cb, &io, NULL);
+    /* Let the load get going first */
+    g_main_context_iteration (NULL, FALSE);
+
+    round.chosen_ns = menu_stats_now_ns ();
+    menu_activate_queue (closure, NULL);
+    menu_activate_queue (closure, NULL);
+    while (round.activated == activated || redraw.remaining > 0 ||
+	   io.remaining > 0)
+      g_main_context_iteration (NULL, TRUE);
+  }
+
+  printf ("scenario=%s rounds=%d activations=%" G_GUINT64_FORMAT
+	  " coalesced=%" G_GUINT64_FORMAT
+	  " mean_latency_us=%.1f max_latency_us=%.1f\n",
+	  name, n_rounds, stats->activations, stats->activations_coalesced,
+	  round.activated ? round.total_ns / 1e3 / round.activated : 0.0,
+	  round.max_ns / 1e3);
+  g_closure_unref (closure);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+
+  context = g_option_context_new ("- time menu activations under load");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (FALSE));
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+  if (n_rounds < 1 || n_busy < 1) {
+    g_printerr ("--rounds and --busy must be positive\n");
+    return 1;
+  }
+
+  run (GTK_OSX_APPLICATION_ACTIVATE_IDLE, "idle");
+  run (GTK_OSX_APPLICATION_ACTIVATE_HIGH, "high");
+  return 0;
+}
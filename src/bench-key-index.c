@@ -0,0 +1,157 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/*
+ * Times matching key presses against a menubar's key equivalents,
+ * the way global_event_filter_func() does: by searching every item,
+ * which is what -[NSMenu performKeyEquivalent:] on the menubar
+ * amounts to, and with the key equivalent index. The key presses are
+ * mostly plain typing with the odd command-key chord mixed in, and
+ * each one's time goes into a latency histogram like the key_latency
+ * one in GtkOSXApplicationMenuStats.
+ *
+ * Output is one line per scenario of whitespace-separated key=value
+ * pairs; the histogram is a comma-separated list of bucket counts.
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include "menu_keyindex.h"
+#include "menu_stats.h"
+
+static gint n_items = 3000;
+static gint n_keys = 100000;
+
+static GOptionEntry entries[] = {
+  { "items", 'i', 0, G_OPTION_ARG_INT, &n_items,
+    "Number of menu items", "N" },
+  { "keys", 'k', 0, G_OPTION_ARG_INT, &n_keys,
+    "Number of key presses", "N" },
+  { NULL }
+};
+
+/* A stand-in for a native menu item */
+typedef struct {
+  gunichar key;
+  guint modifiers;
+} Item;
+
+static const guint modifiers[] = {
+  MENU_KEY_COMMAND,
+  MENU_KEY_COMMAND | MENU_KEY_OPTION,
+  MENU_KEY_COMMAND | MENU_KEY_CONTROL,
+  MENU_KEY_CONTROL,
+  MENU_KEY_OPTION | MENU_KEY_CONTROL,
+  MENU_KEY_COMMAND | MENU_KEY_OPTION | MENU_KEY_CONTROL
+};
+
+static const gchar keys[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+
+/* Only the first few hundred items get an accelerator; there aren't
+   enough keys to go round. */
+static Item *
+build_items (void)
+{
+  Item *items = g_new0 (Item, n_items);
+  guint n_chars = sizeof (keys) - 1;
+  gint i;
+
+  for (i = 0; i < n_items && i < n_chars * G_N_ELEMENTS (modifiers); i++) {
+    items[i].key = keys[i % n_chars];
+    items[i].modifiers = modifiers[i / n_chars];
+    menu_key_index_set (&items[i], items[i].key, items[i].modifiers);
+  }
+  return items;
+}
+
+static gboolean
+scan (Item *items, gunichar key, guint mods)
+{
+  gint i;
+
+  for (i = 0; i < n_items; i++)
+    if (items[i].key == key && items[i].modifiers == mods)
+      return TRUE;
+  return FALSE;
+}
+
+static void
+run (const gchar *scenario, Item *items, gboolean indexed)
+{
+  guint64 histogram[GTK_OSX_APPLICATION_LATENCY_BUCKETS] = { 0 };
+  GRand *rand = g_rand_new_with_seed (42);
+  guint64 total = 0;
+  guint hits = 0;
+  gint i, bucket;
+
+  for (i = 0; i < n_keys; i++) {
+    gunichar key = keys[g_rand_int_range (rand, 0, sizeof (keys) - 1)];
+    guint mods = 0;
+    guint64 start, elapsed;
+    gboolean hit;
+
+    /* One key press in fifty is a chord */
+    if (g_rand_int_range (rand, 0, 50) == 0)
+      mods = modifiers[g_rand_int_range (rand, 0, G_N_ELEMENTS (modifiers))];
+
+    start = menu_stats_now_ns ();
+    if (indexed)
+      hit = menu_key_index_lookup (key, mods) != NULL;
+    else
+      hit = scan (items, key, mods);
+    elapsed = menu_stats_now_ns () - start;
+
+    hits += hit;
+    total += elapsed;
+    menu_stats_record_latency (histogram, elapsed);
+  }
+
+  printf ("scenario=%s items=%d keys=%d hits=%u ns_per_key=%.1f histogram=",
+	  scenario, n_items, n_keys, hits, (gdouble) total / n_keys);
+  for (bucket = 0; bucket < GTK_OSX_APPLICATION_LATENCY_BUCKETS; bucket++)
+    printf ("%s%" G_GUINT64_FORMAT, bucket ? "," : "", histogram[bucket]);
+  printf ("\n");
+  g_rand_free (rand);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  Item *items;
+
+  context = g_option_context_new ("- benchmark matching key presses to menu items");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+
+  items = build_items ();
+  run ("menubar-search", items, FALSE);
+  run ("key-index", items, TRUE);
+  g_free (items);
+  return 0;
+}
@@ -0,0 +1,702 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/*
+ * Checks the generated key equivalent tables against the switch
+ * statements that cocoa_menu_item.c used before them, then times the
+ * two. Every keyval below 0x10000 and every Unicode keyval in the
+ * Basic Multilingual Plane is checked: wherever the switches found a
+ * key equivalent the tables must give the same one with the same
+ * modifiers. Keys the switches couldn't map and the tables can are
+ * counted as "extended".
+ *
+ * Output is one line for the check and one per timed scenario, of
+ * whitespace-separated key=value pairs. The exit status is 1 if
+ * anything didn't match.
+ */
+
+#include <gtk/gtk.h>
+#if GTK_CHECK_VERSION(2,90,7)
+#include <gdk/gdkkeysyms-compat.h>
+#else
+#include <gdk/gdkkeysyms.h>
+#endif
+#include <stdio.h>
+#include "menu_keymap.h"
+
+static gint n_rounds = 20;
+
+static GOptionEntry entries[] = {
+  { "rounds", 'r', 0, G_OPTION_ARG_INT, &n_rounds,
+    "Number of passes over the keyvals to time", "N" },
+  { NULL }
+};
+
+/* Cocoa's values, which NSEvent.h would give the switches */
+#define NSBackspaceCharacter 0x0008
+#define NSUpArrowFunctionKey 0xf700
+#define NSDownArrowFunctionKey 0xf701
+#define NSLeftArrowFunctionKey 0xf702
+#define NSRightArrowFunctionKey 0xf703
+#define NSInsertFunctionKey 0xf727
+#define NSDeleteFunctionKey 0xf728
+#define NSHomeFunctionKey 0xf729
+#define NSBeginFunctionKey 0xf72a
+#define NSEndFunctionKey 0xf72b
+#define NSPageUpFunctionKey 0xf72c
+#define NSPageDownFunctionKey 0xf72d
+#define NSScrollLockFunctionKey 0xf72f
+#define NSPauseFunctionKey 0xf730
+#define NSSysReqFunctionKey 0xf731
+#define NSBreakFunctionKey 0xf732
+#define NSMenuFunctionKey 0xf735
+#define NSPrintFunctionKey 0xf738
+#define NSSelectFunctionKey 0xf741
+#define NSExecuteFunctionKey 0xf742
+#define NSUndoFunctionKey 0xf743
+#define NSRedoFunctionKey 0xf744
+#define NSFindFunctionKey 0xf745
+#define NSHelpFunctionKey 0xf746
+#define NSModeSwitchFunctionKey 0xf747
+#define NSF1FunctionKey 0xf704
+#define NSF2FunctionKey (NSF1FunctionKey + 1)
+#define NSF3FunctionKey (NSF1FunctionKey + 2)
+#define NSF4FunctionKey (NSF1FunctionKey + 3)
+#define NSF5FunctionKey (NSF1FunctionKey + 4)
+#define NSF6FunctionKey (NSF1FunctionKey + 5)
+#define NSF7FunctionKey (NSF1FunctionKey + 6)
+#define NSF8FunctionKey (NSF1FunctionKey + 7)
+#define NSF9FunctionKey (NSF1FunctionKey + 8)
+#define NSF10FunctionKey (NSF1FunctionKey + 9)
+#define NSF11FunctionKey (NSF1FunctionKey + 10)
+#define NSF12FunctionKey (NSF1FunctionKey + 11)
+#define NSF13FunctionKey (NSF1FunctionKey + 12)
+#define NSF14FunctionKey (NSF1FunctionKey + 13)
+#define NSF15FunctionKey (NSF1FunctionKey + 14)
+#define NSF16FunctionKey (NSF1FunctionKey + 15)
+#define NSF17FunctionKey (NSF1FunctionKey + 16)
+#define NSF18FunctionKey (NSF1FunctionKey + 17)
+#define NSF19FunctionKey (NSF1FunctionKey + 18)
+#define NSF20FunctionKey (NSF1FunctionKey + 19)
+#define NSF21FunctionKey (NSF1FunctionKey + 20)
+#define NSF22FunctionKey (NSF1FunctionKey + 21)
+#define NSF23FunctionKey (NSF1FunctionKey + 22)
+#define NSF24FunctionKey (NSF1FunctionKey + 23)
+#define NSF25FunctionKey (NSF1FunctionKey + 24)
+#define NSF26FunctionKey (NSF1FunctionKey + 25)
+#define NSF27FunctionKey (NSF1FunctionKey + 26)
+#define NSF28FunctionKey (NSF1FunctionKey + 27)
+#define NSF29FunctionKey (NSF1FunctionKey + 28)
+#define NSF30FunctionKey (NSF1FunctionKey + 29)
+#define NSF31FunctionKey (NSF1FunctionKey + 30)
+#define NSF32FunctionKey (NSF1FunctionKey + 31)
+#define NSF33FunctionKey (NSF1FunctionKey + 32)
+#define NSF34FunctionKey (NSF1FunctionKey + 33)
+#define NSF35FunctionKey (NSF1FunctionKey + 34)
+
+/*
+ * The switches, as they were in cocoa_menu_item.c
+ */
+
+static guint
+gdk_quartz_keyval_to_ns_keyval (guint keyval)
+{
+  switch (keyval) {
+  case GDK_BackSpace:
+    return NSBackspaceCharacter;
+  case GDK_Delete:
+    return NSDeleteFunctionKey;
+  case GDK_Pause:
+    return NSPauseFunctionKey;
+  case GDK_Scroll_Lock:
+    return NSScrollLockFunctionKey;
+  case GDK_Sys_Req:
+    return NSSysReqFunctionKey;
+  case GDK_Home:
+    return NSHomeFunctionKey;
+  case GDK_Left:
+  case GDK_leftarrow:
+    return NSLeftArrowFunctionKey;
+  case GDK_Up:
+  case GDK_uparrow:
+    return NSUpArrowFunctionKey;
+  case GDK_Right:
+  case GDK_rightarrow:
+    return NSRightArrowFunctionKey;
+  case GDK_Down:
+  case GDK_downarrow:
+    return NSDownArrowFunctionKey;
+  case GDK_Page_Up:
+    return NSPageUpFunctionKey;
+  case GDK_Page_Down:
+    return NSPageDownFunctionKey;
+  case GDK_End:
+    return NSEndFunctionKey;
+  case GDK_Begin:
+    return NSBeginFunctionKey;
+  case GDK_Select:
+    return NSSelectFunctionKey;
+  case GDK_Print:
+    return NSPrintFunctionKey;
+  case GDK_Execute:
+    return NSExecuteFunctionKey;
+  case GDK_Insert:
+    return NSInsertFunctionKey;
+  case GDK_Undo:
+    return NSUndoFunctionKey;
+  case GDK_Redo:
+    return NSRedoFunctionKey;
+  case GDK_Menu:
+    return NSMenuFunctionKey;
+  case GDK_Find:
+    return NSFindFunctionKey;
+  case GDK_Help:
+    return NSHelpFunctionKey;
+  case GDK_Break:
+    return NSBreakFunctionKey;
+  case GDK_Mode_switch:
+    return NSModeSwitchFunctionKey;
+  case GDK_F1:
+    return NSF1FunctionKey;
+  case GDK_F2:
+    return NSF2FunctionKey;
+  case GDK_F3:
+    return NSF3FunctionKey;
+  case GDK_F4:
+    return NSF4FunctionKey;
+  case GDK_F5:
+    return NSF5FunctionKey;
+  case GDK_F6:
+    return NSF6FunctionKey;
+  case GDK_F7:
+    return NSF7FunctionKey;
+  case GDK_F8:
+    return NSF8FunctionKey;
+  case GDK_F9:
+    return NSF9FunctionKey;
+  case GDK_F10:
+    return NSF10FunctionKey;
+  case GDK_F11:
+    return NSF11FunctionKey;
+  case GDK_F12:
+    return NSF12FunctionKey;
+  case GDK_F13:
+    return NSF13FunctionKey;
+  case GDK_F14:
+    return NSF14FunctionKey;
+  case GDK_F15:
+    return NSF15FunctionKey;
+  case GDK_F16:
+    return NSF16FunctionKey;
+  case GDK_F17:
+    return NSF17FunctionKey;
+  case GDK_F18:
+    return NSF18FunctionKey;
+  case GDK_F19:
+    return NSF19FunctionKey;
+  case GDK_F20:
+    return NSF20FunctionKey;
+  case GDK_F21:
+    return NSF21FunctionKey;
+  case GDK_F22:
+    return NSF22FunctionKey;
+  case GDK_F23:
+    return NSF23FunctionKey;
+  case GDK_F24:
+    return NSF24FunctionKey;
+  case GDK_F25:
+    return NSF25FunctionKey;
+  case GDK_F26:
+    return NSF26FunctionKey;
+  case GDK_F27:
+    return NSF27FunctionKey;
+  case GDK_F28:
+    return NSF28FunctionKey;
+  case GDK_F29:
+    return NSF29FunctionKey;
+  case GDK_F30:
+    return NSF30FunctionKey;
+  case GDK_F31:
+    return NSF31FunctionKey;
+  case GDK_F32:
+    return NSF32FunctionKey;
+  case GDK_F33:
+    return NSF33FunctionKey;
+  case GDK_F34:
+    return NSF34FunctionKey;
+  case GDK_F35:
+    return NSF35FunctionKey;
+  default:
+    break;
+  }
+
+  return 0;
+}
+
+static gboolean
+keyval_is_keypad (guint keyval)
+{
+  switch (keyval) {
+  case GDK_KP_F1:
+  case GDK_KP_F2:
+  case GDK_KP_F3:
+  case GDK_KP_F4:
+  case GDK_KP_Home:
+  case GDK_KP_Left:
+  case GDK_KP_Up:
+  case GDK_KP_Right:
+  case GDK_KP_Down:
+  case GDK_KP_Page_Up:
+  case GDK_KP_Page_Down:
+  case GDK_KP_End:
+  case GDK_KP_Begin:
+  case GDK_KP_Insert:
+  case GDK_KP_Delete:
+  case GDK_KP_Equal:
+  case GDK_KP_Multiply:
+  case GDK_KP_Add:
+  case GDK_KP_Separator:
+  case GDK_KP_Subtract:
+  case GDK_KP_Decimal:
+  case GDK_KP_Divide:
+  case GDK_KP_0:
+  case GDK_KP_1:
+  case GDK_KP_2:
+  case GDK_KP_3:
+  case GDK_KP_4:
+  case GDK_KP_5:
+  case GDK_KP_6:
+  case GDK_KP_7:
+  case GDK_KP_8:
+  case GDK_KP_9:
+    return TRUE;
+    break;
+  default:
+    break;
+  }
+  return FALSE;
+}
+
+static guint
+keyval_keypad_nonkeypad_equivalent (guint keyval)
+{
+  switch (keyval) {
+  case GDK_KP_F1:
+    return GDK_F1;
+  case GDK_KP_F2:
+    return GDK_F2;
+  case GDK_KP_F3:
+    return GDK_F3;
+  case GDK_KP_F4:
+    return GDK_F4;
+  case GDK_KP_Home:
+    return GDK_Home;
+  case GDK_KP_Left:
+    return GDK_Left;
+  case GDK_KP_Up:
+    return GDK_Up;
+  case GDK_KP_Right:
+    return GDK_Right;
+  case GDK_KP_Down:
+    return GDK_Down;
+  case GDK_KP_Page_Up:
+    return GDK_Page_Up;
+  case GDK_KP_Page_Down:
+    return GDK_Page_Down;
+  case GDK_KP_End:
+    return GDK_End;
+  case GDK_KP_Begin:
+    return GDK_Begin;
+  case GDK_KP_Insert:
+    return GDK_Insert;
+  case GDK_KP_Delete:
+    return GDK_Delete;
+  case GDK_KP_Equal:
+    return GDK_equal;
+  case GDK_KP_Multiply:
+    return GDK_asterisk;
+  case GDK_KP_Add:
+    return GDK_plus;
+  case GDK_KP_Subtract:
+    return GDK_minus;
+  case GDK_KP_Decimal:
+    return GDK_period;
+  case GDK_KP_Divide:
+    return GDK_slash;
+  case GDK_KP_0:
+    return GDK_0;
+  case GDK_KP_1:
+    return GDK_1;
+  case GDK_KP_2:
+    return GDK_2;
+  case GDK_KP_3:
+    return GDK_3;
+  case GDK_KP_4:
+    return GDK_4;
+  case GDK_KP_5:
+    return GDK_5;
+  case GDK_KP_6:
+    return GDK_6;
+  case GDK_KP_7:
+    return GDK_7;
+  case GDK_KP_8:
+    return GDK_8;
+  case GDK_KP_9:
+    return GDK_9;
+  default:
+    break;
+  }
+
+  return GDK_VoidSymbol;
+}
+
+static const gchar* 
+gdk_quartz_keyval_to_string (guint keyval)
+{
+  switch (keyval) {
+  case GDK_space:
+    return " ";
+  case GDK_exclam:
+    return "!";
+  case GDK_quotedbl:
+    return "\"";
+  case GDK_numbersign:
+    return "#";
+  case GDK_dollar:
+    return "$";
+  case GDK_percent:
+    return "%";
+  case GDK_ampersand:
+    return "&";
+  case GDK_apostrophe:
+    return "'";
+  case GDK_parenleft:
+    return "(";
+  case GDK_parenright:
+    return ")";
+  case GDK_asterisk:
+    return "*";
+  case GDK_plus:
+    return "+";
+  case GDK_comma:
+    return ",";
+  case GDK_minus:
+    return "-";
+  case GDK_period:
+    return ".";
+  case GDK_slash:
+    return "/";
+  case GDK_0:
+    return "0";
+  case GDK_1:
+    return "1";
+  case GDK_2:
+    return "2";
+  case GDK_3:
+    return "3";
+  case GDK_4:
+    return "4";
+  case GDK_5:
+    return "5";
+  case GDK_6:
+    return "6";
+  case GDK_7:
+    return "7";
+  case GDK_8:
+    return "8";
+  case GDK_9:
+    return "9";
+  case GDK_colon:
+    return ":";
+  case GDK_semicolon:
+    return ";";
+  case GDK_less:
+    return "<";
+  case GDK_equal:
+    return "=";
+  case GDK_greater:
+    return ">";
+  case GDK_question:
+    return "?";
+  case GDK_at:
+    return "@";
+  case GDK_A:
+  case GDK_a:
+    return "a";
+  case GDK_B:
+  case GDK_b:
+    return "b";
+  case GDK_C:
+  case GDK_c:
+    return "c";
+  case GDK_D:
+  case GDK_d:
+    return "d";
+  case GDK_E:
+  case GDK_e:
+    return "e";
+  case GDK_F:
+  case GDK_f:
+    return "f";
+  case GDK_G:
+  case GDK_g:
+    return "g";
+  case GDK_H:
+  case GDK_h:
+    return "h";
+  case GDK_I:
+  case GDK_i:
+    return "i";
+  case GDK_J:
+  case GDK_j:
+    return "j";
+  case GDK_K:
+  case GDK_k:
+    return "k";
+  case GDK_L:
+  case GDK_l:
+    return "l";
+  case GDK_M:
+  case GDK_m:
+    return "m";
+  case GDK_N:
+  case GDK_n:
+    return "n";
+  case GDK_O:
+  case GDK_o:
+    return "o";
+  case GDK_P:
+  case GDK_p:
+    return "p";
+  case GDK_Q:
+  case GDK_q:
+    return "q";
+  case GDK_R:
+  case GDK_r:
+    return "r";
+  case GDK_S:
+  case GDK_s:
+    return "s";
+  case GDK_T:
+  case GDK_t:
+    return "t";
+  case GDK_U:
+  case GDK_u:
+    return "u";
+  case GDK_V:
+  case GDK_v:
+    return "v";
+  case GDK_W:
+  case GDK_w:
+    return "w";
+  case GDK_X:
+  case GDK_x:
+    return "x";
+  case GDK_Y:
+  case GDK_y:
+    return "y";
+  case GDK_Z:
+  case GDK_z:
+    return "z";
+  case GDK_bracketleft:
+    return "[";
+  case GDK_backslash:
+    return "\\";
+  case GDK_bracketright:
+    return "]";
+  case GDK_asciicircum:
+    return "^";
+  case GDK_underscore:
+    return "_";
+  case GDK_grave:
+    return "`";
+  case GDK_braceleft:
+    return "{";
+  case GDK_bar:
+    return "|";
+  case GDK_braceright:
+    return "}";
+  case GDK_asciitilde:
+    return "~";
+  default:
+    break;
+  }
+  return NULL;
+}
+
+static gboolean
+keyval_is_uppercase (guint keyval)
+{
+  switch (keyval) {
+  case GDK_A:
+  case GDK_B:
+  case GDK_C:
+  case GDK_D:
+  case GDK_E:
+  case GDK_F:
+  case GDK_G:
+  case GDK_H:
+  case GDK_I:
+  case GDK_J:
+  case GDK_K:
+  case GDK_L:
+  case GDK_M:
+  case GDK_N:
+  case GDK_O:
+  case GDK_P:
+  case GDK_Q:
+  case GDK_R:
+  case GDK_S:
+  case GDK_T:
+  case GDK_U:
+  case GDK_V:
+  case GDK_W:
+  case GDK_X:
+  case GDK_Y:
+  case GDK_Z:
+    return TRUE;
+  default:
+    return FALSE;
+  }
+  return FALSE;
+}
+
+/* What cocoa_menu_item_update_accelerator() made of the switches */
+static MenuKeymapEntry
+switch_lookup (guint keyval)
+{
+  MenuKeymapEntry entry = { 0, 0 };
+  const gchar *str;
+
+  if (keyval_is_keypad (keyval)) {
+    entry.flags |= MENU_KEYMAP_KEYPAD;
+    if ((keyval = keyval_keypad_nonkeypad_equivalent (keyval)) == GDK_VoidSymbol)
+      return entry;
+  }
+  if (keyval_is_uppercase (keyval))
+    entry.flags |= MENU_KEYMAP_SHIFT;
+  str = gdk_quartz_keyval_to_string (keyval);
+  if (str)
+    entry.key_equivalent = str[0];
+  else
+    entry.key_equivalent = gdk_quartz_keyval_to_ns_keyval (keyval);
+  return entry;
+}
+
+static gboolean
+check (void)
+{
+  guint keyval, checked = 0, mapped = 0, extended = 0, mismatches = 0;
+
+  for (keyval = 0; keyval < 0x01010000; keyval++) {
+    MenuKeymapEntry expected, entry;
+
+    if (keyval == 0x10000)
+      keyval = 0x01000000;
+    expected = switch_lookup (keyval);
+    entry = menu_keymap_lookup (keyval);
+    ++checked;
+    if (expected.key_equivalent == 0) {
+      if (entry.key_equivalent != 0)
+	++extended;
+      continue;
+    }
+    ++mapped;
+    if (entry.key_equivalent != expected.key_equivalent ||
+	entry.flags != expected.flags) {
+      if (mismatches++ < 10)
+	g_printerr ("keyval 0x%x (%s): expected 0x%04x/%u, got 0x%04x/%u\n",
+		    keyval, gdk_keyval_name (keyval),
+		    expected.key_equivalent, expected.flags,
+		    entry.key_equivalent, entry.flags);
+    }
+  }
+
+  printf ("check=%s keyvals=%u mapped=%u extended=%u mismatches=%u\n",
+	  mismatches ? "fail" : "pass", checked, mapped, extended, mismatches);
+  return mismatches == 0;
+}
+
+static void
+run (const gchar *workload, const guint *keyvals, guint n_keyvals)
+{
+  GTimer *timer = g_timer_new ();
+  gdouble switch_ns, table_ns;
+  guint sum = 0, round, i;
+
+  g_timer_start (timer);
+  for (round = 0; round < n_rounds; round++)
+    for (i = 0; i < n_keyvals; i++)
+      sum += switch_lookup (keyvals[i]).key_equivalent;
+  g_timer_stop (timer);
+  switch_ns = g_timer_elapsed (timer, NULL) * 1e9 / n_rounds / n_keyvals;
+
+  g_timer_start (timer);
+  for (round = 0; round < n_rounds; round++)
+    for (i = 0; i < n_keyvals; i++)
+      sum += menu_keymap_lookup (keyvals[i]).key_equivalent;
+  g_timer_stop (timer);
+  table_ns = g_timer_elapsed (timer, NULL) * 1e9 / n_rounds / n_keyvals;
+
+  /* sum is printed so the lookups can't be optimized away */
+  printf ("workload=%s keyvals=%u switch_ns_per_lookup=%.2f"
+	  " table_ns_per_lookup=%.2f speedup=%.1f checksum=%u\n",
+	  workload, n_keyvals, switch_ns, table_ns,
+	  table_ns > 0 ? switch_ns / table_ns : 0.0, sum);
+  g_timer_destroy (timer);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GArray *accels;
+  guint *all, keyval;
+  gboolean ok;
+
+  context = g_option_context_new ("- check and benchmark the key equivalent tables");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+
+  ok = check ();
+
+  /* The keys that accelerators actually use, and then everything */
+  accels = g_array_new (FALSE, FALSE, sizeof (guint));
+  all = g_new (guint, 0x10000);
+  for (keyval = 0; keyval < 0x10000; keyval++) {
+    all[keyval] = keyval;
+    if (switch_lookup (keyval).key_equivalent)
+      g_array_append_val (accels, keyval);
+  }
+  run ("accel-keys", (guint *) accels->data, accels->len);
+  run ("all-keyvals", all, 0x10000);
+
+  g_array_free (accels, TRUE);
+  g_free (all);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,285 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Reconciles a menu of --items items with a changed copy of itself,
+ * both with menu_diff (menu_diff_compute() and menu_diff_apply() on
+ * the GPtrArray stand-in, menu_diff_array_funcs) and with the mark
+ * and sweep cocoa_menu_item_add_submenu() used to do: mark every
+ * item, walk the wanted items putting each one where it belongs,
+ * found with a linear search as -[NSMenu indexOfItem:] does, and
+ * sweep out whatever is still marked. The changes are:
+ *
+ *   unchanged	nothing, which is what most resyncs see
+ *   insert	--changes new items put in at random
+ *   remove	--changes items taken out at random
+ *   move	--changes items moved to random places
+ *   reverse	the whole menu turned round
+ *
+ * Each result is checked against the wanted order. Output is one
+ * line per scenario and algorithm of whitespace-separated key=value
+ * pairs; edits counts the removes and inserts made on the menu.
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <string.h>
+#include "menu_diff.h"
+
+static gint n_items = 4000;
+static gint n_changes = 20;
+static gint n_rounds = 20;
+
+static GOptionEntry entries[] = {
+  { "items", 'i', 0, G_OPTION_ARG_INT, &n_items,
+    "Number of items in the menu", "N" },
+  { "changes", 'c', 0, G_OPTION_ARG_INT, &n_changes,
+    "Number of items inserted, removed or moved", "N" },
+  { "rounds", 'r', 0, G_OPTION_ARG_INT, &n_rounds,
+    "Number of times to reconcile each change", "N" },
+  { NULL }
+};
+
+typedef enum {
+  CHANGE_UNCHANGED,
+  CHANGE_INSERT,
+  CHANGE_REMOVE,
+  CHANGE_MOVE,
+  CHANGE_REVERSE,
+  N_CHANGES
+} Change;
+
+static const gchar *change_names[N_CHANGES] = {
+  "unchanged", "insert", "remove", "move", "reverse"
+};
+
+/* Keys are just distinct numbers; 0 would be NULL */
+#define KEY(n) GUINT_TO_POINTER ((n) + 1)
+
+static GPtrArray *
+menu_new (void)
+{
+  GPtrArray *menu = g_ptr_array_sized_new (n_items);
+  gint i;
+
+  for (i = 0; i < n_items; i++)
+    g_ptr_array_add (menu, KEY (i));
+  return menu;
+}
+
+static GPtrArray *
+menu_copy (GPtrArray *menu)
+{
+  GPtrArray *copy = g_ptr_array_sized_new (menu->len);
+  guint i;
+
+  for (i = 0; i < menu->len; i++)
+    g_ptr_array_add (copy, g_ptr_array_index (menu, i));
+  return copy;
+}
+
+/* What the menu ought to look like after @change */
+static GPtrArray *
+wanted_new (GPtrArray *menu, Change change, GRand *rand)
+{
+  GPtrArray *wanted = menu_copy (menu);
+  guint next_key = menu->len;
+  gint i;
+
+  for (i = 0; i < n_changes && wanted->len > 0; i++) {
+    guint from = g_rand_int_range (rand, 0, wanted->len);
+    guint to = g_rand_int_range (rand, 0, wanted->len);
+    gpointer key;
+
+    switch (change) {
+    case CHANGE_INSERT:
+      menu_diff_array_funcs.insert (wanted, KEY (next_key++), to, FALSE);
+      break;
+    case CHANGE_REMOVE:
+      g_ptr_array_remove_index (wanted, from);
+      break;
+    case CHANGE_MOVE:
+      key = g_ptr_array_index (wanted, from);
+      g_ptr_array_remove_index (wanted, from);
+      menu_diff_array_funcs.insert (wanted, key, MIN (to, wanted->len),
+				    FALSE);
+      break;
+    default:
+      i = n_changes;
+      break;
+    }
+  }
+  if (change == CHANGE_REVERSE)
+    for (i = 0; i < (gint) wanted->len / 2; i++) {
+      gpointer key = g_ptr_array_index (wanted, i);
+
+      wanted->pdata[i] = wanted->pdata[wanted->len - 1 - i];
+      wanted->pdata[wanted->len - 1 - i] = key;
+    }
+  return wanted;
+}
+
+/* -[NSMenu indexOfItem:] */
+static gint
+index_of (GPtrArray *menu, gpointer key)
+{
+  guint i;
+
+  for (i = 0; i < menu->len; i++)
+    if (g_ptr_array_index (menu, i) == key)
+      return i;
+  return -1;
+}
+
+/*
+ * The old reconciliation, on the stand-in menu. Returns the number of
+ * removes and inserts it made.
+ */
+static guint
+mark_and_sweep (GPtrArray *menu, GPtrArray *wanted)
+{
+  GHashTable *marked = g_hash_table_new (NULL, NULL);
+  guint index = 0, edits = 0, i;
+
+  for (i = 0; i < menu->len; i++)
+    g_hash_table_insert (marked, g_ptr_array_index (menu, i), NULL);
+  for (i = 0; i < wanted->len; i++) {
+    gpointer key = g_ptr_array_index (wanted, i);
+    gint loc;
+
+    if (index < menu->len && g_ptr_array_index (menu, index) == key) {
+      g_hash_table_remove (marked, key);
+      ++index;
+      continue;
+    }
+    if ((loc = index_of (menu, key)) > -1) {
+      menu_diff_array_funcs.remove (menu, key, loc, TRUE);
+      menu_diff_array_funcs.insert (menu, key, index++, TRUE);
+      g_hash_table_remove (marked, key);
+      edits += 2;
+      continue;
+    }
+    menu_diff_array_funcs.insert (menu, key, index++, FALSE);
+    edits++;
+  }
+  for (index = 0; index < menu->len; )
+    if (g_hash_table_lookup_extended (marked, g_ptr_array_index (menu, index),
+				      NULL, NULL)) {
+      menu_diff_array_funcs.remove (menu, g_ptr_array_index (menu, index),
+				    index, FALSE);
+      edits++;
+    }
+    else
+      index++;
+  g_hash_table_destroy (marked);
+  return edits;
+}
+
+/* menu_diff, as menu_sync_reconcile() uses it */
+static guint
+diff (GPtrArray *menu, GPtrArray *wanted)
+{
+  GArray *script = menu_diff_compute (menu->pdata, menu->len,
+				      wanted->pdata, wanted->len);
+  guint edits = script->len;
+
+  menu_diff_apply (script, &menu_diff_array_funcs, menu);
+  g_array_free (script, TRUE);
+  return edits;
+}
+
+static gboolean
+same (GPtrArray *a, GPtrArray *b)
+{
+  return (a->len == b->len &&
+	  memcmp (a->pdata, b->pdata, a->len * sizeof (gpointer)) == 0);
+}
+
+static gboolean
+run (Change change, gboolean use_diff, GRand *rand)
+{
+  GPtrArray *original = menu_new ();
+  GPtrArray *wanted = wanted_new (original, change, rand);
+  GTimer *timer = g_timer_new ();
+  gdouble elapsed = 0;
+  guint edits = 0;
+  gboolean ok = TRUE;
+  gint round;
+
+  for (round = 0; round < n_rounds && ok; round++) {
+    GPtrArray *menu = menu_copy (original);
+
+    g_timer_start (timer);
+    edits = use_diff ? diff (menu, wanted) : mark_and_sweep (menu, wanted);
+    g_timer_stop (timer);
+    elapsed += g_timer_elapsed (timer, NULL);
+    ok = same (menu, wanted);
+    g_ptr_array_free (menu, TRUE);
+  }
+
+  if (ok)
+    printf ("scenario=%s algorithm=%s items=%d changes=%d edits=%u"
+	    " us_per_reconcile=%.1f\n",
+	    change_names[change], use_diff ? "diff" : "mark-and-sweep",
+	    n_items, change == CHANGE_UNCHANGED || change == CHANGE_REVERSE ?
+	    0 : n_changes, edits, elapsed * 1e6 / n_rounds);
+  else
+    g_printerr ("%s: %s left the menu in the wrong order\n",
+		change_names[change], use_diff ? "diff" : "mark-and-sweep");
+
+  g_timer_destroy (timer);
+  g_ptr_array_free (wanted, TRUE);
+  g_ptr_array_free (original, TRUE);
+  return ok;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  gboolean ok = TRUE;
+  Change change;
+
+  context = g_option_context_new ("- compare menu_diff with mark and sweep");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+  if (n_items < 1 || n_changes < 0 || n_rounds < 1) {
+    g_printerr ("--items and --rounds must be positive, and --changes "
+		"not negative\n");
+    return 1;
+  }
+
+  for (change = 0; change < N_CHANGES; change++) {
+    /* The same change for both */
+    GRand *rand = g_rand_new_with_seed (change);
+
+    ok = run (change, FALSE, rand) && ok;
+    g_rand_set_seed (rand, change);
+    ok = run (change, TRUE, rand) && ok;
+    g_rand_free (rand);
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,207 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/*
+ * Counts what finding the menu item labels costs a full menubar sync,
+ * which looks up each item's label about four times: from add_item,
+ * update_label, update_accelerator and update_submenu. That's done
+ * with the uncached container walk get_menu_label_text() used to
+ * make and with the cached lookup, reporting the time and the list
+ * links and cache records allocated per sync. Half of the items pack
+ * their label in a box beside an image, the way a hand-built item
+ * does, so the walk has two levels to go through.
+ *
+ * Output is one line per scenario of whitespace-separated key=value
+ * pairs.
+ */
+
+#include <gtk/gtk.h>
+#include <stdio.h>
+#include "getlabel.h"
+#include "menu_stats.h"
+
+#define ITEMS_PER_MENU 50
+#define LOOKUPS_PER_ITEM 4
+
+static gint n_items = 5000;
+static gint n_rounds = 10;
+static guint64 walk_allocs = 0;
+
+static GOptionEntry entries[] = {
+  { "items", 'i', 0, G_OPTION_ARG_INT, &n_items,
+    "Number of menu items", "N" },
+  { "rounds", 'r', 0, G_OPTION_ARG_INT, &n_rounds,
+    "Number of syncs to time", "N" },
+  { NULL }
+};
+
+/* What get_menu_label_text() used to do every time */
+static GtkWidget *
+uncached_find_label (GtkWidget *widget)
+{
+  GtkWidget *label = NULL;
+
+  if (GTK_IS_LABEL (widget))
+    return widget;
+
+  if (GTK_IS_CONTAINER (widget)) {
+    GList *children = gtk_container_get_children (GTK_CONTAINER (widget));
+    GList *l;
+
+    walk_allocs += g_list_length (children);
+    for (l = children; l; l = l->next) {
+      label = uncached_find_label ((GtkWidget*) l->data);
+      if (label)
+	break;
+    }
+    g_list_free (children);
+  }
+  return label;
+}
+
+static GtkWidget *
+box_new (void)
+{
+#if GTK_CHECK_VERSION(2,90,7)
+  return gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 0);
+#else
+  return gtk_hbox_new (FALSE, 0);
+#endif
+}
+
+static GtkWidget *
+build_menubar (gint n)
+{
+  GtkWidget *menubar = g_object_ref_sink (gtk_menu_bar_new ());
+  GtkWidget *menu = NULL;
+  gint i;
+
+  for (i = 0; i < n; i++) {
+    GtkWidget *item;
+
+    if (i % ITEMS_PER_MENU == 0) {
+      GtkWidget *top = gtk_menu_item_new_with_label ("Menu");
+      menu = gtk_menu_new ();
+      gtk_menu_item_set_submenu (GTK_MENU_ITEM (top), menu);
+      gtk_menu_shell_append (GTK_MENU_SHELL (menubar), top);
+    }
+    if (i % 2) {
+      GtkWidget *box = box_new ();
+      item = gtk_menu_item_new ();
+      gtk_box_pack_start (GTK_BOX (box), gtk_image_new (), FALSE, FALSE, 0);
+      gtk_box_pack_start (GTK_BOX (box), gtk_label_new ("Item"),
+			  TRUE, TRUE, 0);
+      gtk_container_add (GTK_CONTAINER (item), box);
+    }
+    else
+      item = gtk_menu_item_new_with_label ("Item");
+    gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+  }
+  return menubar;
+}
+
+/* Look up the label of every item below @shell, the way a sync does */
+static guint
+sync_labels (GtkWidget *shell, gboolean cached)
+{
+  GList *children = gtk_container_get_children (GTK_CONTAINER (shell));
+  GList *l;
+  guint found = 0;
+
+  for (l = children; l; l = l->next) {
+    GtkWidget *item = (GtkWidget*) l->data;
+    GtkWidget *submenu = gtk_menu_item_get_submenu (GTK_MENU_ITEM (item));
+    GtkWidget *label = NULL;
+    gint i;
+
+    for (i = 0; i < LOOKUPS_PER_ITEM; i++)
+      if (cached)
+	get_menu_label_text (item, &label);
+      else
+	label = uncached_find_label (item);
+    if (label)
+      ++found;
+    if (submenu)
+      found += sync_labels (submenu, cached);
+  }
+  g_list_free (children);
+  return found;
+}
+
+static void
+run (gboolean cached)
+{
+  GtkWidget *menubar = build_menubar (n_items);
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  GTimer *timer = g_timer_new ();
+  guint64 first_allocs;
+  guint found;
+  gint round;
+
+  menu_stats_reset ();
+  walk_allocs = 0;
+  found = sync_labels (menubar, cached);
+  first_allocs = cached ? stats->label_walk_allocs : walk_allocs;
+
+  menu_stats_reset ();
+  walk_allocs = 0;
+  g_timer_start (timer);
+  for (round = 0; round < n_rounds; round++)
+    sync_labels (menubar, cached);
+  g_timer_stop (timer);
+
+  printf ("scenario=%s items=%d found=%u first_sync_allocs=%" G_GUINT64_FORMAT
+	  " allocs_per_sync=%.1f walks_per_sync=%.1f ns_per_sync=%.0f"
+	  " ns_per_lookup=%.1f\n",
+	  cached ? "cached" : "walk", n_items, found, first_allocs,
+	  (double) (cached ? stats->label_walk_allocs : walk_allocs) / n_rounds,
+	  cached ? (double) stats->label_walks / n_rounds
+	  : (double) found * LOOKUPS_PER_ITEM,
+	  g_timer_elapsed (timer, NULL) * 1e9 / n_rounds,
+	  g_timer_elapsed (timer, NULL) * 1e9 / n_rounds
+	  / (found * LOOKUPS_PER_ITEM));
+
+  g_timer_destroy (timer);
+  gtk_widget_destroy (menubar);
+  g_object_unref (menubar);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+
+  context = g_option_context_new ("- benchmark menu item label lookups");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+
+  run (FALSE);
+  run (TRUE);
+  return 0;
+}
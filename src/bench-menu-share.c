@@ -0,0 +1,248 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/*
+ * Measures the native items of a menubar shared between windows, by
+ * driving the menu sync engine (menu_sync.h) against the in-memory
+ * native menus of menu_backend_record.h as bench-menu-sync does. Each
+ * window gets its own copy of a menubar built from one layout, plus a
+ * Recent submenu of its own; focus then moves between the windows at
+ * random. With separate menubars every window has its own native
+ * menubar; with a shared one, a focus change is
+ * menu_sync_switch_menubar(), which hands the native items over and
+ * syncs what it couldn't. The report has the native items alive in
+ * total and per window after the first, the items and shells each
+ * switch rebinds and resyncs, the time per switch, and how many items
+ * of the windows not being shown still hold a native item, which
+ * ought to be none.
+ *
+ * Output is one line per scenario of whitespace-separated key=value
+ * pairs.
+ */
+
+#include <gtk/gtk.h>
+#include <stdio.h>
+#include "menu_accel.h"
+#include "menu_backend_record.h"
+#include "menu_share.h"
+#include "menu_shortcut.h"
+#include "menu_state.h"
+#include "menu_stats.h"
+#include "menu_sync.h"
+#include "menu_update.h"
+
+#define ITEMS_PER_MENU 100
+
+static gint n_windows = 30;
+static gint n_items = 4000;
+static gint n_recent = 10;
+static gint n_switches = 200;
+
+static GOptionEntry entries[] = {
+  { "windows", 'w', 0, G_OPTION_ARG_INT, &n_windows,
+    "Number of windows", "N" },
+  { "items", 'i', 0, G_OPTION_ARG_INT, &n_items,
+    "Number of items in each menubar", "N" },
+  { "recent", 'r', 0, G_OPTION_ARG_INT, &n_recent,
+    "Number of items in each window's Recent menu", "N" },
+  { "switches", 's', 0, G_OPTION_ARG_INT, &n_switches,
+    "Number of focus changes", "N" },
+  { NULL }
+};
+
+static GtkWidget *
+build_menubar (gint window)
+{
+  GtkWidget *menubar = g_object_ref_sink (gtk_menu_bar_new ());
+  GtkWidget *menu = NULL, *top, *recent;
+  gint i;
+
+  for (i = 0; i < n_items; i++) {
+    GtkWidget *item;
+    gchar *path;
+
+    if (i % ITEMS_PER_MENU == 0) {
+      top = gtk_menu_item_new_with_label ("Menu");
+      menu = gtk_menu_new ();
+      gtk_menu_item_set_submenu (GTK_MENU_ITEM (top), menu);
+      gtk_menu_shell_append (GTK_MENU_SHELL (menubar), top);
+    }
+    item = gtk_menu_item_new_with_label ("Item");
+    path = g_strdup_printf ("<bench>/Menu%d/Item%d", i / ITEMS_PER_MENU, i);
+    gtk_menu_item_set_accel_path (GTK_MENU_ITEM (item), path);
+    g_free (path);
+    gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+  }
+
+  top = gtk_menu_item_new_with_label ("Recent");
+  recent = gtk_menu_new ();
+  gtk_menu_item_set_submenu (GTK_MENU_ITEM (top), recent);
+  gtk_menu_shell_append (GTK_MENU_SHELL (menubar), top);
+  for (i = 0; i < n_recent; i++) {
+    gchar *label = g_strdup_printf ("Document %d.%d", window, i);
+    gtk_menu_shell_append (GTK_MENU_SHELL (recent),
+			   gtk_menu_item_new_with_label (label));
+    g_free (label);
+  }
+  gtk_widget_show_all (menubar);
+  return menubar;
+}
+
+/* What mirror_menu_bar() does; the menubar holds the reference */
+static void
+mirror_menu_bar (GtkWidget *menubar)
+{
+  MenuRecordMenu *native = menu_backend_record_menubar_new ();
+
+  menu_sync_connect_menu (menubar, native);
+  menu_backend_record.menu_unref (native);
+  menu_shell_mark_dirty (menubar);
+  menu_sync_menubar (menubar, native);
+  menu_update_flush ();
+}
+
+/* Items in @shell and beneath it which have a native item */
+static guint
+count_mirrored (GtkWidget *shell)
+{
+  GList *children = gtk_container_get_children (GTK_CONTAINER (shell));
+  GList *l;
+  guint mirrored = 0;
+
+  for (l = children; l; l = l->next) {
+    GtkWidget *item = (GtkWidget*) l->data;
+    GtkWidget *submenu = gtk_menu_item_get_submenu (GTK_MENU_ITEM (item));
+
+    if (menu_sync_get_item (item))
+      mirrored++;
+    if (submenu)
+      mirrored += count_mirrored (submenu);
+  }
+  g_list_free (children);
+  return mirrored;
+}
+
+static void
+run (gboolean shared)
+{
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  GRand *rand = g_rand_new_with_seed (17);
+  GTimer *timer = g_timer_new ();
+  MenuShareGroup *group = NULL;
+  GtkWidget **menubars;
+  guint base_items = menu_backend_record_get_stats ()->live_items;
+  guint native_items, first_items, per_window, stale = 0;
+  guint64 rebound, resynced;
+  gint i, active = 0, switches = 0;
+
+  menubars = g_new (GtkWidget*, n_windows);
+  for (i = 0; i < n_windows; i++)
+    menubars[i] = build_menubar (i);
+
+  mirror_menu_bar (menubars[0]);
+  first_items = menu_backend_record_get_stats ()->live_items - base_items;
+  if (!shared)
+    for (i = 1; i < n_windows; i++)
+      mirror_menu_bar (menubars[i]);
+  else {
+    group = menu_share_group_get (menubars);
+    for (i = 0; i < n_windows; i++)
+      menu_share_add (group, menubars[i]);
+    group->native = menu_sync_get_menu (menubars[0]);
+    group->active = menubars[0];
+  }
+
+  /* What shared_menu_bar_activate() does */
+  rebound = stats->shared_items_rebound;
+  resynced = stats->shared_shells_resynced;
+  g_timer_start (timer);
+  for (i = 0; shared && i < n_switches; i++) {
+    gint next = g_rand_int_range (rand, 0, n_windows);
+
+    if (next == active)
+      continue;
+    menu_sync_switch_menubar (menubars[active], menubars[next]);
+    menu_update_flush ();
+    group->active = menubars[next];
+    active = next;
+    switches++;
+  }
+  g_timer_stop (timer);
+  rebound = stats->shared_items_rebound - rebound;
+  resynced = stats->shared_shells_resynced - resynced;
+
+  native_items = menu_backend_record_get_stats ()->live_items - base_items;
+  per_window = n_windows > 1 ?
+    (native_items - first_items) / (n_windows - 1) : 0;
+  for (i = 0; shared && i < n_windows; i++)
+    if (i != active)
+      stale += count_mirrored (menubars[i]);
+
+  printf ("scenario=%s windows=%d items=%d native_items=%u"
+	  " native_items_per_extra_window=%u switches=%d"
+	  " items_rebound_per_switch=%.0f shells_resynced_per_switch=%.2f"
+	  " us_per_switch=%.1f stale_items=%u\n",
+	  shared ? "shared" : "separate", n_windows, n_items, native_items,
+	  per_window, switches,
+	  switches ? (double) rebound / switches : 0.0,
+	  switches ? (double) resynced / switches : 0.0,
+	  switches ? g_timer_elapsed (timer, NULL) * 1e6 / switches : 0.0,
+	  stale);
+
+  for (i = 0; i < n_windows; i++) {
+    if (group)
+      menu_share_remove (group, menubars[i]);
+    gtk_widget_destroy (menubars[i]);
+    g_object_unref (menubars[i]);
+  }
+  g_free (menubars);
+  g_timer_destroy (timer);
+  g_rand_free (rand);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+
+  context = g_option_context_new ("- measure a menubar shared between windows");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+  if (n_windows < 1 || n_switches < 1) {
+    g_printerr ("--windows and --switches must be positive\n");
+    return 1;
+  }
+
+  menu_sync_set_backend (&menu_backend_record);
+  menu_shortcut_set_func (menu_accel_dispatch);
+
+  run (FALSE);
+  run (TRUE);
+  return 0;
+}
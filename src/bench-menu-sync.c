@@ -0,0 +1,529 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/*
+ * Drives the menu sync engine (menu_sync.h) against the in-memory
+ * native menus of menu_backend_record.h, so that what
+ * gtk_osxapplication_set_menu_bar() and friends cost can be measured
+ * anywhere GTK+ builds. A synthetic menubar is generated with a
+ * given number of menus, items per menu, and levels of submenus, and
+ * a share of the items get accelerators, no two the same. The
+ * scenarios are:
+ *
+ *   set_menu_bar	mirroring the whole menubar for the first time
+ *   sync_menubar	gtk_osxapplication_sync_menubar(): resyncing it all
+ *   reparent		moving an item to another menu
+ *   sensitivity	toggling an item's sensitivity
+ *   accel		changing an item's accelerator
+ *
+ * Each operation is followed by the flush that the idle handler
+ * would do. The report gives the time, the heap allocations (where
+ * they can be counted, which is with glibc), and the native
+ * operations and their cost per operation.
+ *
+ * Output is one line per scenario of whitespace-separated key=value
+ * pairs.
+ */
+
+#include <gtk/gtk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "menu_accel.h"
+#include "menu_backend_record.h"
+#include "menu_shortcut.h"
+#include "menu_state.h"
+#include "menu_stats.h"
+#include "menu_sync.h"
+#include "menu_update.h"
+#include "menu_watch.h"
+
+static gint n_menus = 8;
+static gint n_items = 30;
+static gint depth = 2;
+static gint n_submenus = 3;
+static gdouble accel_density = 0.15;
+static gint n_builds = 5;
+static gint n_syncs = 20;
+static gint n_ops = 2000;
+
+static GOptionEntry entries[] = {
+  { "menus", 'm', 0, G_OPTION_ARG_INT, &n_menus,
+    "Number of menus on the menubar", "N" },
+  { "items", 'i', 0, G_OPTION_ARG_INT, &n_items,
+    "Number of items in each menu", "N" },
+  { "depth", 'd', 0, G_OPTION_ARG_INT, &depth,
+    "Levels of submenus below the menubar's menus", "N" },
+  { "submenus", 's', 0, G_OPTION_ARG_INT, &n_submenus,
+    "Number of items in each menu with a submenu, above the last level",
+    "N" },
+  { "accel-density", 'a', 0, G_OPTION_ARG_DOUBLE, &accel_density,
+    "Share of the items with an accelerator", "F" },
+  { "builds", 'b', 0, G_OPTION_ARG_INT, &n_builds,
+    "Number of times to mirror a new menubar", "N" },
+  { "syncs", 'y', 0, G_OPTION_ARG_INT, &n_syncs,
+    "Number of times to resync the whole menubar", "N" },
+  { "ops", 'o', 0, G_OPTION_ARG_INT, &n_ops,
+    "Number of operations in each of the other scenarios", "N" },
+  { NULL }
+};
+
+#ifdef __GLIBC__
+/* Count every allocation by standing in for the allocator. */
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t n, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+static guint64 n_allocs = 0;
+#define COUNTING_ALLOCS 1
+
+void *
+malloc (size_t size)
+{
+  __sync_fetch_and_add (&n_allocs, 1);
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t n, size_t size)
+{
+  __sync_fetch_and_add (&n_allocs, 1);
+  return __libc_calloc (n, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+  __sync_fetch_and_add (&n_allocs, 1);
+  return __libc_realloc (ptr, size);
+}
+#else
+static guint64 n_allocs = 0;
+#define COUNTING_ALLOCS 0
+#endif
+
+/* What the timed part of a scenario has cost */
+typedef struct {
+  guint64 ns;
+  guint64 allocs;
+  guint64 native_ops;
+  guint64 cost;
+  guint64 redundant;
+} Tally;
+
+static Tally mark;
+
+static void
+tally_start (void)
+{
+  MenuRecordStats *stats = menu_backend_record_get_stats ();
+
+  mark.allocs = n_allocs;
+  mark.native_ops = stats->native_ops;
+  mark.cost = stats->cost;
+  mark.redundant = stats->redundant;
+  mark.ns = menu_stats_now_ns ();
+}
+
+static void
+tally_stop (Tally *total)
+{
+  guint64 now = menu_stats_now_ns ();
+  MenuRecordStats *stats = menu_backend_record_get_stats ();
+
+  total->ns += now - mark.ns;
+  total->allocs += n_allocs - mark.allocs;
+  total->native_ops += stats->native_ops - mark.native_ops;
+  total->cost += stats->cost - mark.cost;
+  total->redundant += stats->redundant - mark.redundant;
+}
+
+/* The synthetic menubar */
+typedef struct {
+  GtkWidget *menubar;
+  MenuRecordMenu *native;
+  /* Items without submenus, and the GtkMenus */
+  GPtrArray *items;
+  GPtrArray *shells;
+  /* The closures of the items with accelerators, and their group */
+  GPtrArray *accels;
+  GtkAccelGroup *accel_group;
+  /* Which shortcut each closure has, and those nobody has */
+  GArray *accel_shortcuts;
+  GArray *free_shortcuts;
+  guint n_items;
+} Tree;
+
+/*
+ * The shortcuts to hand out: a letter or digit with any combination
+ * of the modifiers that the Quartz menus show, which is to say
+ * Control, Option, Command, and Shift, but not Shift alone.
+ */
+#define N_ACCEL_KEYS 36
+#define N_ACCEL_MODS 14
+#define N_SHORTCUTS (N_ACCEL_KEYS * N_ACCEL_MODS)
+
+static void
+shortcut_get (guint shortcut, guint *key, GdkModifierType *mods)
+{
+  static const GdkModifierType mod_bits[] = {
+    GDK_CONTROL_MASK, GDK_MOD5_MASK, GDK_META_MASK, GDK_SHIFT_MASK
+  };
+  guint key_index = shortcut % N_ACCEL_KEYS;
+  guint combination = shortcut / N_ACCEL_KEYS + 1, bit;
+
+  /* Skip Shift alone */
+  if (combination >= 8)
+    combination++;
+  *key = key_index < 26 ? 'a' + key_index : '0' + key_index - 26;
+  *mods = 0;
+  for (bit = 0; bit < G_N_ELEMENTS (mod_bits); bit++)
+    if (combination & (1 << bit))
+      *mods |= mod_bits[bit];
+}
+
+/* Give @closure a shortcut nobody else has */
+static void
+connect_accel (Tree *tree, GClosure *closure, guint slot, GRand *rand)
+{
+  GArray *free_shortcuts = tree->free_shortcuts;
+  guint index = g_rand_int_range (rand, 0, free_shortcuts->len);
+  guint shortcut = g_array_index (free_shortcuts, guint, index), key;
+  GdkModifierType mods;
+
+  g_array_remove_index_fast (free_shortcuts, index);
+  if (slot < tree->accel_shortcuts->len)
+    g_array_index (tree->accel_shortcuts, guint, slot) = shortcut;
+  else
+    g_array_append_val (tree->accel_shortcuts, shortcut);
+  shortcut_get (shortcut, &key, &mods);
+  gtk_accel_group_connect (tree->accel_group, key, mods, GTK_ACCEL_VISIBLE,
+			   closure);
+}
+
+static void
+accel_activate (void)
+{
+}
+
+static void
+add_accel (Tree *tree, GtkWidget *item, GRand *rand)
+{
+  GClosure *closure;
+
+  if (tree->free_shortcuts->len == 0)
+    return;
+  closure = g_cclosure_new (G_CALLBACK (accel_activate), NULL, NULL);
+  /* Ours, for changing the shortcut */
+  g_closure_ref (closure);
+  g_closure_sink (closure);
+  connect_accel (tree, closure, tree->accels->len, rand);
+  gtk_accel_label_set_accel_closure
+    (GTK_ACCEL_LABEL (gtk_bin_get_child (GTK_BIN (item))), closure);
+  g_ptr_array_add (tree->accels, closure);
+}
+
+static GtkWidget *
+build_menu (Tree *tree, gint level, GRand *rand)
+{
+  GtkWidget *menu = gtk_menu_new ();
+  gint i;
+
+  g_ptr_array_add (tree->shells, menu);
+  for (i = 0; i < n_items; i++) {
+    GtkWidget *item;
+    gchar *label;
+
+    tree->n_items++;
+    if (i % 10 == 9) {
+      gtk_menu_shell_append (GTK_MENU_SHELL (menu),
+			     gtk_separator_menu_item_new ());
+      continue;
+    }
+    label = g_strdup_printf ("Item %u", tree->n_items);
+    if (i % 5 == 4)
+      item = gtk_check_menu_item_new_with_label (label);
+    else
+      item = gtk_menu_item_new_with_label (label);
+    g_free (label);
+
+    if (level < depth && i < n_submenus)
+      gtk_menu_item_set_submenu (GTK_MENU_ITEM (item),
+				 build_menu (tree, level + 1, rand));
+    else {
+      g_ptr_array_add (tree->items, item);
+      if (g_rand_double (rand) < accel_density)
+	add_accel (tree, item, rand);
+    }
+    gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+  }
+  return menu;
+}
+
+static Tree *
+tree_new (void)
+{
+  GRand *rand = g_rand_new_with_seed (17);
+  Tree *tree = g_new0 (Tree, 1);
+  guint shortcut;
+  gint i;
+
+  tree->menubar = g_object_ref_sink (gtk_menu_bar_new ());
+  tree->items = g_ptr_array_new ();
+  tree->shells = g_ptr_array_new ();
+  tree->accels = g_ptr_array_new ();
+  tree->accel_group = gtk_accel_group_new ();
+  tree->accel_shortcuts = g_array_new (FALSE, FALSE, sizeof (guint));
+  tree->free_shortcuts = g_array_sized_new (FALSE, FALSE, sizeof (guint),
+					    N_SHORTCUTS);
+  for (shortcut = 0; shortcut < N_SHORTCUTS; shortcut++)
+    g_array_append_val (tree->free_shortcuts, shortcut);
+  for (i = 0; i < n_menus; i++) {
+    gchar *label = g_strdup_printf ("Menu %d", i);
+    GtkWidget *top = gtk_menu_item_new_with_label (label);
+
+    g_free (label);
+    tree->n_items++;
+    gtk_menu_item_set_submenu (GTK_MENU_ITEM (top),
+			       build_menu (tree, 0, rand));
+    gtk_menu_shell_append (GTK_MENU_SHELL (tree->menubar), top);
+  }
+  gtk_widget_show_all (tree->menubar);
+  g_rand_free (rand);
+  return tree;
+}
+
+/* What mirror_menu_bar() does */
+static void
+tree_mirror (Tree *tree)
+{
+  tree->native = menu_backend_record_menubar_new ();
+  menu_sync_connect_menu (tree->menubar, tree->native);
+  menu_shell_mark_dirty (tree->menubar);
+  menu_sync_menubar (tree->menubar, tree->native);
+  menu_update_flush ();
+}
+
+static void
+tree_free (Tree *tree)
+{
+  gtk_widget_destroy (tree->menubar);
+  g_object_unref (tree->menubar);
+  if (tree->native)
+    menu_backend_record.menu_unref (tree->native);
+  /* As a widget's accel closures are when it goes, which takes them
+     out of the shortcut registry */
+  g_ptr_array_foreach (tree->accels, (GFunc) g_closure_invalidate, NULL);
+  g_ptr_array_foreach (tree->accels, (GFunc) g_closure_unref, NULL);
+  g_ptr_array_free (tree->accels, TRUE);
+  g_ptr_array_free (tree->items, TRUE);
+  g_ptr_array_free (tree->shells, TRUE);
+  g_array_free (tree->accel_shortcuts, TRUE);
+  g_array_free (tree->free_shortcuts, TRUE);
+  g_object_unref (tree->accel_group);
+  g_free (tree);
+}
+
+/* What menu_item_parent_changed() in gtkosxapplication_quartz.c does */
+static void
+parent_changed (GtkWidget *menu_item, GtkWidget *old_parent,
+		GtkWidget *new_parent, gint position)
+{
+  gpointer menu;
+
+  if (GTK_IS_MENU_SHELL (old_parent) &&
+      (menu = menu_sync_get_menu (old_parent)) &&
+      !menu_sync_remove_child (old_parent, menu, menu_item))
+    menu_shell_mark_dirty (old_parent);
+
+  if (!GTK_IS_MENU_SHELL (new_parent) ||
+      !(menu = menu_sync_get_menu (new_parent)) ||
+      menu_sync_insert_child (new_parent, menu, menu_item, position))
+    return;
+  menu_shell_mark_dirty (new_parent);
+  if (GTK_IS_MENU_BAR (new_parent))
+    menu_sync_menubar (new_parent, menu);
+  else
+    menu_sync_shell (new_parent, menu, FALSE);
+}
+
+static void
+report (const gchar *scenario, Tree *tree, guint ops, const Tally *total)
+{
+  printf ("scenario=%s items=%u shells=%u accels=%u ops=%u ns_per_op=%.0f",
+	  scenario, tree->n_items, tree->shells->len + 1, tree->accels->len,
+	  ops, (double) total->ns / ops);
+  if (COUNTING_ALLOCS)
+    printf (" allocs_per_op=%.1f", (double) total->allocs / ops);
+  else
+    printf (" allocs_per_op=n/a");
+  printf (" native_ops_per_op=%.1f native_cost_per_op=%.1f"
+	  " redundant_per_op=%.1f\n",
+	  (double) total->native_ops / ops, (double) total->cost / ops,
+	  (double) total->redundant / ops);
+}
+
+static void
+run_set_menu_bar (void)
+{
+  Tally total = { 0 };
+  Tree *tree = NULL;
+  gint i;
+
+  for (i = 0; i < n_builds; i++) {
+    if (tree)
+      tree_free (tree);
+    tree = tree_new ();
+    tally_start ();
+    tree_mirror (tree);
+    tally_stop (&total);
+  }
+  report ("set_menu_bar", tree, n_builds, &total);
+  tree_free (tree);
+}
+
+static void
+run_sync_menubar (Tree *tree)
+{
+  Tally total = { 0 };
+  gint i;
+
+  for (i = 0; i < n_syncs; i++) {
+    tally_start ();
+    menu_state_invalidate_all ();
+    menu_sync_menubar (tree->menubar, tree->native);
+    menu_update_flush ();
+    tally_stop (&total);
+  }
+  report ("sync_menubar", tree, n_syncs, &total);
+}
+
+static void
+run_reparent (Tree *tree, GRand *rand)
+{
+  Tally total = { 0 };
+  gint i;
+
+  for (i = 0; i < n_ops; i++) {
+    GtkWidget *item = g_ptr_array_index (tree->items,
+					 g_rand_int_range (rand, 0, tree->items->len));
+    GtkWidget *shell = g_ptr_array_index (tree->shells,
+					  g_rand_int_range (rand, 0, tree->shells->len));
+    GList *children = gtk_container_get_children (GTK_CONTAINER (shell));
+    gint position = g_rand_int_range (rand, 0, g_list_length (children) + 1);
+
+    g_list_free (children);
+    g_object_ref (item);
+    tally_start ();
+    gtk_container_remove (GTK_CONTAINER (gtk_widget_get_parent (item)), item);
+    gtk_menu_shell_insert (GTK_MENU_SHELL (shell), item, position);
+    menu_update_flush ();
+    tally_stop (&total);
+    g_object_unref (item);
+  }
+  report ("reparent", tree, n_ops, &total);
+}
+
+static void
+run_sensitivity (Tree *tree, GRand *rand)
+{
+  Tally total = { 0 };
+  gint i;
+
+  for (i = 0; i < n_ops; i++) {
+    GtkWidget *item = g_ptr_array_index (tree->items,
+					 g_rand_int_range (rand, 0, tree->items->len));
+
+    tally_start ();
+    gtk_widget_set_sensitive (item, !gtk_widget_get_sensitive (item));
+    menu_update_flush ();
+    tally_stop (&total);
+  }
+  report ("sensitivity", tree, n_ops, &total);
+}
+
+static void
+run_accel (Tree *tree, GRand *rand)
+{
+  Tally total = { 0 };
+  gint i;
+
+  if (tree->accels->len == 0)
+    return;
+  for (i = 0; i < n_ops; i++) {
+    guint slot = g_rand_int_range (rand, 0, tree->accels->len);
+    GClosure *closure = g_ptr_array_index (tree->accels, slot);
+    guint old_shortcut = g_array_index (tree->accel_shortcuts, guint, slot);
+
+    tally_start ();
+    gtk_accel_group_disconnect (tree->accel_group, closure);
+    connect_accel (tree, closure, slot, rand);
+    menu_update_flush ();
+    tally_stop (&total);
+    g_array_append_val (tree->free_shortcuts, old_shortcut);
+  }
+  report ("accel", tree, n_ops, &total);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GRand *rand;
+  Tree *tree;
+
+  /* So that every allocation goes through malloc() */
+  g_setenv ("G_SLICE", "always-malloc", TRUE);
+
+  context = g_option_context_new ("- measure the menu sync engine");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+  if (n_menus < 1 || n_items < 1 || n_builds < 1 || n_syncs < 1 ||
+      n_ops < 1 || depth < 0) {
+    g_printerr ("--menus, --items, --builds, --syncs and --ops must be "
+		"positive\n");
+    return 1;
+  }
+
+  menu_sync_set_backend (&menu_backend_record);
+  menu_watch_set_func (parent_changed);
+  menu_shortcut_set_func (menu_accel_dispatch);
+
+  run_set_menu_bar ();
+
+  rand = g_rand_new_with_seed (17);
+  tree = tree_new ();
+  tree_mirror (tree);
+  run_sync_menubar (tree);
+  run_sensitivity (tree, rand);
+  run_accel (tree, rand);
+  run_reparent (tree, rand);
+  tree_free (tree);
+  g_rand_free (rand);
+  return 0;
+}
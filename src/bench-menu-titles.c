@@ -0,0 +1,153 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/*
+ * Simulates the titles of several windows' menubars, all built from
+ * the same set of labels, being created and then refreshed a number
+ * of times, and reports how many transcodes the title cache made and
+ * its hit rate and size. The native strings are UTF-16 copies made
+ * with g_utf8_to_utf16(), about the work NSString does; the "uncached"
+ * scenario makes one per lookup, the way the menus used to.
+ *
+ * Output is one line per scenario of whitespace-separated key=value
+ * pairs.
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include "menu_title.h"
+#include "menu_stats.h"
+
+static gint n_windows = 10;
+static gint n_items = 300;
+static gint n_labels = 200;
+static gint n_rounds = 20;
+
+static GOptionEntry entries[] = {
+  { "windows", 'w', 0, G_OPTION_ARG_INT, &n_windows,
+    "Number of menubars", "N" },
+  { "items", 'i', 0, G_OPTION_ARG_INT, &n_items,
+    "Number of items in each menubar", "N" },
+  { "labels", 'l', 0, G_OPTION_ARG_INT, &n_labels,
+    "Number of distinct labels", "N" },
+  { "rounds", 'r', 0, G_OPTION_ARG_INT, &n_rounds,
+    "Number of times to refresh every title", "N" },
+  { NULL }
+};
+
+static gpointer
+utf16_create (const gchar *utf8)
+{
+  return g_utf8_to_utf16 (utf8, -1, NULL, NULL, NULL);
+}
+
+static const MenuTitleFuncs utf16_funcs = {
+  utf16_create,
+  g_free
+};
+
+static void
+run (gchar **labels, gboolean cached)
+{
+  guint n = n_windows * n_items;
+  MenuTitle **titles = g_new0 (MenuTitle*, n);
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  GTimer *timer = g_timer_new ();
+  guint64 conversions = 0, peak_bytes = 0;
+  guint peak_titles = 0;
+  gint round;
+  guint i;
+
+  menu_stats_reset ();
+  g_timer_start (timer);
+  for (round = 0; round <= n_rounds; round++)
+    for (i = 0; i < n; i++) {
+      /* Each window shows the same labels, in the same places */
+      const gchar *label = labels[(i % n_items) % n_labels];
+
+      if (cached) {
+	MenuTitle *title = menu_title_ref (label, &utf16_funcs);
+	menu_title_unref (titles[i]);
+	titles[i] = title;
+      }
+      else {
+	g_free (utf16_create (label));
+	++conversions;
+      }
+    }
+  g_timer_stop (timer);
+  if (cached) {
+    conversions = stats->title_conversions;
+    peak_titles = stats->titles_interned;
+    peak_bytes = stats->title_bytes;
+    for (i = 0; i < n; i++)
+      menu_title_unref (titles[i]);
+  }
+
+  printf ("scenario=%s windows=%d items=%d labels=%d lookups=%u"
+	  " conversions=%" G_GUINT64_FORMAT " hit_rate=%.4f"
+	  " address_hits=%" G_GUINT64_FORMAT " text_hits=%" G_GUINT64_FORMAT
+	  " titles=%u title_bytes=%" G_GUINT64_FORMAT " ns_per_lookup=%.1f\n",
+	  cached ? "cached" : "uncached", n_windows, n_items, n_labels,
+	  n * (n_rounds + 1), conversions,
+	  1.0 - (double) conversions / (n * (n_rounds + 1)),
+	  stats->title_address_hits, stats->title_text_hits,
+	  peak_titles, peak_bytes,
+	  g_timer_elapsed (timer, NULL) * 1e9 / (n * (n_rounds + 1)));
+
+  g_timer_destroy (timer);
+  g_free (titles);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  gchar **labels;
+  gint i;
+
+  context = g_option_context_new ("- benchmark the menu title cache");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+  if (n_windows < 1 || n_items < 1 || n_labels < 1) {
+    g_printerr ("--windows, --items and --labels must be positive\n");
+    return 1;
+  }
+
+  labels = g_new (gchar*, n_labels);
+  for (i = 0; i < n_labels; i++)
+    labels[i] = g_strdup_printf ("Élément de menu n° %d…", i);
+
+  run (labels, FALSE);
+  run (labels, TRUE);
+
+  for (i = 0; i < n_labels; i++)
+    g_free (labels[i]);
+  g_free (labels);
+  return 0;
+}
@@ -0,0 +1,199 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/*
+ * Replays a synthetic session trace against a set of mirrored menu
+ * items and counts the notify callbacks the mirror receives, first
+ * with the old undetailed notify handler and its chain of strcmp()s,
+ * then with the detailed subscriptions of menu_update_watch(). Most
+ * of the trace is properties the mirror doesn't care about (focus,
+ * tooltips, size requests and the like, as an application's widgets
+ * churn), with sensitivity, visibility, check state and label changes
+ * mixed in at roughly the rate action updates produce them. The
+ * pending updates are flushed every --batch events, standing in for
+ * main loop iterations.
+ *
+ * Output is one line per scenario of whitespace-separated key=value
+ * pairs.
+ */
+
+#include <gtk/gtk.h>
+#include <stdio.h>
+#include <string.h>
+#include "menu_update.h"
+#include "menu_stats.h"
+
+static gint n_items = 500;
+static gint n_events = 200000;
+static gint batch = 50;
+static guint64 notify_emissions = 0;
+static guint64 flushed_updates = 0;
+
+static GOptionEntry entries[] = {
+  { "items", 'i', 0, G_OPTION_ARG_INT, &n_items,
+    "Number of mirrored menu items", "N" },
+  { "events", 'e', 0, G_OPTION_ARG_INT, &n_events,
+    "Length of the trace", "N" },
+  { "batch", 'b', 0, G_OPTION_ARG_INT, &batch,
+    "Events per main loop iteration", "N" },
+  { NULL }
+};
+
+/* Properties of every widget which a mirror has no use for */
+static const gchar *noise[] = {
+  "has-focus", "is-focus", "can-focus", "has-tooltip", "tooltip-text",
+  "width-request", "height-request", "name", "events", "no-show-all"
+};
+
+static void
+count_flush (GtkWidget *menu_item, MenuUpdateFlags flags)
+{
+  ++flushed_updates;
+}
+
+/* What cocoa_menu_item_notify() and _notify_label() used to be */
+static void
+undetailed_notify (GObject *object, GParamSpec *pspec, gpointer data)
+{
+  menu_stats_get ()->notifies_received++;
+  if (!strcmp (pspec->name, "sensitive") ||
+      !strcmp (pspec->name, "visible"))
+    menu_update_queue (GTK_WIDGET (object), MENU_UPDATE_STATE, count_flush);
+  else if (!strcmp (pspec->name, "active") ||
+	   !strcmp (pspec->name, "inconsistent"))
+    menu_update_queue (GTK_WIDGET (object), MENU_UPDATE_CHECKED, count_flush);
+}
+
+static void
+undetailed_notify_label (GObject *object, GParamSpec *pspec, gpointer data)
+{
+  menu_stats_get ()->notifies_received++;
+  if (!strcmp (pspec->name, "label"))
+    menu_update_queue (GTK_WIDGET (object), MENU_UPDATE_LABEL, count_flush);
+}
+
+static gboolean
+count_emission (GSignalInvocationHint *hint, guint n_params,
+		const GValue *params, gpointer data)
+{
+  ++notify_emissions;
+  return TRUE;
+}
+
+static void
+run (gboolean detailed)
+{
+  GtkWidget **items = g_new (GtkWidget*, n_items);
+  GtkWidget *menu = g_object_ref_sink (gtk_menu_new ());
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  GRand *rand = g_rand_new_with_seed (42);
+  GTimer *timer = g_timer_new ();
+  guint hook;
+  gint i;
+
+  for (i = 0; i < n_items; i++) {
+    GtkWidget *label;
+
+    items[i] = gtk_check_menu_item_new_with_label ("Item");
+    gtk_menu_shell_append (GTK_MENU_SHELL (menu), items[i]);
+    label = gtk_bin_get_child (GTK_BIN (items[i]));
+    if (detailed)
+      menu_update_watch (items[i], label, count_flush);
+    else {
+      g_signal_connect (items[i], "notify",
+			G_CALLBACK (undetailed_notify), NULL);
+      g_signal_connect_swapped (label, "notify::label",
+				G_CALLBACK (undetailed_notify_label),
+				items[i]);
+    }
+  }
+
+  menu_stats_reset ();
+  notify_emissions = flushed_updates = 0;
+  hook = g_signal_add_emission_hook (g_signal_lookup ("notify", G_TYPE_OBJECT),
+				     0, count_emission, NULL, NULL);
+  g_timer_start (timer);
+  for (i = 0; i < n_events; i++) {
+    GtkWidget *item = items[g_rand_int_range (rand, 0, n_items)];
+    gint what = g_rand_int_range (rand, 0, 100);
+
+    if (what < 8)
+      gtk_widget_set_sensitive (item, !gtk_widget_get_sensitive (item));
+    else if (what < 10)
+      gtk_check_menu_item_set_active (GTK_CHECK_MENU_ITEM (item),
+	!gtk_check_menu_item_get_active (GTK_CHECK_MENU_ITEM (item)));
+    else if (what < 11)
+      gtk_label_set_text (GTK_LABEL (gtk_bin_get_child (GTK_BIN (item))),
+			  g_rand_boolean (rand) ? "Item" : "Renamed item");
+    else if (what < 70)
+      g_object_notify (G_OBJECT (item),
+		       noise[g_rand_int_range (rand, 0, G_N_ELEMENTS (noise))]);
+    else
+      g_object_notify (G_OBJECT (gtk_bin_get_child (GTK_BIN (item))),
+		       noise[g_rand_int_range (rand, 0, G_N_ELEMENTS (noise))]);
+    if ((i + 1) % batch == 0)
+      menu_update_flush ();
+  }
+  menu_update_flush ();
+  g_timer_stop (timer);
+  g_signal_remove_emission_hook (g_signal_lookup ("notify", G_TYPE_OBJECT),
+				 hook);
+
+  printf ("scenario=%s items=%d events=%d notify_emissions=%" G_GUINT64_FORMAT
+	  " callbacks=%" G_GUINT64_FORMAT " callbacks_avoided=%" G_GUINT64_FORMAT
+	  " native_updates=%" G_GUINT64_FORMAT " updates_coalesced=%"
+	  G_GUINT64_FORMAT " ns_per_event=%.1f\n",
+	  detailed ? "detailed" : "undetailed", n_items, n_events,
+	  notify_emissions, stats->notifies_received,
+	  notify_emissions - stats->notifies_received, flushed_updates,
+	  stats->updates_coalesced,
+	  g_timer_elapsed (timer, NULL) * 1e9 / n_events);
+
+  g_timer_destroy (timer);
+  g_rand_free (rand);
+  gtk_widget_destroy (menu);
+  g_object_unref (menu);
+  g_free (items);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+
+  context = g_option_context_new ("- benchmark notify dispatch on menu items");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+  if (batch < 1)
+    batch = 1;
+
+  run (FALSE);
+  run (TRUE);
+  return 0;
+}
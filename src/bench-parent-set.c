@@ -0,0 +1,172 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/*
+ * Measures what the menu tracking costs the rest of the application:
+ * builds a large tree of ordinary widgets, reparents every leaf back
+ * and forth, and reports the time per reparent and how many times the
+ * tracking code had to look at one, first with nothing watched and
+ * then with a menubar being mirrored. Menu items moving between
+ * watched menus are timed for comparison.
+ *
+ * Output is one line per scenario of whitespace-separated key=value
+ * pairs.
+ */
+
+#include <gtk/gtk.h>
+#include <stdio.h>
+#include "menu_watch.h"
+#include "menu_stats.h"
+
+static gint n_widgets = 5000;
+static gint n_rounds = 20;
+static guint64 callbacks = 0;
+
+static GOptionEntry entries[] = {
+  { "widgets", 'w', 0, G_OPTION_ARG_INT, &n_widgets,
+    "Number of widgets to reparent", "N" },
+  { "rounds", 'r', 0, G_OPTION_ARG_INT, &n_rounds,
+    "Number of times to move each one there and back", "N" },
+  { NULL }
+};
+
+static void
+count_callback (GtkWidget *menu_item, GtkWidget *old_parent,
+		GtkWidget *new_parent, gint position)
+{
+  ++callbacks;
+}
+
+static GtkWidget *
+box_new (void)
+{
+#if GTK_CHECK_VERSION(2,90,7)
+  return gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+#else
+  return gtk_vbox_new (FALSE, 0);
+#endif
+}
+
+static void
+move_children (GtkWidget *from, GtkWidget *to)
+{
+  GList *children = gtk_container_get_children (GTK_CONTAINER (from));
+  GList *l;
+
+  for (l = children; l; l = l->next) {
+    GtkWidget *child = (GtkWidget*) l->data;
+    g_object_ref (child);
+    gtk_container_remove (GTK_CONTAINER (from), child);
+    if (GTK_IS_MENU_SHELL (to))
+      gtk_menu_shell_append (GTK_MENU_SHELL (to), child);
+    else
+      gtk_container_add (GTK_CONTAINER (to), child);
+    g_object_unref (child);
+  }
+  g_list_free (children);
+}
+
+static void
+run (const gchar *scenario, GtkWidget *a, GtkWidget *b)
+{
+  GTimer *timer = g_timer_new ();
+  guint64 ops = (guint64) n_widgets * n_rounds * 2;
+  guint64 checks;
+  gint round;
+
+  menu_stats_reset ();
+  callbacks = 0;
+  g_timer_start (timer);
+  for (round = 0; round < n_rounds; round++) {
+    move_children (a, b);
+    move_children (b, a);
+  }
+  g_timer_stop (timer);
+  checks = menu_stats_get ()->parent_set_checks;
+
+  printf ("scenario=%s ops=%" G_GUINT64_FORMAT " ns_per_op=%.1f"
+	  " checks_per_op=%.2f callbacks_per_op=%.2f\n",
+	  scenario, ops, g_timer_elapsed (timer, NULL) * 1e9 / ops,
+	  (double) checks / ops, (double) callbacks / ops);
+  g_timer_destroy (timer);
+}
+
+static void
+fill_boxes (GtkWidget **a, GtkWidget **b)
+{
+  gint i;
+
+  *a = g_object_ref_sink (box_new ());
+  *b = g_object_ref_sink (box_new ());
+  for (i = 0; i < n_widgets; i++)
+    gtk_container_add (GTK_CONTAINER (*a), gtk_label_new ("label"));
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GtkWidget *a, *b, *menubar, *menu1, *menu2, *item;
+  gint i;
+
+  context = g_option_context_new ("- benchmark menu tracking overhead");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+  menu_watch_set_func (count_callback);
+
+  fill_boxes (&a, &b);
+  run ("non-menu-unwatched", a, b);
+
+  /* Now mirror a menubar and do it again */
+  menubar = g_object_ref_sink (gtk_menu_bar_new ());
+  menu1 = gtk_menu_new ();
+  menu2 = gtk_menu_new ();
+  item = gtk_menu_item_new_with_label ("One");
+  gtk_menu_item_set_submenu (GTK_MENU_ITEM (item), menu1);
+  gtk_menu_shell_append (GTK_MENU_SHELL (menubar), item);
+  item = gtk_menu_item_new_with_label ("Two");
+  gtk_menu_item_set_submenu (GTK_MENU_ITEM (item), menu2);
+  gtk_menu_shell_append (GTK_MENU_SHELL (menubar), item);
+  menu_watch_shell (menubar);
+  menu_watch_shell (menu1);
+  menu_watch_shell (menu2);
+  run ("non-menu-watched", a, b);
+
+  for (i = 0; i < n_widgets; i++)
+    gtk_menu_shell_append (GTK_MENU_SHELL (menu1),
+			   gtk_menu_item_new_with_label ("item"));
+  run ("menu-items-watched", menu1, menu2);
+
+  gtk_widget_destroy (menubar);
+  g_object_unref (menubar);
+  gtk_widget_destroy (a);
+  gtk_widget_destroy (b);
+  g_object_unref (a);
+  g_object_unref (b);
+  return 0;
+}
@@ -0,0 +1,205 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/*
+ * Measures how long a window's menubar takes to be ready when the
+ * window takes focus, with and without pre-warming. Every round
+ * invalidates all of the menubars, the way
+ * gtk_osxapplication_sync_menubar() does, and then focuses one of the
+ * windows. Without pre-warming the focused menubar has to be synced
+ * on the spot; with it, the main loop is first left to run its idle
+ * callbacks, which step through the menubars a menu at a time. The
+ * "sync" visits each item of a dirty shell and marks it synced, which
+ * stands in for reconciling it with its native menu.
+ *
+ * Output is one line per scenario of whitespace-separated key=value
+ * pairs.
+ */
+
+#include <gtk/gtk.h>
+#include <stdio.h>
+#include "menu_prewarm.h"
+#include "menu_state.h"
+#include "menu_stats.h"
+
+#define ITEMS_PER_MENU 50
+
+static gint n_windows = 10;
+static gint n_items = 2000;
+static gint n_rounds = 50;
+static guint64 items_synced = 0;
+
+static GOptionEntry entries[] = {
+  { "windows", 'w', 0, G_OPTION_ARG_INT, &n_windows,
+    "Number of windows", "N" },
+  { "items", 'i', 0, G_OPTION_ARG_INT, &n_items,
+    "Number of items in each menubar", "N" },
+  { "rounds", 'r', 0, G_OPTION_ARG_INT, &n_rounds,
+    "Number of focus changes", "N" },
+  { NULL }
+};
+
+/* The menubar stands in for the native menu of every shell in it */
+static void
+sync_shell (GtkWidget *shell, GtkWidget *menubar)
+{
+  GList *children, *l;
+  gboolean dirty;
+
+  if (!menu_shell_needs_sync (shell, menubar))
+    return;
+  dirty = menu_shell_is_dirty (shell, menubar);
+  children = gtk_container_get_children (GTK_CONTAINER (shell));
+  for (l = children; l; l = l->next) {
+    GtkWidget *submenu = gtk_menu_item_get_submenu (GTK_MENU_ITEM (l->data));
+
+    if (dirty)
+      ++items_synced;
+    if (submenu)
+      sync_shell (submenu, menubar);
+  }
+  g_list_free (children);
+  menu_shell_mark_synced (shell, menubar);
+}
+
+static gboolean
+prewarm (GtkWidget *menubar, GtkWidget *menu_item)
+{
+  GtkWidget *shell = menu_item ?
+    gtk_menu_item_get_submenu (GTK_MENU_ITEM (menu_item)) : menubar;
+
+  if (!shell || !menu_shell_needs_sync (shell, menubar))
+    return FALSE;
+  sync_shell (shell, menubar);
+  return TRUE;
+}
+
+static GtkWidget *
+build_menubar (void)
+{
+  GtkWidget *menubar = g_object_ref_sink (gtk_menu_bar_new ());
+  GtkWidget *menu = NULL;
+  gint i;
+
+  for (i = 0; i < n_items; i++) {
+    if (i % ITEMS_PER_MENU == 0) {
+      GtkWidget *top = gtk_menu_item_new_with_label ("Menu");
+      menu = gtk_menu_new ();
+      gtk_menu_item_set_submenu (GTK_MENU_ITEM (top), menu);
+      gtk_menu_shell_append (GTK_MENU_SHELL (menubar), top);
+    }
+    gtk_menu_shell_append (GTK_MENU_SHELL (menu),
+			   gtk_menu_item_new_with_label ("Item"));
+  }
+  sync_shell (menubar, menubar);
+  menu_prewarm_add (menubar);
+  return menubar;
+}
+
+static void
+run (GtkWidget **menubars, gboolean prewarming)
+{
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  GRand *rand = g_rand_new_with_seed (18);
+  guint64 focus_ns = 0, max_focus_ns = 0, max_step_ns = 0;
+  guint cold = 0;
+  gint round;
+
+  menu_prewarm_set_enabled (prewarming);
+  menu_stats_reset ();
+  items_synced = 0;
+  for (round = 0; round < n_rounds; round++) {
+    GtkWidget *menubar = menubars[g_rand_int_range (rand, 0, n_windows)];
+    guint64 start, ns;
+
+    menu_state_invalidate_all ();
+    if (prewarming)
+      for (;;) {
+	start = menu_stats_now_ns ();
+	if (!g_main_context_iteration (NULL, FALSE))
+	  break;
+	ns = menu_stats_now_ns () - start;
+	if (ns > max_step_ns)
+	  max_step_ns = ns;
+      }
+
+    start = menu_stats_now_ns ();
+    if (menu_shell_needs_sync (menubar, menubar)) {
+      sync_shell (menubar, menubar);
+      ++cold;
+    }
+    ns = menu_stats_now_ns () - start;
+    focus_ns += ns;
+    if (ns > max_focus_ns)
+      max_focus_ns = ns;
+  }
+
+  printf ("scenario=%s windows=%d items=%d rounds=%d cold_switches=%u"
+	  " focus_ready_ns=%" G_GUINT64_FORMAT
+	  " max_focus_ready_ns=%" G_GUINT64_FORMAT
+	  " prewarm_steps=%" G_GUINT64_FORMAT
+	  " max_idle_step_ns=%" G_GUINT64_FORMAT
+	  " items_synced=%" G_GUINT64_FORMAT "\n",
+	  prewarming ? "prewarm" : "on-focus", n_windows, n_items, n_rounds,
+	  cold, focus_ns / n_rounds, max_focus_ns, stats->prewarm_steps,
+	  max_step_ns, items_synced);
+  g_rand_free (rand);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GtkWidget **menubars;
+  gint i;
+
+  context = g_option_context_new ("- time menubars becoming ready on focus");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+  if (n_windows < 1 || n_items < 1 || n_rounds < 1) {
+    g_printerr ("--windows, --items and --rounds must be positive\n");
+    return 1;
+  }
+
+  menu_prewarm_set_func (prewarm);
+  menu_state_set_changed_func (menu_prewarm_schedule);
+  menubars = g_new (GtkWidget*, n_windows);
+  for (i = 0; i < n_windows; i++)
+    menubars[i] = build_menubar ();
+
+  run (menubars, FALSE);
+  run (menubars, TRUE);
+
+  for (i = 0; i < n_windows; i++) {
+    gtk_widget_destroy (menubars[i]);
+    g_object_unref (menubars[i]);
+  }
+  g_free (menubars);
+  return 0;
+}
@@ -0,0 +1,647 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/*
+ * Plays back a menu trace (menu_trace.h), as recorded by an
+ * application with gtk_osxapplication_start_menu_trace() or
+ * GTK_OSX_MENU_TRACE, against the menu sync engine on the in-memory
+ * native menus of menu_backend_record.h. The menus are rebuilt from
+ * the trace's descriptions of them, and each event is done to them
+ * the way the application did it and handled the way
+ * gtkosxapplication_quartz.c handles it, followed by the flush the
+ * idle handler would do. Only the events are timed, not the
+ * rebuilding.
+ *
+ * Output is a line of key=value pairs for each type of event, with
+ * the count, the mean, median, 99th percentile and worst latency, and
+ * the native operations per event; then the slowest events, so that
+ * they can be found in the trace; then a total. --verbose gives a
+ * line for every event.
+ */
+
+#include <gtk/gtk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "menu_accel.h"
+#include "menu_backend_record.h"
+#include "menu_share.h"
+#include "menu_shortcut.h"
+#include "menu_state.h"
+#include "menu_stats.h"
+#include "menu_sync.h"
+#include "menu_trace.h"
+#include "menu_update.h"
+#include "menu_watch.h"
+
+static gint n_slowest = 10;
+static gboolean lazy_submenus = FALSE;
+static gboolean verbose = FALSE;
+
+static GOptionEntry entries[] = {
+  { "slowest", 's', 0, G_OPTION_ARG_INT, &n_slowest,
+    "Number of the slowest events to list", "N" },
+  { "lazy-submenus", 'l', 0, G_OPTION_ARG_NONE, &lazy_submenus,
+    "Replay with lazy submenus, if the application used them", NULL },
+  { "verbose", 'v', 0, G_OPTION_ARG_NONE, &verbose,
+    "Print every event", NULL },
+  { NULL }
+};
+
+/* A widget of the trace, by number */
+typedef struct {
+  GtkWidget *widget;
+  /* The closure its accel label shows, and the shortcut it has */
+  GClosure *accel;
+  guint key;
+  guint mods;
+} Node;
+
+static GArray *nodes;
+static GtkAccelGroup *accel_group;
+
+/* While the menus are being rebuilt to match the trace, which isn't
+   something the application did */
+static gboolean rebuilding = FALSE;
+
+/* One replayed event */
+typedef struct {
+  guint index;
+  MenuTraceType type;
+  guint id;
+  guint64 time;
+  guint64 ns;
+  guint64 native_ops;
+} Event;
+
+static Node *
+node_get (guint id)
+{
+  if (id >= nodes->len)
+    g_array_set_size (nodes, id + 1);
+  return &g_array_index (nodes, Node, id);
+}
+
+static GtkWidget *
+widget_get (guint id)
+{
+  return id && id < nodes->len ? g_array_index (nodes, Node, id).widget : NULL;
+}
+
+/* What menu_item_parent_changed() in gtkosxapplication_quartz.c does */
+static void
+parent_changed (GtkWidget *menu_item, GtkWidget *old_parent,
+		GtkWidget *new_parent, gint position)
+{
+  gpointer menu;
+
+  if (rebuilding)
+    return;
+  if (GTK_IS_MENU_SHELL (old_parent) &&
+      (menu = menu_sync_get_menu (old_parent))) {
+    gboolean in_sync = menu_sync_remove_child (old_parent, menu, menu_item);
+
+    if (menu_state_is_frozen ())
+      menu_state_record_frozen (old_parent);
+    else if (!in_sync)
+      menu_shell_mark_dirty (old_parent);
+  }
+  if (!GTK_IS_MENU_SHELL (new_parent) ||
+      !(menu = menu_sync_get_menu (new_parent)))
+    return;
+  if (menu_state_is_frozen ()) {
+    menu_state_record_frozen (new_parent);
+    return;
+  }
+  if (menu_sync_insert_child (new_parent, menu, menu_item, position))
+    return;
+  menu_shell_mark_dirty (new_parent);
+  if (GTK_IS_MENU_BAR (new_parent))
+    menu_sync_menubar (new_parent, menu);
+  else
+    menu_sync_shell (new_parent, menu, FALSE);
+}
+
+static void
+accel_activate (void)
+{
+}
+
+/*
+ * node_set_accel:
+ * @node: A menu item's node
+ * @has_accel: Whether its label shows an accel closure
+ * @key: The closure's key, or 0 for none
+ * @mods: Its modifiers
+ * @reconnect: Connect the closure again even if its shortcut hasn't
+ * changed, so that accel-changed is emitted
+ */
+static void
+node_set_accel (Node *node, gboolean has_accel, guint key, guint mods,
+		gboolean reconnect)
+{
+  GtkWidget *label = gtk_bin_get_child (GTK_BIN (node->widget));
+
+  if (!GTK_IS_ACCEL_LABEL (label))
+    return;
+  if (node->accel && (!has_accel || reconnect ||
+		      key != node->key || mods != node->mods)) {
+    if (node->key)
+      gtk_accel_group_disconnect (accel_group, node->accel);
+    node->key = node->mods = 0;
+  }
+  if (node->accel && !has_accel) {
+    gtk_accel_label_set_accel_closure (GTK_ACCEL_LABEL (label), NULL);
+    g_closure_invalidate (node->accel);
+    g_closure_unref (node->accel);
+    node->accel = NULL;
+  }
+  if (!has_accel)
+    return;
+  if (!node->accel) {
+    node->accel = g_cclosure_new (G_CALLBACK (accel_activate), NULL, NULL);
+    g_closure_ref (node->accel);
+    g_closure_sink (node->accel);
+    gtk_accel_label_set_accel_closure (GTK_ACCEL_LABEL (label), node->accel);
+  }
+  if (key && key != node->key) {
+    node->key = key;
+    node->mods = mods;
+    gtk_accel_group_connect (accel_group, key, mods, GTK_ACCEL_VISIBLE,
+			     node->accel);
+  }
+}
+
+static void
+node_set_state (Node *node, guint state, guint flags)
+{
+  GtkWidget *widget = node->widget;
+
+  if (flags & MENU_UPDATE_STATE) {
+    gtk_widget_set_sensitive (widget, (state & MENU_TRACE_SENSITIVE) != 0);
+    gtk_widget_set_visible (widget, (state & MENU_TRACE_VISIBLE) != 0);
+  }
+  if (flags & MENU_UPDATE_CHECKED && GTK_IS_CHECK_MENU_ITEM (widget)) {
+    gtk_check_menu_item_set_active (GTK_CHECK_MENU_ITEM (widget),
+				    (state & MENU_TRACE_ACTIVE) != 0);
+    gtk_check_menu_item_set_inconsistent (GTK_CHECK_MENU_ITEM (widget),
+					  (state & MENU_TRACE_INCONSISTENT) != 0);
+  }
+}
+
+static void
+node_set_label (Node *node, const gchar *label)
+{
+  const gchar *old_label;
+
+  if (GTK_IS_SEPARATOR_MENU_ITEM (node->widget) ||
+      GTK_IS_TEAROFF_MENU_ITEM (node->widget))
+    return;
+  old_label = gtk_menu_item_get_label (GTK_MENU_ITEM (node->widget));
+  if (g_strcmp0 (old_label, label) != 0)
+    gtk_menu_item_set_label (GTK_MENU_ITEM (node->widget), label);
+}
+
+/* Take @widget out of its shell, behind the mirror's back */
+static void
+detach (GtkWidget *widget)
+{
+  GtkWidget *parent = gtk_widget_get_parent (widget);
+
+  if (!parent)
+    return;
+  gtk_container_remove (GTK_CONTAINER (parent), widget);
+  if (menu_sync_get_menu (parent))
+    menu_shell_mark_dirty (parent);
+}
+
+/* A SHELL record: create the shell, or put its children right */
+static void
+define_shell (const MenuTraceRecord *record)
+{
+  Node *node = node_get (record->id);
+  GList *children, *l;
+  gboolean same = TRUE;
+  guint i;
+
+  if (!node->widget) {
+    node->widget = record->kind == MENU_TRACE_MENUBAR ?
+      gtk_menu_bar_new () : gtk_menu_new ();
+    g_object_ref_sink (node->widget);
+  }
+  children = gtk_container_get_children (GTK_CONTAINER (node->widget));
+  for (l = children, i = 0; l || i < record->children->len; l = l->next, i++)
+    if (!l || i >= record->children->len ||
+	l->data != widget_get (g_array_index (record->children, guint, i))) {
+      same = FALSE;
+      break;
+    }
+  if (same) {
+    g_list_free (children);
+    return;
+  }
+  for (l = children; l; l = l->next)
+    gtk_container_remove (GTK_CONTAINER (node->widget), l->data);
+  g_list_free (children);
+  for (i = 0; i < record->children->len; i++) {
+    GtkWidget *child = widget_get (g_array_index (record->children, guint, i));
+
+    if (!child)
+      continue;
+    detach (child);
+    gtk_menu_shell_append (GTK_MENU_SHELL (node->widget), child);
+  }
+  if (menu_sync_get_menu (node->widget))
+    menu_shell_mark_dirty (node->widget);
+}
+
+/* An ITEM record: create the item, or bring it up to date */
+static void
+define_item (const MenuTraceRecord *record)
+{
+  Node *node = node_get (record->id);
+  GtkWidget *submenu;
+
+  if (!node->widget) {
+    switch (record->kind) {
+    case MENU_TRACE_CHECK_MENU_ITEM:
+    case MENU_TRACE_RADIO_MENU_ITEM:
+      /* A radio item's group is left out, as each item's changes are
+	 in the trace */
+      node->widget = gtk_check_menu_item_new_with_label (record->label);
+      gtk_check_menu_item_set_draw_as_radio
+	(GTK_CHECK_MENU_ITEM (node->widget),
+	 record->kind == MENU_TRACE_RADIO_MENU_ITEM);
+      break;
+    case MENU_TRACE_SEPARATOR:
+      node->widget = gtk_separator_menu_item_new ();
+      break;
+    case MENU_TRACE_TEAROFF:
+      node->widget = gtk_tearoff_menu_item_new ();
+      break;
+    default:
+      node->widget = gtk_menu_item_new_with_label (record->label);
+      break;
+    }
+    g_object_ref_sink (node->widget);
+  }
+  node_set_state (node, record->state,
+		  MENU_UPDATE_STATE | MENU_UPDATE_CHECKED);
+  node_set_label (node, record->label);
+  node_set_accel (node, (record->state & MENU_TRACE_HAS_ACCEL) != 0,
+		  record->key, record->mods, FALSE);
+  submenu = widget_get (record->submenu);
+  if (gtk_menu_item_get_submenu (GTK_MENU_ITEM (node->widget)) != submenu)
+    gtk_menu_item_set_submenu (GTK_MENU_ITEM (node->widget), submenu);
+}
+
+/* What mirror_menu_bar() does */
+static gpointer
+mirror_menu_bar (GtkWidget *menubar)
+{
+  gpointer native = menu_sync_get_menu (menubar);
+
+  if (!native) {
+    native = menu_backend_record_menubar_new ();
+    menu_sync_connect_menu (menubar, native);
+  }
+  menu_shell_mark_dirty (menubar);
+  menu_sync_shell (menubar, native, TRUE);
+  return native;
+}
+
+/* What shared_menu_bar_activate() does */
+static void
+shared_menu_bar_activate (MenuShareGroup *group, GtkWidget *menubar)
+{
+  if (group->active != menubar) {
+    menu_sync_switch_menubar (group->active, menubar);
+    group->active = menubar;
+  }
+}
+
+static void
+set_menu_bar (GtkWidget *menubar, guint layout)
+{
+  MenuShareGroup *group;
+
+  if (!layout) {
+    mirror_menu_bar (menubar);
+    return;
+  }
+  group = menu_share_group_find (menubar);
+  if (!group) {
+    group = menu_share_group_get (GUINT_TO_POINTER (layout));
+    menu_share_add (group, menubar);
+  }
+  if (!group->active) {
+    group->native = mirror_menu_bar (menubar);
+    group->active = menubar;
+  }
+  else
+    shared_menu_bar_activate (group, menubar);
+}
+
+/* What window_focus_cb() and shared_window_focus_cb() do */
+static void
+focus (GtkWidget *menubar)
+{
+  MenuShareGroup *group = menu_share_group_find (menubar);
+  gpointer native;
+
+  if (group && group->active) {
+    if (group->active == menubar &&
+	menu_shell_needs_sync (menubar, group->native))
+      menu_sync_menubar (menubar, group->native);
+    shared_menu_bar_activate (group, menubar);
+  }
+  else if (!group && (native = menu_sync_get_menu (menubar)) &&
+	   menu_shell_needs_sync (menubar, native))
+    menu_sync_menubar (menubar, native);
+}
+
+/* What gtk_osxapplication_thaw_menubar() does */
+static void
+thaw (void)
+{
+  GList *roots, *l;
+
+  if (!menu_state_thaw ())
+    return;
+  roots = menu_state_take_frozen ();
+  for (l = roots; l; l = l->next) {
+    GtkWidget *root = (GtkWidget*) l->data;
+    gpointer menu = menu_sync_get_menu (root);
+
+    if (menu && GTK_IS_MENU_BAR (root))
+      menu_sync_menubar (root, menu);
+    else if (menu)
+      menu_sync_shell (root, menu, FALSE);
+    g_object_unref (root);
+  }
+  g_list_free (roots);
+}
+
+/* Do a PARENT_SET */
+static void
+parent_set (const MenuTraceRecord *record)
+{
+  GtkWidget *item = widget_get (record->id);
+  GtkWidget *old_parent = widget_get (record->old_parent);
+  GtkWidget *new_parent = widget_get (record->new_parent);
+
+  if (!item)
+    return;
+  if (old_parent && gtk_widget_get_parent (item) == old_parent)
+    gtk_container_remove (GTK_CONTAINER (old_parent), item);
+  if (!new_parent || new_parent == old_parent)
+    return;
+  /* The item is already there if the parent was described with it */
+  if (gtk_widget_get_parent (item)) {
+    rebuilding = TRUE;
+    gtk_container_remove (GTK_CONTAINER (gtk_widget_get_parent (item)), item);
+    rebuilding = FALSE;
+  }
+  gtk_menu_shell_insert (GTK_MENU_SHELL (new_parent), item, record->position);
+}
+
+/*
+ * replay:
+ * @record: An event
+ *
+ * Returns: FALSE if the event refers to a widget the trace hasn't
+ * described, so there's nothing to replay.
+ */
+static gboolean
+replay (const MenuTraceRecord *record)
+{
+  GtkWidget *widget = widget_get (record->id);
+  Node *node;
+
+  if (!widget && record->type != MENU_TRACE_FREEZE &&
+      record->type != MENU_TRACE_THAW)
+    return FALSE;
+  switch (record->type) {
+  case MENU_TRACE_PARENT_SET:
+    parent_set (record);
+    break;
+  case MENU_TRACE_NOTIFY:
+    node = node_get (record->id);
+    node_set_state (node, record->state, record->flags);
+    if (record->flags & MENU_UPDATE_LABEL)
+      node_set_label (node, record->label);
+    if (record->flags & MENU_UPDATE_ACCEL_CLOSURE) {
+      /* The label has a different closure, not just a new shortcut */
+      node_set_accel (node, FALSE, 0, 0, FALSE);
+      node_set_accel (node, (record->state & MENU_TRACE_HAS_ACCEL) != 0,
+		      record->key, record->mods, FALSE);
+    }
+    break;
+  case MENU_TRACE_ACCEL:
+    node_set_accel (node_get (record->id), TRUE, record->key, record->mods,
+		    TRUE);
+    break;
+  case MENU_TRACE_SUBMENU:
+    gtk_menu_item_set_submenu (GTK_MENU_ITEM (widget),
+			       widget_get (record->submenu));
+    break;
+  case MENU_TRACE_SET_MENU_BAR:
+    set_menu_bar (widget, record->layout);
+    break;
+  case MENU_TRACE_SYNC_MENUBAR:
+    if (!menu_sync_get_menu (widget))
+      return FALSE;
+    menu_state_invalidate_all ();
+    menu_sync_menubar (widget, menu_sync_get_menu (widget));
+    break;
+  case MENU_TRACE_FOCUS:
+    focus (widget);
+    break;
+  case MENU_TRACE_MENU_OPEN:
+    if (!menu_sync_get_menu (widget))
+      return FALSE;
+    menu_sync_menu_will_open (widget);
+    break;
+  case MENU_TRACE_FREEZE:
+    menu_state_freeze ();
+    break;
+  case MENU_TRACE_THAW:
+    thaw ();
+    break;
+  default:
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* Slowest first */
+static gint
+compare_ns (gconstpointer a, gconstpointer b)
+{
+  guint64 ns_a = *(const guint64*) a, ns_b = *(const guint64*) b;
+
+  return (ns_a < ns_b) - (ns_a > ns_b);
+}
+
+static gint
+event_compare_ns (gconstpointer a, gconstpointer b)
+{
+  return compare_ns (&((const Event*) a)->ns, &((const Event*) b)->ns);
+}
+
+static void
+print_event (const gchar *prefix, const Event *event)
+{
+  printf ("%s index=%u event=%s id=%u at_ms=%.3f ns=%" G_GUINT64_FORMAT
+	  " native_ops=%" G_GUINT64_FORMAT "\n", prefix, event->index,
+	  menu_trace_type_name (event->type), event->id, event->time / 1e6,
+	  event->ns, event->native_ops);
+}
+
+static void
+report (GArray *events, guint64 trace_ns)
+{
+  GArray *of_type = g_array_new (FALSE, FALSE, sizeof (guint64));
+  guint64 replay_ns = 0;
+  MenuTraceType type;
+  guint i;
+
+  for (type = MENU_TRACE_PARENT_SET; type < MENU_TRACE_N_TYPES; type++) {
+    guint64 total = 0, native_ops = 0;
+
+    g_array_set_size (of_type, 0);
+    for (i = 0; i < events->len; i++) {
+      const Event *event = &g_array_index (events, Event, i);
+
+      if (event->type != type)
+	continue;
+      g_array_append_val (of_type, event->ns);
+      total += event->ns;
+      native_ops += event->native_ops;
+    }
+    if (of_type->len == 0)
+      continue;
+    replay_ns += total;
+    g_array_sort (of_type, compare_ns);
+    printf ("event=%s count=%u mean_ns=%.0f p50_ns=%" G_GUINT64_FORMAT
+	    " p99_ns=%" G_GUINT64_FORMAT " max_ns=%" G_GUINT64_FORMAT
+	    " native_ops_per_event=%.1f\n",
+	    menu_trace_type_name (type), of_type->len,
+	    (double) total / of_type->len,
+	    g_array_index (of_type, guint64, of_type->len / 2),
+	    g_array_index (of_type, guint64, of_type->len / 100),
+	    g_array_index (of_type, guint64, 0),
+	    (double) native_ops / of_type->len);
+  }
+  g_array_free (of_type, TRUE);
+
+  g_array_sort (events, event_compare_ns);
+  for (i = 0; i < events->len && i < (guint) n_slowest; i++)
+    print_event ("slow", &g_array_index (events, Event, i));
+  printf ("events=%u widgets=%u trace_ms=%.3f replay_ms=%.3f\n",
+	  events->len, nodes->len > 0 ? nodes->len - 1 : 0, trace_ns / 1e6,
+	  replay_ns / 1e6);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  MenuTraceReader *reader;
+  MenuTraceRecord record;
+  GArray *events;
+  guint64 trace_ns = 0;
+  guint index = 0;
+
+  context = g_option_context_new ("TRACE - replay a menu trace");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+  if (argc != 2) {
+    g_printerr ("Usage: %s [OPTION...] TRACE\n", argv[0]);
+    return 1;
+  }
+  if (!(reader = menu_trace_reader_open (argv[1], &error))) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+
+  menu_sync_set_backend (&menu_backend_record);
+  menu_watch_set_func (parent_changed);
+  menu_shortcut_set_func (menu_accel_dispatch);
+  menu_state_set_lazy_submenus (lazy_submenus);
+
+  nodes = g_array_new (FALSE, TRUE, sizeof (Node));
+  accel_group = gtk_accel_group_new ();
+  events = g_array_new (FALSE, FALSE, sizeof (Event));
+
+  while (menu_trace_reader_next (reader, &record, &error)) {
+    Event event = { 0 };
+    guint64 native_ops;
+
+    trace_ns = record.time;
+    if (record.type == MENU_TRACE_SHELL || record.type == MENU_TRACE_ITEM) {
+      rebuilding = TRUE;
+      if (record.type == MENU_TRACE_SHELL)
+	define_shell (&record);
+      else
+	define_item (&record);
+      rebuilding = FALSE;
+      menu_trace_record_clear (&record);
+      continue;
+    }
+    /* Whatever the rebuilding left queued isn't the event's doing */
+    menu_update_flush ();
+
+    event.index = index++;
+    event.type = record.type;
+    event.id = record.id;
+    event.time = record.time;
+    native_ops = menu_backend_record_get_stats ()->native_ops;
+    event.ns = menu_stats_now_ns ();
+    if (replay (&record)) {
+      menu_update_flush ();
+      event.ns = menu_stats_now_ns () - event.ns;
+      event.native_ops = menu_backend_record_get_stats ()->native_ops
+	- native_ops;
+      g_array_append_val (events, event);
+      if (verbose)
+	print_event ("replayed", &event);
+    }
+    menu_trace_record_clear (&record);
+  }
+  menu_trace_reader_close (reader);
+  /* The application may not have got as far as stopping the trace,
+     so replay what there is */
+  if (error) {
+    g_printerr ("%s\n", error->message);
+    g_error_free (error);
+  }
+
+  report (events, trace_ns);
+  g_array_free (events, TRUE);
+  return 0;
+}
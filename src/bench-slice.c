@@ -0,0 +1,340 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/*
+ * Measures how long the main loop is held up while a plugin fills
+ * the menus, with and without a sync budget
+ * (gtk_osxapplication_set_menu_sync_budget()). Each round mirrors a
+ * fresh menubar into the in-memory native menus of
+ * menu_backend_record.h, then, with the menus frozen, has a "plugin"
+ * hang a number of new submenus full of items off the menubar's
+ * menus, and thaws them. Straight after the thaw the user opens the
+ * last of the plugin's submenus; after that the main loop is run
+ * until it's idle, which with a budget is when pre-warming has
+ * finished the sync, and the native menus are checked against the
+ * GtkMenuShells.
+ *
+ * The longest stretch the main loop was held up for is the longer of
+ * the thaw and the slowest main loop iteration; frames_missed counts
+ * those over 16.7ms, a frame at 60Hz.
+ *
+ * Output is one line per scenario of whitespace-separated key=value
+ * pairs, the times being averages over the rounds except for the
+ * maximum.
+ */
+
+#include <gtk/gtk.h>
+#include <stdio.h>
+#include "menu_backend_record.h"
+#include "menu_prewarm.h"
+#include "menu_state.h"
+#include "menu_stats.h"
+#include "menu_sync.h"
+#include "menu_update.h"
+#include "menu_watch.h"
+
+#define FRAME_NS G_GUINT64_CONSTANT (16666667)
+
+static gint n_menus = 8;
+static gint n_items = 30;
+static gint n_plugin_menus = 40;
+static gint n_plugin_items = 8000;
+static gint budget_us = 2000;
+static gint n_rounds = 5;
+
+static GOptionEntry entries[] = {
+  { "menus", 'm', 0, G_OPTION_ARG_INT, &n_menus,
+    "Number of menus on the menubar", "N" },
+  { "items", 'i', 0, G_OPTION_ARG_INT, &n_items,
+    "Number of items in each of them to begin with", "N" },
+  { "plugin-menus", 'p', 0, G_OPTION_ARG_INT, &n_plugin_menus,
+    "Number of submenus the plugin adds", "N" },
+  { "plugin-items", 'n', 0, G_OPTION_ARG_INT, &n_plugin_items,
+    "Number of items the plugin adds, spread over its submenus", "N" },
+  { "budget", 'u', 0, G_OPTION_ARG_INT, &budget_us,
+    "Sync budget to compare with none, in microseconds", "US" },
+  { "rounds", 'r', 0, G_OPTION_ARG_INT, &n_rounds,
+    "Number of times to load the plugin", "N" },
+  { NULL }
+};
+
+/* What menu_item_parent_changed() in gtkosxapplication_quartz.c does */
+static void
+parent_changed (GtkWidget *menu_item, GtkWidget *old_parent,
+		GtkWidget *new_parent, gint position)
+{
+  gpointer menu;
+
+  if (GTK_IS_MENU_SHELL (old_parent) &&
+      (menu = menu_sync_get_menu (old_parent))) {
+    gboolean in_sync = menu_sync_remove_child (old_parent, menu, menu_item);
+
+    if (menu_state_is_frozen ())
+      menu_state_record_frozen (old_parent);
+    else if (!in_sync)
+      menu_shell_mark_dirty (old_parent);
+  }
+  if (!GTK_IS_MENU_SHELL (new_parent) ||
+      !(menu = menu_sync_get_menu (new_parent)))
+    return;
+  if (menu_state_is_frozen ()) {
+    menu_state_record_frozen (new_parent);
+    return;
+  }
+  if (menu_sync_insert_child (new_parent, menu, menu_item, position))
+    return;
+  menu_shell_mark_dirty (new_parent);
+  if (GTK_IS_MENU_BAR (new_parent))
+    menu_sync_menubar (new_parent, menu);
+  else
+    menu_sync_shell (new_parent, menu, FALSE);
+}
+
+/* What gtk_osxapplication_thaw_menubar() does */
+static void
+thaw (void)
+{
+  GList *roots, *l;
+
+  if (!menu_state_thaw ())
+    return;
+  roots = menu_state_take_frozen ();
+  menu_state_begin_slice ();
+  for (l = roots; l; l = l->next) {
+    GtkWidget *root = (GtkWidget*) l->data;
+    gpointer menu = menu_sync_get_menu (root);
+
+    if (menu && GTK_IS_MENU_BAR (root))
+      menu_sync_menubar (root, menu);
+    else if (menu)
+      menu_sync_shell (root, menu, FALSE);
+    g_object_unref (root);
+  }
+  menu_state_end_slice ();
+  g_list_free (roots);
+  menu_update_flush ();
+  menu_prewarm_schedule ();
+}
+
+static GtkWidget *
+menu_new (gint n, const gchar *prefix)
+{
+  GtkWidget *menu = gtk_menu_new ();
+  gint i;
+
+  for (i = 0; i < n; i++) {
+    gchar *label = g_strdup_printf ("%s %d", prefix, i);
+
+    gtk_menu_shell_append (GTK_MENU_SHELL (menu),
+			   gtk_menu_item_new_with_label (label));
+    g_free (label);
+  }
+  return menu;
+}
+
+static GtkWidget *
+menubar_new (MenuRecordMenu **native)
+{
+  GtkWidget *menubar = g_object_ref_sink (gtk_menu_bar_new ());
+  gint i;
+
+  for (i = 0; i < n_menus; i++) {
+    gchar *label = g_strdup_printf ("Menu %d", i);
+    GtkWidget *top = gtk_menu_item_new_with_label (label);
+
+    g_free (label);
+    gtk_menu_item_set_submenu (GTK_MENU_ITEM (top), menu_new (n_items, "Item"));
+    gtk_menu_shell_append (GTK_MENU_SHELL (menubar), top);
+  }
+  gtk_widget_show_all (menubar);
+
+  /* What mirror_menu_bar() does */
+  *native = menu_backend_record_menubar_new ();
+  menu_sync_connect_menu (menubar, *native);
+  menu_shell_mark_dirty (menubar);
+  menu_sync_menubar (menubar, *native);
+  menu_update_flush ();
+  menu_prewarm_add (menubar);
+  return menubar;
+}
+
+/*
+ * The plugin: each submenu is filled before it's attached, as
+ * GtkUIManager does, and hung off the menubar's menus in turn.
+ * Returns the last one.
+ */
+static GtkWidget *
+load_plugin (GtkWidget *menubar)
+{
+  GList *tops = gtk_container_get_children (GTK_CONTAINER (menubar));
+  GtkWidget *submenu = NULL;
+  gint i;
+
+  for (i = 0; i < n_plugin_menus; i++) {
+    GtkWidget *top = g_list_nth_data (tops, i % n_menus);
+    GtkWidget *menu = gtk_menu_item_get_submenu (GTK_MENU_ITEM (top));
+    GtkWidget *item = gtk_menu_item_new_with_label ("Plugin");
+    gint n = n_plugin_items / n_plugin_menus +
+      (i < n_plugin_items % n_plugin_menus ? 1 : 0);
+
+    submenu = menu_new (n, "Plugin item");
+    gtk_menu_item_set_submenu (GTK_MENU_ITEM (item), submenu);
+    gtk_widget_show_all (item);
+    gtk_menu_shell_append (GTK_MENU_SHELL (menu), item);
+  }
+  g_list_free (tops);
+  return submenu;
+}
+
+/* What the user does: open the menus leading to @menu_shell, and
+   then it */
+static void
+open_menu (GtkWidget *menu_shell)
+{
+  GtkWidget *parent = menu_shell_get_parent_shell (menu_shell);
+
+  if (parent && !GTK_IS_MENU_BAR (parent))
+    open_menu (parent);
+  menu_backend_record_open (menu_sync_get_menu (menu_shell));
+}
+
+/* Whether @menu_shell and everything below it has been built */
+static gboolean
+shell_complete (GtkWidget *menu_shell)
+{
+  MenuRecordMenu *menu = menu_sync_get_menu (menu_shell);
+  GList *children, *l;
+  guint n_native;
+  gboolean complete;
+
+  if (!menu || menu_shell_state_get (menu_shell)->deferred)
+    return FALSE;
+  children = gtk_container_get_children (GTK_CONTAINER (menu_shell));
+  n_native = menu->items->len - (menu->menubar ? 1 : 0);
+  complete = n_native == g_list_length (children);
+  for (l = children; l && complete; l = l->next) {
+    GtkWidget *submenu = gtk_menu_item_get_submenu (GTK_MENU_ITEM (l->data));
+
+    complete = !submenu || shell_complete (submenu);
+  }
+  g_list_free (children);
+  return complete;
+}
+
+static gboolean
+run (guint budget)
+{
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  guint64 thaw_ns = 0, open_ns = 0, settle_ns = 0, max_ns = 0;
+  guint iterations = 0, frames_missed = 0;
+  gboolean complete = TRUE;
+  gint round;
+
+  menu_state_set_sync_budget (budget);
+  menu_stats_reset ();
+  for (round = 0; round < n_rounds; round++) {
+    MenuRecordMenu *native;
+    GtkWidget *menubar = menubar_new (&native), *opened;
+    guint64 start, ns, open_start;
+
+    menu_state_freeze ();
+    opened = load_plugin (menubar);
+
+    start = menu_stats_now_ns ();
+    thaw ();
+    ns = menu_stats_now_ns () - start;
+    thaw_ns += ns;
+    max_ns = MAX (max_ns, ns);
+    frames_missed += ns > FRAME_NS;
+
+    open_start = menu_stats_now_ns ();
+    open_menu (opened);
+    open_ns += menu_stats_now_ns () - open_start;
+    complete = complete && shell_complete (opened);
+
+    for (;;) {
+      guint64 iteration_start = menu_stats_now_ns ();
+
+      if (!g_main_context_iteration (NULL, FALSE))
+	break;
+      ns = menu_stats_now_ns () - iteration_start;
+      max_ns = MAX (max_ns, ns);
+      frames_missed += ns > FRAME_NS;
+      ++iterations;
+    }
+    settle_ns += menu_stats_now_ns () - start;
+    complete = complete && shell_complete (menubar);
+
+    gtk_widget_destroy (menubar);
+    g_object_unref (menubar);
+    menu_backend_record.menu_unref (native);
+  }
+
+  printf ("scenario=%s budget_us=%u menus=%d plugin_menus=%d"
+	  " plugin_items=%d rounds=%d thaw_ns=%" G_GUINT64_FORMAT
+	  " open_ns=%" G_GUINT64_FORMAT " settle_ns=%" G_GUINT64_FORMAT
+	  " max_stall_ns=%" G_GUINT64_FORMAT " frames_missed=%u"
+	  " iterations=%u shells_postponed=%" G_GUINT64_FORMAT
+	  " complete=%s\n",
+	  budget ? "sliced" : "unsliced", budget, n_menus, n_plugin_menus,
+	  n_plugin_items, n_rounds, thaw_ns / n_rounds, open_ns / n_rounds,
+	  settle_ns / n_rounds, max_ns, frames_missed, iterations / n_rounds,
+	  stats->shells_postponed / n_rounds, complete ? "yes" : "no");
+  return complete;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  gboolean complete;
+
+  context = g_option_context_new ("- time the main loop while a plugin fills the menus");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+  if (n_menus < 1 || n_items < 0 || n_plugin_menus < 1 ||
+      n_plugin_items < 0 || budget_us < 1 || n_rounds < 1) {
+    g_printerr ("--menus, --plugin-menus, --budget and --rounds must be "
+		"positive\n");
+    return 1;
+  }
+
+  menu_sync_set_backend (&menu_backend_record);
+  menu_watch_set_func (parent_changed);
+  menu_prewarm_set_func (menu_sync_prewarm);
+  menu_state_set_changed_func (menu_prewarm_schedule);
+
+  complete = run (0);
+  complete = run (budget_us) && complete;
+  if (!complete) {
+    g_printerr ("the native menus weren't all built\n");
+    return 1;
+  }
+  return 0;
+}
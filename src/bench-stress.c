@@ -0,0 +1,1304 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+/*
+ * Throws random changes at a mirrored menubar and checks, after each
+ * batch of them, that the in-memory native menus of
+ * menu_backend_record.h are exactly what the GTK+ menus say they
+ * should be: the same items in the same order, with the same titles,
+ * state, key equivalents and submenus, all the way down. The changes
+ * are the ones applications make, through the calls they'd use:
+ *
+ *   add		a new item, or one removed earlier, put anywhere
+ *   remove		an item taken out of its menu
+ *   move		an item taken out and put back elsewhere in its menu
+ *   reparent		an item moved to another menu
+ *   visible		an item hidden or shown
+ *   sensitive		an item greyed out or made sensitive again
+ *   toggle		a check or radio item set, or made inconsistent
+ *   submenu		submenus swapped between items or moved to another
+ *			item, taken off, or added
+ *   label		an item's label changed
+ *   accel		an item's accelerator changed, taken off, or added
+ *   resync		a menu's items reordered without anyone hearing of
+ *			it, and then gtk_osxapplication_sync_menubar()
+ *   foreign		an item or a separator put at the end of the native
+ *			menubar by the application, or taken off again;
+ *			syncs have to leave these be
+ *
+ * Each batch ends with the main loop running the idle handlers,
+ * pre-warming among them, so that with --budget the submenus a sync
+ * ran out of time for are finished before the check. If
+ * the menus don't match, the mismatch, the seed and the batch's
+ * changes are printed, so that it can be reproduced, and the exit
+ * status is 1. Otherwise the output is one line per kind of change
+ * and a total, of whitespace-separated key=value pairs; the times
+ * leave out the checking.
+ */
+
+#include <gtk/gtk.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include "getlabel.h"
+#include "menu_accel.h"
+#include "menu_backend_record.h"
+#include "menu_prewarm.h"
+#include "menu_shortcut.h"
+#include "menu_state.h"
+#include "menu_stats.h"
+#include "menu_sync.h"
+#include "menu_update.h"
+#include "menu_watch.h"
+
+static gint n_ops = 1000000;
+static gint batch_size = 100;
+static gint n_target = 300;
+static gint seed = 1;
+static gdouble accel_density = 0.15;
+static gint budget_us = 0;
+
+static GOptionEntry entries[] = {
+  { "ops", 'o', 0, G_OPTION_ARG_INT, &n_ops,
+    "Number of changes to make", "N" },
+  { "batch", 'b', 0, G_OPTION_ARG_INT, &batch_size,
+    "Number of changes between checks", "N" },
+  { "items", 'i', 0, G_OPTION_ARG_INT, &n_target,
+    "Number of items to keep the menubar at, roughly", "N" },
+  { "seed", 's', 0, G_OPTION_ARG_INT, &seed,
+    "Seed for the random changes", "N" },
+  { "accel-density", 'a', 0, G_OPTION_ARG_DOUBLE, &accel_density,
+    "Share of the new items with an accelerator", "F" },
+  { "budget", 'u', 0, G_OPTION_ARG_INT, &budget_us,
+    "Sync budget in microseconds, 0 for none", "US" },
+  { NULL }
+};
+
+typedef enum {
+  OP_ADD,
+  OP_REMOVE,
+  OP_MOVE,
+  OP_REPARENT,
+  OP_VISIBLE,
+  OP_SENSITIVE,
+  OP_TOGGLE,
+  OP_SUBMENU,
+  OP_LABEL,
+  OP_ACCEL,
+  OP_RESYNC,
+  OP_FOREIGN,
+  N_OPS
+} Op;
+
+static const struct {
+  const gchar *name;
+  guint weight;
+} op_info[N_OPS] = {
+  { "add",        0 },	/* Worked out from the menubar's size */
+  { "remove",     0 },
+  { "move",      10 },
+  { "reparent",  10 },
+  { "visible",   10 },
+  { "sensitive", 10 },
+  { "toggle",    10 },
+  { "submenu",    6 },
+  { "label",     10 },
+  { "accel",      8 },
+  { "resync",     1 },
+  { "foreign",    1 }
+};
+
+/* Shared titles, as well as each item's own */
+static const gchar *const common_labels[] = {
+  "Open", "Save", "Close", "Copy", "Paste", "Undo", "Preferences…"
+};
+
+/* A change, for the report if it goes wrong */
+typedef struct {
+  Op op;
+  guint serial;
+  guint other;
+  gint position;
+} LogEntry;
+
+typedef struct {
+  GtkWidget *menubar;
+  MenuRecordMenu *native;
+  /* What was in the menubar at the last check, and everything made
+     since, each with a reference */
+  GPtrArray *items;
+  GPtrArray *shells;
+  /* Taken out and not put back yet, also with references */
+  GPtrArray *loose_items;
+  GPtrArray *loose_menus;
+  guint n_items;
+  guint serial;
+  GRand *rand;
+  GtkAccelGroup *accel_group;
+  GArray *free_shortcuts;
+  /* Given up during this batch; they're only handed out again after
+     the flush, so that one closure never takes over another's
+     shortcut before the sync engine has heard that it's gone */
+  GArray *released_shortcuts;
+  /* The accelerators of finalized items, to let go of between
+     batches */
+  GPtrArray *dead_accels;
+  /* The native menubar's items which the sync engine didn't make, in
+     order, each with a reference */
+  GPtrArray *foreign;
+  GArray *log;
+} Tree;
+
+/* An item's accelerator, if it's been given one */
+typedef struct {
+  Tree *tree;
+  GClosure *closure;
+  /* What the closure is connected with, or -1 */
+  gint shortcut;
+} ItemAccel;
+
+static GQuark serial_quark;
+static GQuark dead_quark;
+static GQuark accel_quark;
+
+static guint
+widget_serial (GtkWidget *widget)
+{
+  return GPOINTER_TO_UINT (g_object_get_qdata (G_OBJECT (widget),
+					       serial_quark));
+}
+
+static gboolean
+widget_is_dead (GtkWidget *widget)
+{
+  return g_object_get_qdata (G_OBJECT (widget), dead_quark) != NULL;
+}
+
+static void
+widget_destroyed (GtkWidget *widget)
+{
+  g_object_set_qdata (G_OBJECT (widget), dead_quark, GINT_TO_POINTER (1));
+}
+
+/* Number @widget and hold a reference to it */
+static GtkWidget *
+tree_track (Tree *tree, GtkWidget *widget)
+{
+  g_object_ref_sink (widget);
+  g_object_set_qdata (G_OBJECT (widget), serial_quark,
+		      GUINT_TO_POINTER (++tree->serial));
+  g_signal_connect (widget, "destroy", G_CALLBACK (widget_destroyed), NULL);
+  return widget;
+}
+
+static gint
+random_index (Tree *tree, guint n)
+{
+  return g_rand_int_range (tree->rand, 0, n);
+}
+
+static gboolean
+chance (Tree *tree, gdouble p)
+{
+  return g_rand_double (tree->rand) < p;
+}
+
+/*
+ * Whether @widget is @ancestor or somewhere below it, going up from
+ * items to their menus and from menus to the items they're the
+ * submenus of.
+ */
+static gboolean
+is_inside (GtkWidget *widget, GtkWidget *ancestor)
+{
+  while (widget) {
+    if (widget == ancestor)
+      return TRUE;
+    if (GTK_IS_MENU (widget))
+      widget = gtk_menu_get_attach_widget (GTK_MENU (widget));
+    else
+      widget = gtk_widget_get_parent (widget);
+  }
+  return FALSE;
+}
+
+static guint
+n_children (GtkWidget *shell)
+{
+  GList *children = gtk_container_get_children (GTK_CONTAINER (shell));
+  guint n = g_list_length (children);
+
+  g_list_free (children);
+  return n;
+}
+
+typedef gboolean (*PickFunc) (GtkWidget *widget);
+
+/* A live widget from @from which @func likes, if one turns up */
+static GtkWidget *
+pick (Tree *tree, GPtrArray *from, PickFunc func)
+{
+  gint tries;
+
+  for (tries = 0; tries < 16 && from->len > 0; tries++) {
+    GtkWidget *widget = g_ptr_array_index (from,
+					   random_index (tree, from->len));
+
+    if (!widget_is_dead (widget) && (!func || func (widget)))
+      return widget;
+  }
+  return NULL;
+}
+
+static gboolean
+is_placed (GtkWidget *item)
+{
+  return gtk_widget_get_parent (item) != NULL;
+}
+
+static gboolean
+is_loose (GtkWidget *widget)
+{
+  if (GTK_IS_MENU (widget))
+    return gtk_menu_get_attach_widget (GTK_MENU (widget)) == NULL;
+  return gtk_widget_get_parent (widget) == NULL;
+}
+
+static gboolean
+is_menu (GtkWidget *shell)
+{
+  return GTK_IS_MENU (shell);
+}
+
+static gboolean
+is_labelled (GtkWidget *item)
+{
+  return !GTK_IS_SEPARATOR_MENU_ITEM (item);
+}
+
+static gboolean
+is_check (GtkWidget *item)
+{
+  return GTK_IS_CHECK_MENU_ITEM (item);
+}
+
+static gboolean
+is_radio (GtkWidget *item)
+{
+  return GTK_IS_RADIO_MENU_ITEM (item);
+}
+
+static gboolean
+has_submenu (GtkWidget *item)
+{
+  return (GTK_IS_MENU_ITEM (item) &&
+	  gtk_menu_item_get_submenu (GTK_MENU_ITEM (item)) != NULL);
+}
+
+static gboolean
+can_have_submenu (GtkWidget *item)
+{
+  return is_labelled (item) && !has_submenu (item);
+}
+
+/*
+ * The shortcuts to hand out, as in bench-menu-sync: a letter or
+ * digit with any combination of Control, Option, Command, and Shift,
+ * but not Shift alone. No two closures have the same one, so every
+ * item with an accelerator shows it.
+ */
+#define N_ACCEL_KEYS 36
+#define N_ACCEL_MODS 14
+#define N_SHORTCUTS (N_ACCEL_KEYS * N_ACCEL_MODS)
+
+static void
+shortcut_get (guint shortcut, guint *key, GdkModifierType *mods)
+{
+  static const GdkModifierType mod_bits[] = {
+    GDK_CONTROL_MASK, GDK_MOD5_MASK, GDK_META_MASK, GDK_SHIFT_MASK
+  };
+  guint key_index = shortcut % N_ACCEL_KEYS;
+  guint combination = shortcut / N_ACCEL_KEYS + 1, bit;
+
+  /* Skip Shift alone */
+  if (combination >= 8)
+    combination++;
+  *key = key_index < 26 ? 'a' + key_index : '0' + key_index - 26;
+  *mods = 0;
+  for (bit = 0; bit < G_N_ELEMENTS (mod_bits); bit++)
+    if (combination & (1 << bit))
+      *mods |= mod_bits[bit];
+}
+
+static void
+accel_activate (void)
+{
+}
+
+/*
+ * Connect a shortcut nobody else has to @accel's closure. A closure
+ * is only ever on a label while it's connected, as one made for an
+ * accel path is: the label, and so the sync engine, can only watch
+ * for changes to a closure in a group.
+ */
+static gboolean
+accel_connect (ItemAccel *accel)
+{
+  Tree *tree = accel->tree;
+  GArray *free_shortcuts = tree->free_shortcuts;
+  GdkModifierType mods;
+  guint index, key;
+
+  if (free_shortcuts->len == 0)
+    return FALSE;
+  index = random_index (tree, free_shortcuts->len);
+  accel->shortcut = g_array_index (free_shortcuts, guint, index);
+  g_array_remove_index_fast (free_shortcuts, index);
+  shortcut_get (accel->shortcut, &key, &mods);
+  gtk_accel_group_connect (tree->accel_group, key, mods, GTK_ACCEL_VISIBLE,
+			   accel->closure);
+  return TRUE;
+}
+
+static void
+accel_disconnect (ItemAccel *accel)
+{
+  guint shortcut = accel->shortcut;
+
+  if (accel->shortcut < 0)
+    return;
+  gtk_accel_group_disconnect (accel->tree->accel_group, accel->closure);
+  accel->shortcut = -1;
+  g_array_append_val (accel->tree->released_shortcuts, shortcut);
+}
+
+/*
+ * The item has been finalized, but disconnecting the closure now
+ * would tell the sync engine about an item that's half gone; it's
+ * done between batches.
+ */
+static void
+accel_item_finalized (gpointer data)
+{
+  ItemAccel *accel = (ItemAccel*) data;
+
+  g_ptr_array_add (accel->tree->dead_accels, accel);
+}
+
+static void
+accel_free (ItemAccel *accel)
+{
+  if (accel->closure) {
+    accel_disconnect (accel);
+    g_closure_unref (accel->closure);
+  }
+  g_slice_free (ItemAccel, accel);
+}
+
+static GtkWidget *
+item_label (GtkWidget *item)
+{
+  return gtk_bin_get_child (GTK_BIN (item));
+}
+
+/* Give @item a closure on its accel label, with a shortcut */
+static gboolean
+item_add_accel (Tree *tree, GtkWidget *item)
+{
+  ItemAccel *accel = g_object_get_qdata (G_OBJECT (item), accel_quark);
+
+  if (!GTK_IS_ACCEL_LABEL (item_label (item)) ||
+      tree->free_shortcuts->len == 0)
+    return FALSE;
+  if (!accel) {
+    accel = g_slice_new0 (ItemAccel);
+    accel->tree = tree;
+    accel->shortcut = -1;
+    g_object_set_qdata_full (G_OBJECT (item), accel_quark, accel,
+			     accel_item_finalized);
+  }
+  accel->closure = g_cclosure_new (G_CALLBACK (accel_activate), NULL, NULL);
+  g_closure_ref (accel->closure);
+  g_closure_sink (accel->closure);
+  accel_connect (accel);
+  gtk_accel_label_set_accel_closure (GTK_ACCEL_LABEL (item_label (item)),
+				     accel->closure);
+  return TRUE;
+}
+
+static GtkWidget *
+item_new (Tree *tree)
+{
+  gdouble kind = g_rand_double (tree->rand);
+  GtkWidget *item;
+  gchar *label;
+
+  if (kind < 0.1) {
+    item = tree_track (tree, gtk_separator_menu_item_new ());
+    g_ptr_array_add (tree->items, item);
+    gtk_widget_set_visible (item, TRUE);
+    return item;
+  }
+
+  label = g_strdup_printf ("Item %u", tree->serial + 1);
+  if (kind < 0.25)
+    item = gtk_check_menu_item_new_with_label (label);
+  else if (kind < 0.35) {
+    GtkWidget *group = chance (tree, 0.7) ? pick (tree, tree->items, is_radio)
+					  : NULL;
+
+    item = gtk_radio_menu_item_new_with_label_from_widget
+      (group ? GTK_RADIO_MENU_ITEM (group) : NULL, label);
+  }
+  else
+    item = gtk_menu_item_new_with_label (label);
+  g_free (label);
+  tree_track (tree, item);
+  g_ptr_array_add (tree->items, item);
+  gtk_widget_set_visible (item, TRUE);
+  if (chance (tree, accel_density))
+    item_add_accel (tree, item);
+  return item;
+}
+
+static GtkWidget *
+menu_new (Tree *tree, guint n)
+{
+  GtkWidget *menu = tree_track (tree, gtk_menu_new ());
+
+  g_ptr_array_add (tree->shells, menu);
+  while (n-- > 0)
+    gtk_menu_shell_append (GTK_MENU_SHELL (menu), item_new (tree));
+  return menu;
+}
+
+/* What menu_item_parent_changed() in gtkosxapplication_quartz.c does */
+static void
+parent_changed (GtkWidget *menu_item, GtkWidget *old_parent,
+		GtkWidget *new_parent, gint position)
+{
+  gpointer menu;
+
+  if (GTK_IS_MENU_SHELL (old_parent) &&
+      (menu = menu_sync_get_menu (old_parent)) &&
+      !menu_sync_remove_child (old_parent, menu, menu_item))
+    menu_shell_mark_dirty (old_parent);
+
+  if (!GTK_IS_MENU_SHELL (new_parent) ||
+      !(menu = menu_sync_get_menu (new_parent)) ||
+      menu_sync_insert_child (new_parent, menu, menu_item, position))
+    return;
+  menu_shell_mark_dirty (new_parent);
+  if (GTK_IS_MENU_BAR (new_parent))
+    menu_sync_menubar (new_parent, menu);
+  else
+    menu_sync_shell (new_parent, menu, FALSE);
+}
+
+/* Somewhere to put @item, which mustn't end up inside itself */
+static GtkWidget *
+pick_shell (Tree *tree, GtkWidget *item, gint *position)
+{
+  gint tries;
+
+  for (tries = 0; tries < 16; tries++) {
+    GtkWidget *shell = pick (tree, tree->shells, NULL);
+
+    if (shell && !is_inside (shell, item)) {
+      *position = chance (tree, 0.1) ? -1 :
+	random_index (tree, n_children (shell) + 1);
+      return shell;
+    }
+  }
+  return NULL;
+}
+
+static void
+item_remove (GtkWidget *item)
+{
+  gtk_container_remove (GTK_CONTAINER (gtk_widget_get_parent (item)), item);
+}
+
+/*
+ * Each op_*() makes one change and fills in @entry, or returns FALSE
+ * if it couldn't find anything to change.
+ */
+static gboolean
+op_add (Tree *tree, LogEntry *entry)
+{
+  GtkWidget *item = NULL, *shell;
+
+  if (chance (tree, 0.3))
+    item = pick (tree, tree->loose_items, is_loose);
+  if (!item)
+    item = item_new (tree);
+  if (!(shell = pick_shell (tree, item, &entry->position)))
+    return FALSE;
+  gtk_menu_shell_insert (GTK_MENU_SHELL (shell), item, entry->position);
+  entry->serial = widget_serial (item);
+  entry->other = widget_serial (shell);
+  tree->n_items++;
+  return TRUE;
+}
+
+static gboolean
+op_remove (Tree *tree, LogEntry *entry)
+{
+  GtkWidget *item = pick (tree, tree->items, is_placed);
+
+  if (!item)
+    return FALSE;
+  entry->serial = widget_serial (item);
+  entry->other = widget_serial (gtk_widget_get_parent (item));
+  g_ptr_array_add (tree->loose_items, g_object_ref (item));
+  item_remove (item);
+  tree->n_items--;
+  return TRUE;
+}
+
+static gboolean
+op_move (Tree *tree, LogEntry *entry)
+{
+  GtkWidget *item = pick (tree, tree->items, is_placed), *shell;
+
+  if (!item)
+    return FALSE;
+  shell = gtk_widget_get_parent (item);
+  g_object_ref (item);
+  item_remove (item);
+  entry->position = random_index (tree, n_children (shell) + 1);
+  gtk_menu_shell_insert (GTK_MENU_SHELL (shell), item, entry->position);
+  g_object_unref (item);
+  entry->serial = widget_serial (item);
+  entry->other = widget_serial (shell);
+  return TRUE;
+}
+
+static gboolean
+op_reparent (Tree *tree, LogEntry *entry)
+{
+  GtkWidget *item = pick (tree, tree->items, is_placed), *shell;
+
+  if (!item || !(shell = pick_shell (tree, item, &entry->position)))
+    return FALSE;
+  g_object_ref (item);
+  item_remove (item);
+  gtk_menu_shell_insert (GTK_MENU_SHELL (shell), item, entry->position);
+  g_object_unref (item);
+  entry->serial = widget_serial (item);
+  entry->other = widget_serial (shell);
+  return TRUE;
+}
+
+static gboolean
+op_visible (Tree *tree, LogEntry *entry)
+{
+  GtkWidget *item = pick (tree, tree->items, NULL);
+
+  if (!item)
+    return FALSE;
+  gtk_widget_set_visible (item, !gtk_widget_get_visible (item));
+  entry->serial = widget_serial (item);
+  return TRUE;
+}
+
+static gboolean
+op_sensitive (Tree *tree, LogEntry *entry)
+{
+  GtkWidget *item = pick (tree, tree->items, NULL);
+
+  if (!item)
+    return FALSE;
+  gtk_widget_set_sensitive (item, !gtk_widget_get_sensitive (item));
+  entry->serial = widget_serial (item);
+  return TRUE;
+}
+
+static gboolean
+op_toggle (Tree *tree, LogEntry *entry)
+{
+  GtkWidget *item = pick (tree, tree->items, is_check);
+  GtkCheckMenuItem *check;
+
+  if (!item)
+    return FALSE;
+  check = GTK_CHECK_MENU_ITEM (item);
+  /* Setting a radio item turns the rest of its group off */
+  if (chance (tree, 0.2) ||
+      (GTK_IS_RADIO_MENU_ITEM (item) && gtk_check_menu_item_get_active (check)))
+    gtk_check_menu_item_set_inconsistent
+      (check, !gtk_check_menu_item_get_inconsistent (check));
+  else
+    gtk_check_menu_item_set_active (check,
+				    !gtk_check_menu_item_get_active (check));
+  entry->serial = widget_serial (item);
+  return TRUE;
+}
+
+static gboolean
+op_submenu (Tree *tree, LogEntry *entry)
+{
+  GtkWidget *item = pick (tree, tree->items, is_labelled), *other, *submenu;
+
+  if (!item)
+    return FALSE;
+  entry->serial = widget_serial (item);
+  submenu = gtk_menu_item_get_submenu (GTK_MENU_ITEM (item));
+
+  if (!submenu) {
+    /* Put back one taken off before, or a new one */
+    submenu = chance (tree, 0.5) ? pick (tree, tree->loose_menus, is_loose)
+				 : NULL;
+    if (submenu && is_inside (item, submenu))
+      return FALSE;
+    if (!submenu)
+      submenu = menu_new (tree, random_index (tree, 4));
+    gtk_menu_item_set_submenu (GTK_MENU_ITEM (item), submenu);
+    entry->other = widget_serial (submenu);
+    return TRUE;
+  }
+
+  if (chance (tree, 0.25)) {
+    g_ptr_array_add (tree->loose_menus, g_object_ref (submenu));
+    gtk_menu_item_set_submenu (GTK_MENU_ITEM (item), NULL);
+    return TRUE;
+  }
+
+  g_object_ref (submenu);
+  if (chance (tree, 0.5) &&
+      (other = pick (tree, tree->items, has_submenu)) && other != item) {
+    GtkWidget *other_submenu =
+      g_object_ref (gtk_menu_item_get_submenu (GTK_MENU_ITEM (other)));
+    gboolean ok = (!is_inside (item, other_submenu) &&
+		   !is_inside (other, submenu));
+
+    if (ok) {
+      gtk_menu_item_set_submenu (GTK_MENU_ITEM (item), NULL);
+      gtk_menu_item_set_submenu (GTK_MENU_ITEM (other), NULL);
+      gtk_menu_item_set_submenu (GTK_MENU_ITEM (item), other_submenu);
+      gtk_menu_item_set_submenu (GTK_MENU_ITEM (other), submenu);
+      entry->other = widget_serial (other);
+    }
+    g_object_unref (other_submenu);
+    g_object_unref (submenu);
+    return ok;
+  }
+
+  /* Move it to an item without one */
+  other = pick (tree, tree->items, can_have_submenu);
+  if (other && !is_inside (other, submenu)) {
+    gtk_menu_item_set_submenu (GTK_MENU_ITEM (item), NULL);
+    gtk_menu_item_set_submenu (GTK_MENU_ITEM (other), submenu);
+    entry->other = widget_serial (other);
+    g_object_unref (submenu);
+    return TRUE;
+  }
+  g_object_unref (submenu);
+  return FALSE;
+}
+
+static gboolean
+op_label (Tree *tree, LogEntry *entry)
+{
+  GtkWidget *item = pick (tree, tree->items, is_labelled);
+  gchar *label;
+
+  if (!item)
+    return FALSE;
+  if (chance (tree, 0.5))
+    label = g_strdup (common_labels[random_index (tree,
+						  G_N_ELEMENTS (common_labels))]);
+  else
+    label = g_strdup_printf ("Item %u.%u", widget_serial (item),
+			     g_rand_int_range (tree->rand, 0, 1000));
+  gtk_menu_item_set_label (GTK_MENU_ITEM (item), label);
+  g_free (label);
+  entry->serial = widget_serial (item);
+  return TRUE;
+}
+
+static gboolean
+op_accel (Tree *tree, LogEntry *entry)
+{
+  GtkWidget *item = pick (tree, tree->items, is_labelled);
+  ItemAccel *accel;
+  gint old_shortcut;
+
+  if (!item)
+    return FALSE;
+  entry->serial = widget_serial (item);
+  accel = g_object_get_qdata (G_OBJECT (item), accel_quark);
+  if (!accel || !accel->closure)
+    return item_add_accel (tree, item);
+
+  if (chance (tree, 0.5)) {
+    /* A new shortcut */
+    if (tree->free_shortcuts->len == 0)
+      return FALSE;
+    old_shortcut = accel->shortcut;
+    gtk_accel_group_disconnect (tree->accel_group, accel->closure);
+    accel_connect (accel);
+    g_array_append_val (tree->released_shortcuts, old_shortcut);
+  }
+  else {
+    /* Take the closure off the label altogether */
+    gtk_accel_label_set_accel_closure (GTK_ACCEL_LABEL (item_label (item)),
+				       NULL);
+    accel_disconnect (accel);
+    g_closure_unref (accel->closure);
+    accel->closure = NULL;
+  }
+  return TRUE;
+}
+
+static gboolean
+op_resync (Tree *tree, LogEntry *entry)
+{
+  GtkWidget *shell = pick (tree, tree->shells, is_menu);
+  guint n, i;
+
+  /* Only a menu that's in the menubar gets synced */
+  if (!shell || !is_inside (shell, tree->menubar) ||
+      (n = n_children (shell)) < 2)
+    return FALSE;
+  for (i = random_index (tree, 3); i < 3; i++) {
+    GList *children = gtk_container_get_children (GTK_CONTAINER (shell));
+    GtkWidget *item = g_list_nth_data (children, random_index (tree, n));
+
+    g_list_free (children);
+    gtk_menu_reorder_child (GTK_MENU (shell), item, random_index (tree, n));
+  }
+  /* What gtk_osxapplication_sync_menubar() does */
+  menu_state_invalidate_all ();
+  menu_sync_menubar (tree->menubar, tree->native);
+  entry->serial = widget_serial (shell);
+  return TRUE;
+}
+
+static gboolean
+op_foreign (Tree *tree, LogEntry *entry)
+{
+  MenuRecordItem *item;
+  gchar *title;
+
+  if (tree->foreign->len > 3 && chance (tree, 0.5)) {
+    item = g_ptr_array_remove_index (tree->foreign,
+				     random_index (tree, tree->foreign->len));
+    menu_backend_record.item_remove_from_menu (item, tree->native);
+    menu_backend_record.item_unref (item);
+    return TRUE;
+  }
+  if (chance (tree, 0.3))
+    item = menu_backend_record_item_new (NULL);
+  else {
+    title = g_strdup_printf ("Foreign %u", ++tree->serial);
+    item = menu_backend_record_item_new (title);
+    g_free (title);
+    entry->serial = tree->serial;
+  }
+  menu_backend_record.menu_insert (tree->native, item,
+				   tree->native->items->len);
+  g_ptr_array_add (tree->foreign, item);
+  return TRUE;
+}
+
+static gboolean (*const op_funcs[N_OPS]) (Tree *tree, LogEntry *entry) = {
+  op_add,
+  op_remove,
+  op_move,
+  op_reparent,
+  op_visible,
+  op_sensitive,
+  op_toggle,
+  op_submenu,
+  op_label,
+  op_accel,
+  op_resync,
+  op_foreign
+};
+
+/* Keep the menubar around --items by weighting adding and removing */
+static Op
+choose_op (Tree *tree)
+{
+  guint weights[N_OPS], total = 0, choice;
+  Op op;
+
+  for (op = 0; op < N_OPS; op++)
+    weights[op] = op_info[op].weight;
+  weights[OP_ADD] = tree->n_items < (guint) n_target ? 16 : 4;
+  weights[OP_REMOVE] = tree->n_items > (guint) n_target ? 16 : 4;
+  for (op = 0; op < N_OPS; op++)
+    total += weights[op];
+  choice = random_index (tree, total);
+  for (op = 0; choice >= weights[op]; op++)
+    choice -= weights[op];
+  return op;
+}
+
+static Tree *
+tree_new (void)
+{
+  Tree *tree = g_new0 (Tree, 1);
+  guint shortcut;
+  gint i;
+
+  tree->rand = g_rand_new_with_seed (seed);
+  tree->items = g_ptr_array_new ();
+  tree->shells = g_ptr_array_new ();
+  tree->loose_items = g_ptr_array_new ();
+  tree->loose_menus = g_ptr_array_new ();
+  tree->dead_accels = g_ptr_array_new ();
+  tree->foreign = g_ptr_array_new ();
+  tree->log = g_array_new (FALSE, FALSE, sizeof (LogEntry));
+  tree->accel_group = gtk_accel_group_new ();
+  tree->free_shortcuts = g_array_sized_new (FALSE, FALSE, sizeof (guint),
+					    N_SHORTCUTS);
+  tree->released_shortcuts = g_array_new (FALSE, FALSE, sizeof (guint));
+  for (shortcut = 0; shortcut < N_SHORTCUTS; shortcut++)
+    g_array_append_val (tree->free_shortcuts, shortcut);
+
+  tree->menubar = tree_track (tree, gtk_menu_bar_new ());
+  g_ptr_array_add (tree->shells, tree->menubar);
+  for (i = 0; i < 6; i++) {
+    gchar *label = g_strdup_printf ("Menu %d", i);
+    GtkWidget *top = tree_track (tree, gtk_menu_item_new_with_label (label));
+
+    g_free (label);
+    g_ptr_array_add (tree->items, top);
+    gtk_widget_set_visible (top, TRUE);
+    gtk_menu_item_set_submenu (GTK_MENU_ITEM (top), menu_new (tree, 0));
+    gtk_menu_shell_append (GTK_MENU_SHELL (tree->menubar), top);
+  }
+  tree->n_items = 6;
+
+  /* Fill it up before it's mirrored, with a submenu here and there */
+  while (tree->n_items < (guint) n_target) {
+    GtkWidget *item = item_new (tree), *shell;
+    gint position;
+
+    if (is_labelled (item) && chance (tree, 0.08))
+      gtk_menu_item_set_submenu (GTK_MENU_ITEM (item), menu_new (tree, 0));
+    /* Mostly in the menus rather than on the menubar */
+    do
+      shell = pick_shell (tree, item, &position);
+    while (shell == tree->menubar && !chance (tree, 0.05));
+    gtk_menu_shell_insert (GTK_MENU_SHELL (shell), item, position);
+    tree->n_items++;
+  }
+  return tree;
+}
+
+/*
+ * Let the idle handler flush the queued updates, and then whatever
+ * the flush queued in turn, as the main loop would.
+ */
+static void
+flush_updates (void)
+{
+  while (g_main_context_iteration (NULL, FALSE))
+    ;
+}
+
+/* What mirror_menu_bar() does */
+static void
+tree_mirror (Tree *tree)
+{
+  tree->native = menu_backend_record_menubar_new ();
+  menu_sync_connect_menu (tree->menubar, tree->native);
+  menu_shell_mark_dirty (tree->menubar);
+  menu_sync_menubar (tree->menubar, tree->native);
+  menu_prewarm_add (tree->menubar);
+  flush_updates ();
+}
+
+static void
+unref_all (GPtrArray *widgets)
+{
+  g_ptr_array_foreach (widgets, (GFunc) g_object_unref, NULL);
+  g_ptr_array_free (widgets, TRUE);
+}
+
+static void
+tree_free (Tree *tree)
+{
+  gtk_widget_destroy (tree->menubar);
+  menu_backend_record.menu_unref (tree->native);
+  g_ptr_array_foreach (tree->loose_menus, (GFunc) gtk_widget_destroy, NULL);
+  g_ptr_array_foreach (tree->loose_items, (GFunc) gtk_widget_destroy, NULL);
+  unref_all (tree->loose_menus);
+  unref_all (tree->loose_items);
+  unref_all (tree->shells);
+  unref_all (tree->items);
+  g_ptr_array_foreach (tree->dead_accels, (GFunc) accel_free, NULL);
+  g_ptr_array_free (tree->dead_accels, TRUE);
+  g_ptr_array_foreach (tree->foreign, (GFunc) menu_backend_record.item_unref,
+		       NULL);
+  g_ptr_array_free (tree->foreign, TRUE);
+  g_array_free (tree->free_shortcuts, TRUE);
+  g_array_free (tree->released_shortcuts, TRUE);
+  g_object_unref (tree->accel_group);
+  g_array_free (tree->log, TRUE);
+  g_rand_free (tree->rand);
+  g_free (tree);
+}
+
+/* Checking the native menus */
+typedef struct {
+  Tree *tree;
+  /* Everything found in the menubar, each with a reference */
+  GPtrArray *items;
+  GPtrArray *shells;
+  guint n_checked;
+} Check;
+
+/* E.g. "Menu 2 (#3) > Item 40 (#40)" */
+static gchar *
+describe (GtkWidget *widget)
+{
+  GString *path = g_string_new (NULL);
+
+  while (widget) {
+    gchar *here;
+
+    if (GTK_IS_MENU_BAR (widget))
+      here = g_strdup ("menubar");
+    else if (GTK_IS_MENU (widget))
+      here = g_strdup_printf ("menu #%u", widget_serial (widget));
+    else if (GTK_IS_SEPARATOR_MENU_ITEM (widget))
+      here = g_strdup_printf ("separator #%u", widget_serial (widget));
+    else
+      here = g_strdup_printf ("\"%s\" #%u", get_menu_label_text (widget, NULL),
+			      widget_serial (widget));
+    g_string_prepend (path, here);
+    g_free (here);
+    if (GTK_IS_MENU (widget))
+      widget = gtk_menu_get_attach_widget (GTK_MENU (widget));
+    else if (GTK_IS_MENU_ITEM (widget))
+      widget = gtk_widget_get_parent (widget);
+    else
+      widget = NULL;
+    if (widget)
+      g_string_prepend (path, " > ");
+  }
+  return g_string_free (path, FALSE);
+}
+
+static gboolean
+mismatch (GtkWidget *widget, const gchar *format, ...)
+{
+  gchar *where = describe (widget), *what;
+  va_list args;
+
+  va_start (args, format);
+  what = g_strdup_vprintf (format, args);
+  va_end (args);
+  g_printerr ("mismatch at %s: %s\n", where, what);
+  g_free (what);
+  g_free (where);
+  return FALSE;
+}
+
+/* The key equivalent @item ought to show */
+static void
+expected_key (GtkWidget *item, gunichar *key_equivalent, guint *modifiers)
+{
+  ItemAccel *accel = g_object_get_qdata (G_OBJECT (item), accel_quark);
+  GdkModifierType mods;
+  guint key;
+
+  *key_equivalent = 0;
+  *modifiers = 0;
+  if (!accel || !accel->closure || accel->shortcut < 0 ||
+      GTK_IS_SEPARATOR_MENU_ITEM (item))
+    return;
+  shortcut_get (accel->shortcut, &key, &mods);
+  menu_shortcut_translate (key, mods, menu_shortcut_quartz_modifiers,
+			   key_equivalent, modifiers);
+}
+
+static gboolean check_shell (Check *check, GtkWidget *shell,
+			     MenuRecordMenu *menu);
+
+static gboolean
+check_item (Check *check, GtkWidget *item, MenuRecordItem *native,
+	    MenuRecordMenu *menu)
+{
+  gboolean sensitive, visible, separator = GTK_IS_SEPARATOR_MENU_ITEM (item);
+  GtkWidget *submenu;
+  gunichar key;
+  guint modifiers;
+
+  check->n_checked++;
+  if (native->menu != menu)
+    return mismatch (item, "native item thinks it's in another menu");
+  if (!native->mirror)
+    return mismatch (item, "native item isn't a mirror");
+  if (native->separator != separator)
+    return mismatch (item, "native item %s a separator",
+		     separator ? "isn't" : "is");
+
+  g_object_get (item, "sensitive", &sensitive, "visible", &visible, NULL);
+  if (native->enabled != sensitive)
+    return mismatch (item, "native item is %s", sensitive ? "disabled"
+							   : "enabled");
+  if (native->hidden == visible)
+    return mismatch (item, "native item is %s", visible ? "hidden" : "shown");
+  if (separator)
+    return TRUE;
+
+  if (g_strcmp0 (native->title, get_menu_label_text (item, NULL)) != 0)
+    return mismatch (item, "native title is \"%s\"", native->title);
+
+  if (GTK_IS_CHECK_MENU_ITEM (item)) {
+    GtkCheckMenuItem *check_item = GTK_CHECK_MENU_ITEM (item);
+    MenuItemState state = MENU_ITEM_STATE_OFF;
+
+    if (gtk_check_menu_item_get_inconsistent (check_item))
+      state = MENU_ITEM_STATE_MIXED;
+    else if (gtk_check_menu_item_get_active (check_item))
+      state = MENU_ITEM_STATE_ON;
+    if (native->state != state)
+      return mismatch (item, "native state is %d, not %d",
+		       native->state, state);
+  }
+
+  expected_key (item, &key, &modifiers);
+  if (native->key != key || (key && native->modifiers != modifiers))
+    return mismatch (item, "native key equivalent is U+%04X/%x, not U+%04X/%x",
+		     native->key, native->modifiers, key, modifiers);
+
+  submenu = gtk_menu_item_get_submenu (GTK_MENU_ITEM (item));
+  if (!submenu)
+    return (native->submenu == NULL ||
+	    mismatch (item, "native item has a submenu"));
+  if (!native->submenu)
+    return mismatch (item, "native item has no submenu");
+  if (native->submenu != menu_sync_get_menu (submenu))
+    return mismatch (item, "native item has the wrong submenu");
+  return check_shell (check, submenu, native->submenu);
+}
+
+static gboolean
+check_shell (Check *check, GtkWidget *shell, MenuRecordMenu *menu)
+{
+  GList *children, *l;
+  gboolean ok = TRUE;
+  guint index = 0;
+
+  g_ptr_array_add (check->shells, g_object_ref (shell));
+  if (menu->menubar) {
+    if (menu->items->len == 0 ||
+	g_ptr_array_index (menu->items, 0) != menu->app_item)
+      return mismatch (shell, "the application menu isn't first");
+    index = 1;
+  }
+
+  children = gtk_container_get_children (GTK_CONTAINER (shell));
+  for (l = children; l && ok; l = l->next) {
+    GtkWidget *item = (GtkWidget*) l->data;
+    MenuRecordItem *native;
+
+    g_ptr_array_add (check->items, g_object_ref (item));
+    /* Never mirrored */
+    if (GTK_IS_SEPARATOR_MENU_ITEM (item) && GTK_IS_MENU_BAR (shell))
+      continue;
+    if (index >= menu->items->len)
+      ok = mismatch (item, "missing from the native menu");
+    else if ((native = g_ptr_array_index (menu->items, index++)) !=
+	     menu_sync_get_item (item))
+      ok = mismatch (item, "native item %u is \"%s\"", index - 1,
+		     native->title ? native->title : "(separator)");
+    else
+      ok = check_item (check, item, native, menu);
+  }
+  g_list_free (children);
+  /* Then the application's own, as it left them */
+  if (ok && shell == check->tree->menubar) {
+    GPtrArray *foreign = check->tree->foreign;
+    guint i;
+
+    for (i = 0; ok && i < foreign->len; i++)
+      if (index >= menu->items->len ||
+	  g_ptr_array_index (menu->items, index++) !=
+	  g_ptr_array_index (foreign, i))
+	ok = mismatch (shell, "foreign item %u has gone or moved", i);
+  }
+  if (ok && index != menu->items->len)
+    ok = mismatch (shell, "%u native items too many",
+		   menu->items->len - index);
+  return ok;
+}
+
+static void
+print_log (Tree *tree, guint batch)
+{
+  guint i;
+
+  g_printerr ("seed=%d batch=%u changes:\n", seed, batch);
+  for (i = 0; i < tree->log->len; i++) {
+    LogEntry *entry = &g_array_index (tree->log, LogEntry, i);
+
+    g_printerr ("  %s #%u", op_info[entry->op].name, entry->serial);
+    if (entry->other)
+      g_printerr (" #%u", entry->other);
+    if (entry->op == OP_ADD || entry->op == OP_MOVE ||
+	entry->op == OP_REPARENT)
+      g_printerr (" position=%d", entry->position);
+    g_printerr ("\n");
+  }
+}
+
+/* Drop what's fallen out of the menubar, and hold on to the rest */
+static void
+tree_collect (Tree *tree, Check *check)
+{
+  GPtrArray *loose;
+  guint i;
+
+  unref_all (tree->items);
+  unref_all (tree->shells);
+  tree->items = check->items;
+  tree->shells = check->shells;
+  tree->n_items = tree->items->len;
+
+  /* Keep a few of the loose items and menus for putting back */
+  for (loose = tree->loose_items; loose;
+       loose = loose == tree->loose_items ? tree->loose_menus : NULL) {
+    for (i = loose->len; i-- > 0;) {
+      GtkWidget *widget = g_ptr_array_index (loose, i);
+
+      if (widget_is_dead (widget) || !is_loose (widget) ||
+	  loose->len > 32) {
+	if (!widget_is_dead (widget) && is_loose (widget))
+	  gtk_widget_destroy (widget);
+	g_object_unref (widget);
+	g_ptr_array_remove_index (loose, i);
+      }
+    }
+  }
+
+  g_ptr_array_foreach (tree->dead_accels, (GFunc) accel_free, NULL);
+  g_ptr_array_set_size (tree->dead_accels, 0);
+  g_array_append_vals (tree->free_shortcuts, tree->released_shortcuts->data,
+		       tree->released_shortcuts->len);
+  g_array_set_size (tree->released_shortcuts, 0);
+}
+
+static gboolean
+tree_check (Tree *tree, guint batch, guint *n_checked)
+{
+  Check check = { tree, g_ptr_array_new (), g_ptr_array_new (), 0 };
+  gboolean ok = check_shell (&check, tree->menubar, tree->native);
+
+  if (!ok) {
+    print_log (tree, batch);
+    return FALSE;
+  }
+  *n_checked += check.n_checked;
+  tree_collect (tree, &check);
+  return TRUE;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  guint64 op_ns[N_OPS] = { 0 }, flush_ns = 0, start, total_ns = 0;
+  guint op_counts[N_OPS] = { 0 }, n_checked = 0, batch = 0;
+  guint64 native_ops;
+  gint done = 0;
+  Tree *tree;
+  Op op;
+
+  context = g_option_context_new ("- check the menu sync engine under "
+				  "random changes");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gtk_get_option_group (TRUE));
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+  if (n_ops < 1 || batch_size < 1 || n_target < 1 || budget_us < 0) {
+    g_printerr ("--ops, --batch and --items must be positive, and "
+		"--budget not negative\n");
+    return 1;
+  }
+
+  serial_quark = g_quark_from_static_string ("bench-stress-serial");
+  dead_quark = g_quark_from_static_string ("bench-stress-dead");
+  accel_quark = g_quark_from_static_string ("bench-stress-accel");
+  menu_sync_set_backend (&menu_backend_record);
+  menu_watch_set_func (parent_changed);
+  menu_shortcut_set_func (menu_accel_dispatch);
+  menu_prewarm_set_func (menu_sync_prewarm);
+  menu_state_set_changed_func (menu_prewarm_schedule);
+  menu_state_set_sync_budget (budget_us);
+
+  tree = tree_new ();
+  tree_mirror (tree);
+  if (!tree_check (tree, batch, &n_checked))
+    return 1;
+
+  native_ops = menu_backend_record_get_stats ()->native_ops;
+  while (done < n_ops) {
+    gint n = MIN (batch_size, n_ops - done);
+
+    batch++;
+    g_array_set_size (tree->log, 0);
+    while (n > 0) {
+      LogEntry entry = { 0 };
+
+      entry.op = op = choose_op (tree);
+      start = menu_stats_now_ns ();
+      if (!op_funcs[op] (tree, &entry))
+	continue;
+      op_ns[op] += menu_stats_now_ns () - start;
+      op_counts[op]++;
+      g_array_append_val (tree->log, entry);
+      n--;
+      done++;
+    }
+    start = menu_stats_now_ns ();
+    flush_updates ();
+    flush_ns += menu_stats_now_ns () - start;
+    if (!tree_check (tree, batch, &n_checked))
+      return 1;
+  }
+  native_ops = menu_backend_record_get_stats ()->native_ops - native_ops;
+
+  for (op = 0; op < N_OPS; op++) {
+    total_ns += op_ns[op];
+    printf ("op=%s count=%u ns_per_op=%.0f\n", op_info[op].name,
+	    op_counts[op], op_counts[op] ? (double) op_ns[op] / op_counts[op]
+					 : 0.0);
+  }
+  total_ns += flush_ns;
+  printf ("seed=%d ops=%d batches=%u items_checked=%u flush_ns_per_batch=%.0f"
+	  " native_ops_per_op=%.1f ops_per_sec=%.0f\n",
+	  seed, done, batch, n_checked, (double) flush_ns / batch,
+	  (double) native_ops / done, done / (total_ns / 1e9));
+  tree_free (tree);
+  return 0;
+}
@@ -0,0 +1,12 @@
+#!/bin/sh
+#
+# Short fixed-seed runs of bench-stress for make check: one syncing
+# whole menus, one with a sync budget so that pre-warming finishes the
+# submenus. bench-stress exits 1 if the native menus stop matching the
+# menubar; warnings are made fatal so that they fail the check too.
+
+G_DEBUG=fatal-warnings
+export G_DEBUG
+
+./bench-stress --seed 1 --ops 20000 > /dev/null || exit 1
+./bench-stress --seed 2 --ops 20000 --budget 50 > /dev/null || exit 1
@@ -21,36 +21,104 @@
  */
 
 #include "cocoa_menu.h"
+#include "menu_sync.h"
+#import "GNSMenuBar.h"
+#import "GNSMenuDelegate.h"
 
-static GQuark cocoa_menu_quark = 0;
+/*
+ * The NSMenu half of cocoa_menu_item_backend.
+ */
 
 NSMenu *
 cocoa_menu_get (GtkWidget *widget)
 {
-  /* If cocoa_menu_quark == 0 then cocoa_menu_connect hasn't been
-     called yet and we therefore don't have an NSMenu* to return. */
-  if (cocoa_menu_quark <= 0)
-    return NULL;
-  return (NSMenu*) g_object_get_qdata (G_OBJECT (widget), cocoa_menu_quark);
+  return (NSMenu*) menu_sync_get_menu (widget);
+}
+
+gpointer
+cocoa_menu_new (MenuTitle *title)
+{
+  NSMenu *menu = [[NSMenu alloc] initWithTitle: (NSString*) title->native];
+
+  [menu setAutoenablesItems:NO];
+  return menu;
+}
+
+void
+cocoa_menu_ref (gpointer menu)
+{
+  [(NSMenu*) menu retain];
+}
+
+void
+cocoa_menu_unref (gpointer menu)
+{
+  [(NSMenu*) menu release];
+}
+
+guint
+cocoa_menu_n_items (gpointer menu)
+{
+  return [(NSMenu*) menu numberOfItems];
+}
+
+gpointer
+cocoa_menu_nth_item (gpointer menu, guint index)
+{
+  return [(NSMenu*) menu itemAtIndex: index];
+}
+
+gint
+cocoa_menu_index_of (gpointer menu, gpointer item)
+{
+  return [(NSMenu*) menu indexOfItem: (NSMenuItem*) item];
+}
+
+void
+cocoa_menu_insert (gpointer menu, gpointer item, guint index)
+{
+  [(NSMenu*) menu insertItem: (NSMenuItem*) item atIndex: index];
+}
+
+void
+cocoa_menu_remove (gpointer menu, guint index)
+{
+  [(NSMenu*) menu removeItemAtIndex: index];
 }
 
-static void
-cocoa_menu_free (gpointer *ptr)
+/*
+ * cocoa_menu_defer:
+ * @menu: A still empty NSMenu, or one a sync didn't have time to finish
+ * @menu_shell: The GtkMenuShell it mirrors
+ *
+ * Leave @menu as it is until Cocoa is about to show it, at which point
+ * a GNSMenuDelegate will fill it in.
+ *
+ * Returns: The delegate.
+ */
+gpointer
+cocoa_menu_defer (gpointer menu, GtkWidget *menu_shell)
 {
-  NSMenu* menu = (NSMenu*) ptr;
-  [menu release];
+  return [[GNSMenuDelegate alloc] initWithMenuShell: GTK_MENU_SHELL (menu_shell)
+	  menu: (NSMenu*) menu];
 }
 
 void
-cocoa_menu_connect (GtkWidget *menu,
-		    NSMenu*    cocoa_menu)
+cocoa_menu_undefer (gpointer deferral)
+{
+  [(GNSMenuDelegate*) deferral release];
+}
+
+gboolean
+cocoa_menu_menubar_special (gpointer menu, gpointer *app_item,
+			    gpointer *window_item, gpointer *help_item)
 {
-  [cocoa_menu retain];
+  GNSMenuBar *menubar = (GNSMenuBar*) menu;
 
-  if (cocoa_menu_quark == 0)
-    cocoa_menu_quark = g_quark_from_static_string ("NSMenu");
-	
-  g_object_set_qdata_full (G_OBJECT (menu), cocoa_menu_quark,
-			   cocoa_menu,
-			   (GDestroyNotify) cocoa_menu_free);
+  if (![menubar isKindOfClass: [GNSMenuBar class]])
+    return FALSE;
+  *app_item = [menubar appMenu];
+  *window_item = [menubar windowsMenu];
+  *help_item = [menubar helpMenu];
+  return TRUE;
 }
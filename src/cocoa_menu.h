@@ -25,8 +25,22 @@
 
 #import <Cocoa/Cocoa.h>
 #include <gtk/gtk.h>
+#include "menu_title.h"
 
 NSMenu *cocoa_menu_get(GtkWidget *widget);
-void cocoa_menu_connect(GtkWidget *menu, NSMenu *cocoa_menu);
+
+gpointer cocoa_menu_new (MenuTitle *title);
+void cocoa_menu_ref (gpointer menu);
+void cocoa_menu_unref (gpointer menu);
+guint cocoa_menu_n_items (gpointer menu);
+gpointer cocoa_menu_nth_item (gpointer menu, guint index);
+gint cocoa_menu_index_of (gpointer menu, gpointer item);
+void cocoa_menu_insert (gpointer menu, gpointer item, guint index);
+void cocoa_menu_remove (gpointer menu, guint index);
+gpointer cocoa_menu_defer (gpointer menu, GtkWidget *menu_shell);
+void cocoa_menu_undefer (gpointer deferral);
+gboolean cocoa_menu_menubar_special (gpointer menu, gpointer *app_item,
+				     gpointer *window_item,
+				     gpointer *help_item);
 
 #endif //__COCOA_MENU_H__
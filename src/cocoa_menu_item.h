@@ -26,18 +26,16 @@
 #import <Cocoa/Cocoa.h>
 #include <gtk/gtk.h>
 #include "cocoa_menu.h"
+#include "menu_backend.h"
 #import "GNSMenuItem.h"
 
 GNSMenuItem *cocoa_menu_item_get(GtkWidget* menu_item);
 
-void cocoa_menu_item_add_item (NSMenu* cocoa_menu, 
-			       GtkWidget* menu_item, 
-			       int index);
-
-void cocoa_menu_item_add_submenu (GtkMenuShell *menu_shell,
-				  NSMenu*       cocoa_menu,
-				  gboolean      toplevel,
-				  gboolean      debug);
+guint cocoa_menu_item_key_modifiers (NSUInteger modifier_flags);
+void cocoa_menu_item_index_key_equivalent (NSMenuItem *item);
+void cocoa_menu_item_unindex_key_equivalent (NSMenuItem *item);
+void cocoa_menu_item_unindex_menu (NSMenu *menu);
 
+extern const MenuBackend cocoa_menu_item_backend;
 
 #endif __COCOA_MENU_ITEM_H__
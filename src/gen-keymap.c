@@ -0,0 +1,208 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/*
+ * Writes menu_keymap_tables.h, the tables behind menu_keymap_lookup(),
+ * to standard output.
+ *
+ * Every keyval below 0x10000 gets an entry. The function and keypad
+ * keys come from the lists below; the rest of the keysyms, apart from
+ * the dead keys and the other modifiers in pages 0xfe and 0xff, are
+ * run through gdk_keyval_to_unicode(), after folding them to
+ * lowercase, so that e.g. GDK_Eacute gets "é" and the shift modifier.
+ * Each 256-keyval page is written out once, and pages with nothing
+ * in them all share the first one.
+ */
+
+#include <gtk/gtk.h>
+#if GTK_CHECK_VERSION(2,90,7)
+#include <gdk/gdkkeysyms-compat.h>
+#else
+#include <gdk/gdkkeysyms.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+#include "menu_keymap.h"
+
+/* The NS*FunctionKey values from NSEvent.h. They're part of Cocoa's
+   ABI, and spelling them out lets this run without it. */
+static const struct {
+  guint keyval;
+  guint16 key_equivalent;
+} function_keys[] = {
+  { GDK_BackSpace, 0x0008 },    /* NSBackspaceCharacter */
+  { GDK_Up, 0xf700 },           /* NSUpArrowFunctionKey */
+  { GDK_uparrow, 0xf700 },      /* NSUpArrowFunctionKey */
+  { GDK_Down, 0xf701 },         /* NSDownArrowFunctionKey */
+  { GDK_downarrow, 0xf701 },    /* NSDownArrowFunctionKey */
+  { GDK_Left, 0xf702 },         /* NSLeftArrowFunctionKey */
+  { GDK_leftarrow, 0xf702 },    /* NSLeftArrowFunctionKey */
+  { GDK_Right, 0xf703 },        /* NSRightArrowFunctionKey */
+  { GDK_rightarrow, 0xf703 },   /* NSRightArrowFunctionKey */
+  /* GDK_F1 ... GDK_F35 are filled in from 0xf704 on */
+  { GDK_Insert, 0xf727 },       /* NSInsertFunctionKey */
+  { GDK_Delete, 0xf728 },       /* NSDeleteFunctionKey */
+  { GDK_Home, 0xf729 },         /* NSHomeFunctionKey */
+  { GDK_Begin, 0xf72a },        /* NSBeginFunctionKey */
+  { GDK_End, 0xf72b },          /* NSEndFunctionKey */
+  { GDK_Page_Up, 0xf72c },      /* NSPageUpFunctionKey */
+  { GDK_Page_Down, 0xf72d },    /* NSPageDownFunctionKey */
+  { GDK_Scroll_Lock, 0xf72f },  /* NSScrollLockFunctionKey */
+  { GDK_Pause, 0xf730 },        /* NSPauseFunctionKey */
+  { GDK_Sys_Req, 0xf731 },      /* NSSysReqFunctionKey */
+  { GDK_Break, 0xf732 },        /* NSBreakFunctionKey */
+  { GDK_Menu, 0xf735 },         /* NSMenuFunctionKey */
+  { GDK_Print, 0xf738 },        /* NSPrintFunctionKey */
+  { GDK_Select, 0xf741 },       /* NSSelectFunctionKey */
+  { GDK_Execute, 0xf742 },      /* NSExecuteFunctionKey */
+  { GDK_Undo, 0xf743 },         /* NSUndoFunctionKey */
+  { GDK_Redo, 0xf744 },         /* NSRedoFunctionKey */
+  { GDK_Find, 0xf745 },         /* NSFindFunctionKey */
+  { GDK_Help, 0xf746 },         /* NSHelpFunctionKey */
+  { GDK_Mode_switch, 0xf747 }   /* NSModeSwitchFunctionKey */
+};
+
+#define NS_F1_FUNCTION_KEY 0xf704
+
+/* GDK_VoidSymbol for a keypad key means it has no key equivalent */
+static const struct {
+  guint keyval;
+  guint equivalent;
+} keypad_keys[] = {
+  { GDK_KP_F1, GDK_F1 },
+  { GDK_KP_F2, GDK_F2 },
+  { GDK_KP_F3, GDK_F3 },
+  { GDK_KP_F4, GDK_F4 },
+  { GDK_KP_Home, GDK_Home },
+  { GDK_KP_Left, GDK_Left },
+  { GDK_KP_Up, GDK_Up },
+  { GDK_KP_Right, GDK_Right },
+  { GDK_KP_Down, GDK_Down },
+  { GDK_KP_Page_Up, GDK_Page_Up },
+  { GDK_KP_Page_Down, GDK_Page_Down },
+  { GDK_KP_End, GDK_End },
+  { GDK_KP_Begin, GDK_Begin },
+  { GDK_KP_Insert, GDK_Insert },
+  { GDK_KP_Delete, GDK_Delete },
+  { GDK_KP_Equal, GDK_equal },
+  { GDK_KP_Multiply, GDK_asterisk },
+  { GDK_KP_Add, GDK_plus },
+  { GDK_KP_Separator, GDK_VoidSymbol },
+  { GDK_KP_Subtract, GDK_minus },
+  { GDK_KP_Decimal, GDK_period },
+  { GDK_KP_Divide, GDK_slash },
+  { GDK_KP_0, GDK_0 },
+  { GDK_KP_1, GDK_1 },
+  { GDK_KP_2, GDK_2 },
+  { GDK_KP_3, GDK_3 },
+  { GDK_KP_4, GDK_4 },
+  { GDK_KP_5, GDK_5 },
+  { GDK_KP_6, GDK_6 },
+  { GDK_KP_7, GDK_7 },
+  { GDK_KP_8, GDK_8 },
+  { GDK_KP_9, GDK_9 }
+};
+
+#define N_KEYVALS 0x10000
+#define PAGE_SIZE 256
+#define N_PAGES (N_KEYVALS / PAGE_SIZE)
+
+static MenuKeymapEntry entries[N_KEYVALS];
+
+/* The same rules as menu_keymap_lookup() has for Unicode keyvals */
+static void
+set_character (guint keyval)
+{
+  guint lower, upper;
+  gunichar c;
+
+  if (keyval >= 0xfe00)
+    return;
+  gdk_keyval_convert_case (keyval, &lower, &upper);
+  c = gdk_keyval_to_unicode (lower);
+  if (c < 0x20 || c > 0xffff || g_unichar_iscntrl (c) ||
+      (c >= 0xd800 && c < 0xf900))
+    return;
+  entries[keyval].key_equivalent = c;
+  if (lower != keyval)
+    entries[keyval].flags = MENU_KEYMAP_SHIFT;
+}
+
+static void
+fill_entries (void)
+{
+  guint keyval, i;
+
+  for (keyval = 0; keyval < N_KEYVALS; keyval++)
+    set_character (keyval);
+  for (i = 0; i < G_N_ELEMENTS (function_keys); i++)
+    entries[function_keys[i].keyval].key_equivalent =
+      function_keys[i].key_equivalent;
+  for (keyval = GDK_F1; keyval <= GDK_F35; keyval++)
+    entries[keyval].key_equivalent = NS_F1_FUNCTION_KEY + (keyval - GDK_F1);
+
+  /* After the rest, so that the keys they stand in for are done */
+  for (i = 0; i < G_N_ELEMENTS (keypad_keys); i++) {
+    MenuKeymapEntry *entry = &entries[keypad_keys[i].keyval];
+    if (keypad_keys[i].equivalent != GDK_VoidSymbol)
+      *entry = entries[keypad_keys[i].equivalent];
+    entry->flags |= MENU_KEYMAP_KEYPAD;
+  }
+}
+
+int
+main (int argc, char **argv)
+{
+  static const MenuKeymapEntry empty[PAGE_SIZE];
+  guint pages[N_PAGES];
+  guint page, n_blocks = 1, i;
+
+  fill_entries ();
+
+  printf ("/* Generated by gen-keymap from GDK's keysyms; don't edit. */\n\n");
+  printf ("static const MenuKeymapEntry menu_keymap_entries[][%d] = {\n",
+	  PAGE_SIZE);
+  printf ("  {\n    { 0, 0 }\n  },\n");
+  for (page = 0; page < N_PAGES; page++) {
+    const MenuKeymapEntry *block = entries + page * PAGE_SIZE;
+
+    if (memcmp (block, empty, sizeof (empty)) == 0) {
+      pages[page] = 0;
+      continue;
+    }
+    pages[page] = n_blocks++;
+    printf ("  /* 0x%04x */\n  {", page * PAGE_SIZE);
+    for (i = 0; i < PAGE_SIZE; i++)
+      printf ("%s{ 0x%04x, %u },", i % 4 ? " " : "\n    ",
+	      block[i].key_equivalent, block[i].flags);
+    printf ("\n  },\n");
+  }
+  printf ("};\n\n");
+
+  printf ("static const guint8 menu_keymap_pages[%d] = {", N_PAGES);
+  for (page = 0; page < N_PAGES; page++)
+    printf ("%s%u,", page % 16 ? " " : "\n  ", pages[page]);
+  printf ("\n};\n");
+
+  g_assert (n_blocks <= 256);
+  return 0;
+}
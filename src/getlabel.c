@@ -21,9 +21,63 @@
  */
 
 #include "getlabel.h"
+#include "menu_stats.h"
+
+/*
+ * Finding the label means walking the menu item's children, and
+ * gtk_container_get_children() allocates a list at every level, so
+ * the result is cached on the item. Every container the walk looked
+ * into is watched for children being added or removed, which is the
+ * only way the result can change; the label's text isn't cached, so
+ * set_label and friends need no attention.
+ */
+typedef struct {
+  GtkWidget *menu_item;
+  GtkWidget *label;
+  GSList *containers;
+} MenuLabelCache;
+
+static GQuark menu_label_cache_quark = 0;
+
+static void menu_label_cache_changed (GtkContainer *container,
+				      GtkWidget    *child,
+				      MenuLabelCache *cache);
+
+static void
+menu_label_cache_unwatch (MenuLabelCache *cache)
+{
+  GSList *l;
+
+  for (l = cache->containers; l; l = l->next)
+    g_signal_handlers_disconnect_by_func (l->data, menu_label_cache_changed,
+					  cache);
+  g_slist_free (cache->containers);
+  cache->containers = NULL;
+}
+
+static void
+menu_label_cache_changed (GtkContainer   *container,
+			  GtkWidget      *child,
+			  MenuLabelCache *cache)
+{
+  /* Drop the cache now rather than at the next lookup, so that a
+     container on its way out isn't left with a handler pointing at
+     it. */
+  g_object_set_qdata (G_OBJECT (cache->menu_item), menu_label_cache_quark,
+		      NULL);
+}
+
+static void
+menu_label_cache_free (gpointer data)
+{
+  MenuLabelCache *cache = data;
+
+  menu_label_cache_unwatch (cache);
+  g_slice_free (MenuLabelCache, cache);
+}
 
 static GtkWidget *
-find_menu_label (GtkWidget *widget)
+find_menu_label (GtkWidget *widget, MenuLabelCache *cache)
 {
   GtkWidget *label = NULL;
 
@@ -35,11 +89,18 @@ find_menu_label (GtkWidget *widget)
       GList *children;
       GList *l;
 
+      g_signal_connect (widget, "add",
+			G_CALLBACK (menu_label_cache_changed), cache);
+      g_signal_connect (widget, "remove",
+			G_CALLBACK (menu_label_cache_changed), cache);
+      cache->containers = g_slist_prepend (cache->containers, widget);
+
       children = gtk_container_get_children (GTK_CONTAINER (widget));
+      menu_stats_get ()->label_walk_allocs += g_list_length (children);
 
       for (l = children; l; l = l->next)
 	{
-	  label = find_menu_label ((GtkWidget*) l->data);
+	  label = find_menu_label ((GtkWidget*) l->data, cache);
 	  if (label)
 	    break;
 	}
@@ -50,19 +111,43 @@ find_menu_label (GtkWidget *widget)
   return label;
 }
 
+/*
+ * get_menu_label_text:
+ * @menu_item: A GtkMenuItem
+ * @label: Set to the first GtkLabel inside @menu_item, or NULL if
+ * there isn't one. May be NULL.
+ *
+ * Returns: The text of that label, or NULL.
+ */
 const gchar *
 get_menu_label_text (GtkWidget  *menu_item,
 		     GtkWidget **label)
 {
-  GtkWidget *my_label;
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  MenuLabelCache *cache;
+
+  if (menu_label_cache_quark == 0)
+    menu_label_cache_quark = g_quark_from_static_string ("MenuLabelCache");
+
+  ++stats->label_lookups;
+  cache = g_object_get_qdata (G_OBJECT (menu_item), menu_label_cache_quark);
+  if (!cache)
+    {
+      ++stats->label_walks;
+      cache = g_slice_new0 (MenuLabelCache);
+      cache->menu_item = menu_item;
+      cache->label = find_menu_label (menu_item, cache);
+      /* The cache itself and one list link per watched container */
+      stats->label_walk_allocs += 1 + g_slist_length (cache->containers);
+      g_object_set_qdata_full (G_OBJECT (menu_item), menu_label_cache_quark,
+			       cache, menu_label_cache_free);
+    }
 
-  my_label = find_menu_label (menu_item);
   if (label)
-    *label = my_label;
+    *label = cache->label;
 
-  if (my_label)
-    return gtk_label_get_text (GTK_LABEL (my_label));
+  if (cache->label)
+    return gtk_label_get_text (GTK_LABEL (cache->label));
 
   return NULL;
 }
-
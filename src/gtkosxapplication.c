@@ -22,8 +22,14 @@
  * Boston, MA 02111-1307, USA.
  */
 
+#include <string.h>
 #include "gtkosxapplication.h"
 #include "gtkosxapplicationprivate.h"
+#include "menu_activate.h"
+#include "menu_prewarm.h"
+#include "menu_stats.h"
+#include "menu_state.h"
+#include "menu_trace.h"
 
 //#define DEBUG(format, ...) g_printerr ("%s: " format, G_STRFUNC, ## __VA_ARGS__)
 #define DEBUG(format, ...)
@@ -253,6 +259,12 @@ gtk_osxapplication_use_quartz_accelerators(GtkOSXApplication *self)
  * Set quartz accelerator handling; TRUE (default) uses quartz; FALSE
  * uses Gtk+. Quartz accelerator handling is required for normal OSX
  * accelerators (e.g., command-q to quit) to work.
+ *
+ * Key presses are matched against an index of the key equivalents
+ * shown in the menubar rather than by searching it, so ordinary
+ * typing doesn't cost a walk over every menu item. The key_latency
+ * histogram in #GtkOSXApplicationMenuStats records how long each key
+ * press took.
  */
 void
 gtk_osxapplication_set_use_quartz_accelerators(GtkOSXApplication *self,
@@ -261,6 +273,249 @@ gtk_osxapplication_set_use_quartz_accelerators(GtkOSXApplication *self,
     self->priv->use_quartz_accelerators = use_quartz_accelerators;
 }
 
+/**
+ * gtk_osxapplication_get_menu_stats:
+ * @self: The GtkOSXApplication pointer.
+ * @stats: A GtkOSXApplicationMenuStats to fill in, with its
+ * struct_size set to sizeof (GtkOSXApplicationMenuStats).
+ *
+ * Copy the menubar synchronization counters into @stats. The
+ * last_sync fields describe the most recent sync on its own; the
+ * others accumulate from startup or the last call to
+ * gtk_osxapplication_reset_menu_stats().
+ *
+ * Only the first struct_size bytes of @stats are written, so a caller
+ * built against an older, smaller GtkOSXApplicationMenuStats gets the
+ * counters it knows about, and one built against a newer one finds
+ * the counters this version doesn't have left as it set them.
+ */
+void
+gtk_osxapplication_get_menu_stats (GtkOSXApplication *self,
+				   GtkOSXApplicationMenuStats *stats)
+{
+    gsize size;
+
+    g_return_if_fail (stats != NULL);
+    g_return_if_fail (stats->struct_size >= sizeof (stats->struct_size));
+
+    size = MIN (stats->struct_size, sizeof (GtkOSXApplicationMenuStats));
+    memcpy ((gchar*) stats + sizeof (stats->struct_size),
+	    (gchar*) menu_stats_get () + sizeof (stats->struct_size),
+	    size - sizeof (stats->struct_size));
+}
+
+/**
+ * gtk_osxapplication_reset_menu_stats:
+ * @self: The GtkOSXApplication pointer.
+ *
+ * Zero the menubar synchronization counters.
+ */
+void
+gtk_osxapplication_reset_menu_stats (GtkOSXApplication *self)
+{
+    menu_stats_reset ();
+}
+
+/**
+ * gtk_osxapplication_set_lazy_submenus:
+ * @self: The GtkOSXApplication pointer.
+ * @lazy_submenus: Whether to put off building each submenu until it's
+ * first opened.
+ *
+ * By default the whole menu tree is copied into the menubar when it's
+ * set, which can take a while for an application with very large
+ * menus. With lazy submenus only the top level is built up front;
+ * each submenu is filled in when the user first opens it, and is kept
+ * up to date from then on.
+ *
+ * Call this before gtk_osxapplication_set_menu_bar(); it only affects
+ * submenus created afterwards. Note that Cocoa also updates menus
+ * when it searches them for a key equivalent, so if you use quartz
+ * accelerators the submenus will be built by the first key press
+ * that Cocoa looks up rather than when they're opened.
+ */
+void
+gtk_osxapplication_set_lazy_submenus (GtkOSXApplication *self,
+				      gboolean lazy_submenus)
+{
+    menu_state_set_lazy_submenus (lazy_submenus);
+}
+
+/**
+ * gtk_osxapplication_lazy_submenus:
+ * @self: The GtkOSXApplication pointer.
+ *
+ * Are submenus built only when they're first opened?
+ *
+ * Returns: Boolean
+ */
+gboolean
+gtk_osxapplication_lazy_submenus (GtkOSXApplication *self)
+{
+    return menu_state_get_lazy_submenus ();
+}
+
+/**
+ * gtk_osxapplication_set_prewarm_menubars:
+ * @self: The GtkOSXApplication pointer.
+ * @prewarm: Whether to bring the menubars up to date in idle time
+ *
+ * Pre-warming is on by default. Whenever the main loop is idle, the
+ * menubars of all of the windows, not just the focused one, are
+ * brought up to date a menu at a time, so that switching windows
+ * only has to swap the OSX menubar. With lazy submenus, pre-warming
+ * also builds the submenus in the background, so they're ready
+ * before they're first opened.
+ *
+ * How long each window took to get its menubar ready on taking focus
+ * is recorded in the focus_latency histogram of
+ * #GtkOSXApplicationMenuStats; focus_switches_cold counts the
+ * switches which found the menubar out of date.
+ */
+void
+gtk_osxapplication_set_prewarm_menubars (GtkOSXApplication *self,
+					 gboolean prewarm)
+{
+    menu_prewarm_set_enabled (prewarm);
+}
+
+/**
+ * gtk_osxapplication_prewarm_menubars:
+ * @self: The GtkOSXApplication pointer.
+ *
+ * Are the menubars brought up to date in idle time?
+ *
+ * Returns: Boolean
+ */
+gboolean
+gtk_osxapplication_prewarm_menubars (GtkOSXApplication *self)
+{
+    return menu_prewarm_get_enabled ();
+}
+
+/**
+ * gtk_osxapplication_set_menu_sync_budget:
+ * @self: The GtkOSXApplication pointer.
+ * @budget_us: How long, in microseconds, bringing the menus up to date
+ * may hold up the main loop at a time, or 0 for no limit
+ *
+ * With no limit, the default, a sync of the menubar (on thawing it,
+ * on gtk_osxapplication_sync_menubar(), when a window takes focus and
+ * so on) goes right through the menu tree before it returns. With a
+ * budget, once that much time has gone the sync leaves the submenus
+ * it hasn't got to for pre-warming to finish, in idle callbacks which
+ * each take about as long again, so that redrawing isn't held up
+ * while a plugin fills the menus with thousands of items. 2000 (2ms)
+ * keeps well inside a 60Hz frame. A menu the user opens in the
+ * meantime is brought up to date first, before it's shown.
+ *
+ * The menu or menubar being synced is always done completely; it's
+ * the submenus below it that wait. With pre-warming turned off they
+ * wait until they're opened. shells_postponed in
+ * #GtkOSXApplicationMenuStats counts them.
+ */
+void
+gtk_osxapplication_set_menu_sync_budget (GtkOSXApplication *self,
+					 guint budget_us)
+{
+    menu_state_set_sync_budget (budget_us);
+}
+
+/**
+ * gtk_osxapplication_menu_sync_budget:
+ * @self: The GtkOSXApplication pointer.
+ *
+ * How long may a sync of the menus hold up the main loop?
+ *
+ * Returns: The budget in microseconds, or 0 for no limit.
+ */
+guint
+gtk_osxapplication_menu_sync_budget (GtkOSXApplication *self)
+{
+    return menu_state_get_sync_budget ();
+}
+
+/**
+ * gtk_osxapplication_set_activation_mode:
+ * @self: The GtkOSXApplication pointer.
+ * @mode: When to run the handlers of items chosen from the menubar
+ *
+ * Cocoa reports a menu item being chosen from the middle of its own
+ * event handling, so the item's "activate" handlers are normally run
+ * a little later from the GLib main loop:
+ *
+ * GTK_OSX_APPLICATION_ACTIVATE_HIGH (the default) runs them from a
+ * G_PRIORITY_HIGH source, ahead of redrawing and I/O, so they don't
+ * wait behind a busy main loop.
+ *
+ * GTK_OSX_APPLICATION_ACTIVATE_IDLE runs them at the default idle
+ * priority, as older versions did; under heavy load that can take
+ * hundreds of milliseconds.
+ *
+ * In every mode an item chosen again before its handlers have run is
+ * only activated once. The time each activation waited is recorded
+ * in the activation_latency histogram of
+ * #GtkOSXApplicationMenuStats.
+ */
+void
+gtk_osxapplication_set_activation_mode (GtkOSXApplication *self,
+					GtkOSXApplicationActivationMode mode)
+{
+    menu_activate_set_mode (mode);
+}
+
+/**
+ * gtk_osxapplication_activation_mode:
+ * @self: The GtkOSXApplication pointer.
+ *
+ * Returns: When the handlers of items chosen from the menubar run.
+ */
+GtkOSXApplicationActivationMode
+gtk_osxapplication_activation_mode (GtkOSXApplication *self)
+{
+    return menu_activate_get_mode ();
+}
+
+/**
+ * gtk_osxapplication_start_menu_trace:
+ * @self: The GtkOSXApplication pointer.
+ * @file_name: The file to write the trace to
+ *
+ * Record everything the OSX menubar reacts to in the GTK+ menus
+ * (menu items being added, removed and moved, their properties and
+ * accelerators changing, submenus being set, menubars being set and
+ * synced, windows taking focus and menus opening) in @file_name,
+ * with the time of each. The bench-replay program in the source tree
+ * can play the trace back against the menu code without a Mac, which
+ * makes slow menu updates in an application reproducible anywhere.
+ *
+ * Setting the GTK_OSX_MENU_TRACE environment variable to a file name
+ * starts a trace when the GtkOSXApplication is created. The trace
+ * stops with gtk_osxapplication_stop_menu_trace() or
+ * gtk_osxapplication_cleanup().
+ *
+ * Returns: FALSE if @file_name couldn't be opened.
+ */
+gboolean
+gtk_osxapplication_start_menu_trace (GtkOSXApplication *self,
+				     const gchar *file_name)
+{
+    g_return_val_if_fail (file_name != NULL, FALSE);
+    return menu_trace_start (file_name);
+}
+
+/**
+ * gtk_osxapplication_stop_menu_trace:
+ * @self: The GtkOSXApplication pointer.
+ *
+ * Finish the trace started by gtk_osxapplication_start_menu_trace().
+ */
+void
+gtk_osxapplication_stop_menu_trace (GtkOSXApplication *self)
+{
+    menu_trace_stop ();
+}
+
 /*
  * gtk_type_osxapplication_attention_type_get_type:
  *
@@ -273,3 +528,14 @@ gtk_type_osxapplication_attention_type_get_type(void)
   //Bogus GType, but there's no good reason to register this; it's only an enum
   return 0;
 }
+
+/*
+ * gtk_type_osxapplication_activation_mode_get_type:
+ *
+ * See gtk_type_osxapplication_attention_type_get_type().
+ */
+GType
+gtk_type_osxapplication_activation_mode_get_type(void)
+{
+  return 0;
+}
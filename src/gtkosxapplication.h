@@ -39,6 +39,13 @@ typedef struct _GtkOSXApplication GtkOSXApplication;
 typedef struct _GtkOSXApplicationPrivate GtkOSXApplicationPrivate;
 typedef struct _GtkOSXApplicationClass GtkOSXApplicationClass;
 typedef struct _GtkOSXApplicationMenuGroup GtkOSXApplicationMenuGroup;
+typedef struct _GtkOSXApplicationMenuStats GtkOSXApplicationMenuStats;
+
+/* The latency histograms in GtkOSXApplicationMenuStats count events
+   by how long they took. Bucket 0 is everything under 256ns, bucket i
+   from 2^(i+7)ns up to twice that, and the last bucket everything
+   over 2^26ns (67ms). */
+#define GTK_OSX_APPLICATION_LATENCY_BUCKETS 20
 
 struct _GtkOSXApplication
 {
@@ -58,6 +65,93 @@ struct _GtkOSXApplicationMenuGroup
   GList *items;
 };
 
+/* Counters for the menu mirroring; see
+   gtk_osxapplication_get_menu_stats(). New counters are only ever
+   added at the end, taking the place of reserved space, so that
+   callers built against an older version still work. */
+struct _GtkOSXApplicationMenuStats
+{
+  /* Set by the caller to sizeof (GtkOSXApplicationMenuStats) */
+  gsize struct_size;
+
+  /* Menubar synchronization */
+  guint syncs;
+  guint last_sync_shells_visited;
+  guint last_sync_items_visited;
+  guint64 shells_visited;
+  guint64 items_visited;
+
+  /* Lazy submenus, and submenus left for later by a sync which ran
+     out of budget */
+  guint submenus_deferred;
+  guint submenus_materialized;
+  guint64 shells_postponed;
+
+  /* Coalesced item updates */
+  guint64 notifies_received;
+  guint64 native_updates;
+  guint64 updates_coalesced;
+  guint update_flushes;
+
+  /* Menu item reparenting */
+  guint64 parent_set_checks;
+  guint64 items_inserted_in_place;
+  guint64 insert_fallbacks;
+
+  /* Menu item labels */
+  guint64 label_lookups;
+  guint64 label_walks;
+  guint64 label_walk_allocs;
+
+  /* Interned titles */
+  guint64 title_lookups;
+  guint64 title_address_hits;
+  guint64 title_text_hits;
+  guint64 title_conversions;
+  guint titles_interned;
+  guint64 title_bytes;
+
+  /* Shared menubars */
+  guint shared_menubars;
+  guint shared_windows;
+  guint native_items;
+  guint64 shared_switches;
+  guint64 shared_items_rebound;
+  guint64 shared_shells_resynced;
+
+  /* Pre-warming and focus changes */
+  guint64 prewarm_steps;
+  guint64 focus_switches;
+  guint64 focus_switches_cold;
+  guint64 focus_latency[GTK_OSX_APPLICATION_LATENCY_BUCKETS];
+
+  /* Menu item activation */
+  guint64 activations;
+  guint64 activations_coalesced;
+  guint64 activation_latency[GTK_OSX_APPLICATION_LATENCY_BUCKETS];
+
+  /* Accelerators */
+  guint64 accel_changes;
+  guint64 accel_dispatches;
+  guint64 accel_lookups;
+  guint accel_index_builds;
+  guint accel_map_loads;
+  guint last_accel_map_changes;
+  guint64 last_accel_map_load_ns;
+  guint64 last_accel_map_update_ns;
+  guint shortcut_conflicts;
+
+  /* Key equivalents */
+  guint64 key_events;
+  guint64 key_index_hits;
+  guint64 key_index_misses;
+  guint64 key_index_fallbacks;
+  guint64 key_latency[GTK_OSX_APPLICATION_LATENCY_BUCKETS];
+
+  /*< private >*/
+  guint64 reserved[32];
+};
+
 
 GType gtk_osxapplication_get_type (void);
 //GtkOSXApplication *gtk_osxapplication_get (void);
@@ -71,11 +165,51 @@ void gtk_osxapplication_cleanup (GtkOSXApplication *self);
 void gtk_osxapplication_set_use_quartz_accelerators(GtkOSXApplication *self, 
 					 gboolean use_quartz_accelerators);
 gboolean gtk_osxapplication_use_quartz_accelerators(GtkOSXApplication *self);
+void gtk_osxapplication_load_accel_map (GtkOSXApplication *self,
+					const gchar *file_name);
+void gtk_osxapplication_load_accel_map_fd (GtkOSXApplication *self,
+					   gint fd);
 
 /*Menu functions*/
+
+/* When a menu item's handlers run after it's chosen from the OSX
+   menubar. See gtk_osxapplication_set_activation_mode(). */
+typedef enum {
+  GTK_OSX_APPLICATION_ACTIVATE_IDLE = 0,
+  GTK_OSX_APPLICATION_ACTIVATE_HIGH
+} GtkOSXApplicationActivationMode;
+
+/*To satisfy h2defs.py */
+#define GTK_TYPE_OSX_APPLICATION_ACTIVATION_MODE	(gtk_type_osxapplication_activation_mode_get_type())
+GType gtk_type_osxapplication_activation_mode_get_type(void);
+
 void gtk_osxapplication_set_menu_bar (GtkOSXApplication *self, 
 				      GtkMenuShell *menu_shell);
+void gtk_osxapplication_set_shared_menu_bar (GtkOSXApplication *self,
+					     GtkMenuShell *menu_shell,
+					     gpointer layout);
 void gtk_osxapplication_sync_menubar (GtkOSXApplication *self);
+void gtk_osxapplication_freeze_menubar (GtkOSXApplication *self);
+void gtk_osxapplication_thaw_menubar (GtkOSXApplication *self);
+void gtk_osxapplication_get_menu_stats (GtkOSXApplication *self,
+					GtkOSXApplicationMenuStats *stats);
+void gtk_osxapplication_reset_menu_stats (GtkOSXApplication *self);
+void gtk_osxapplication_set_lazy_submenus (GtkOSXApplication *self,
+					   gboolean lazy_submenus);
+gboolean gtk_osxapplication_lazy_submenus (GtkOSXApplication *self);
+void gtk_osxapplication_set_prewarm_menubars (GtkOSXApplication *self,
+					      gboolean prewarm);
+gboolean gtk_osxapplication_prewarm_menubars (GtkOSXApplication *self);
+void gtk_osxapplication_set_menu_sync_budget (GtkOSXApplication *self,
+					      guint budget_us);
+guint gtk_osxapplication_menu_sync_budget (GtkOSXApplication *self);
+void gtk_osxapplication_set_activation_mode (GtkOSXApplication *self,
+					     GtkOSXApplicationActivationMode mode);
+GtkOSXApplicationActivationMode
+gtk_osxapplication_activation_mode (GtkOSXApplication *self);
+gboolean gtk_osxapplication_start_menu_trace (GtkOSXApplication *self,
+					      const gchar *file_name);
+void gtk_osxapplication_stop_menu_trace (GtkOSXApplication *self);
 
 #ifndef GTK_DISABLE_DEPRECATED
 GtkOSXApplicationMenuGroup *gtk_osxapplication_add_app_menu_group (GtkOSXApplication* self);
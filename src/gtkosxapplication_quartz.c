@@ -36,6 +36,17 @@
 #include "cocoa_menu_item.h"
 #include "cocoa_menu.h"
 #include "getlabel.h"
+#include "menu_accel.h"
+#include "menu_keyindex.h"
+#include "menu_prewarm.h"
+#include "menu_share.h"
+#include "menu_shortcut.h"
+#include "menu_state.h"
+#include "menu_stats.h"
+#include "menu_sync.h"
+#include "menu_trace.h"
+#include "menu_update.h"
+#include "menu_watch.h"
 #include "ige-mac-image-utils.h"
 
 /* This is a private function in libgdk; we need to have is so that we
@@ -56,78 +67,58 @@ extern NSWindow* gdk_quartz_window_get_nswindow(GdkWindow*);
 G_DEFINE_TYPE (GtkOSXApplication, gtk_osxapplication, G_TYPE_OBJECT)
 
 
-static gulong emission_hook_id = 0;
-
 /*
- * parent_set_emission_hook:
- * @ihint: The signal hint confgigured when the signal was created.
- * @n_param_values: The number of parameters passed in param_values
- * @param_values: A GValue[] containing the parameters
- * data: A gpointer to pass to the signal handler
- *
- * Sets an emission hook for all parent-set signals. 
+ * menu_item_parent_changed:
+ * @instance: A GtkMenuItem
+ * @old_parent: The shell it was in, if any
+ * @new_parent: The shell it's in now, if any
+ * @position: Where it is in @new_parent, or -1 for the end
+ *
+ * The MenuWatchFunc: a menu item has moved into or out of a mirrored
+ * menu shell.
  */
-static gboolean
-parent_set_emission_hook (GSignalInvocationHint *ihint,
-			  guint                  n_param_values,
-			  const GValue          *param_values,
-			  gpointer               data)
+static void
+menu_item_parent_changed (GtkWidget *instance,
+			  GtkWidget *old_parent,
+			  GtkWidget *new_parent,
+			  gint       position)
 {
-  GtkWidget *instance = (GtkWidget*) g_value_get_object (param_values);
-
-  if (GTK_IS_MENU_ITEM (instance)) {
-    GtkWidget *old_parent = (GtkWidget*) g_value_get_object (param_values + 1);
-    GtkWidget *new_parent = gtk_widget_get_parent(instance);
-    GNSMenuItem *cocoa_item = cocoa_menu_item_get(instance);
 /* If neither the old parent or the new parent has a cocoa menu, then
    we're not really interested in this. */
-    if (!( (old_parent && GTK_IS_WIDGET(old_parent) 
-	    && cocoa_menu_get(old_parent)) || 
-	   (new_parent && GTK_IS_WIDGET(new_parent)
-	    && cocoa_menu_get(new_parent))))
-      return TRUE;
-
-    if (GTK_IS_MENU_SHELL (old_parent)) {
-  	GNSMenuBar *cocoa_menu = (GNSMenuBar*)cocoa_menu_get (old_parent);
-	[cocoa_item removeFromMenu: cocoa_menu];
-
-    }
-    /*This would be considerably more efficient if we could just
-      insert it into the menu, but we can't easily get the item's
-      position in the GtkMenu and even if we could we don't know that
-      there isn't some other item in the menu that's been moved to the
-      app-menu for quartz.  */
-    if (GTK_IS_MENU_SHELL (new_parent) && cocoa_menu_get(new_parent)) {
-  	GNSMenuBar *cocoa_menu = (GNSMenuBar*)cocoa_menu_get (new_parent);
-	if (GTK_IS_MENU_BAR(new_parent) && cocoa_menu && 
-	    [cocoa_menu respondsToSelector: @selector(resync)]) {
-	  [cocoa_menu resync];
-	}
-	else
-	  cocoa_menu_item_add_submenu (GTK_MENU_SHELL (new_parent),
-				       cocoa_menu,
-				       cocoa_menu == (NSMenu*) data,
-				       FALSE);
-    }
+  if (!( (old_parent && GTK_IS_WIDGET(old_parent) 
+	  && cocoa_menu_get(old_parent)) || 
+	 (new_parent && GTK_IS_WIDGET(new_parent)
+	  && cocoa_menu_get(new_parent))))
+    return;
+  menu_trace_parent_set (instance, old_parent, new_parent, position);
+
+  if (GTK_IS_MENU_SHELL (old_parent) && cocoa_menu_get(old_parent)) {
+    GNSMenuBar *cocoa_menu = (GNSMenuBar*)cocoa_menu_get (old_parent);
+    gboolean in_sync =
+      menu_sync_remove_child (old_parent, cocoa_menu, instance);
+    if (menu_state_is_frozen ())
+      menu_state_record_frozen (old_parent);
+    else if (!in_sync)
+      menu_shell_mark_dirty (old_parent);
+  }
+  if (menu_state_is_frozen ()) {
+    /* Just note it; gtk_osxapplication_thaw_menubar() syncs */
+    if (GTK_IS_MENU_SHELL (new_parent) && cocoa_menu_get(new_parent))
+      menu_state_record_frozen (new_parent);
+    return;
+  }
+  /* Usually the item can go straight into the menu at the right
+     place; if not, sync the whole menu. */
+  if (GTK_IS_MENU_SHELL (new_parent) && cocoa_menu_get(new_parent)) {
+    GNSMenuBar *cocoa_menu = (GNSMenuBar*)cocoa_menu_get (new_parent);
+    if (menu_sync_insert_child (new_parent, cocoa_menu, instance, position))
+      return;
+    menu_shell_mark_dirty (new_parent);
+    if (GTK_IS_MENU_BAR (new_parent))
+      menu_sync_menubar (new_parent, cocoa_menu);
+    else
+      menu_sync_shell (new_parent, cocoa_menu, FALSE);
   }
-  return TRUE;
-}
-
-/*
- * parent_set_emission_hook_remove:
- * @widget: A random widget. Not used.
- * @data: A random gpointer. Not used.
- *
- * Removes the parent-set emission hook. This meets a particular
- * template, which is the reason for the unused parameters.
- */
-static void
-parent_set_emission_hook_remove (GtkWidget *widget,
-				 gpointer   data)
-{
-  g_signal_remove_emission_hook (g_signal_lookup ("parent-set",
-						  GTK_TYPE_WIDGET),
-				 emission_hook_id);
 }
 
 /*
@@ -191,12 +182,14 @@ create_apple_menu (GtkOSXApplication *self)
   menuitem = [[NSMenuItem alloc] initWithTitle: NSLocalizedStringFromTable(@"Hide",  @"GtkOSXApplication", @"Hide menu item title")
 				 action:@selector(hide:) keyEquivalent:@"h"];
   [menuitem setTarget: NSApp];
+  cocoa_menu_item_index_key_equivalent (menuitem);
   [app_menu addItem: menuitem];
   [menuitem release];
   menuitem = [[NSMenuItem alloc] initWithTitle: NSLocalizedStringFromTable(@"Hide Others",  @"GtkOSXApplication", @"Hide Others menu item title")
 				 action:@selector(hideOtherApplications:) keyEquivalent:@"h"];
   [menuitem setKeyEquivalentModifierMask: NSCommandKeyMask | NSAlternateKeyMask];
   [menuitem setTarget: NSApp];
+  cocoa_menu_item_index_key_equivalent (menuitem);
   [app_menu addItem: menuitem];
   [menuitem release];
   menuitem = [[NSMenuItem alloc] initWithTitle: NSLocalizedStringFromTable( @"Show All", @"GtkOSXApplication",  @"Show All menu item title")
@@ -208,6 +201,7 @@ create_apple_menu (GtkOSXApplication *self)
   menuitem = [[NSMenuItem alloc] initWithTitle: NSLocalizedStringFromTable(@"Quit",  @"GtkOSXApplication", @"Quit menu item title")
 				 action:@selector(terminate:) keyEquivalent:@"q"];
   [menuitem setTarget: NSApp];
+  cocoa_menu_item_index_key_equivalent (menuitem);
   [app_menu addItem: menuitem];
   [menuitem release];
 
@@ -238,6 +232,7 @@ create_window_menu (GtkOSXApplication *self)
   GtkWidget *parent = NULL;
   GdkWindow *win = NULL;
   NSWindow *nswin = NULL;
+  NSMenuItem *menuitem;
   int pos;
 
   g_return_val_if_fail(menubar != NULL, NULL);
@@ -248,8 +243,9 @@ create_window_menu (GtkOSXApplication *self)
   if (win && GDK_IS_WINDOW(win))
     nswin = gdk_quartz_window_get_nswindow(win);
 
-  [window_menu addItemWithTitle: NSLocalizedStringFromTable(@"Minimize", @"GtkOSXApplication", @"Windows|Minimize menu item")
+  menuitem = [window_menu addItemWithTitle: NSLocalizedStringFromTable(@"Minimize", @"GtkOSXApplication", @"Windows|Minimize menu item")
 		action:@selector(performMiniaturize:) keyEquivalent:@"m"];
+  cocoa_menu_item_index_key_equivalent (menuitem);
   [window_menu addItem: [NSMenuItem separatorItem]];
   [window_menu addItemWithTitle: NSLocalizedStringFromTable(@"Bring All to Front", @"GtkOSXApplication", @"Windows|Bring All To Front menu item title")
 		action:@selector(arrangeInFront:) keyEquivalent:@""];
@@ -405,6 +401,75 @@ block_termination_accumulator(GSignalInvocationHint *ihint, GValue *accum,
   return TRUE; //Continue handling the signal
  }
 
+/*
+ * perform_key_equivalent:
+ * @nsevent: An NSKeyDown event
+ *
+ * Look @nsevent up in the key equivalent index and hand it to the
+ * menus holding the items it might match, rather than have Cocoa
+ * search the whole menubar for it. Most key presses are just typing,
+ * and they don't match anything.
+ *
+ * The index only has the items this library made, so a Command or
+ * Control chord which misses it still goes to the whole menubar:
+ * AppKit and the application put key equivalents of their own there
+ * (Enter Full Screen, Emoji & Symbols, and so on). Only keys without
+ * those modifiers, which is nearly all of the typing, are rejected
+ * without a search.
+ *
+ * Returns: Whether a menu item took the key press.
+ */
+static gboolean
+perform_key_equivalent (NSEvent *nsevent)
+{
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  NSMenu *main_menu = [NSApp mainMenu];
+  NSString *chars;
+  GSList *items, *l;
+  gboolean handled = FALSE;
+  guint modifiers = cocoa_menu_item_key_modifiers ([nsevent modifierFlags]);
+  gboolean chord = (modifiers & (MENU_KEY_COMMAND | MENU_KEY_CONTROL)) != 0;
+
+  /* Lazy submenus are filled in when Cocoa searches them, so until
+     they have been their key equivalents can't be in the index. */
+  if (menu_state_n_deferred () > 0) {
+    stats->key_index_fallbacks++;
+    return [main_menu performKeyEquivalent: nsevent];
+  }
+
+  /* Dead keys and the like don't produce a character */
+  chars = [nsevent charactersIgnoringModifiers];
+  if ([chars length] != 1 && !chord) {
+    stats->key_index_misses++;
+    return FALSE;
+  }
+
+  /* Copied, because the menus may be synced as they're searched */
+  items = [chars length] == 1 ?
+    g_slist_copy (menu_key_index_lookup ([chars characterAtIndex: 0],
+					 modifiers)) : NULL;
+  for (l = items; l && !handled; l = l->next) {
+    NSMenu *menu = [(NSMenuItem*) l->data menu], *root = menu;
+
+    /* Items on other windows' menubars are in the index too */
+    while ([root supermenu])
+      root = [root supermenu];
+    if (menu && root == main_menu)
+      handled = [menu performKeyEquivalent: nsevent];
+  }
+  g_slist_free (items);
+
+  if (handled)
+    stats->key_index_hits++;
+  else if (chord) {
+    stats->key_index_fallbacks++;
+    handled = [main_menu performKeyEquivalent: nsevent];
+  }
+  else
+    stats->key_index_misses++;
+  return handled;
+}
+
 /*
  * global_event_filter_func
  * @windowing_event: The event to process as a gpointer
@@ -423,15 +488,25 @@ global_event_filter_func (gpointer  windowing_event, GdkEvent *event,
 {
   NSEvent *nsevent = windowing_event;
   GtkOSXApplication* app = user_data;
+  GdkFilterReturn result = GDK_FILTER_CONTINUE;
 
   /* Handle menu events with no window, since they won't go through the
    * regular event processing.
    */
   if ([nsevent type] == NSKeyDown && 
-      gtk_osxapplication_use_quartz_accelerators(app) )
-    if ([[NSApp mainMenu] performKeyEquivalent: nsevent])
-      return GDK_FILTER_TRANSLATE;
-  return GDK_FILTER_CONTINUE;
+      gtk_osxapplication_use_quartz_accelerators(app) ) {
+    GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+    guint64 start = menu_stats_now_ns ();
+
+    /* Disabled items mustn't match */
+    menu_update_flush ();
+    if (perform_key_equivalent (nsevent))
+      result = GDK_FILTER_TRANSLATE;
+    stats->key_events++;
+    menu_stats_record_latency (stats->key_latency,
+			       menu_stats_now_ns () - start);
+  }
+  return result;
 }
 
 enum {
@@ -461,6 +536,17 @@ gtk_osxapplication_init (GtkOSXApplication *self)
   self->priv->use_quartz_accelerators = TRUE;
   self->priv->dock_menu = NULL;
   gdk_window_add_filter (NULL, global_event_filter_func, (gpointer)self);
+  menu_sync_set_backend (&cocoa_menu_item_backend);
+  menu_watch_set_func (menu_item_parent_changed);
+  /* A shortcut changing hands is shown like an accelerator change */
+  menu_shortcut_set_func (menu_accel_dispatch);
+  /* Whatever leaves a menu out of date starts the pre-warming */
+  menu_prewarm_set_func (menu_sync_prewarm);
+  menu_state_set_changed_func (menu_prewarm_schedule);
+  /* So that a whole session's menu changes can be traced without
+     touching the application; see gtk_osxapplication_start_menu_trace() */
+  if (g_getenv ("GTK_OSX_MENU_TRACE"))
+    menu_trace_start (g_getenv ("GTK_OSX_MENU_TRACE"));
   self->priv->notify = [[GtkApplicationNotificationObject alloc] init];
   [self->priv->notify retain];
 
@@ -618,6 +704,27 @@ gtk_osxapplication_cleanup(GtkOSXApplication *self)
 {
   [self->priv->dock_menu release];
   [self->priv->notify release];
+  menu_trace_stop ();
+}
+
+/*
+ * record_focus_switch:
+ * @start: When the window took focus, from menu_stats_now_ns()
+ * @cold: Whether its menubar had to be brought up to date first
+ *
+ * Count a window taking focus, and how long it took for its menubar
+ * to be ready.
+ */
+static void
+record_focus_switch (guint64 start, gboolean cold)
+{
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+
+  stats->focus_switches++;
+  if (cold)
+    stats->focus_switches_cold++;
+  menu_stats_record_latency (stats->focus_latency,
+			     menu_stats_now_ns () - start);
 }
 
 /*
@@ -630,38 +737,48 @@ gtk_osxapplication_cleanup(GtkOSXApplication *self)
  * windows. If you switch window focus programmatically, make sure
  * that the activate signal is emitted for the new window to trigger
  * this handler.
+ *
+ * Pre-warming has normally brought the menubar up to date already;
+ * if it hasn't got to it yet, it's synced here, so that the first
+ * menu the user opens doesn't have to wait.
  */
 static gboolean
 window_focus_cb (GtkWindow* window, GdkEventFocus *event, GNSMenuBar *menubar)
 {
-  [NSApp setMainMenu: menubar];
+  guint64 start = menu_stats_now_ns ();
+  GtkWidget *menu_shell = GTK_WIDGET ([menubar menuBar]);
+  gboolean cold;
+
+  menu_trace_focus (menu_shell);
+  cold = menu_shell_needs_sync (menu_shell, menubar);
+  if (cold)
+    [menubar resync];
+  if (menubar != [NSApp mainMenu])
+    [NSApp setMainMenu: menubar];
+  record_focus_switch (start, cold);
   return FALSE;
 }
 
-/**
- * gtk_osxapplication_set_menu_bar:
+/*
+ * mirror_menu_bar:
  * @self: The GtkOSXApplication object
- * @menu_shell: The GtkMenuBar that you want to set.
+ * @menu_shell: A window's GtkMenuBar
  *
- * Set a window's menubar as the application menu bar. Call this once
- * for each window as you create them. It works best if the menubar is
- * reasonably fully populated before you call it. Once set, it will
- * stay syncronized through signals as long as you don't disconnect or
- * block them.
+ * Mirror @menu_shell into its GNSMenuBar, creating that if need be,
+ * and make it the application menubar.
+ *
+ * Returns: The GNSMenuBar.
  */
-void
-gtk_osxapplication_set_menu_bar (GtkOSXApplication *self, GtkMenuShell *menu_shell)
+static GNSMenuBar*
+mirror_menu_bar (GtkOSXApplication *self, GtkMenuShell *menu_shell)
 {
   GNSMenuBar* cocoa_menubar;
-  GtkWidget *parent = gtk_widget_get_toplevel(GTK_WIDGET(menu_shell));
- 
-  g_return_if_fail (GTK_IS_MENU_SHELL (menu_shell));
 
   cocoa_menubar = (GNSMenuBar*)cocoa_menu_get(GTK_WIDGET (menu_shell));
   if (!cocoa_menubar) {
     cocoa_menubar = [[GNSMenuBar alloc] initWithGtkMenuBar: 
 		     GTK_MENU_BAR(menu_shell)];
-    cocoa_menu_connect(GTK_WIDGET (menu_shell), cocoa_menubar);
+    menu_sync_connect_menu (GTK_WIDGET (menu_shell), cocoa_menubar);
   /* turn off auto-enabling for the menu - its silly and slow and
      doesn't really make sense for a Gtk/Cocoa hybrid menu.
   */
@@ -673,23 +790,164 @@ gtk_osxapplication_set_menu_bar (GtkOSXApplication *self, GtkMenuShell *menu_she
 
   [cocoa_menubar setAppMenu: create_apple_menu (self)];
 
-  emission_hook_id =
-    g_signal_add_emission_hook (g_signal_lookup ("parent-set",
-						 GTK_TYPE_WIDGET),
-				0,
-				parent_set_emission_hook,
-				cocoa_menubar, NULL);
-
+  /* The app menu has just been replaced, so the menubar needs a look
+     even if its GtkMenuBar hasn't changed. */
+  menu_shell_mark_dirty (GTK_WIDGET (menu_shell));
+  menu_sync_shell (GTK_WIDGET (menu_shell), cocoa_menubar, TRUE);
+  menu_prewarm_add (GTK_WIDGET (menu_shell));
+  return cocoa_menubar;
+}
 
-  g_signal_connect (menu_shell, "destroy",
-		    G_CALLBACK (parent_set_emission_hook_remove),
-		    NULL);
+/**
+ * gtk_osxapplication_set_menu_bar:
+ * @self: The GtkOSXApplication object
+ * @menu_shell: The GtkMenuBar that you want to set.
+ *
+ * Set a window's menubar as the application menu bar. Call this once
+ * for each window as you create them. It works best if the menubar is
+ * reasonably fully populated before you call it. Once set, it will
+ * stay syncronized through signals as long as you don't disconnect or
+ * block them.
+ */
+void
+gtk_osxapplication_set_menu_bar (GtkOSXApplication *self, GtkMenuShell *menu_shell)
+{
+  GNSMenuBar* cocoa_menubar;
+  GtkWidget *parent = gtk_widget_get_toplevel(GTK_WIDGET(menu_shell));
+ 
+  g_return_if_fail (GTK_IS_MENU_SHELL (menu_shell));
 
+  menu_trace_set_menu_bar (GTK_WIDGET (menu_shell), NULL);
+  cocoa_menubar = mirror_menu_bar (self, menu_shell);
   g_signal_connect (parent, "focus-in-event", 
 		    G_CALLBACK(window_focus_cb),
 		    cocoa_menubar);
+}
 
-  cocoa_menu_item_add_submenu (menu_shell, cocoa_menubar, TRUE, FALSE);
+/*
+ * shared_menu_bar_activate:
+ * @group: A group of shared menubars
+ * @menubar: The member to show
+ *
+ * Hand the group's native menubar over to @menubar if it isn't
+ * already showing it, and make it the application menubar.
+ */
+static void
+shared_menu_bar_activate (MenuShareGroup *group, GtkWidget *menubar)
+{
+  if (group->active != menubar) {
+    [(GNSMenuBar*) group->native setMenuBar: GTK_MENU_BAR (menubar)];
+    menu_sync_switch_menubar (group->active, menubar);
+    group->active = menubar;
+  }
+  if ((NSMenu*) group->native != [NSApp mainMenu])
+    [NSApp setMainMenu: (NSMenu*) group->native];
+}
+
+/*
+ * shared_window_focus_cb:
+ * @window: The application window receiving focus
+ * @event: The GdkEvent. Not used.
+ * @menubar: The window's shared GtkMenuBar
+ *
+ * window_focus_cb() for windows with shared menubars.
+ */
+static gboolean
+shared_window_focus_cb (GtkWindow* window, GdkEventFocus *event,
+			GtkWidget *menubar)
+{
+  guint64 start = menu_stats_now_ns ();
+  MenuShareGroup *group = menu_share_group_find (menubar);
+  gboolean cold;
+
+  if (!group || !group->active)
+    return FALSE;
+  menu_trace_focus (menubar);
+  /* Handing the native menubar over is a sync in itself */
+  cold = (group->active != menubar ||
+	  menu_shell_needs_sync (menubar, group->native));
+  if (cold && group->active == menubar)
+    [(GNSMenuBar*) group->native resync];
+  shared_menu_bar_activate (group, menubar);
+  record_focus_switch (start, cold);
+  return FALSE;
+}
+
+/*
+ * shared_menu_bar_destroy_cb:
+ * @menubar: A shared GtkMenuBar being destroyed
+ * @data: Not used
+ *
+ * Pass the native menubar on to another member of the group before
+ * @menubar's items go, so that it needn't be rebuilt.
+ */
+static void
+shared_menu_bar_destroy_cb (GtkWidget *menubar, gpointer data)
+{
+  MenuShareGroup *group = menu_share_group_find (menubar);
+  GSList *l;
+
+  if (!group)
+    return;
+  g_signal_handlers_disconnect_by_func (gtk_widget_get_toplevel (menubar),
+					shared_window_focus_cb, menubar);
+  if (group->active == menubar)
+    for (l = group->menubars; l; l = l->next)
+      if (l->data != menubar) {
+	shared_menu_bar_activate (group, (GtkWidget*) l->data);
+	break;
+      }
+  menu_share_remove (group, menubar);
+}
+
+/**
+ * gtk_osxapplication_set_shared_menu_bar:
+ * @self: The GtkOSXApplication object
+ * @menu_shell: A window's GtkMenuBar
+ * @layout: Identifies the menu layout @menu_shell was built from,
+ * such as the GtkUIManager that made it
+ *
+ * Use this instead of gtk_osxapplication_set_menu_bar() when every
+ * window has its own copy of the same menus. All of the menubars set
+ * with the same @layout share one OSX menubar. Only the focused
+ * window's menubar is mirrored into it: when another window takes
+ * focus, the OSX menu items are handed over to the matching items of
+ * its menubar and only what differs between the two windows is
+ * updated. Additional windows cost next to nothing, as the
+ * native_items count in #GtkOSXApplicationMenuStats shows.
+ *
+ * Items are matched by their action's name, or failing that their
+ * accel path or their label, so windows may add items of their own
+ * (a recent files list, say); those are mirrored in the ordinary way
+ * when the window takes focus.
+ */
+void
+gtk_osxapplication_set_shared_menu_bar (GtkOSXApplication *self,
+					GtkMenuShell *menu_shell,
+					gpointer layout)
+{
+  GtkWidget *menubar = GTK_WIDGET (menu_shell);
+  MenuShareGroup *group;
+
+  g_return_if_fail (GTK_IS_MENU_BAR (menu_shell));
+  g_return_if_fail (layout != NULL);
+
+  menu_trace_set_menu_bar (menubar, layout);
+  group = menu_share_group_find (menubar);
+  if (!group) {
+    group = menu_share_group_get (layout);
+    menu_share_add (group, menubar);
+    g_signal_connect (menubar, "destroy",
+		      G_CALLBACK (shared_menu_bar_destroy_cb), NULL);
+    g_signal_connect (gtk_widget_get_toplevel (menubar), "focus-in-event",
+		      G_CALLBACK (shared_window_focus_cb), menubar);
+  }
+  if (!group->active) {
+    group->native = mirror_menu_bar (self, menu_shell);
+    group->active = menubar;
+  }
+  else
+    shared_menu_bar_activate (group, menubar);
 }
 
 /**
@@ -703,7 +961,164 @@ gtk_osxapplication_set_menu_bar (GtkOSXApplication *self, GtkMenuShell *menu_she
 void
 gtk_osxapplication_sync_menubar (GtkOSXApplication *self)
 {
+  /* We can't know what was changed with the signals blocked, so
+     everything has to be looked at again. */
+  menu_trace_sync_menubar
+    (GTK_WIDGET ([(GNSMenuBar*)[NSApp mainMenu] menuBar]));
+  menu_state_invalidate_all ();
   [(GNSMenuBar*)[NSApp mainMenu] resync];
+  menu_update_flush ();
+}
+
+/**
+ * gtk_osxapplication_freeze_menubar:
+ * @self: The GtkOSXApplication object
+ *
+ * Stop mirroring menu changes into the OSX menus until
+ * gtk_osxapplication_thaw_menubar() is called. Use this around large
+ * changes to the menus, like merging a GtkUIManager description or
+ * loading plugins: while frozen, adding, removing and changing menu
+ * items just records which menus have changed, and the thaw brings
+ * them up to date in one go.
+ *
+ * Calls can be nested; the menus are thawed when each freeze has
+ * been matched by a thaw.
+ */
+void
+gtk_osxapplication_freeze_menubar (GtkOSXApplication *self)
+{
+  menu_trace_freeze ();
+  menu_state_freeze ();
+}
+
+/**
+ * gtk_osxapplication_thaw_menubar:
+ * @self: The GtkOSXApplication object
+ *
+ * Undo one gtk_osxapplication_freeze_menubar(). If it was the last
+ * one, sync every menu which changed in the meantime, or as much as
+ * the sync budget allows (see gtk_osxapplication_set_menu_sync_budget()).
+ */
+void
+gtk_osxapplication_thaw_menubar (GtkOSXApplication *self)
+{
+  GList *roots, *l;
+
+  menu_trace_thaw ();
+  if (!menu_state_thaw ())
+    return;
+
+  roots = menu_state_take_frozen ();
+  /* The trees share one sync budget */
+  menu_state_begin_slice ();
+  for (l = roots; l; l = l->next) {
+    GtkWidget *root = (GtkWidget*) l->data;
+    NSMenu *cocoa_menu = cocoa_menu_get (root);
+
+    if (cocoa_menu && GTK_IS_MENU_BAR (root))
+      menu_sync_menubar (root, cocoa_menu);
+    else if (cocoa_menu)
+      menu_sync_shell (root, cocoa_menu, FALSE);
+    g_object_unref (root);
+  }
+  menu_state_end_slice ();
+  g_list_free (roots);
+  menu_update_flush ();
+  /* For any deferred submenus which changed */
+  menu_prewarm_schedule ();
+}
+
+/*
+ * accel_map_load_begin:
+ * @self: The GtkOSXApplication object
+ *
+ * Set up for loading an accel map: freeze the menus so that the
+ * accel-changed notifications just queue their items, and start
+ * timing.
+ *
+ * Returns: A GTimer for the load, for accel_map_load_end().
+ */
+static GTimer *
+accel_map_load_begin (GtkOSXApplication *self)
+{
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+
+  gtk_osxapplication_freeze_menubar (self);
+  stats->accel_map_loads++;
+  stats->last_accel_map_changes = stats->accel_changes;
+  return g_timer_new ();
+}
+
+/*
+ * accel_map_load_end:
+ * @self: The GtkOSXApplication object
+ * @timer: The GTimer from accel_map_load_begin()
+ *
+ * Finish loading an accel map: thaw the menus, which updates all of
+ * the changed key equivalents in one pass, and record how long the
+ * load and the update took.
+ */
+static void
+accel_map_load_end (GtkOSXApplication *self, GTimer *timer)
+{
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  gdouble loaded;
+
+  loaded = g_timer_elapsed (timer, NULL);
+  stats->last_accel_map_changes =
+    stats->accel_changes - stats->last_accel_map_changes;
+  gtk_osxapplication_thaw_menubar (self);
+  stats->last_accel_map_load_ns = (guint64) (loaded * 1e9);
+  stats->last_accel_map_update_ns =
+    (guint64) ((g_timer_elapsed (timer, NULL) - loaded) * 1e9);
+  g_timer_destroy (timer);
+}
+
+/**
+ * gtk_osxapplication_load_accel_map:
+ * @self: The GtkOSXApplication object
+ * @file_name: A file containing an accelerator map
+ *
+ * Load @file_name with gtk_accel_map_load(). Rather than updating
+ * each menu item's key equivalent as its accelerator changes, which
+ * is slow for a large map, the changed items are noted and brought up
+ * to date in one pass at the end. The time spent on each part is
+ * reported in the last_accel_map fields of
+ * GtkOSXApplicationMenuStats.
+ */
+void
+gtk_osxapplication_load_accel_map (GtkOSXApplication *self,
+				   const gchar *file_name)
+{
+  GTimer *timer;
+
+  g_return_if_fail (GTK_IS_OSX_APPLICATION (self));
+  g_return_if_fail (file_name != NULL);
+
+  timer = accel_map_load_begin (self);
+  gtk_accel_map_load (file_name);
+  accel_map_load_end (self, timer);
+}
+
+/**
+ * gtk_osxapplication_load_accel_map_fd:
+ * @self: The GtkOSXApplication object
+ * @fd: A valid readable file descriptor
+ *
+ * Like gtk_osxapplication_load_accel_map(), but with
+ * gtk_accel_map_load_fd().
+ */
+void
+gtk_osxapplication_load_accel_map_fd (GtkOSXApplication *self, gint fd)
+{
+  GTimer *timer;
+
+  g_return_if_fail (GTK_IS_OSX_APPLICATION (self));
+  g_return_if_fail (fd >= 0);
+
+  timer = accel_map_load_begin (self);
+  gtk_accel_map_load_fd (fd);
+  accel_map_load_end (self, timer);
 }
 
 
@@ -793,8 +1208,8 @@ gtk_osxapplication_add_app_menu_item (GtkOSXApplication *self,
 	      index++;
 	    }
 	  DEBUG ("Add to APP menu bar %s\n", get_menu_label_text (GTK_WIDGET(menu_item), NULL));
-	  cocoa_menu_item_add_item ([[[NSApp mainMenu] itemAtIndex: 0] submenu],
-				    GTK_WIDGET(menu_item), index + 1);
+	  menu_sync_add_item ([[[NSApp mainMenu] itemAtIndex: 0] submenu],
+			      GTK_WIDGET(menu_item), index + 1);
 
 	  group->items = g_list_append (group->items, menu_item);
 	  return;
@@ -829,8 +1244,8 @@ void
 gtk_osxapplication_insert_app_menu_item (GtkOSXApplication* self,
 					 GtkWidget* item,
 					 gint index) {
-    cocoa_menu_item_add_item ([[[NSApp mainMenu] itemAtIndex: 0] submenu],
-			      item, index);
+    menu_sync_add_item ([[[NSApp mainMenu] itemAtIndex: 0] submenu],
+			item, index);
     [(GNSMenuItem*)[[[[NSApp mainMenu] itemAtIndex: 0] submenu] 
       itemAtIndex: index] setHidden: NO];
 }
@@ -939,7 +1354,7 @@ gtk_osxapplication_set_dock_menu(GtkOSXApplication *self,
   g_return_if_fail (GTK_IS_MENU_SHELL (menu_shell));
   if (!self->priv->dock_menu) {
     self->priv->dock_menu = [[NSMenu alloc] initWithTitle: @""]; 
-    cocoa_menu_item_add_submenu(menu_shell, self->priv->dock_menu, FALSE, FALSE);
+    menu_sync_shell (GTK_WIDGET (menu_shell), self->priv->dock_menu, FALSE);
     [self->priv->dock_menu retain];
   }
 }
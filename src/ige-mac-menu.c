@@ -34,6 +34,8 @@
 
 #include "ige-mac-menu.h"
 #include "ige-mac-private.h"
+#include "getlabel.h"
+#include "menu_shortcut.h"
 
 /* TODO
  *
@@ -84,36 +86,6 @@ menu_flash_off_cb (gpointer data) {
  * utility functions
  */
 
-static GtkWidget *
-find_menu_label (GtkWidget *widget) {
-    GtkWidget *label = NULL;
-    if (GTK_IS_LABEL (widget))
-	return widget;
-    if (GTK_IS_CONTAINER (widget)) {
-	GList *children;
-	GList *l;
-	children = gtk_container_get_children (GTK_CONTAINER (widget));
-	for (l = children; l; l = l->next) {
-	    label = find_menu_label (l->data);
-	    if (label)
-		break;
-	}
-	g_list_free (children);
-    }
-    return label;
-}
-
-static const gchar *
-get_menu_label_text (GtkWidget  *menu_item, GtkWidget **label) {
-    GtkWidget *my_label;
-    my_label = find_menu_label (menu_item);
-    if (label)
-	*label = my_label;
-    if (my_label)
-	return gtk_label_get_text (GTK_LABEL (my_label));
-    return NULL;
-}
-
 static gboolean
 accel_find_func (GtkAccelKey *key, GClosure *closure, gpointer data) {
     return (GClosure *) data == closure;
@@ -429,6 +401,22 @@ carbon_menu_item_update_label (CarbonMenuItem *carbon_item, GtkWidget *widget) {
 	CFRelease (cfstr);
 }
 
+static void
+carbon_menu_item_clear_accelerator (CarbonMenuItem *carbon_item,
+				    const gchar *label_txt) {
+    OSStatus err;
+
+    err = SetMenuItemModifiers (carbon_item->menu, carbon_item->index,
+				kMenuNoModifiers | kMenuNoCommandModifier);
+    carbon_menu_warn_label(err, label_txt, "Failed to set modifiers");
+    err = ChangeMenuItemAttributes (carbon_item->menu, carbon_item->index,
+				    0, kMenuItemAttrUseVirtualKey);
+    carbon_menu_warn_label(err, label_txt, "Failed to change attributes");
+    err = SetMenuItemCommandKey (carbon_item->menu, carbon_item->index,
+				 false, 0);
+    carbon_menu_warn_label(err, label_txt, "Failed to clear command key");
+}
+
 static void
 carbon_menu_item_update_accelerator (CarbonMenuItem *carbon_item,
 				     GtkWidget *widget) {
@@ -437,6 +425,7 @@ carbon_menu_item_update_accelerator (CarbonMenuItem *carbon_item,
     GdkDisplay *display = NULL;
     GdkKeymap *keymap = NULL;
     GdkKeymapKey *keys = NULL;
+    const MenuShortcut *shortcut;
     gint n_keys = 0;
     UInt8 modifiers = 0;
     OSStatus err;
@@ -445,23 +434,28 @@ carbon_menu_item_update_accelerator (CarbonMenuItem *carbon_item,
     if (!(GTK_IS_ACCEL_LABEL (label) 
 	  && _gtk_accel_label_get_closure(GTK_ACCEL_LABEL (label)))) {
 // Clear the menu shortcut
-	err = SetMenuItemModifiers (carbon_item->menu, carbon_item->index,
-				    kMenuNoModifiers | kMenuNoCommandModifier);
-	carbon_menu_warn_label(err, label_txt, "Failed to set modifiers");
-	err = ChangeMenuItemAttributes (carbon_item->menu, carbon_item->index,
-					0, kMenuItemAttrUseVirtualKey);
-	carbon_menu_warn_label(err, label_txt, "Failed to change attributes");
-	err = SetMenuItemCommandKey (carbon_item->menu, carbon_item->index,
-				     false, 0);
-	carbon_menu_warn_label(err, label_txt, "Failed to clear command key");
+	carbon_menu_item_clear_accelerator (carbon_item, label_txt);
 	return;
     }
     GClosure *closure = _gtk_accel_label_get_closure(GTK_ACCEL_LABEL(label));
     key = gtk_accel_group_find (gtk_accel_group_from_accel_closure(closure),
 				    accel_find_func,
 				    closure);
-    if (!(key && key->accel_key && key->accel_flags & GTK_ACCEL_VISIBLE))
+    if (!(key && key->accel_key && key->accel_flags & GTK_ACCEL_VISIBLE)) {
+	menu_shortcut_unregister (closure, menu_shortcut_get_scope (widget));
 	return;
+    }
+// Shortcuts only conflict within the one menubar
+    shortcut = menu_shortcut_register (closure, widget,
+				       menu_shortcut_get_scope (widget),
+				       key->accel_key,
+				       key->accel_mods,
+				       menu_shortcut_carbon_modifiers);
+// Another item earlier in the menus has the same shortcut
+    if (shortcut->owner != closure) {
+	carbon_menu_item_clear_accelerator (carbon_item, label_txt);
+	return;
+    }
     display = gtk_widget_get_display (widget);
     keymap  = gdk_keymap_get_for_display (display);
 
@@ -473,15 +467,14 @@ carbon_menu_item_update_accelerator (CarbonMenuItem *carbon_item,
 				 true, keys[0].keycode);
     carbon_menu_warn_label(err, label_txt, "Set Command Key Failed");
     g_free (keys);
-    if (key->accel_mods) {
-	if (key->accel_mods & GDK_SHIFT_MASK)
-	    modifiers |= kMenuShiftModifier;
-	if (key->accel_mods & GDK_MOD1_MASK)
-	    modifiers |= kMenuOptionModifier;
-    }
-    if (!(key->accel_mods & GDK_CONTROL_MASK)) {
+    if (shortcut->modifiers & MENU_SHORTCUT_SHIFT)
+	modifiers |= kMenuShiftModifier;
+    if (shortcut->modifiers & MENU_SHORTCUT_OPTION)
+	modifiers |= kMenuOptionModifier;
+    if (shortcut->modifiers & MENU_SHORTCUT_CONTROL)
+	modifiers |= kMenuControlModifier;
+    if (!(shortcut->modifiers & MENU_SHORTCUT_COMMAND))
 	modifiers |= kMenuNoCommandModifier;
-    }
     err = SetMenuItemModifiers (carbon_item->menu, carbon_item->index,
 				modifiers);
     carbon_menu_warn_label(err, label_txt, "Set Item Modifiers Failed");
@@ -574,23 +567,38 @@ carbon_menu_item_notify_label (GObject *object, GParamSpec *pspec,
     }
 }
 
+/* Only these reach carbon_menu_item_notify(), not every property
+   change on the item */
+static const gchar *carbon_menu_item_notifies[] = {
+    "notify::sensitive",
+    "notify::visible",
+    "notify::active",
+    "notify::submenu"
+};
+
 static CarbonMenuItem *
 carbon_menu_item_connect (GtkWidget *menu_item, GtkWidget *label,
 			  MenuRef menu, MenuItemIndex index) {
     CarbonMenuItem *carbon_item = 
 	carbon_menu_item_get_checked (menu_item);
+    guint i;
 
     if (!carbon_item) {
 	carbon_item = carbon_menu_item_new ();
 	g_object_set_qdata_full (G_OBJECT (menu_item), carbon_menu_item_quark,
 				 carbon_item,
 				 (GDestroyNotify) carbon_menu_item_free);
-	g_signal_connect (menu_item, "notify",
-			  G_CALLBACK (carbon_menu_item_notify), carbon_item);
-	if (label)
+	for (i = 0; i < G_N_ELEMENTS (carbon_menu_item_notifies); i++)
+	    g_signal_connect (menu_item, carbon_menu_item_notifies[i],
+			      G_CALLBACK (carbon_menu_item_notify), carbon_item);
+	if (label) {
 	    g_signal_connect_swapped(label, "notify::label",
 				     G_CALLBACK (carbon_menu_item_notify_label),
 				     menu_item);
+	    g_signal_connect_swapped(label, "notify::accel-closure",
+				     G_CALLBACK (carbon_menu_item_notify_label),
+				     menu_item);
+	}
     }
     carbon_item->menu  = menu;
     carbon_item->index = index;
@@ -0,0 +1,306 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#include "menu_accel.h"
+#include "menu_stats.h"
+
+/* Attached to each GtkAccelGroup with mirrored items */
+typedef struct {
+  GHashTable *closures; /* GClosure -> GSList of GtkWidget */
+  GHashTable *keys;     /* GClosure -> GtkAccelKey, or NULL until needed */
+} MenuAccelGroup;
+
+/* Attached to each watching GtkMenuItem */
+typedef struct {
+  GtkWidget *menu_item;
+  GClosure *closure;
+  /* Where the closure was when the watch began; it may have been
+     disconnected since. Weak. */
+  GtkAccelGroup *accel_group;
+} MenuAccelWatch;
+
+static GQuark menu_accel_group_quark = 0;
+static GQuark menu_accel_watch_quark = 0;
+static MenuAccelFunc menu_accel_func = NULL;
+static MenuAccelUnwatchFunc menu_accel_unwatch_func = NULL;
+
+static void
+menu_accel_group_free (gpointer data)
+{
+  MenuAccelGroup *group_data = (MenuAccelGroup*) data;
+
+  g_hash_table_destroy (group_data->closures);
+  if (group_data->keys)
+    g_hash_table_destroy (group_data->keys);
+  g_slice_free (MenuAccelGroup, group_data);
+}
+
+static void
+menu_accel_key_free (gpointer data)
+{
+  g_slice_free (GtkAccelKey, data);
+}
+
+static void
+menu_accel_key_set (MenuAccelGroup *group_data, GClosure *closure,
+		    const GtkAccelKey *key)
+{
+  g_hash_table_insert (group_data->keys, closure,
+		       g_slice_dup (GtkAccelKey, key));
+}
+
+/* gtk_accel_group_find() visits every entry, for building the table */
+static gboolean
+menu_accel_key_collect (GtkAccelKey *key, GClosure *closure, gpointer data)
+{
+  menu_accel_key_set ((MenuAccelGroup*) data, closure, key);
+  return FALSE;
+}
+
+/*
+ * menu_accel_key_changed:
+ * @accel_group: The group
+ * @group_data: Its MenuAccelGroup
+ * @keyval: The accel-changed keyval
+ * @modifier: The accel-changed modifier
+ * @accel_closure: The accel-changed closure
+ *
+ * Keep the key table up to date. accel-changed is emitted for a
+ * closure being connected, reconnected with a new key, or
+ * disconnected; after a disconnect the closure no longer belongs to
+ * the group. Otherwise the signal gives its new key, and the entry,
+ * which also has the flags, is found by querying that key.
+ */
+static void
+menu_accel_key_changed (GtkAccelGroup   *accel_group,
+			MenuAccelGroup  *group_data,
+			guint            keyval,
+			GdkModifierType  modifier,
+			GClosure        *accel_closure)
+{
+  GtkAccelGroupEntry *entries;
+  guint n_entries, i;
+
+  g_hash_table_remove (group_data->keys, accel_closure);
+  if (gtk_accel_group_from_accel_closure (accel_closure) != accel_group)
+    return;
+  entries = gtk_accel_group_query (accel_group, keyval, modifier, &n_entries);
+  for (i = 0; i < n_entries; i++)
+    if (entries[i].closure == accel_closure) {
+      menu_accel_key_set (group_data, accel_closure, &entries[i].key);
+      break;
+    }
+}
+
+static void
+menu_accel_changed (GtkAccelGroup   *accel_group,
+		    guint            keyval,
+		    GdkModifierType  modifier,
+		    GClosure        *accel_closure,
+		    MenuAccelGroup  *group_data)
+{
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  GSList *l;
+
+  stats->accel_changes++;
+  if (group_data->keys)
+    menu_accel_key_changed (accel_group, group_data,
+			    keyval, modifier, accel_closure);
+  for (l = g_hash_table_lookup (group_data->closures, accel_closure);
+       l; l = l->next) {
+    stats->accel_dispatches++;
+    if (menu_accel_func)
+      menu_accel_func ((GtkWidget*) l->data);
+  }
+}
+
+static MenuAccelGroup *
+menu_accel_group_get (GtkAccelGroup *accel_group)
+{
+  MenuAccelGroup *group_data;
+
+  if (menu_accel_group_quark == 0)
+    menu_accel_group_quark = g_quark_from_static_string ("MenuAccelGroup");
+
+  group_data = g_object_get_qdata (G_OBJECT (accel_group),
+				   menu_accel_group_quark);
+  if (!group_data) {
+    group_data = g_slice_new (MenuAccelGroup);
+    group_data->closures =
+      g_hash_table_new_full (NULL, NULL, NULL,
+			     (GDestroyNotify) g_slist_free);
+    group_data->keys = NULL;
+    g_object_set_qdata_full (G_OBJECT (accel_group), menu_accel_group_quark,
+			     group_data, menu_accel_group_free);
+    /* It goes when the group does */
+    g_signal_connect (accel_group, "accel-changed",
+		      G_CALLBACK (menu_accel_changed), group_data);
+  }
+  return group_data;
+}
+
+/* Also the destroy notify, so a finalized item drops out by itself */
+static void
+menu_accel_watch_free (gpointer data)
+{
+  MenuAccelWatch *watch = (MenuAccelWatch*) data;
+  MenuAccelGroup *group_data;
+
+  /* The group may have gone already */
+  group_data = watch->accel_group ?
+    g_object_get_qdata (G_OBJECT (watch->accel_group),
+			menu_accel_group_quark) : NULL;
+  if (group_data) {
+    GSList *items = g_hash_table_lookup (group_data->closures, watch->closure);
+    items = g_slist_remove (items, watch->menu_item);
+    g_hash_table_steal (group_data->closures, watch->closure);
+    if (items)
+      g_hash_table_insert (group_data->closures, watch->closure, items);
+    else if (menu_accel_unwatch_func)
+      menu_accel_unwatch_func (watch->closure);
+  }
+  if (watch->accel_group)
+    g_object_remove_weak_pointer (G_OBJECT (watch->accel_group),
+				  (gpointer*) &watch->accel_group);
+  g_closure_unref (watch->closure);
+  g_slice_free (MenuAccelWatch, watch);
+}
+
+/*
+ * menu_accel_watch:
+ * @menu_item: A mirrored GtkMenuItem
+ * @accel_closure: The accel closure its label shows, or NULL for none
+ * @func: Called with @menu_item when @accel_closure's accelerator changes
+ *
+ * Replace whatever accel closure @menu_item was watching with
+ * @accel_closure.
+ */
+void
+menu_accel_watch (GtkWidget *menu_item, GClosure *accel_closure,
+		  MenuAccelFunc func)
+{
+  GtkAccelGroup *accel_group;
+  MenuAccelGroup *group_data;
+  MenuAccelWatch *watch;
+  GSList *items;
+
+  if (menu_accel_watch_quark == 0)
+    menu_accel_watch_quark = g_quark_from_static_string ("MenuAccelWatch");
+  menu_accel_func = func;
+
+  watch = g_object_get_qdata (G_OBJECT (menu_item), menu_accel_watch_quark);
+  if (watch && watch->closure == accel_closure)
+    return;
+  /* This frees any old watch */
+  g_object_set_qdata (G_OBJECT (menu_item), menu_accel_watch_quark, NULL);
+
+  accel_group = accel_closure ?
+    gtk_accel_group_from_accel_closure (accel_closure) : NULL;
+  if (!accel_group)
+    return;
+
+  group_data = menu_accel_group_get (accel_group);
+  items = g_hash_table_lookup (group_data->closures, accel_closure);
+  g_hash_table_steal (group_data->closures, accel_closure);
+  g_hash_table_insert (group_data->closures, accel_closure,
+		       g_slist_prepend (items, menu_item));
+
+  watch = g_slice_new (MenuAccelWatch);
+  watch->menu_item = menu_item;
+  watch->closure = g_closure_ref (accel_closure);
+  watch->accel_group = accel_group;
+  g_object_add_weak_pointer (G_OBJECT (accel_group),
+			     (gpointer*) &watch->accel_group);
+  g_object_set_qdata_full (G_OBJECT (menu_item), menu_accel_watch_quark,
+			   watch, menu_accel_watch_free);
+}
+
+/*
+ * menu_accel_set_unwatch_func:
+ * @func: Called with a closure when the last item watching it stops
+ *
+ * For letting go of whatever was kept for a closure's sake while
+ * items showed it.
+ */
+void
+menu_accel_set_unwatch_func (MenuAccelUnwatchFunc func)
+{
+  menu_accel_unwatch_func = func;
+}
+
+/*
+ * menu_accel_lookup:
+ * @accel_closure: An accel closure
+ *
+ * Find @accel_closure's accelerator. The first lookup in a group
+ * indexes the whole group; after that it's a hash lookup.
+ *
+ * Returns: The GtkAccelKey, owned by the index, or NULL if
+ * @accel_closure isn't connected to a group.
+ */
+GtkAccelKey *
+menu_accel_lookup (GClosure *accel_closure)
+{
+  GtkAccelGroup *accel_group;
+  MenuAccelGroup *group_data;
+
+  accel_group = gtk_accel_group_from_accel_closure (accel_closure);
+  if (!accel_group)
+    return NULL;
+
+  menu_stats_get ()->accel_lookups++;
+  group_data = menu_accel_group_get (accel_group);
+  if (!group_data->keys) {
+    menu_stats_get ()->accel_index_builds++;
+    group_data->keys = g_hash_table_new_full (NULL, NULL, NULL,
+					      menu_accel_key_free);
+    gtk_accel_group_find (accel_group, menu_accel_key_collect, group_data);
+  }
+  return (GtkAccelKey*) g_hash_table_lookup (group_data->keys, accel_closure);
+}
+
+/*
+ * menu_accel_dispatch:
+ * @accel_closure: An accel closure
+ *
+ * Call the MenuAccelFunc for each item showing @accel_closure, as if
+ * its accelerator had changed; for when the way it's shown depends on
+ * something else, like which closure owns a shortcut.
+ */
+void
+menu_accel_dispatch (GClosure *accel_closure)
+{
+  GtkAccelGroup *accel_group;
+  MenuAccelGroup *group_data;
+  GSList *l;
+
+  accel_group = gtk_accel_group_from_accel_closure (accel_closure);
+  group_data = accel_group && menu_accel_group_quark ?
+    g_object_get_qdata (G_OBJECT (accel_group), menu_accel_group_quark) : NULL;
+  if (!group_data || !menu_accel_func)
+    return;
+  for (l = g_hash_table_lookup (group_data->closures, accel_closure);
+       l; l = l->next) {
+    menu_stats_get ()->accel_dispatches++;
+    menu_accel_func ((GtkWidget*) l->data);
+  }
+}
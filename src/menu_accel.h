@@ -0,0 +1,49 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __MENU_ACCEL_H__
+#define __MENU_ACCEL_H__
+
+#include <gtk/gtk.h>
+
+/*
+ * Dispatch accel-changed to the mirrored menu items. Each
+ * GtkAccelGroup gets a single handler and a table from accel closure
+ * to the items whose accel labels show it, so an accelerator change
+ * goes straight to the items it affects however many items share the
+ * group.
+ *
+ * The same handler keeps a table from closure to GtkAccelKey for the
+ * group, built the first time something is looked up in it, so that
+ * syncing an item doesn't have to search the whole group for its
+ * accelerator.
+ */
+typedef void (*MenuAccelFunc) (GtkWidget *menu_item);
+typedef void (*MenuAccelUnwatchFunc) (GClosure *accel_closure);
+
+void menu_accel_watch (GtkWidget *menu_item, GClosure *accel_closure,
+		       MenuAccelFunc func);
+void menu_accel_set_unwatch_func (MenuAccelUnwatchFunc func);
+GtkAccelKey *menu_accel_lookup (GClosure *accel_closure);
+void menu_accel_dispatch (GClosure *accel_closure);
+
+#endif /* __MENU_ACCEL_H__ */
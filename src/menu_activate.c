@@ -0,0 +1,147 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#include "menu_activate.h"
+#include "menu_stats.h"
+
+typedef struct {
+  GClosure *closure;
+  gpointer data;
+  guint64 queued_ns;
+} MenuActivation;
+
+static GtkOSXApplicationActivationMode menu_activate_mode =
+  GTK_OSX_APPLICATION_ACTIVATE_HIGH;
+
+/* The activations waiting to run, in the order they were chosen, and
+   the source which will run them. */
+static GArray *menu_activate_pending = NULL;
+static guint menu_activate_source_id = 0;
+
+void
+menu_activate_set_mode (GtkOSXApplicationActivationMode mode)
+{
+  menu_activate_mode = mode;
+}
+
+GtkOSXApplicationActivationMode
+menu_activate_get_mode (void)
+{
+  return menu_activate_mode;
+}
+
+static void
+menu_activate_invoke (GClosure *closure, gpointer data, guint64 queued_ns)
+{
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  GValue arg = {0};
+
+  stats->activations++;
+  menu_stats_record_latency (stats->activation_latency,
+			     menu_stats_now_ns () - queued_ns);
+
+  g_value_init (&arg, G_TYPE_POINTER);
+  g_value_set_pointer (&arg, data);
+  g_closure_invoke (closure, NULL, 1, &arg, NULL);
+  g_value_unset (&arg);
+}
+
+static gboolean
+menu_activate_dispatch (gpointer user_data)
+{
+  menu_activate_source_id = 0;
+  menu_activate_flush ();
+  return FALSE;
+}
+
+/*
+ * menu_activate_flush:
+ *
+ * Run every pending activation now. The queue is taken first, so a
+ * handler which chooses another item (or the same one) queues a new
+ * activation rather than joining this batch.
+ */
+void
+menu_activate_flush (void)
+{
+  GArray *batch = menu_activate_pending;
+  guint i;
+
+  if (!batch)
+    return;
+  menu_activate_pending = NULL;
+  if (menu_activate_source_id) {
+    g_source_remove (menu_activate_source_id);
+    menu_activate_source_id = 0;
+  }
+
+  for (i = 0; i < batch->len; i++) {
+    MenuActivation *activation = &g_array_index (batch, MenuActivation, i);
+
+    menu_activate_invoke (activation->closure, activation->data,
+			  activation->queued_ns);
+    g_closure_unref (activation->closure);
+  }
+  g_array_free (batch, TRUE);
+}
+
+/*
+ * menu_activate_queue:
+ * @closure: The closure of the item that was chosen
+ * @data: Passed to @closure as its only argument
+ *
+ * Activate an item chosen from the native menus, in the current
+ * mode. The pending activation holds a reference to @closure, so it
+ * can't go away with the native item in the meantime; a closure that
+ * has been invalidated, because its GtkMenuItem was destroyed, does
+ * nothing when it's invoked.
+ */
+void
+menu_activate_queue (GClosure *closure, gpointer data)
+{
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  MenuActivation activation;
+  guint i;
+
+  g_return_if_fail (closure != NULL);
+
+  activation.queued_ns = menu_stats_now_ns ();
+
+  if (!menu_activate_pending)
+    menu_activate_pending = g_array_new (FALSE, FALSE, sizeof (MenuActivation));
+  for (i = 0; i < menu_activate_pending->len; i++)
+    if (g_array_index (menu_activate_pending, MenuActivation, i).closure
+	== closure) {
+      stats->activations_coalesced++;
+      return;
+    }
+
+  activation.closure = g_closure_ref (closure);
+  activation.data = data;
+  g_array_append_val (menu_activate_pending, activation);
+
+  if (menu_activate_source_id == 0)
+    menu_activate_source_id =
+      g_idle_add_full (menu_activate_mode == GTK_OSX_APPLICATION_ACTIVATE_IDLE ?
+		       G_PRIORITY_DEFAULT_IDLE : G_PRIORITY_HIGH,
+		       menu_activate_dispatch, NULL, NULL);
+}
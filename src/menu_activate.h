@@ -0,0 +1,47 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __MENU_ACTIVATE_H__
+#define __MENU_ACTIVATE_H__
+
+#include "gtkosxapplication.h"
+
+/*
+ * Running the handlers of menu items chosen from the native menus.
+ * Cocoa tells us about the choice from inside its own event handling,
+ * so by default the item's closure is queued and invoked from a
+ * G_PRIORITY_HIGH source, ahead of redrawing and I/O; it can instead
+ * go at idle priority, the old way (see
+ * gtk_osxapplication_set_activation_mode()). It is never run on the
+ * spot: the choice arrives inside GDK's event dispatch, where the
+ * application doesn't expect its handlers to run. An item chosen again
+ * before its first activation has run is only activated once. The
+ * time from the choice to the closure being invoked goes into the
+ * activation_latency histogram.
+ */
+void menu_activate_set_mode (GtkOSXApplicationActivationMode mode);
+GtkOSXApplicationActivationMode menu_activate_get_mode (void);
+
+void menu_activate_queue (GClosure *closure, gpointer data);
+void menu_activate_flush (void);
+
+#endif /* __MENU_ACTIVATE_H__ */
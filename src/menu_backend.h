@@ -0,0 +1,101 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __MENU_BACKEND_H__
+#define __MENU_BACKEND_H__
+
+#include <gtk/gtk.h>
+#include "menu_title.h"
+
+/*
+ * The native menu operations the sync engine (menu_sync.h) is written
+ * against. Native menus and items are opaque pointers, reference
+ * counted by the backend. The Cocoa backend, cocoa_menu_item_backend,
+ * works on NSMenus and GNSMenuItems; menu_backend_record.h keeps the
+ * menus in memory and counts what's done to them, so that the engine
+ * can be run and measured without AppKit.
+ */
+
+typedef enum {
+  MENU_ITEM_STATE_OFF,
+  MENU_ITEM_STATE_ON,
+  MENU_ITEM_STATE_MIXED
+} MenuItemState;
+
+typedef struct {
+  /* For the interned titles of items and menus */
+  MenuTitleFuncs titles;
+
+  /* Returns a new, empty menu, owning a reference to it */
+  gpointer (*menu_new) (MenuTitle *title);
+  void (*menu_ref) (gpointer menu);
+  void (*menu_unref) (gpointer menu);
+  guint (*menu_n_items) (gpointer menu);
+  gpointer (*menu_item_at) (gpointer menu, guint index);
+  /* Returns -1 if @item isn't in @menu */
+  gint (*menu_index_of) (gpointer menu, gpointer item);
+  /* The menu holds its own reference to its items */
+  void (*menu_insert) (gpointer menu, gpointer item, guint index);
+  void (*menu_remove) (gpointer menu, guint index);
+  /* Leave @menu empty until it's about to be opened, when
+     menu_sync_menu_will_open() is to be called for @menu_shell. The
+     engine also defers menus it has part built, when a sync runs out
+     of its budget. Returns something for menu_undefer() to drop when
+     the menu is built or handed over. */
+  gpointer (*menu_defer) (gpointer menu, GtkWidget *menu_shell);
+  void (*menu_undefer) (gpointer deferral);
+  /* If @menu is a menubar, the application, Window, and Help menus'
+     items on it, any of which may be NULL */
+  gboolean (*menubar_special) (gpointer menu, gpointer *app_item,
+			       gpointer *window_item, gpointer *help_item);
+
+  /* Returns a new item which invokes @action (floating) when it's
+     activated, owning a reference to it */
+  gpointer (*item_new) (MenuTitle *title, GClosure *action);
+  gpointer (*separator_new) (void);
+  void (*item_ref) (gpointer item);
+  void (*item_unref) (gpointer item);
+  /* Whether @item was made by item_new() or separator_new(), rather
+     than put in a menu by the platform or the application */
+  gboolean (*item_is_mirror) (gpointer item);
+  gboolean (*item_is_separator) (gpointer item);
+  /* The menu @item is in, or NULL */
+  gpointer (*item_get_menu) (gpointer item);
+  gboolean (*item_is_hidden) (gpointer item);
+  gpointer (*item_get_submenu) (gpointer item);
+  /* @submenu may be NULL */
+  void (*item_set_submenu) (gpointer item, gpointer submenu);
+  void (*item_set_title) (gpointer item, MenuTitle *title);
+  void (*item_set_enabled) (gpointer item, gboolean enabled);
+  void (*item_set_hidden) (gpointer item, gboolean hidden);
+  void (*item_set_state) (gpointer item, MenuItemState state);
+  /* @key is 0 for none; @modifiers are MENU_SHORTCUT_* flags */
+  void (*item_set_key_equivalent) (gpointer item, gunichar key,
+				   guint modifiers);
+  void (*item_set_action) (gpointer item, GClosure *action);
+  /* Take @item out of @menu, if that's where it is */
+  void (*item_remove_from_menu) (gpointer item, gpointer menu);
+  /* @item has stopped mirroring a GtkMenuItem */
+  void (*item_unbind) (gpointer item);
+} MenuBackend;
+
+#endif /* __MENU_BACKEND_H__ */
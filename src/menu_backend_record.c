@@ -0,0 +1,584 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#include <string.h>
+#include "menu_backend_record.h"
+#include "menu_sync.h"
+#include "menu_update.h"
+
+static MenuRecordStats menu_record_stats;
+
+static const gchar *menu_record_op_names[MENU_RECORD_N_OPS] = {
+  "menu_new",
+  "menu_insert",
+  "menu_remove",
+  "menu_defer",
+  "item_new",
+  "separator_new",
+  "set_submenu",
+  "set_title",
+  "set_enabled",
+  "set_hidden",
+  "set_state",
+  "set_key_equivalent",
+  "set_action",
+  "query"
+};
+
+static void
+menu_record_count (MenuRecordOp op, guint cost)
+{
+  menu_record_stats.ops[op]++;
+  if (op != MENU_RECORD_QUERY) {
+    menu_record_stats.native_ops++;
+    menu_record_stats.cost += cost;
+  }
+}
+
+MenuRecordStats *
+menu_backend_record_get_stats (void)
+{
+  return &menu_record_stats;
+}
+
+void
+menu_backend_record_reset_stats (void)
+{
+  guint live_menus = menu_record_stats.live_menus;
+  guint live_items = menu_record_stats.live_items;
+
+  memset (&menu_record_stats, 0, sizeof (menu_record_stats));
+  menu_record_stats.live_menus = live_menus;
+  menu_record_stats.live_items = live_items;
+}
+
+const gchar *
+menu_backend_record_op_name (MenuRecordOp op)
+{
+  g_return_val_if_fail (op < MENU_RECORD_N_OPS, NULL);
+  return menu_record_op_names[op];
+}
+
+static gpointer
+menu_record_title_create (const gchar *utf8)
+{
+  return g_strdup (utf8);
+}
+
+/*
+ * Menus
+ */
+
+static MenuRecordMenu *
+menu_record_menu_alloc (const gchar *title)
+{
+  MenuRecordMenu *menu = g_slice_new0 (MenuRecordMenu);
+
+  menu->ref_count = 1;
+  menu->title = g_strdup (title);
+  menu->items = g_ptr_array_new ();
+  menu_record_stats.live_menus++;
+  return menu;
+}
+
+static gpointer
+menu_record_menu_new (MenuTitle *title)
+{
+  menu_record_count (MENU_RECORD_MENU_NEW, 1);
+  return menu_record_menu_alloc ((const gchar*) title->native);
+}
+
+static void
+menu_record_menu_ref (gpointer menu)
+{
+  ((MenuRecordMenu*) menu)->ref_count++;
+}
+
+static void menu_record_item_unref (gpointer item);
+
+static void
+menu_record_menu_unref (gpointer data)
+{
+  MenuRecordMenu *menu = data;
+  guint i;
+
+  if (--menu->ref_count > 0)
+    return;
+  for (i = 0; i < menu->items->len; i++) {
+    MenuRecordItem *item = g_ptr_array_index (menu->items, i);
+
+    item->menu = NULL;
+    menu_record_item_unref (item);
+  }
+  g_ptr_array_free (menu->items, TRUE);
+  if (menu->app_item)
+    menu_record_item_unref (menu->app_item);
+  if (menu->window_item)
+    menu_record_item_unref (menu->window_item);
+  if (menu->help_item)
+    menu_record_item_unref (menu->help_item);
+  g_free (menu->title);
+  g_slice_free (MenuRecordMenu, menu);
+  menu_record_stats.live_menus--;
+}
+
+static guint
+menu_record_menu_n_items (gpointer menu)
+{
+  menu_record_count (MENU_RECORD_QUERY, 0);
+  return ((MenuRecordMenu*) menu)->items->len;
+}
+
+static gpointer
+menu_record_menu_item_at (gpointer menu, guint index)
+{
+  GPtrArray *items = ((MenuRecordMenu*) menu)->items;
+
+  menu_record_count (MENU_RECORD_QUERY, 0);
+  g_return_val_if_fail (index < items->len, NULL);
+  return g_ptr_array_index (items, index);
+}
+
+static gint
+menu_record_menu_index_of (gpointer menu, gpointer item)
+{
+  GPtrArray *items = ((MenuRecordMenu*) menu)->items;
+  guint i;
+
+  menu_record_count (MENU_RECORD_QUERY, 0);
+  for (i = 0; i < items->len; i++)
+    if (g_ptr_array_index (items, i) == item)
+      return i;
+  return -1;
+}
+
+static void
+menu_record_menu_insert (gpointer data, gpointer item_data, guint index)
+{
+  MenuRecordMenu *menu = data;
+  MenuRecordItem *item = item_data;
+  GPtrArray *items = menu->items;
+
+  /* As Cocoa insists */
+  g_return_if_fail (item->menu == NULL);
+  g_return_if_fail (index <= items->len);
+
+  menu_record_count (MENU_RECORD_MENU_INSERT, 1 + items->len - index);
+  item->ref_count++;
+  item->menu = menu;
+  g_ptr_array_add (items, NULL);
+  memmove (items->pdata + index + 1, items->pdata + index,
+	   (items->len - 1 - index) * sizeof (gpointer));
+  items->pdata[index] = item;
+}
+
+static void
+menu_record_menu_remove (gpointer data, guint index)
+{
+  MenuRecordMenu *menu = data;
+  MenuRecordItem *item;
+
+  g_return_if_fail (index < menu->items->len);
+
+  menu_record_count (MENU_RECORD_MENU_REMOVE, menu->items->len - index);
+  item = g_ptr_array_remove_index (menu->items, index);
+  item->menu = NULL;
+  menu_record_item_unref (item);
+}
+
+static gpointer
+menu_record_menu_defer (gpointer data, GtkWidget *menu_shell)
+{
+  MenuRecordMenu *menu = data;
+
+  menu_record_count (MENU_RECORD_MENU_DEFER, 1);
+  menu->deferred_shell = menu_shell;
+  menu_record_menu_ref (menu);
+  return menu;
+}
+
+static void
+menu_record_menu_undefer (gpointer data)
+{
+  MenuRecordMenu *menu = data;
+
+  menu->deferred_shell = NULL;
+  menu_record_menu_unref (menu);
+}
+
+static gboolean
+menu_record_menubar_special (gpointer data, gpointer *app_item,
+			     gpointer *window_item, gpointer *help_item)
+{
+  MenuRecordMenu *menu = data;
+
+  menu_record_count (MENU_RECORD_QUERY, 0);
+  if (!menu->menubar)
+    return FALSE;
+  *app_item = menu->app_item;
+  *window_item = menu->window_item;
+  *help_item = menu->help_item;
+  return TRUE;
+}
+
+/*
+ * Items
+ */
+
+/*
+ * As with the Cocoa backend's tag, @mirror is set here for the items
+ * the engine makes and for nothing else, separators included, so
+ * that the engine can't sweep away anything it didn't make.
+ */
+static MenuRecordItem *
+menu_record_item_alloc (const gchar *title, gboolean mirror)
+{
+  MenuRecordItem *item = g_slice_new0 (MenuRecordItem);
+
+  item->ref_count = 1;
+  item->title = g_strdup (title);
+  item->mirror = mirror;
+  item->enabled = TRUE;
+  menu_record_stats.live_items++;
+  return item;
+}
+
+static void
+menu_record_item_set_action (gpointer data, GClosure *action)
+{
+  MenuRecordItem *item = data;
+
+  menu_record_count (MENU_RECORD_SET_ACTION, 1);
+  g_closure_ref (action);
+  g_closure_sink (action);
+  if (item->action)
+    g_closure_unref (item->action);
+  item->action = action;
+}
+
+static gpointer
+menu_record_item_new (MenuTitle *title, GClosure *action)
+{
+  MenuRecordItem *item = menu_record_item_alloc ((const gchar*) title->native,
+						 TRUE);
+
+  menu_record_count (MENU_RECORD_ITEM_NEW, 1);
+  g_closure_ref (action);
+  g_closure_sink (action);
+  item->action = action;
+  return item;
+}
+
+static gpointer
+menu_record_separator_new (void)
+{
+  MenuRecordItem *item = menu_record_item_alloc (NULL, TRUE);
+
+  menu_record_count (MENU_RECORD_SEPARATOR_NEW, 1);
+  item->separator = TRUE;
+  return item;
+}
+
+static void
+menu_record_item_ref (gpointer item)
+{
+  ((MenuRecordItem*) item)->ref_count++;
+}
+
+static void
+menu_record_item_unref (gpointer data)
+{
+  MenuRecordItem *item = data;
+
+  if (--item->ref_count > 0)
+    return;
+  if (item->submenu)
+    menu_record_menu_unref (item->submenu);
+  if (item->action)
+    g_closure_unref (item->action);
+  g_free (item->title);
+  g_slice_free (MenuRecordItem, item);
+  menu_record_stats.live_items--;
+}
+
+static gboolean
+menu_record_item_is_mirror (gpointer item)
+{
+  menu_record_count (MENU_RECORD_QUERY, 0);
+  return ((MenuRecordItem*) item)->mirror;
+}
+
+static gboolean
+menu_record_item_is_separator (gpointer item)
+{
+  menu_record_count (MENU_RECORD_QUERY, 0);
+  return ((MenuRecordItem*) item)->separator;
+}
+
+static gpointer
+menu_record_item_get_menu (gpointer item)
+{
+  menu_record_count (MENU_RECORD_QUERY, 0);
+  return ((MenuRecordItem*) item)->menu;
+}
+
+static gboolean
+menu_record_item_is_hidden (gpointer item)
+{
+  menu_record_count (MENU_RECORD_QUERY, 0);
+  return ((MenuRecordItem*) item)->hidden;
+}
+
+static gpointer
+menu_record_item_get_submenu (gpointer item)
+{
+  menu_record_count (MENU_RECORD_QUERY, 0);
+  return ((MenuRecordItem*) item)->submenu;
+}
+
+static void
+menu_record_item_set_submenu (gpointer data, gpointer submenu)
+{
+  MenuRecordItem *item = data;
+
+  menu_record_count (MENU_RECORD_SET_SUBMENU, 1);
+  if (item->submenu == submenu) {
+    menu_record_stats.redundant++;
+    return;
+  }
+  if (submenu)
+    menu_record_menu_ref (submenu);
+  if (item->submenu)
+    menu_record_menu_unref (item->submenu);
+  item->submenu = submenu;
+}
+
+static void
+menu_record_item_set_title (gpointer data, MenuTitle *title)
+{
+  MenuRecordItem *item = data;
+
+  menu_record_count (MENU_RECORD_SET_TITLE, 1);
+  if (item->title && !strcmp (item->title, title->native))
+    menu_record_stats.redundant++;
+  g_free (item->title);
+  item->title = g_strdup (title->native);
+}
+
+static void
+menu_record_item_set_enabled (gpointer data, gboolean enabled)
+{
+  MenuRecordItem *item = data;
+
+  menu_record_count (MENU_RECORD_SET_ENABLED, 1);
+  enabled = enabled != FALSE;
+  if (item->enabled == enabled)
+    menu_record_stats.redundant++;
+  item->enabled = enabled;
+}
+
+static void
+menu_record_item_set_hidden (gpointer data, gboolean hidden)
+{
+  MenuRecordItem *item = data;
+
+  menu_record_count (MENU_RECORD_SET_HIDDEN, 1);
+  hidden = hidden != FALSE;
+  if (item->hidden == hidden)
+    menu_record_stats.redundant++;
+  item->hidden = hidden;
+}
+
+static void
+menu_record_item_set_state (gpointer data, MenuItemState state)
+{
+  MenuRecordItem *item = data;
+
+  menu_record_count (MENU_RECORD_SET_STATE, 1);
+  if (item->state == state)
+    menu_record_stats.redundant++;
+  item->state = state;
+}
+
+static void
+menu_record_item_set_key_equivalent (gpointer data, gunichar key,
+				     guint modifiers)
+{
+  MenuRecordItem *item = data;
+
+  menu_record_count (MENU_RECORD_SET_KEY_EQUIVALENT, 1);
+  /* Cocoa keeps the modifiers of a cleared key equivalent */
+  if (key == 0)
+    modifiers = item->modifiers;
+  if (item->key == key && item->modifiers == modifiers)
+    menu_record_stats.redundant++;
+  item->key = key;
+  item->modifiers = modifiers;
+}
+
+static void
+menu_record_item_remove_from_menu (gpointer data, gpointer menu)
+{
+  MenuRecordItem *item = data;
+
+  if (!menu || item->menu != menu)
+    return;
+  menu_record_menu_remove (menu, menu_record_menu_index_of (menu, item));
+}
+
+static void
+menu_record_item_unbind (gpointer item)
+{
+}
+
+const MenuBackend menu_backend_record = {
+  {
+    menu_record_title_create,
+    g_free
+  },
+  menu_record_menu_new,
+  menu_record_menu_ref,
+  menu_record_menu_unref,
+  menu_record_menu_n_items,
+  menu_record_menu_item_at,
+  menu_record_menu_index_of,
+  menu_record_menu_insert,
+  menu_record_menu_remove,
+  menu_record_menu_defer,
+  menu_record_menu_undefer,
+  menu_record_menubar_special,
+  menu_record_item_new,
+  menu_record_separator_new,
+  menu_record_item_ref,
+  menu_record_item_unref,
+  menu_record_item_is_mirror,
+  menu_record_item_is_separator,
+  menu_record_item_get_menu,
+  menu_record_item_is_hidden,
+  menu_record_item_get_submenu,
+  menu_record_item_set_submenu,
+  menu_record_item_set_title,
+  menu_record_item_set_enabled,
+  menu_record_item_set_hidden,
+  menu_record_item_set_state,
+  menu_record_item_set_key_equivalent,
+  menu_record_item_set_action,
+  menu_record_item_remove_from_menu,
+  menu_record_item_unbind
+};
+
+/*
+ * menu_backend_record_menubar_new:
+ *
+ * Make a menubar the way gtk_osxapplication_set_menu_bar() does, with
+ * an application menu as its 0th item.
+ *
+ * Returns: The menubar, with a reference for the caller.
+ */
+MenuRecordMenu *
+menu_backend_record_menubar_new (void)
+{
+  MenuRecordMenu *menubar = menu_record_menu_alloc ("");
+  MenuRecordItem *app_item = menu_record_item_alloc ("", FALSE);
+
+  menubar->menubar = TRUE;
+  app_item->submenu = menu_record_menu_alloc ("Application");
+  menu_record_menu_insert (menubar, app_item, 0);
+  menubar->app_item = app_item;
+  return menubar;
+}
+
+/*
+ * menu_backend_record_item_new:
+ * @title: The item's title, or NULL for a separator
+ *
+ * Make an item the way the platform or the application would, to be
+ * put in a menu with menu_backend_record.menu_insert(). It isn't a
+ * mirror, so syncs leave it in its menu.
+ *
+ * Returns: The item, with a reference for the caller.
+ */
+MenuRecordItem *
+menu_backend_record_item_new (const gchar *title)
+{
+  MenuRecordItem *item = menu_record_item_alloc (title, FALSE);
+
+  item->separator = title == NULL;
+  return item;
+}
+
+/*
+ * menu_backend_record_set_special:
+ * @menubar: A menubar from menu_backend_record_menubar_new()
+ * @window_item: The item on it to take as the Window menu, or NULL
+ * @help_item: The item to take as the Help menu, or NULL
+ *
+ * See gtk_osxapplication_set_window_menu() and
+ * gtk_osxapplication_set_help_menu().
+ */
+void
+menu_backend_record_set_special (MenuRecordMenu *menubar,
+				 MenuRecordItem *window_item,
+				 MenuRecordItem *help_item)
+{
+  g_return_if_fail (menubar->menubar);
+
+  if (window_item)
+    menu_record_item_ref (window_item);
+  if (help_item)
+    menu_record_item_ref (help_item);
+  if (menubar->window_item)
+    menu_record_item_unref (menubar->window_item);
+  if (menubar->help_item)
+    menu_record_item_unref (menubar->help_item);
+  menubar->window_item = window_item;
+  menubar->help_item = help_item;
+}
+
+/*
+ * menu_backend_record_open:
+ * @menu: A menu
+ *
+ * Do what Cocoa does to a deferred menu when it's opened.
+ */
+void
+menu_backend_record_open (MenuRecordMenu *menu)
+{
+  if (!menu->deferred_shell)
+    return;
+  menu_update_flush ();
+  menu_sync_menu_will_open (menu->deferred_shell);
+}
+
+/*
+ * menu_backend_record_activate:
+ * @item: An item made by the sync engine
+ *
+ * Invoke @item's action the way GNSMenuItem does, bypassing
+ * menu_activate.h.
+ */
+void
+menu_backend_record_activate (MenuRecordItem *item)
+{
+  if (item->action)
+    g_closure_invoke (item->action, NULL, 0, NULL, NULL);
+}
@@ -0,0 +1,120 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __MENU_BACKEND_RECORD_H__
+#define __MENU_BACKEND_RECORD_H__
+
+#include <gtk/gtk.h>
+#include "menu_backend.h"
+
+/*
+ * A MenuBackend which keeps its menus in memory, so that the sync
+ * engine can be driven without AppKit: by the benchmarks, and by
+ * anything which wants to check the mirrored menus against the GTK+
+ * ones. Every operation is counted, along with a cost which stands in
+ * for the work a real toolkit would do: one for the call, plus one
+ * for each item an insert or remove has to shift along.
+ *
+ * The structures are for reading only; change them through the
+ * backend.
+ */
+typedef struct _MenuRecordMenu MenuRecordMenu;
+typedef struct _MenuRecordItem MenuRecordItem;
+
+struct _MenuRecordMenu {
+  guint ref_count;
+  gchar *title;
+  /* Of MenuRecordItem, each holding a reference */
+  GPtrArray *items;
+  /* If it was deferred, the shell to sync when the menu is opened */
+  GtkWidget *deferred_shell;
+  /* Made by menu_backend_record_menubar_new() */
+  gboolean menubar;
+  MenuRecordItem *app_item;
+  MenuRecordItem *window_item;
+  MenuRecordItem *help_item;
+};
+
+struct _MenuRecordItem {
+  guint ref_count;
+  gchar *title;
+  GClosure *action;
+  /* Made by the sync engine */
+  gboolean mirror;
+  gboolean separator;
+  gboolean enabled;
+  gboolean hidden;
+  MenuItemState state;
+  gunichar key;
+  guint modifiers;
+  /* The menu it's in, not owned */
+  MenuRecordMenu *menu;
+  /* Owned */
+  MenuRecordMenu *submenu;
+};
+
+typedef enum {
+  MENU_RECORD_MENU_NEW,
+  MENU_RECORD_MENU_INSERT,
+  MENU_RECORD_MENU_REMOVE,
+  MENU_RECORD_MENU_DEFER,
+  MENU_RECORD_ITEM_NEW,
+  MENU_RECORD_SEPARATOR_NEW,
+  MENU_RECORD_SET_SUBMENU,
+  MENU_RECORD_SET_TITLE,
+  MENU_RECORD_SET_ENABLED,
+  MENU_RECORD_SET_HIDDEN,
+  MENU_RECORD_SET_STATE,
+  MENU_RECORD_SET_KEY_EQUIVALENT,
+  MENU_RECORD_SET_ACTION,
+  /* Everything which only looks */
+  MENU_RECORD_QUERY,
+  MENU_RECORD_N_OPS
+} MenuRecordOp;
+
+typedef struct {
+  guint64 ops[MENU_RECORD_N_OPS];
+  /* Everything but the queries */
+  guint64 native_ops;
+  guint64 cost;
+  /* Setters which didn't change anything */
+  guint64 redundant;
+  /* Not reset */
+  guint live_menus;
+  guint live_items;
+} MenuRecordStats;
+
+extern const MenuBackend menu_backend_record;
+
+MenuRecordStats *menu_backend_record_get_stats (void);
+void menu_backend_record_reset_stats (void);
+const gchar *menu_backend_record_op_name (MenuRecordOp op);
+
+MenuRecordMenu *menu_backend_record_menubar_new (void);
+MenuRecordItem *menu_backend_record_item_new (const gchar *title);
+void menu_backend_record_set_special (MenuRecordMenu *menubar,
+				      MenuRecordItem *window_item,
+				      MenuRecordItem *help_item);
+void menu_backend_record_open (MenuRecordMenu *menu);
+void menu_backend_record_activate (MenuRecordItem *item);
+
+#endif /* __MENU_BACKEND_RECORD_H__ */
@@ -0,0 +1,203 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include "menu_diff.h"
+
+enum {
+  OLD_REMOVED = 0,
+  OLD_MOVED,
+  OLD_STABLE
+};
+
+/*
+ * mark_longest_increasing:
+ * @seq: The old positions of the surviving items, in their new order
+ * @n: The length of @seq
+ * @stable: Set to TRUE for each member of a longest increasing subsequence
+ *
+ * The items in a longest increasing subsequence are already in the
+ * right order relative to each other, so they're the largest set we
+ * can leave alone; everything else has to move. This is the usual
+ * patience sort, O(n log n), except that an element which extends
+ * the longest run so far skips the binary search. An unchanged or
+ * appended-to menu is therefore linear.
+ */
+static void
+mark_longest_increasing (const guint *seq, guint n, gboolean *stable)
+{
+  guint *tails = g_new (guint, n);
+  guint *prev = g_new (guint, n);
+  guint len = 0, i, k;
+
+  for (i = 0; i < n; i++) {
+    guint lo = 0, hi = len;
+    if (len > 0 && seq[tails[len - 1]] < seq[i])
+      lo = len;
+    else
+      while (lo < hi) {
+	guint mid = (lo + hi) / 2;
+	if (seq[tails[mid]] < seq[i])
+	  lo = mid + 1;
+	else
+	  hi = mid;
+      }
+    prev[i] = lo > 0 ? tails[lo - 1] : G_MAXUINT;
+    tails[lo] = i;
+    if (lo == len)
+      ++len;
+  }
+  if (len > 0)
+    for (k = tails[len - 1]; k != G_MAXUINT; k = prev[k])
+      stable[k] = TRUE;
+
+  g_free (tails);
+  g_free (prev);
+}
+
+/**
+ * menu_diff_compute:
+ * @old_keys: The items currently in the menu, in order
+ * @n_old: The number of items in @old_keys
+ * @new_keys: The items that should be in the menu, in order. No key
+ * may appear twice.
+ * @n_new: The number of items in @new_keys
+ *
+ * Compute an edit script which turns @old_keys into @new_keys. Items
+ * in neither list are removed, items only in @new_keys are inserted,
+ * and of the items in both only those outside a longest increasing
+ * subsequence are moved, so the script is as short as a sequence of
+ * single-item removes and inserts can be.
+ *
+ * The script is ordered so that it can be played back in a single
+ * pass: all of the removes and detaches come first, from the back of
+ * the menu to the front, so each index is valid when it's used; then
+ * the inserts and moves, front to back, each at its final index.
+ *
+ * Returns: A GArray of MenuDiffOp. Free it with g_array_free().
+ */
+GArray *
+menu_diff_compute (gpointer *old_keys, guint n_old,
+		   gpointer *new_keys, guint n_new)
+{
+  GArray *script = g_array_new (FALSE, FALSE, sizeof (MenuDiffOp));
+  GHashTable *old_index = g_hash_table_new (NULL, NULL);
+  guint8 *old_state = g_new0 (guint8, n_old);
+  guint *seq = g_new (guint, n_new);
+  gboolean *stable;
+  guint i, pos, n_kept = 0;
+  MenuDiffOp op;
+
+  /* Positions are stored off by one so that NULL means "not there" */
+  for (i = 0; i < n_old; i++)
+    g_hash_table_insert (old_index, old_keys[i], GUINT_TO_POINTER (i + 1));
+
+  for (i = 0; i < n_new; i++) {
+    pos = GPOINTER_TO_UINT (g_hash_table_lookup (old_index, new_keys[i]));
+    if (pos) {
+      seq[n_kept++] = pos - 1;
+      old_state[pos - 1] = OLD_MOVED;
+    }
+  }
+
+  stable = g_new0 (gboolean, n_kept);
+  mark_longest_increasing (seq, n_kept, stable);
+  for (i = 0; i < n_kept; i++)
+    if (stable[i])
+      old_state[seq[i]] = OLD_STABLE;
+
+  for (i = n_old; i-- > 0;) {
+    if (old_state[i] == OLD_STABLE)
+      continue;
+    op.type = old_state[i] == OLD_MOVED ? MENU_DIFF_DETACH : MENU_DIFF_REMOVE;
+    op.key = old_keys[i];
+    op.index = i;
+    g_array_append_val (script, op);
+  }
+
+  /* Only the stable items are left now, already in their final
+     relative order, so everything else slots in around them. */
+  for (i = 0; i < n_new; i++) {
+    pos = GPOINTER_TO_UINT (g_hash_table_lookup (old_index, new_keys[i]));
+    if (pos && old_state[pos - 1] == OLD_STABLE)
+      continue;
+    op.type = pos ? MENU_DIFF_MOVE : MENU_DIFF_INSERT;
+    op.key = new_keys[i];
+    op.index = i;
+    g_array_append_val (script, op);
+  }
+
+  g_hash_table_destroy (old_index);
+  g_free (old_state);
+  g_free (seq);
+  g_free (stable);
+  return script;
+}
+
+/**
+ * menu_diff_apply:
+ * @script: An edit script from menu_diff_compute()
+ * @funcs: The native menu operations to use
+ * @menu: The native menu, passed through to @funcs
+ *
+ * Play @script back against @menu.
+ */
+void
+menu_diff_apply (GArray *script, const MenuDiffFuncs *funcs, gpointer menu)
+{
+  guint i;
+
+  for (i = 0; i < script->len; i++) {
+    MenuDiffOp *op = &g_array_index (script, MenuDiffOp, i);
+    switch (op->type) {
+    case MENU_DIFF_REMOVE:
+    case MENU_DIFF_DETACH:
+      funcs->remove (menu, op->key, op->index, op->type == MENU_DIFF_DETACH);
+      break;
+    case MENU_DIFF_INSERT:
+    case MENU_DIFF_MOVE:
+      funcs->insert (menu, op->key, op->index, op->type == MENU_DIFF_MOVE);
+      break;
+    }
+  }
+}
+
+static void
+array_remove (gpointer menu, gpointer key, guint index, gboolean detach)
+{
+  g_ptr_array_remove_index ((GPtrArray*) menu, index);
+}
+
+static void
+array_insert (gpointer menu, gpointer key, guint index, gboolean moved)
+{
+  GPtrArray *array = (GPtrArray*) menu;
+
+  g_ptr_array_add (array, NULL);
+  memmove (array->pdata + index + 1, array->pdata + index,
+	   (array->len - index - 1) * sizeof (gpointer));
+  array->pdata[index] = key;
+}
+
+const MenuDiffFuncs menu_diff_array_funcs = {
+  array_remove,
+  array_insert
+};
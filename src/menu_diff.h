@@ -0,0 +1,63 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __MENU_DIFF_H__
+#define __MENU_DIFF_H__
+
+#include <glib.h>
+
+/*
+ * menu_diff computes the edits needed to turn one sequence of menu
+ * items into another. Items are compared by identity (the key
+ * pointer) only, so it knows nothing about Cocoa and can be run
+ * against any native menu -- or none at all -- through a
+ * MenuDiffFuncs table.
+ */
+
+typedef enum {
+  MENU_DIFF_REMOVE,	/* The item leaves the menu for good */
+  MENU_DIFF_DETACH,	/* The item is taken out and re-inserted by a later MOVE */
+  MENU_DIFF_INSERT,	/* The item is new to the menu */
+  MENU_DIFF_MOVE	/* The item was detached and goes back in here */
+} MenuDiffOpType;
+
+typedef struct {
+  MenuDiffOpType type;
+  gpointer key;
+  guint index;
+} MenuDiffOp;
+
+typedef struct {
+  void (*remove) (gpointer menu, gpointer key, guint index, gboolean detach);
+  void (*insert) (gpointer menu, gpointer key, guint index, gboolean moved);
+} MenuDiffFuncs;
+
+GArray *menu_diff_compute (gpointer *old_keys, guint n_old,
+			   gpointer *new_keys, guint n_new);
+
+void menu_diff_apply (GArray *script, const MenuDiffFuncs *funcs,
+		      gpointer menu);
+
+/* A stand-in native menu: menu is a GPtrArray of keys. bench-menu-diff
+ * reconciles it both ways. */
+extern const MenuDiffFuncs menu_diff_array_funcs;
+
+#endif /* __MENU_DIFF_H__ */
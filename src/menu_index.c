@@ -0,0 +1,203 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#include "menu_index.h"
+
+typedef struct {
+  GtkWidget *child;
+  GSequenceIter *child_iter;
+  GSequenceIter *mirrored_iter; /* NULL if it has no native item */
+} MenuIndexEntry;
+
+typedef struct {
+  GSequence *children;  /* of MenuIndexEntry, which it owns */
+  GSequence *mirrored;  /* of MenuIndexEntry */
+  GHashTable *entries;  /* child -> MenuIndexEntry */
+  guint offset;
+} MenuIndex;
+
+static GQuark menu_index_quark = 0;
+
+static void
+menu_index_entry_free (gpointer data)
+{
+  g_slice_free (MenuIndexEntry, data);
+}
+
+static void
+menu_index_free (gpointer data)
+{
+  MenuIndex *index = (MenuIndex*) data;
+
+  g_hash_table_destroy (index->entries);
+  g_sequence_free (index->mirrored);
+  g_sequence_free (index->children);
+  g_slice_free (MenuIndex, index);
+}
+
+static MenuIndex *
+menu_index_get (GtkWidget *menu_shell)
+{
+  if (menu_index_quark == 0)
+    return NULL;
+  return (MenuIndex*) g_object_get_qdata (G_OBJECT (menu_shell),
+					  menu_index_quark);
+}
+
+/*
+ * menu_index_rebuild:
+ * @menu_shell: A GtkMenuShell whose native menu has just been reconciled
+ * @children: @menu_shell's children
+ * @mirrored: Says whether a child has an item in @menu_shell's native menu
+ * @data: Passed to @mirrored
+ * @offset: The number of native items ahead of the first child's
+ *
+ * Index @menu_shell's children afresh.
+ */
+void
+menu_index_rebuild (GtkWidget *menu_shell, GList *children,
+		    MenuIndexMirroredFunc mirrored, gpointer data,
+		    guint offset)
+{
+  MenuIndex *index = g_slice_new (MenuIndex);
+  GList *l;
+
+  if (menu_index_quark == 0)
+    menu_index_quark = g_quark_from_static_string ("MenuIndex");
+
+  index->children = g_sequence_new (menu_index_entry_free);
+  index->mirrored = g_sequence_new (NULL);
+  index->entries = g_hash_table_new (NULL, NULL);
+  index->offset = offset;
+  for (l = children; l; l = l->next) {
+    MenuIndexEntry *entry = g_slice_new (MenuIndexEntry);
+    entry->child = (GtkWidget*) l->data;
+    entry->child_iter = g_sequence_append (index->children, entry);
+    entry->mirrored_iter = mirrored (entry->child, data) ?
+      g_sequence_append (index->mirrored, entry) : NULL;
+    g_hash_table_insert (index->entries, entry->child, entry);
+  }
+  g_object_set_qdata_full (G_OBJECT (menu_shell), menu_index_quark,
+			   index, menu_index_free);
+}
+
+/*
+ * menu_index_invalidate:
+ * @menu_shell: A GtkMenuShell
+ *
+ * Throw away @menu_shell's index, if it has one, because it can't be
+ * trusted any more.
+ */
+void
+menu_index_invalidate (GtkWidget *menu_shell)
+{
+  if (menu_index_get (menu_shell))
+    g_object_set_qdata (G_OBJECT (menu_shell), menu_index_quark, NULL);
+}
+
+/*
+ * menu_index_insert:
+ * @menu_shell: A GtkMenuShell
+ * @child: A child which has just been added to @menu_shell
+ * @position: Where it was added, or -1 for the end
+ * @mirrored: Whether it's going into the native menu
+ * @previous: Set to the nearest mirrored child before @child, or NULL
+ *
+ * Add @child to @menu_shell's index.
+ *
+ * Returns: The index at which @child's native item belongs if
+ * @mirrored, 0 if not, or -1 if @menu_shell isn't indexed.
+ */
+gint
+menu_index_insert (GtkWidget *menu_shell, GtkWidget *child,
+		   gint position, gboolean mirrored, GtkWidget **previous)
+{
+  MenuIndex *index = menu_index_get (menu_shell);
+  MenuIndexEntry *entry;
+  GSequenceIter *iter;
+
+  *previous = NULL;
+  if (!index)
+    return -1;
+  if (g_hash_table_lookup (index->entries, child)) {
+    /* We've missed something */
+    menu_index_invalidate (menu_shell);
+    return -1;
+  }
+
+  entry = g_slice_new (MenuIndexEntry);
+  entry->child = child;
+  entry->mirrored_iter = NULL;
+  if (position < 0 || position >= g_sequence_get_length (index->children))
+    entry->child_iter = g_sequence_append (index->children, entry);
+  else
+    entry->child_iter =
+      g_sequence_insert_before (g_sequence_get_iter_at_pos (index->children,
+							    position),
+				entry);
+  g_hash_table_insert (index->entries, child, entry);
+  if (!mirrored)
+    return 0;
+
+  /* Skipped children are few (tearoffs, say), so this walk is short */
+  for (iter = entry->child_iter; !g_sequence_iter_is_begin (iter);) {
+    MenuIndexEntry *prev_entry;
+    iter = g_sequence_iter_prev (iter);
+    prev_entry = (MenuIndexEntry*) g_sequence_get (iter);
+    if (prev_entry->mirrored_iter) {
+      *previous = prev_entry->child;
+      entry->mirrored_iter =
+	g_sequence_insert_before (g_sequence_iter_next (prev_entry->mirrored_iter),
+				  entry);
+      break;
+    }
+  }
+  if (!entry->mirrored_iter)
+    entry->mirrored_iter = g_sequence_prepend (index->mirrored, entry);
+
+  return index->offset + g_sequence_iter_get_position (entry->mirrored_iter);
+}
+
+/*
+ * menu_index_remove:
+ * @menu_shell: A GtkMenuShell
+ * @child: A child which has just been removed from @menu_shell
+ *
+ * Drop @child from @menu_shell's index.
+ */
+void
+menu_index_remove (GtkWidget *menu_shell, GtkWidget *child)
+{
+  MenuIndex *index = menu_index_get (menu_shell);
+  MenuIndexEntry *entry;
+
+  if (!index)
+    return;
+  entry = (MenuIndexEntry*) g_hash_table_lookup (index->entries, child);
+  if (!entry)
+    return;
+  g_hash_table_remove (index->entries, child);
+  if (entry->mirrored_iter)
+    g_sequence_remove (entry->mirrored_iter);
+  /* This frees the entry */
+  g_sequence_remove (entry->child_iter);
+}
@@ -0,0 +1,52 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __MENU_INDEX_H__
+#define __MENU_INDEX_H__
+
+#include <gtk/gtk.h>
+
+/*
+ * A positional index of a mirrored GtkMenuShell's children, so that
+ * an item added to the shell can be put straight into the native menu
+ * at the right place instead of reconciling the whole menu. It keeps
+ * two balanced sequences: all of the shell's children in order, and
+ * just those which have a native item in the shell's own native menu.
+ * An item's native index is then its rank in the second sequence plus
+ * a fixed offset for anything at the front of the native menu (the
+ * app menu on the menubar), found in O(log n).
+ *
+ * The index is rebuilt by every full reconcile and updated as items
+ * come and go between them.
+ */
+typedef gboolean (*MenuIndexMirroredFunc) (GtkWidget *child, gpointer data);
+
+void menu_index_rebuild (GtkWidget *menu_shell, GList *children,
+			 MenuIndexMirroredFunc mirrored, gpointer data,
+			 guint offset);
+void menu_index_invalidate (GtkWidget *menu_shell);
+gint menu_index_insert (GtkWidget *menu_shell, GtkWidget *child,
+			gint position, gboolean mirrored,
+			GtkWidget **previous);
+void menu_index_remove (GtkWidget *menu_shell, GtkWidget *child);
+
+#endif /* __MENU_INDEX_H__ */
@@ -0,0 +1,132 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "menu_keyindex.h"
+
+/* Key equivalent and modifiers packed into one hash key: the
+   modifiers take the bottom three bits. */
+#define PACK_KEY(key, modifiers) \
+  GUINT_TO_POINTER ((g_unichar_tolower (key) << 3) | ((modifiers) & 7))
+
+/* Packed key to a GSList of native items */
+static GHashTable *menu_key_index_keys = NULL;
+/* Native item to its packed key */
+static GHashTable *menu_key_index_items = NULL;
+
+static void
+menu_key_index_unlink (gpointer native_item, gpointer packed)
+{
+  GSList *items = g_hash_table_lookup (menu_key_index_keys, packed);
+
+  items = g_slist_remove (items, native_item);
+  if (items)
+    g_hash_table_insert (menu_key_index_keys, packed, items);
+  else
+    g_hash_table_remove (menu_key_index_keys, packed);
+}
+
+/*
+ * menu_key_index_set:
+ * @native_item: A native menu item
+ * @key: The character of its key equivalent, or 0 if it has none
+ * @modifiers: MENU_KEY_CONTROL, MENU_KEY_OPTION and MENU_KEY_COMMAND
+ *
+ * Index @native_item under @key and @modifiers, replacing whatever it
+ * was indexed under before. A @key of 0 takes it out of the index.
+ *
+ * Returns: TRUE if @native_item has just been added to the index, so
+ * that the caller can hold a reference to it for as long as it's
+ * there.
+ */
+gboolean
+menu_key_index_set (gpointer native_item, gunichar key, guint modifiers)
+{
+  gpointer packed, old_packed;
+  gboolean present;
+
+  if (key == 0) {
+    menu_key_index_remove (native_item);
+    return FALSE;
+  }
+
+  if (!menu_key_index_keys) {
+    menu_key_index_keys = g_hash_table_new (NULL, NULL);
+    menu_key_index_items = g_hash_table_new (NULL, NULL);
+  }
+
+  packed = PACK_KEY (key, modifiers);
+  present = g_hash_table_lookup_extended (menu_key_index_items, native_item,
+					  NULL, &old_packed);
+  if (present) {
+    if (old_packed == packed)
+      return FALSE;
+    menu_key_index_unlink (native_item, old_packed);
+  }
+  g_hash_table_insert (menu_key_index_items, native_item, packed);
+  g_hash_table_insert (menu_key_index_keys, packed,
+		       g_slist_prepend (g_hash_table_lookup (menu_key_index_keys,
+							     packed),
+					native_item));
+  return !present;
+}
+
+/*
+ * menu_key_index_remove:
+ * @native_item: A native menu item
+ *
+ * Returns: TRUE if @native_item was in the index.
+ */
+gboolean
+menu_key_index_remove (gpointer native_item)
+{
+  gpointer packed;
+
+  if (!menu_key_index_items ||
+      !g_hash_table_lookup_extended (menu_key_index_items, native_item,
+				     NULL, &packed))
+    return FALSE;
+  menu_key_index_unlink (native_item, packed);
+  g_hash_table_remove (menu_key_index_items, native_item);
+  return TRUE;
+}
+
+/*
+ * menu_key_index_lookup:
+ * @key: The character a key press produced, without modifiers
+ * @modifiers: The modifiers held down with it
+ *
+ * Returns: The native items which might have @key and @modifiers as
+ * their key equivalent. The list belongs to the index, and changes
+ * when the index does.
+ */
+GSList *
+menu_key_index_lookup (gunichar key, guint modifiers)
+{
+  if (!menu_key_index_keys)
+    return NULL;
+  return g_hash_table_lookup (menu_key_index_keys, PACK_KEY (key, modifiers));
+}
+
+guint
+menu_key_index_size (void)
+{
+  return menu_key_index_items ? g_hash_table_size (menu_key_index_items) : 0;
+}
@@ -0,0 +1,53 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __MENU_KEYINDEX_H__
+#define __MENU_KEYINDEX_H__
+
+#include <glib.h>
+
+/*
+ * An index from key equivalent to the native menu items showing it,
+ * so that a key press can be matched against the menus without
+ * searching them. Keys are folded to lowercase and shift is left
+ * out, since Cocoa's matching of those depends on the keyboard
+ * layout; a lookup gives every item which could match, and the
+ * native menu holding it has the final say.
+ *
+ * The index only knows about the items it's told about. Key
+ * equivalents which something else puts in the native menus won't be
+ * found, so a miss only settles a key press that has no Command or
+ * Control modifier; perform_key_equivalent() sends the rest on to
+ * the native menubar.
+ */
+enum {
+  MENU_KEY_CONTROL = 1 << 0,
+  MENU_KEY_OPTION  = 1 << 1,
+  MENU_KEY_COMMAND = 1 << 2
+};
+
+gboolean menu_key_index_set (gpointer native_item, gunichar key,
+			     guint modifiers);
+gboolean menu_key_index_remove (gpointer native_item);
+GSList *menu_key_index_lookup (gunichar key, guint modifiers);
+guint menu_key_index_size (void);
+
+#endif /* __MENU_KEYINDEX_H__ */
@@ -0,0 +1,59 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "menu_keymap.h"
+#include "menu_keymap_tables.h"
+
+/* Unicode keyvals are the character with this bit set */
+#define UNICODE_KEYVAL 0x01000000
+
+/*
+ * menu_keymap_lookup:
+ * @keyval: A GDK keyval
+ *
+ * Returns: The key equivalent for @keyval and the modifiers it needs.
+ */
+MenuKeymapEntry
+menu_keymap_lookup (guint keyval)
+{
+  MenuKeymapEntry entry = { 0, 0 };
+  gunichar c;
+
+  if (keyval <= 0xffff)
+    return menu_keymap_entries[menu_keymap_pages[keyval >> 8]][keyval & 0xff];
+
+  if ((keyval & 0xff000000) != UNICODE_KEYVAL)
+    return entry;
+  /* The key equivalent is a single UTF-16 code unit, so nothing
+     outside the Basic Multilingual Plane can be shown, and Cocoa uses
+     the private use area for its function keys. */
+  c = keyval & 0x00ffffff;
+  if (c < 0x20 || c > 0xffff || g_unichar_iscntrl (c) ||
+      (c >= 0xd800 && c < 0xf900))
+    return entry;
+
+  if (g_unichar_isupper (c) && g_unichar_tolower (c) != c) {
+    c = g_unichar_tolower (c);
+    entry.flags = MENU_KEYMAP_SHIFT;
+  }
+  entry.key_equivalent = c;
+  return entry;
+}
@@ -0,0 +1,50 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __MENU_KEYMAP_H__
+#define __MENU_KEYMAP_H__
+
+#include <glib.h>
+
+/*
+ * Translate GDK keyvals to the key equivalents that NSMenuItem
+ * displays. The keyvals below 0x10000 are looked up in tables which
+ * gen-keymap builds from GDK's keysyms, a page of 256 entries at a
+ * time, with the empty pages shared; Unicode keyvals are translated
+ * directly.
+ *
+ * The key equivalent is a UTF-16 code unit: the lowercase character
+ * for printable keys, or one of Cocoa's NS*FunctionKey values. It's
+ * 0 if the key can't be shown as a key equivalent.
+ */
+enum {
+  MENU_KEYMAP_KEYPAD = 1 << 0,	/* Add NSNumericPadKeyMask */
+  MENU_KEYMAP_SHIFT  = 1 << 1	/* Add NSShiftKeyMask: the keyval was uppercase */
+};
+
+typedef struct {
+  guint16 key_equivalent;
+  guint16 flags;
+} MenuKeymapEntry;
+
+MenuKeymapEntry menu_keymap_lookup (guint keyval);
+
+#endif /* __MENU_KEYMAP_H__ */
@@ -0,0 +1,214 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#include "menu_prewarm.h"
+#include "menu_state.h"
+#include "menu_stats.h"
+
+static MenuPrewarmFunc menu_prewarm_func = NULL;
+static gboolean menu_prewarm_enabled = TRUE;
+static guint menu_prewarm_idle_id = 0;
+
+/* The menubars, and where the current pass has got to: the menubar,
+   the top level item within it, and whether anything so far in the
+   pass needed work. */
+static GPtrArray *menu_prewarm_bars = NULL;
+static guint menu_prewarm_current = 0;
+static guint menu_prewarm_position = 0;
+static gboolean menu_prewarm_pass_worked = FALSE;
+
+/*
+ * menu_prewarm_set_func:
+ * @func: Brings part of a menubar up to date
+ *
+ * Set the function that does the work of each step.
+ */
+void
+menu_prewarm_set_func (MenuPrewarmFunc func)
+{
+  menu_prewarm_func = func;
+}
+
+/*
+ * menu_prewarm_set_enabled:
+ * @enabled: Whether to pre-warm the menubars
+ *
+ * See gtk_osxapplication_set_prewarm_menubars().
+ */
+void
+menu_prewarm_set_enabled (gboolean enabled)
+{
+  menu_prewarm_enabled = enabled;
+  if (!enabled && menu_prewarm_idle_id) {
+    g_source_remove (menu_prewarm_idle_id);
+    menu_prewarm_idle_id = 0;
+  }
+  else if (enabled)
+    menu_prewarm_schedule ();
+}
+
+gboolean
+menu_prewarm_get_enabled (void)
+{
+  return menu_prewarm_enabled;
+}
+
+static void
+menu_prewarm_bar_gone (gpointer data, GObject *where_the_object_was)
+{
+  guint i;
+
+  for (i = 0; i < menu_prewarm_bars->len; i++)
+    if (g_ptr_array_index (menu_prewarm_bars, i) == where_the_object_was)
+      break;
+  if (i == menu_prewarm_bars->len)
+    return;
+  g_ptr_array_remove_index (menu_prewarm_bars, i);
+  if (i < menu_prewarm_current)
+    --menu_prewarm_current;
+  else if (i == menu_prewarm_current)
+    menu_prewarm_position = 0;
+}
+
+/*
+ * menu_prewarm_add:
+ * @menubar: A mirrored GtkMenuBar
+ *
+ * Include @menubar in pre-warming until it's finalized.
+ */
+void
+menu_prewarm_add (GtkWidget *menubar)
+{
+  guint i;
+
+  g_return_if_fail (GTK_IS_MENU_SHELL (menubar));
+
+  if (!menu_prewarm_bars)
+    menu_prewarm_bars = g_ptr_array_new ();
+  for (i = 0; i < menu_prewarm_bars->len; i++)
+    if (g_ptr_array_index (menu_prewarm_bars, i) == menubar)
+      return;
+  g_ptr_array_add (menu_prewarm_bars, menubar);
+  g_object_weak_ref (G_OBJECT (menubar), menu_prewarm_bar_gone, NULL);
+  menu_prewarm_schedule ();
+}
+
+/*
+ * menu_prewarm_idle:
+ *
+ * Do a step, or with a sync budget as many steps as fit in it, the
+ * syncs they do sharing the one slice (see menu_state.h).
+ */
+static gboolean
+menu_prewarm_idle (gpointer data)
+{
+  gboolean more;
+
+  /* Thawing syncs, and schedules us again */
+  if (menu_state_is_frozen ()) {
+    menu_prewarm_idle_id = 0;
+    return FALSE;
+  }
+  menu_state_begin_slice ();
+  do
+    more = menu_prewarm_step ();
+  while (more && menu_state_get_sync_budget () > 0 &&
+	 !menu_state_slice_expired ());
+  menu_state_end_slice ();
+  if (more)
+    return TRUE;
+  menu_prewarm_idle_id = 0;
+  return FALSE;
+}
+
+/*
+ * menu_prewarm_schedule:
+ *
+ * Something may have left a menubar out of date: start stepping
+ * through them again whenever the main loop is idle.
+ */
+void
+menu_prewarm_schedule (void)
+{
+  menu_prewarm_pass_worked = TRUE;
+  if (menu_prewarm_idle_id || !menu_prewarm_enabled ||
+      !menu_prewarm_bars || menu_prewarm_bars->len == 0)
+    return;
+  /* Behind redrawing and everything else, so the user never waits
+     for it */
+  menu_prewarm_idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+					  menu_prewarm_idle, NULL, NULL);
+}
+
+/*
+ * menu_prewarm_step:
+ *
+ * Do the next step of pre-warming.
+ *
+ * Returns: FALSE once a whole pass over the menubars has found them
+ * all up to date, TRUE if there may be more to do.
+ */
+gboolean
+menu_prewarm_step (void)
+{
+  GtkWidget *menubar, *menu_item;
+  GList *children;
+  gboolean worked, end_of_pass = FALSE;
+
+  if (!menu_prewarm_func || !menu_prewarm_bars || menu_prewarm_bars->len == 0)
+    return FALSE;
+  if (menu_prewarm_current >= menu_prewarm_bars->len) {
+    menu_prewarm_current = 0;
+    menu_prewarm_position = 0;
+  }
+
+  menubar = g_ptr_array_index (menu_prewarm_bars, menu_prewarm_current);
+  children = gtk_container_get_children (GTK_CONTAINER (menubar));
+  menu_item = g_list_nth_data (children, menu_prewarm_position);
+  g_list_free (children);
+
+  if (menu_item) {
+    ++menu_prewarm_position;
+    worked = menu_prewarm_func (menubar, menu_item);
+  }
+  else {
+    /* The submenus are done, so this only has the menubar's own
+       items left to do */
+    worked = menu_prewarm_func (menubar, NULL);
+    menu_prewarm_position = 0;
+    if (++menu_prewarm_current == menu_prewarm_bars->len) {
+      menu_prewarm_current = 0;
+      end_of_pass = TRUE;
+    }
+  }
+
+  if (worked) {
+    menu_stats_get ()->prewarm_steps++;
+    menu_prewarm_pass_worked = TRUE;
+  }
+  if (end_of_pass) {
+    if (!menu_prewarm_pass_worked)
+      return FALSE;
+    menu_prewarm_pass_worked = FALSE;
+  }
+  return TRUE;
+}
@@ -0,0 +1,55 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __MENU_PREWARM_H__
+#define __MENU_PREWARM_H__
+
+#include <gtk/gtk.h>
+
+/*
+ * Pre-warming: whenever the main loop has nothing better to do, the
+ * mirrored menubars are brought up to date a little at a time, so
+ * that a window taking focus only has to swap the main menu and
+ * opening a menu finds it already built. Each idle callback does a
+ * single step, one of a menubar's top level menus or, at the end of
+ * a pass, the menubar's own items; the callbacks stop once a whole
+ * pass over every menubar has found nothing to do, and start again
+ * when something changes. With a sync budget (menu_state.h) a
+ * callback does steps until the budget runs out instead, and a step
+ * that runs out partway carries on in the next pass; this is also
+ * how a sync which ran out of time is finished.
+ */
+
+/* Bring @menu_item's submenu, or if it's NULL @menubar's own items,
+   up to date. Returns TRUE if there was anything to do. */
+typedef gboolean (*MenuPrewarmFunc) (GtkWidget *menubar,
+				     GtkWidget *menu_item);
+
+void menu_prewarm_set_func (MenuPrewarmFunc func);
+void menu_prewarm_set_enabled (gboolean enabled);
+gboolean menu_prewarm_get_enabled (void);
+
+void menu_prewarm_add (GtkWidget *menubar);
+void menu_prewarm_schedule (void);
+gboolean menu_prewarm_step (void);
+
+#endif /* __MENU_PREWARM_H__ */
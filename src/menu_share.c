@@ -0,0 +1,190 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#include <string.h>
+#include "menu_share.h"
+#include "getlabel.h"
+#include "menu_stats.h"
+
+static GHashTable *menu_share_groups = NULL;
+static GQuark menu_share_quark = 0;
+static guint menu_share_n_windows = 0;
+
+/*
+ * menu_share_group_get:
+ * @layout: Identifies the menu layout, e.g. the GtkUIManager
+ *
+ * Returns: The group of menubars built from @layout, created empty if
+ * need be.
+ */
+MenuShareGroup *
+menu_share_group_get (gpointer layout)
+{
+  MenuShareGroup *group;
+
+  if (!menu_share_groups)
+    menu_share_groups = g_hash_table_new (NULL, NULL);
+  group = g_hash_table_lookup (menu_share_groups, layout);
+  if (!group) {
+    group = g_slice_new0 (MenuShareGroup);
+    group->layout = layout;
+    g_hash_table_insert (menu_share_groups, layout, group);
+    menu_stats_get ()->shared_menubars = g_hash_table_size (menu_share_groups);
+  }
+  return group;
+}
+
+/*
+ * menu_share_group_find:
+ * @menubar: A GtkMenuBar
+ *
+ * Returns: The group @menubar belongs to, or NULL.
+ */
+MenuShareGroup *
+menu_share_group_find (GtkWidget *menubar)
+{
+  if (menu_share_quark == 0)
+    return NULL;
+  return g_object_get_qdata (G_OBJECT (menubar), menu_share_quark);
+}
+
+/*
+ * menu_share_add:
+ * @group: A MenuShareGroup
+ * @menubar: A GtkMenuBar to add to it
+ *
+ * The group doesn't hold a reference to @menubar; the mirror has to
+ * call menu_share_remove() as @menubar is destroyed.
+ */
+void
+menu_share_add (MenuShareGroup *group, GtkWidget *menubar)
+{
+  if (menu_share_quark == 0)
+    menu_share_quark = g_quark_from_static_string ("MenuShareGroup");
+
+  g_return_if_fail (menu_share_group_find (menubar) == NULL);
+  g_object_set_qdata (G_OBJECT (menubar), menu_share_quark, group);
+  group->menubars = g_slist_prepend (group->menubars, menubar);
+  menu_stats_get ()->shared_windows = ++menu_share_n_windows;
+}
+
+/*
+ * menu_share_remove:
+ * @group: The MenuShareGroup @menubar is in
+ * @menubar: A GtkMenuBar to take out of it
+ *
+ * Forget @menubar, and the group as well if it was the last one. If
+ * @menubar was the active member the caller should have moved the
+ * native menubar on first.
+ */
+void
+menu_share_remove (MenuShareGroup *group, GtkWidget *menubar)
+{
+  g_return_if_fail (menu_share_group_find (menubar) == group);
+
+  g_object_set_qdata (G_OBJECT (menubar), menu_share_quark, NULL);
+  group->menubars = g_slist_remove (group->menubars, menubar);
+  menu_stats_get ()->shared_windows = --menu_share_n_windows;
+  if (group->active == menubar)
+    group->active = NULL;
+  if (group->menubars)
+    return;
+
+  g_hash_table_remove (menu_share_groups, group->layout);
+  menu_stats_get ()->shared_menubars = g_hash_table_size (menu_share_groups);
+  g_slice_free (MenuShareGroup, group);
+}
+
+/* What makes two items in the same place in two windows the same */
+static const gchar *
+menu_share_item_identity (GtkWidget *menu_item)
+{
+  const gchar *identity = NULL;
+
+#if GTK_CHECK_VERSION(2,16,0)
+  if (GTK_IS_ACTIVATABLE (menu_item)) {
+    GtkAction *action =
+      gtk_activatable_get_related_action (GTK_ACTIVATABLE (menu_item));
+    if (action)
+      identity = gtk_action_get_name (action);
+  }
+#endif
+  if (!identity && GTK_IS_MENU_ITEM (menu_item))
+    identity = gtk_menu_item_get_accel_path (GTK_MENU_ITEM (menu_item));
+  if (!identity)
+    identity = get_menu_label_text (menu_item, NULL);
+  return identity;
+}
+
+static gboolean
+menu_share_items_match (GtkWidget *a, GtkWidget *b)
+{
+  if (G_OBJECT_TYPE (a) != G_OBJECT_TYPE (b))
+    return FALSE;
+  return g_strcmp0 (menu_share_item_identity (a),
+		    menu_share_item_identity (b)) == 0;
+}
+
+/*
+ * menu_share_pair:
+ * @from_shell: A mirrored GtkMenuShell
+ * @to_shell: The shell in the same place in another window's menubar
+ * @funcs: Called for each matching pair
+ * @data: Passed to @funcs
+ *
+ * Walk the two shells and their submenus together, pairing off the
+ * children in order for as long as they match. Each pair of items is
+ * passed to @funcs->item after the pair of submenus beneath them, if
+ * any, so that the submenus have been dealt with by the time the
+ * items are; each pair of shells is passed to @funcs->shell after all
+ * of its children.
+ *
+ * Returns: The number of pairs of items.
+ */
+guint
+menu_share_pair (GtkWidget *from_shell, GtkWidget *to_shell,
+		 const MenuShareFuncs *funcs, gpointer data)
+{
+  GList *from_children, *to_children, *f, *t;
+  guint pairs = 0;
+
+  from_children = gtk_container_get_children (GTK_CONTAINER (from_shell));
+  to_children = gtk_container_get_children (GTK_CONTAINER (to_shell));
+  for (f = from_children, t = to_children; f && t; f = f->next, t = t->next) {
+    GtkWidget *from = (GtkWidget*) f->data, *to = (GtkWidget*) t->data;
+    GtkWidget *from_submenu, *to_submenu;
+
+    if (!menu_share_items_match (from, to))
+      break;
+    from_submenu = gtk_menu_item_get_submenu (GTK_MENU_ITEM (from));
+    to_submenu = gtk_menu_item_get_submenu (GTK_MENU_ITEM (to));
+    if (from_submenu && to_submenu)
+      pairs += menu_share_pair (from_submenu, to_submenu, funcs, data);
+    funcs->item (from, to, data);
+    ++pairs;
+  }
+  funcs->shell (from_shell, to_shell, !f && !t, data);
+
+  g_list_free (from_children);
+  g_list_free (to_children);
+  return pairs;
+}
@@ -0,0 +1,72 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+
+#ifndef __MENU_SHARE_H__
+#define __MENU_SHARE_H__
+
+#include <gtk/gtk.h>
+
+/*
+ * Menubars shared between windows. Windows whose menubars are built
+ * from the same layout (one GtkUIManager description, say) register
+ * them under a common key, and the group gets a single native
+ * menubar. Only the focused window's GtkMenuBar is mirrored into it.
+ * When another window of the group takes focus, its menubar is
+ * walked in step with the mirrored one and each native item is
+ * handed over to the matching GtkMenuItem, so only the differences
+ * between the windows have to be synced. The native items that
+ * couldn't be handed over are let go of, so the windows which aren't
+ * being shown have no native items at all.
+ *
+ * Items match if they're of the same type and have the same identity:
+ * their action's name, failing that their accel path, failing that
+ * their label. A shell is only matched up to its first difference;
+ * the rest of it is left for an ordinary sync to sort out.
+ */
+typedef struct {
+  gpointer layout;
+  /* The native menubar, owned by the mirror */
+  gpointer native;
+  /* The member being mirrored, and all of the members */
+  GtkWidget *active;
+  GSList *menubars;
+} MenuShareGroup;
+
+typedef struct {
+  /* @to matches @from, which is being mirrored */
+  void (*item) (GtkWidget *from, GtkWidget *to, gpointer data);
+  /* Called after the items (and submenus) of the two shells. @complete
+     is TRUE if every child of both was matched. */
+  void (*shell) (GtkWidget *from, GtkWidget *to, gboolean complete,
+		 gpointer data);
+} MenuShareFuncs;
+
+MenuShareGroup *menu_share_group_get (gpointer layout);
+MenuShareGroup *menu_share_group_find (GtkWidget *menubar);
+void menu_share_add (MenuShareGroup *group, GtkWidget *menubar);
+void menu_share_remove (MenuShareGroup *group, GtkWidget *menubar);
+
+guint menu_share_pair (GtkWidget *from_shell, GtkWidget *to_shell,
+		       const MenuShareFuncs *funcs, gpointer data);
+
+#endif /* __MENU_SHARE_H__ */
@@ -0,0 +1,506 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "menu_keymap.h"
+#include "menu_shortcut.h"
+#include "menu_stats.h"
+
+/* gdk/quartz maps Alt/Option to Mod5 and Command to Meta */
+const MenuShortcutModifier menu_shortcut_quartz_modifiers[] = {
+  { GDK_CONTROL_MASK, MENU_SHORTCUT_CONTROL },
+  { GDK_MOD5_MASK, MENU_SHORTCUT_OPTION },
+  { GDK_META_MASK, MENU_SHORTCUT_COMMAND },
+  { 0, 0 }
+};
+
+/* ige-mac-menu has always put Control accelerators on the Command key */
+const MenuShortcutModifier menu_shortcut_carbon_modifiers[] = {
+  { GDK_MOD1_MASK, MENU_SHORTCUT_OPTION },
+  { GDK_CONTROL_MASK, MENU_SHORTCUT_COMMAND },
+  { 0, 0 }
+};
+
+/* The shortcuts of one mirrored menubar: the trie, a table from key
+   to MenuShortcut for each combination of modifiers, made when it's
+   first needed, and each registered GClosure's MenuShortcutEntry */
+typedef struct {
+  GObject *object;
+  GHashTable *trie[MENU_SHORTCUT_N_MODIFIER_SETS];
+  GHashTable *closures;
+} MenuShortcutScope;
+
+/* A closure's registration: its shortcut, and the menu item showing
+   it, which decides who owns a shortcut in conflict (a weak pointer,
+   since the Carbon mirror doesn't unregister items as they go) */
+typedef struct {
+  MenuShortcut *shortcut;
+  GtkWidget *menu_item;
+} MenuShortcutEntry;
+
+/* Every scope with something registered in it, by its object */
+static GHashTable *menu_shortcut_scopes = NULL;
+static MenuShortcutFunc menu_shortcut_func = NULL;
+
+/* Keys that can't be key equivalents go under their keyvals, with
+   the top bit set to keep them apart from the characters. */
+#define TRIE_KEY(key_equivalent, keyval) \
+  GUINT_TO_POINTER ((key_equivalent) ? (key_equivalent) : (keyval) | 0x80000000)
+
+static const struct {
+  gunichar key_equivalent;
+  const gchar *name;
+} key_names[] = {
+  { ' ', "Space" },
+  { 0x0008, "⌫" },		/* NSBackspaceCharacter */
+  { 0xf700, "↑" },		/* NSUpArrowFunctionKey */
+  { 0xf701, "↓" },		/* NSDownArrowFunctionKey */
+  { 0xf702, "←" },		/* NSLeftArrowFunctionKey */
+  { 0xf703, "→" },		/* NSRightArrowFunctionKey */
+  { 0xf728, "⌦" },		/* NSDeleteFunctionKey */
+  { 0xf729, "↖" },		/* NSHomeFunctionKey */
+  { 0xf72b, "↘" },		/* NSEndFunctionKey */
+  { 0xf72c, "⇞" },		/* NSPageUpFunctionKey */
+  { 0xf72d, "⇟" },		/* NSPageDownFunctionKey */
+  { 0xf746, "Help" }		/* NSHelpFunctionKey */
+};
+
+#define NS_F1_FUNCTION_KEY 0xf704
+#define NS_F35_FUNCTION_KEY 0xf726
+
+/* The shortcut the way the Mac menus show it */
+static gchar *
+menu_shortcut_label (guint keyval, gunichar key_equivalent, guint modifiers)
+{
+  GString *label = g_string_new (NULL);
+  const gchar *name = NULL;
+  guint i;
+
+  if (modifiers & MENU_SHORTCUT_CONTROL)
+    g_string_append (label, "⌃");
+  if (modifiers & MENU_SHORTCUT_OPTION)
+    g_string_append (label, "⌥");
+  if (modifiers & MENU_SHORTCUT_SHIFT)
+    g_string_append (label, "⇧");
+  if (modifiers & MENU_SHORTCUT_COMMAND)
+    g_string_append (label, "⌘");
+
+  for (i = 0; i < G_N_ELEMENTS (key_names) && !name; i++)
+    if (key_names[i].key_equivalent == key_equivalent)
+      name = key_names[i].name;
+
+  if (name)
+    g_string_append (label, name);
+  else if (key_equivalent >= NS_F1_FUNCTION_KEY &&
+	   key_equivalent <= NS_F35_FUNCTION_KEY)
+    g_string_append_printf (label, "F%u",
+			    key_equivalent - NS_F1_FUNCTION_KEY + 1);
+  else if (key_equivalent && (key_equivalent < 0xf700 || key_equivalent > 0xf8ff))
+    g_string_append_unichar (label, g_unichar_toupper (key_equivalent));
+  else if ((name = gdk_keyval_name (keyval)))
+    g_string_append (label, name);
+  return g_string_free (label, FALSE);
+}
+
+/*
+ * menu_shortcut_translate:
+ * @keyval: An accelerator's keyval
+ * @accel_mods: Its modifiers
+ * @map: How to read @accel_mods
+ * @key_equivalent: Set to the character to show, or 0 if there isn't
+ * one
+ * @modifiers: Set to the MENU_SHORTCUT modifiers to show
+ */
+void
+menu_shortcut_translate (guint keyval, GdkModifierType accel_mods,
+			 const MenuShortcutModifier *map,
+			 gunichar *key_equivalent, guint *modifiers)
+{
+  MenuKeymapEntry entry = menu_keymap_lookup (keyval);
+  guint mods = 0;
+
+  if (entry.flags & MENU_KEYMAP_KEYPAD)
+    mods |= MENU_SHORTCUT_KEYPAD;
+  /* An uppercase keyval means shift, whatever the mask says */
+  if (entry.flags & MENU_KEYMAP_SHIFT || accel_mods & GDK_SHIFT_MASK)
+    mods |= MENU_SHORTCUT_SHIFT;
+  for (; map->gdk_mask; map++)
+    if (accel_mods & map->gdk_mask)
+      mods |= map->modifiers;
+
+  *key_equivalent = entry.key_equivalent;
+  *modifiers = mods;
+}
+
+/*
+ * menu_shortcut_get_scope:
+ * @menu_item: A GtkMenuItem
+ *
+ * Returns: The menu shell at the top of the menus @menu_item is in,
+ * normally a window's GtkMenuBar, or @menu_item itself if it isn't
+ * in a menu. Shortcuts only conflict within one scope.
+ */
+GObject *
+menu_shortcut_get_scope (GtkWidget *menu_item)
+{
+  GtkWidget *shell = gtk_widget_get_parent (menu_item);
+
+  if (!GTK_IS_MENU_SHELL (shell))
+    return G_OBJECT (menu_item);
+  while (GTK_IS_MENU (shell)) {
+    GtkWidget *item = gtk_menu_get_attach_widget (GTK_MENU (shell));
+    GtkWidget *parent = item ? gtk_widget_get_parent (item) : NULL;
+
+    if (!GTK_IS_MENU_SHELL (parent))
+      break;
+    shell = parent;
+  }
+  return G_OBJECT (shell);
+}
+
+/* Where @menu_item is in the menus, as the index of each item on the
+   way down from the top. */
+static GArray *
+menu_shortcut_position (GtkWidget *menu_item)
+{
+  GArray *position = g_array_new (FALSE, FALSE, sizeof (gint));
+  GtkWidget *shell;
+
+  while (menu_item &&
+	 GTK_IS_MENU_SHELL (shell = gtk_widget_get_parent (menu_item))) {
+    GList *children = gtk_container_get_children (GTK_CONTAINER (shell));
+    gint index = g_list_index (children, menu_item);
+
+    g_list_free (children);
+    g_array_prepend_val (position, index);
+    menu_item = GTK_IS_MENU (shell) ?
+      gtk_menu_get_attach_widget (GTK_MENU (shell)) : NULL;
+  }
+  return position;
+}
+
+/* Order two registrations of the same shortcut by where their items
+   are in the menus, so that the first item in them owns it however
+   the syncs happened to register them. Items which have gone, or
+   aren't in a menu any more, go last. */
+static gint
+menu_shortcut_compare (gconstpointer a, gconstpointer b, gpointer data)
+{
+  MenuShortcutScope *scope = (MenuShortcutScope*) data;
+  MenuShortcutEntry *entry_a = g_hash_table_lookup (scope->closures, a);
+  MenuShortcutEntry *entry_b = g_hash_table_lookup (scope->closures, b);
+  GArray *position_a = menu_shortcut_position (entry_a->menu_item);
+  GArray *position_b = menu_shortcut_position (entry_b->menu_item);
+  guint i;
+  gint result = 0;
+
+  if (!position_a->len || !position_b->len)
+    result = (position_a->len ? -1 : 0) + (position_b->len ? 1 : 0);
+  for (i = 0; !result && i < position_a->len && i < position_b->len; i++)
+    result = (g_array_index (position_a, gint, i) -
+	      g_array_index (position_b, gint, i));
+  if (!result)
+    result = (gint) position_a->len - (gint) position_b->len;
+  g_array_free (position_a, TRUE);
+  g_array_free (position_b, TRUE);
+  return result;
+}
+
+/* Put @shortcut's closures back in menu order and hand it to the
+   first. The MenuShortcutFunc is told about the closure which had it
+   and the one which has it now, except for @registering, whose
+   caller is about to look. */
+static void
+menu_shortcut_sort (MenuShortcutScope *scope, MenuShortcut *shortcut,
+		    GClosure *registering)
+{
+  GClosure *old_owner = shortcut->owner;
+
+  if (!shortcut->closures->next)
+    return;
+  shortcut->closures = g_slist_sort_with_data (shortcut->closures,
+					       menu_shortcut_compare, scope);
+  shortcut->owner = (GClosure*) shortcut->closures->data;
+  if (shortcut->owner == old_owner || !menu_shortcut_func)
+    return;
+  if (old_owner != registering)
+    menu_shortcut_func (old_owner);
+  if (shortcut->owner != registering)
+    menu_shortcut_func (shortcut->owner);
+}
+
+static void
+menu_shortcut_entry_set_item (MenuShortcutEntry *entry, GtkWidget *menu_item)
+{
+  if (entry->menu_item == menu_item)
+    return;
+  if (entry->menu_item)
+    g_object_remove_weak_pointer (G_OBJECT (entry->menu_item),
+				  (gpointer*) &entry->menu_item);
+  entry->menu_item = menu_item;
+  if (menu_item)
+    g_object_add_weak_pointer (G_OBJECT (menu_item),
+			       (gpointer*) &entry->menu_item);
+}
+
+static void menu_shortcut_scope_finalized (gpointer  data,
+					   GObject  *object);
+static void menu_shortcut_closure_invalidated (gpointer  data,
+					       GClosure *accel_closure);
+
+static MenuShortcutScope *
+menu_shortcut_scope_lookup (GObject *object)
+{
+  return (menu_shortcut_scopes ?
+	  g_hash_table_lookup (menu_shortcut_scopes, object) : NULL);
+}
+
+static MenuShortcutScope *
+menu_shortcut_scope_get (GObject *object)
+{
+  MenuShortcutScope *scope = menu_shortcut_scope_lookup (object);
+
+  if (scope)
+    return scope;
+  if (!menu_shortcut_scopes)
+    menu_shortcut_scopes = g_hash_table_new (NULL, NULL);
+  scope = g_slice_new0 (MenuShortcutScope);
+  scope->object = object;
+  scope->closures = g_hash_table_new (NULL, NULL);
+  g_hash_table_insert (menu_shortcut_scopes, object, scope);
+  g_object_weak_ref (object, menu_shortcut_scope_finalized, scope);
+  return scope;
+}
+
+static void
+menu_shortcut_scope_free (MenuShortcutScope *scope)
+{
+  guint i;
+
+  g_hash_table_remove (menu_shortcut_scopes, scope->object);
+  for (i = 0; i < MENU_SHORTCUT_N_MODIFIER_SETS; i++)
+    if (scope->trie[i])
+      g_hash_table_destroy (scope->trie[i]);
+  g_hash_table_destroy (scope->closures);
+  g_slice_free (MenuShortcutScope, scope);
+}
+
+/* Take @accel_closure's registration out of @scope. @notify says
+   whether to tell the MenuShortcutFunc about a new owner, which isn't
+   wanted when the whole scope is going. */
+static void
+menu_shortcut_remove (MenuShortcutScope *scope, GClosure *accel_closure,
+		      gboolean invalidated, gboolean notify)
+{
+  MenuShortcutEntry *entry = g_hash_table_lookup (scope->closures,
+						   accel_closure);
+  MenuShortcut *shortcut;
+
+  if (!entry)
+    return;
+
+  shortcut = entry->shortcut;
+  menu_shortcut_entry_set_item (entry, NULL);
+  g_slice_free (MenuShortcutEntry, entry);
+  g_hash_table_remove (scope->closures, accel_closure);
+  shortcut->closures = g_slist_remove (shortcut->closures, accel_closure);
+  if (!shortcut->closures) {
+    g_hash_table_remove (scope->trie[shortcut->modifiers],
+			 TRIE_KEY (shortcut->key_equivalent, shortcut->keyval));
+    g_free (shortcut->label);
+    g_slice_free (MenuShortcut, shortcut);
+  }
+  else if (shortcut->owner == accel_closure) {
+    shortcut->owner = (GClosure*) shortcut->closures->data;
+    if (notify && menu_shortcut_func)
+      menu_shortcut_func (shortcut->owner);
+  }
+
+  /* An invalidated closure has already dropped its notifiers */
+  if (!invalidated)
+    g_closure_remove_invalidate_notifier (accel_closure, scope,
+					  menu_shortcut_closure_invalidated);
+  g_closure_unref (accel_closure);
+}
+
+static void
+menu_shortcut_closure_invalidated (gpointer data, GClosure *accel_closure)
+{
+  menu_shortcut_remove ((MenuShortcutScope*) data, accel_closure, TRUE, TRUE);
+}
+
+/* The menubar has gone, and its shortcuts with it */
+static void
+menu_shortcut_scope_finalized (gpointer data, GObject *object)
+{
+  MenuShortcutScope *scope = (MenuShortcutScope*) data;
+  GList *closures = g_hash_table_get_keys (scope->closures);
+  GList *l;
+
+  for (l = closures; l; l = l->next)
+    menu_shortcut_remove (scope, (GClosure*) l->data, FALSE, FALSE);
+  g_list_free (closures);
+  menu_shortcut_scope_free (scope);
+}
+
+/*
+ * menu_shortcut_register:
+ * @accel_closure: The accel closure a menu item shows
+ * @menu_item: The menu item
+ * @scope: The menubar the item is in, from menu_shortcut_get_scope()
+ * @keyval: Its accelerator's keyval
+ * @accel_mods: Its accelerator's modifiers
+ * @map: How the mirror reads @accel_mods
+ *
+ * Register @accel_closure's accelerator in @scope, replacing whatever
+ * it was registered with there before. If another closure already
+ * has the same shortcut in @scope it's a conflict, which GTK+ allows:
+ * the closure whose item comes first in the menus owns the shortcut,
+ * and the others only get it when the owner gives it up. If that
+ * takes the shortcut away from another closure, the MenuShortcutFunc
+ * is told. Other menubars, such as other windows' with their own
+ * accel groups, don't come into it. The registry holds a reference
+ * to @accel_closure until it's unregistered or invalidated, or @scope
+ * is finalized.
+ *
+ * Returns: The shortcut, owned by the registry. The caller should
+ * only show it if its owner is @accel_closure.
+ */
+const MenuShortcut *
+menu_shortcut_register (GClosure *accel_closure, GtkWidget *menu_item,
+			GObject *scope_object, guint keyval,
+			GdkModifierType accel_mods,
+			const MenuShortcutModifier *map)
+{
+  MenuShortcutScope *scope;
+  MenuShortcutEntry *entry;
+  MenuShortcut *shortcut;
+  GtkWidget *position_item = menu_item;
+  GHashTable **node;
+  gunichar key_equivalent;
+  guint modifiers;
+
+  g_return_val_if_fail (accel_closure != NULL, NULL);
+  g_return_val_if_fail (GTK_IS_MENU_ITEM (menu_item), NULL);
+  g_return_val_if_fail (G_IS_OBJECT (scope_object), NULL);
+  g_return_val_if_fail (map != NULL, NULL);
+
+  /* An item that isn't in a menu is a scope of its own, and nothing
+     can conflict with it; its weak pointer would only get in the way
+     of the scope's when it goes */
+  if (scope_object == G_OBJECT (menu_item))
+    position_item = NULL;
+
+  menu_shortcut_translate (keyval, accel_mods, map,
+			   &key_equivalent, &modifiers);
+  scope = menu_shortcut_scope_get (scope_object);
+  entry = g_hash_table_lookup (scope->closures, accel_closure);
+  if (entry) {
+    shortcut = entry->shortcut;
+    if (shortcut->modifiers == modifiers &&
+	TRIE_KEY (shortcut->key_equivalent, shortcut->keyval) ==
+	TRIE_KEY (key_equivalent, keyval)) {
+      /* The item may have moved */
+      menu_shortcut_entry_set_item (entry, position_item);
+      menu_shortcut_sort (scope, shortcut, accel_closure);
+      return shortcut;
+    }
+    menu_shortcut_remove (scope, accel_closure, FALSE, TRUE);
+  }
+
+  node = &scope->trie[modifiers];
+  if (!*node)
+    *node = g_hash_table_new (NULL, NULL);
+  shortcut = g_hash_table_lookup (*node, TRIE_KEY (key_equivalent, keyval));
+  if (!shortcut) {
+    shortcut = g_slice_new0 (MenuShortcut);
+    shortcut->keyval = keyval;
+    shortcut->key_equivalent = key_equivalent;
+    shortcut->modifiers = modifiers;
+    shortcut->label = menu_shortcut_label (keyval, key_equivalent, modifiers);
+    shortcut->owner = accel_closure;
+    g_hash_table_insert (*node, TRIE_KEY (key_equivalent, keyval), shortcut);
+  }
+  else {
+    menu_stats_get ()->shortcut_conflicts++;
+    g_debug ("Accelerator %s is used more than once in this menubar; "
+	     "the first menu item with it shows it", shortcut->label);
+  }
+  shortcut->closures = g_slist_append (shortcut->closures, accel_closure);
+
+  entry = g_slice_new0 (MenuShortcutEntry);
+  entry->shortcut = shortcut;
+  menu_shortcut_entry_set_item (entry, position_item);
+  g_hash_table_insert (scope->closures, accel_closure, entry);
+  g_closure_ref (accel_closure);
+  g_closure_add_invalidate_notifier (accel_closure, scope,
+				     menu_shortcut_closure_invalidated);
+  menu_shortcut_sort (scope, shortcut, accel_closure);
+  return shortcut;
+}
+
+/*
+ * menu_shortcut_unregister:
+ * @accel_closure: A closure that's no longer shown with an accelerator
+ * @scope: The menubar it was registered in
+ *
+ * If @accel_closure owned its shortcut, the next closure registered
+ * for it in @scope takes it over, and the MenuShortcutFunc is told.
+ */
+void
+menu_shortcut_unregister (GClosure *accel_closure, GObject *scope_object)
+{
+  MenuShortcutScope *scope = menu_shortcut_scope_lookup (scope_object);
+
+  if (scope)
+    menu_shortcut_remove (scope, accel_closure, FALSE, TRUE);
+}
+
+/*
+ * menu_shortcut_unregister_all:
+ * @accel_closure: A closure that no menu item shows any more
+ *
+ * menu_shortcut_unregister() @accel_closure from every menubar.
+ */
+void
+menu_shortcut_unregister_all (GClosure *accel_closure)
+{
+  GHashTableIter iter;
+  gpointer scope;
+  GSList *scopes = NULL, *l;
+
+  if (!menu_shortcut_scopes)
+    return;
+  /* Handing a shortcut on may register things, so not while iterating */
+  g_hash_table_iter_init (&iter, menu_shortcut_scopes);
+  while (g_hash_table_iter_next (&iter, NULL, &scope))
+    if (g_hash_table_lookup (((MenuShortcutScope*) scope)->closures,
+			     accel_closure))
+      scopes = g_slist_prepend (scopes, ((MenuShortcutScope*) scope)->object);
+  for (l = scopes; l; l = l->next)
+    menu_shortcut_unregister (accel_closure, (GObject*) l->data);
+  g_slist_free (scopes);
+}
+
+void
+menu_shortcut_set_func (MenuShortcutFunc func)
+{
+  menu_shortcut_func = func;
+}
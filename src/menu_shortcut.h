@@ -0,0 +1,92 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __MENU_SHORTCUT_H__
+#define __MENU_SHORTCUT_H__
+
+#include <gtk/gtk.h>
+
+/*
+ * The keyboard shortcuts shown in the native menus, shared by the
+ * Cocoa and Carbon mirrors. Each mirror registers the accel closures
+ * its items show; the registry translates the GTK+ accelerator into
+ * platform-neutral modifiers and a key equivalent once, works out its
+ * label, and decides which closure a key press should go to.
+ *
+ * Each mirrored menubar is a scope of its own, with its shortcuts in
+ * a two-level trie: the combination of modifiers picks a node, and
+ * the key picks the shortcut under it. Two closures registered for
+ * the same shortcut in one menubar are a conflict, which GTK+
+ * allows; the one whose item comes first in the menus keeps it, and
+ * the mirrors leave it off the other's items. Since a key
+ * press is matched against the key equivalents the items show
+ * (menu_keyindex.h), that also decides where it goes. Other windows'
+ * menubars, which only one at a time is showing, can have the same
+ * shortcuts without conflict. A scope goes when its menubar does.
+ */
+enum {
+  MENU_SHORTCUT_SHIFT   = 1 << 0,
+  MENU_SHORTCUT_CONTROL = 1 << 1,
+  MENU_SHORTCUT_OPTION  = 1 << 2,
+  MENU_SHORTCUT_COMMAND = 1 << 3,
+  MENU_SHORTCUT_KEYPAD  = 1 << 4
+};
+#define MENU_SHORTCUT_N_MODIFIER_SETS 32
+
+/* How a mirror reads GDK's modifiers, in an array ending with a zero
+   gdk_mask. Shift comes from GDK_SHIFT_MASK in every case. */
+typedef struct {
+  GdkModifierType gdk_mask;
+  guint modifiers;
+} MenuShortcutModifier;
+
+extern const MenuShortcutModifier menu_shortcut_quartz_modifiers[];
+extern const MenuShortcutModifier menu_shortcut_carbon_modifiers[];
+
+typedef struct {
+  guint keyval;
+  gunichar key_equivalent;	/* 0 if the key can't be a key equivalent */
+  guint modifiers;
+  gchar *label;			/* e.g. "⌥⌘S" */
+  GClosure *owner;		/* Where the shortcut goes */
+  GSList *closures;		/* Everything registered for it, owner first */
+} MenuShortcut;
+
+/* Called with a closure which has just become or stopped being the
+   owner of its shortcut, so its items can show it or stop. */
+typedef void (*MenuShortcutFunc) (GClosure *accel_closure);
+
+void menu_shortcut_translate (guint keyval, GdkModifierType accel_mods,
+			      const MenuShortcutModifier *map,
+			      gunichar *key_equivalent, guint *modifiers);
+
+GObject *menu_shortcut_get_scope (GtkWidget *menu_item);
+const MenuShortcut *menu_shortcut_register (GClosure *accel_closure,
+					    GtkWidget *menu_item,
+					    GObject *scope,
+					    guint keyval,
+					    GdkModifierType accel_mods,
+					    const MenuShortcutModifier *map);
+void menu_shortcut_unregister (GClosure *accel_closure, GObject *scope);
+void menu_shortcut_unregister_all (GClosure *accel_closure);
+void menu_shortcut_set_func (MenuShortcutFunc func);
+
+#endif /* __MENU_SHORTCUT_H__ */
@@ -0,0 +1,425 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "menu_state.h"
+#include "menu_stats.h"
+
+static GQuark menu_shell_state_quark = 0;
+
+/* The clock starts at 1 and the epoch at 1 so that a fresh state,
+   which is all zeroes, is always out of date. */
+static guint menu_state_clock = 1;
+static guint menu_state_epoch = 1;
+
+static MenuStateChangedFunc menu_state_changed_func = NULL;
+
+static gboolean menu_state_lazy_submenus = FALSE;
+/* The number of shells whose native menus are still placeholders */
+static guint menu_state_n_deferred_shells = 0;
+
+/* The time a sync may take before it leaves the rest for later, 0
+   for no limit, and when the current slice of work has to stop */
+static guint64 menu_state_sync_budget_ns = 0;
+static guint menu_state_slice_depth = 0;
+static guint64 menu_state_slice_deadline = 0;
+
+/* While the menus are frozen, the roots of the menu trees which have
+   changed, each holding a reference. */
+static guint menu_state_freeze_count = 0;
+static GHashTable *menu_state_frozen_roots = NULL;
+
+static void
+menu_shell_state_free (gpointer data)
+{
+  MenuShellState *state = data;
+
+  if (state->deferred)
+    --menu_state_n_deferred_shells;
+  g_slice_free (MenuShellState, state);
+}
+
+static void
+menu_state_changed (void)
+{
+  if (menu_state_changed_func)
+    menu_state_changed_func ();
+}
+
+/*
+ * menu_state_set_changed_func:
+ * @func: Called when a shell is marked dirty or deferred, or
+ * everything is invalidated
+ */
+void
+menu_state_set_changed_func (MenuStateChangedFunc func)
+{
+  menu_state_changed_func = func;
+}
+
+/*
+ * menu_shell_state_get:
+ * @menu_shell: A GtkMenuShell
+ *
+ * Returns: The MenuShellState for @menu_shell, creating it if need be.
+ */
+MenuShellState *
+menu_shell_state_get (GtkWidget *menu_shell)
+{
+  MenuShellState *state;
+
+  if (menu_shell_state_quark == 0)
+    menu_shell_state_quark = g_quark_from_static_string ("MenuShellState");
+
+  state = g_object_get_qdata (G_OBJECT (menu_shell), menu_shell_state_quark);
+  if (!state) {
+    state = g_slice_new0 (MenuShellState);
+    g_object_set_qdata_full (G_OBJECT (menu_shell), menu_shell_state_quark,
+			     state, menu_shell_state_free);
+  }
+  return state;
+}
+
+/*
+ * menu_shell_get_parent_shell:
+ * @menu_shell: A GtkMenuShell
+ *
+ * Returns: The menu shell holding the item that @menu_shell is the
+ * submenu of, or NULL if it's a menubar or isn't attached.
+ */
+GtkWidget *
+menu_shell_get_parent_shell (GtkWidget *menu_shell)
+{
+  GtkWidget *item, *parent;
+
+  if (!GTK_IS_MENU (menu_shell))
+    return NULL;
+  item = gtk_menu_get_attach_widget (GTK_MENU (menu_shell));
+  if (!item)
+    return NULL;
+  parent = gtk_widget_get_parent (item);
+  return GTK_IS_MENU_SHELL (parent) ? parent : NULL;
+}
+
+/*
+ * menu_shell_mark_dirty:
+ * @menu_shell: A GtkMenuShell whose children have changed
+ *
+ * Give @menu_shell a new generation and pass it up to all of the
+ * shells above it.
+ */
+void
+menu_shell_mark_dirty (GtkWidget *menu_shell)
+{
+  guint generation = ++menu_state_clock;
+  GtkWidget *shell;
+
+  g_return_if_fail (GTK_IS_MENU_SHELL (menu_shell));
+
+  menu_shell_state_get (menu_shell)->generation = generation;
+  for (shell = menu_shell; shell; shell = menu_shell_get_parent_shell (shell))
+    menu_shell_state_get (shell)->subtree_generation = generation;
+  menu_state_changed ();
+}
+
+/*
+ * menu_shell_is_dirty:
+ * @menu_shell: A GtkMenuShell
+ * @native_menu: The native menu it's being synced into
+ *
+ * Returns: TRUE if @menu_shell's own children need reconciling with
+ * @native_menu.
+ */
+gboolean
+menu_shell_is_dirty (GtkWidget *menu_shell, gpointer native_menu)
+{
+  MenuShellState *state = menu_shell_state_get (menu_shell);
+
+  return (state->synced_epoch != menu_state_epoch ||
+	  state->synced_menu != native_menu ||
+	  state->generation > state->synced_generation);
+}
+
+/*
+ * menu_shell_has_changed:
+ * @menu_shell: A GtkMenuShell
+ * @native_menu: The native menu it's being synced into
+ *
+ * Returns: TRUE if anything at or below @menu_shell has changed since
+ * it was last synced.
+ */
+gboolean
+menu_shell_has_changed (GtkWidget *menu_shell, gpointer native_menu)
+{
+  MenuShellState *state = menu_shell_state_get (menu_shell);
+
+  return (menu_shell_is_dirty (menu_shell, native_menu) ||
+	  state->subtree_generation > state->synced_generation);
+}
+
+/*
+ * menu_shell_needs_sync:
+ * @menu_shell: A GtkMenuShell
+ * @native_menu: The native menu it's being synced into
+ *
+ * Returns: TRUE if anything at or below @menu_shell has changed since
+ * it was last synced, or the last sync couldn't reach all of it.
+ */
+gboolean
+menu_shell_needs_sync (GtkWidget *menu_shell, gpointer native_menu)
+{
+  return (menu_shell_has_changed (menu_shell, native_menu) ||
+	  menu_shell_state_get (menu_shell)->incomplete);
+}
+
+/*
+ * menu_shell_mark_synced:
+ * @menu_shell: A GtkMenuShell
+ * @native_menu: The native menu it has just been synced into
+ *
+ * Record that @menu_shell and everything below it are up to date.
+ */
+void
+menu_shell_mark_synced (GtkWidget *menu_shell, gpointer native_menu)
+{
+  MenuShellState *state = menu_shell_state_get (menu_shell);
+
+  state->synced_generation = menu_state_clock;
+  state->synced_epoch = menu_state_epoch;
+  state->synced_menu = native_menu;
+  state->incomplete = FALSE;
+}
+
+/*
+ * menu_shell_mark_reconciled:
+ * @menu_shell: A GtkMenuShell
+ * @native_menu: The native menu its children have just been
+ * reconciled with
+ *
+ * Record that @menu_shell's own children are up to date, but that a
+ * submenu somewhere below them may not be, so that the next sync
+ * still comes this way.
+ */
+void
+menu_shell_mark_reconciled (GtkWidget *menu_shell, gpointer native_menu)
+{
+  menu_shell_mark_synced (menu_shell, native_menu);
+  menu_shell_state_get (menu_shell)->incomplete = TRUE;
+}
+
+/*
+ * menu_state_invalidate_all:
+ *
+ * Make every shell dirty, for when the menus may have changed behind
+ * our backs (e.g. with signals blocked).
+ */
+void
+menu_state_invalidate_all (void)
+{
+  ++menu_state_epoch;
+  menu_state_changed ();
+}
+
+/*
+ * menu_state_set_lazy_submenus:
+ * @lazy: Whether new submenus should wait until they're opened to be built
+ *
+ * See gtk_osxapplication_set_lazy_submenus().
+ */
+void
+menu_state_set_lazy_submenus (gboolean lazy)
+{
+  menu_state_lazy_submenus = lazy;
+}
+
+gboolean
+menu_state_get_lazy_submenus (void)
+{
+  return menu_state_lazy_submenus;
+}
+
+/*
+ * menu_shell_set_deferred:
+ * @menu_shell: A GtkMenuShell
+ * @deferred: Whether its native menu is a placeholder waiting to be
+ * built
+ */
+void
+menu_shell_set_deferred (GtkWidget *menu_shell, gboolean deferred)
+{
+  MenuShellState *state = menu_shell_state_get (menu_shell);
+
+  deferred = deferred != FALSE;
+  if (state->deferred == deferred)
+    return;
+  state->deferred = deferred;
+  if (deferred) {
+    ++menu_state_n_deferred_shells;
+    menu_state_changed ();
+  }
+  else
+    --menu_state_n_deferred_shells;
+}
+
+/*
+ * menu_state_n_deferred:
+ *
+ * Returns: The number of shells whose native menus haven't been built
+ * yet.
+ */
+guint
+menu_state_n_deferred (void)
+{
+  return menu_state_n_deferred_shells;
+}
+
+/*
+ * menu_state_set_sync_budget:
+ * @budget_us: How long a sync may take, in microseconds, or 0 for as
+ * long as it needs
+ *
+ * See gtk_osxapplication_set_menu_sync_budget().
+ */
+void
+menu_state_set_sync_budget (guint budget_us)
+{
+  menu_state_sync_budget_ns = (guint64) budget_us * 1000;
+}
+
+guint
+menu_state_get_sync_budget (void)
+{
+  return menu_state_sync_budget_ns / 1000;
+}
+
+/*
+ * menu_state_begin_slice:
+ *
+ * Start the clock on a slice of syncing, which
+ * menu_state_slice_expired() says has run out once the sync budget
+ * has gone. Slices nest: the outermost one sets the deadline.
+ */
+void
+menu_state_begin_slice (void)
+{
+  if (menu_state_slice_depth++ > 0)
+    return;
+  menu_state_slice_deadline = menu_state_sync_budget_ns ?
+    menu_stats_now_ns () + menu_state_sync_budget_ns : 0;
+}
+
+/*
+ * menu_state_end_slice:
+ *
+ * Undo one menu_state_begin_slice().
+ */
+void
+menu_state_end_slice (void)
+{
+  g_return_if_fail (menu_state_slice_depth > 0);
+  if (--menu_state_slice_depth == 0)
+    menu_state_slice_deadline = 0;
+}
+
+/*
+ * menu_state_slice_expired:
+ *
+ * Returns: TRUE if the current slice has used up the sync budget, so
+ * whatever is left should be put off until later. Always FALSE
+ * outside a slice or without a budget.
+ */
+gboolean
+menu_state_slice_expired (void)
+{
+  return (menu_state_slice_deadline != 0 &&
+	  menu_stats_now_ns () >= menu_state_slice_deadline);
+}
+
+/*
+ * menu_state_freeze:
+ *
+ * See gtk_osxapplication_freeze_menubar().
+ */
+void
+menu_state_freeze (void)
+{
+  ++menu_state_freeze_count;
+}
+
+/*
+ * menu_state_thaw:
+ *
+ * Undo one menu_state_freeze().
+ *
+ * Returns: TRUE if that was the last one, so the menus need syncing.
+ */
+gboolean
+menu_state_thaw (void)
+{
+  g_return_val_if_fail (menu_state_freeze_count > 0, FALSE);
+  return --menu_state_freeze_count == 0;
+}
+
+gboolean
+menu_state_is_frozen (void)
+{
+  return menu_state_freeze_count > 0;
+}
+
+/*
+ * menu_state_record_frozen:
+ * @menu_shell: A GtkMenuShell which has changed while frozen
+ *
+ * Mark @menu_shell dirty and remember the menu tree it's in, so that
+ * the tree can be synced when the menus are thawed.
+ */
+void
+menu_state_record_frozen (GtkWidget *menu_shell)
+{
+  GtkWidget *root = menu_shell, *parent;
+
+  menu_shell_mark_dirty (menu_shell);
+  while ((parent = menu_shell_get_parent_shell (root)))
+    root = parent;
+
+  if (!menu_state_frozen_roots)
+    menu_state_frozen_roots = g_hash_table_new (NULL, NULL);
+  if (!g_hash_table_lookup (menu_state_frozen_roots, root))
+    g_hash_table_insert (menu_state_frozen_roots, g_object_ref (root), root);
+}
+
+/*
+ * menu_state_take_frozen:
+ *
+ * Returns: A list of the menu tree roots recorded while frozen. The
+ * caller owns the list and a reference to each root.
+ */
+GList *
+menu_state_take_frozen (void)
+{
+  GList *roots;
+
+  if (!menu_state_frozen_roots)
+    return NULL;
+  roots = g_hash_table_get_keys (menu_state_frozen_roots);
+  g_hash_table_destroy (menu_state_frozen_roots);
+  menu_state_frozen_roots = NULL;
+  return roots;
+}
@@ -0,0 +1,86 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __MENU_STATE_H__
+#define __MENU_STATE_H__
+
+#include <gtk/gtk.h>
+
+/*
+ * Bookkeeping for the mirrored GtkMenuShells, attached to each one
+ * as qdata. Every change to a shell's children takes a new
+ * generation from a global clock; the shell records it as its own
+ * generation and every shell above it as its subtree generation. A
+ * sync can then skip any shell whose subtree hasn't moved since it
+ * was last synced.
+ */
+typedef struct {
+  guint generation;
+  guint subtree_generation;
+  guint synced_generation;
+  guint synced_epoch;
+  gpointer synced_menu;
+  /* Lazy submenus: the native menu is an empty placeholder until it
+     is opened for the first time. Set with menu_shell_set_deferred().
+     A sync which runs out of time leaves the shells it didn't get to
+     deferred too, however far they had been built. */
+  gboolean deferred;
+  /* The last sync reconciled the shell's own children but couldn't
+     get to the submenus of some of them, so it still needs a sync
+     whatever the generations say */
+  gboolean incomplete;
+} MenuShellState;
+
+/* Called whenever something may have left a shell out of date */
+typedef void (*MenuStateChangedFunc) (void);
+
+void menu_state_set_changed_func (MenuStateChangedFunc func);
+
+MenuShellState *menu_shell_state_get (GtkWidget *menu_shell);
+GtkWidget *menu_shell_get_parent_shell (GtkWidget *menu_shell);
+
+void menu_shell_mark_dirty (GtkWidget *menu_shell);
+gboolean menu_shell_is_dirty (GtkWidget *menu_shell, gpointer native_menu);
+gboolean menu_shell_has_changed (GtkWidget *menu_shell, gpointer native_menu);
+gboolean menu_shell_needs_sync (GtkWidget *menu_shell, gpointer native_menu);
+void menu_shell_mark_synced (GtkWidget *menu_shell, gpointer native_menu);
+void menu_shell_mark_reconciled (GtkWidget *menu_shell, gpointer native_menu);
+
+void menu_state_invalidate_all (void);
+
+void menu_state_set_lazy_submenus (gboolean lazy);
+gboolean menu_state_get_lazy_submenus (void);
+void menu_shell_set_deferred (GtkWidget *menu_shell, gboolean deferred);
+guint menu_state_n_deferred (void);
+
+void menu_state_set_sync_budget (guint budget_us);
+guint menu_state_get_sync_budget (void);
+void menu_state_begin_slice (void);
+void menu_state_end_slice (void);
+gboolean menu_state_slice_expired (void);
+
+void menu_state_freeze (void);
+gboolean menu_state_thaw (void);
+gboolean menu_state_is_frozen (void);
+void menu_state_record_frozen (GtkWidget *menu_shell);
+GList *menu_state_take_frozen (void);
+
+#endif /* __MENU_STATE_H__ */
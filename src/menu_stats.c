@@ -0,0 +1,85 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+#include "menu_stats.h"
+
+/* There's only ever one application, so the counters are global. */
+static GtkOSXApplicationMenuStats menu_stats;
+
+GtkOSXApplicationMenuStats *
+menu_stats_get (void)
+{
+  return &menu_stats;
+}
+
+void
+menu_stats_reset (void)
+{
+  memset (&menu_stats, 0, sizeof (menu_stats));
+}
+
+/*
+ * menu_stats_now_ns:
+ *
+ * Returns: A monotonic time in nanoseconds, for timing things too
+ * quick for GTimer.
+ */
+guint64
+menu_stats_now_ns (void)
+{
+#ifdef __APPLE__
+  static mach_timebase_info_data_t timebase;
+
+  if (timebase.denom == 0)
+    mach_timebase_info (&timebase);
+  return mach_absolute_time () * timebase.numer / timebase.denom;
+#else
+  struct timespec now;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (guint64) now.tv_sec * G_GUINT64_CONSTANT (1000000000) + now.tv_nsec;
+#endif
+}
+
+/*
+ * menu_stats_record_latency:
+ * @histogram: One of the latency histograms in the stats, with
+ * GTK_OSX_APPLICATION_LATENCY_BUCKETS buckets
+ * @ns: How long the event took
+ *
+ * Count the event in its bucket.
+ */
+void
+menu_stats_record_latency (guint64 *histogram, guint64 ns)
+{
+  guint bucket = 0;
+
+  for (ns >>= 8; ns && bucket < GTK_OSX_APPLICATION_LATENCY_BUCKETS - 1;
+       ns >>= 1)
+    ++bucket;
+  histogram[bucket]++;
+}
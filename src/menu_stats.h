@@ -0,0 +1,33 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __MENU_STATS_H__
+#define __MENU_STATS_H__
+
+#include "gtkosxapplication.h"
+
+GtkOSXApplicationMenuStats *menu_stats_get (void);
+void menu_stats_reset (void);
+
+guint64 menu_stats_now_ns (void);
+void menu_stats_record_latency (guint64 *histogram, guint64 ns);
+
+#endif /* __MENU_STATS_H__ */
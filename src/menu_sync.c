@@ -0,0 +1,1413 @@
+/* GTK+ Integration with platform-specific application-wide features 
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright (C) 2009 Paul Davis
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <gtk/gtk.h>
+
+#include "menu_sync.h"
+#include "getlabel.h"
+#include "menu_accel.h"
+#include "menu_diff.h"
+#include "menu_index.h"
+#include "menu_share.h"
+#include "menu_shortcut.h"
+#include "menu_state.h"
+#include "menu_stats.h"
+#include "menu_title.h"
+#include "menu_trace.h"
+#include "menu_update.h"
+#include "menu_watch.h"
+
+//#define DEBUG(format, ...) g_printerr ("%s: " format, G_STRFUNC, ## __VA_ARGS__)
+#define DEBUG(format, ...)
+
+/*
+ * What a mirrored GtkMenuItem knows about its native item, attached
+ * to it as qdata.
+ */
+typedef struct {
+  /* Owned */
+  gpointer native;
+  /* The interned title being shown */
+  MenuTitle *title;
+  /* The accel label's closure, as of the last sync */
+  GClosure *accel_closure;
+  /* The menubar its shortcut is registered in (menu_shortcut.h), or
+     NULL if it isn't; a weak pointer */
+  GObject *shortcut_scope;
+  /* Taken out of its menu along with the GtkMenuItem, and not put
+     anywhere since */
+  gboolean removed;
+} MenuSyncItem;
+
+static const MenuBackend *menu_sync_backend = NULL;
+
+static GQuark menu_sync_menu_quark = 0;
+static GQuark menu_sync_deferral_quark = 0;
+static GQuark menu_sync_item_quark = 0;
+
+void
+menu_sync_set_backend (const MenuBackend *backend)
+{
+  menu_sync_backend = backend;
+  /* A closure no item shows any more mustn't keep its shortcut from
+     the next closure given it */
+  menu_accel_set_unwatch_func (menu_shortcut_unregister_all);
+}
+
+const MenuBackend *
+menu_sync_get_backend (void)
+{
+  return menu_sync_backend;
+}
+
+/*
+ * Native menus
+ */
+
+gpointer
+menu_sync_get_menu (GtkWidget *menu_shell)
+{
+  /* If menu_sync_menu_quark == 0 then menu_sync_connect_menu hasn't
+     been called yet and we therefore don't have a menu to return. */
+  if (menu_sync_menu_quark == 0)
+    return NULL;
+  return g_object_get_qdata (G_OBJECT (menu_shell), menu_sync_menu_quark);
+}
+
+void
+menu_sync_connect_menu (GtkWidget *menu_shell, gpointer menu)
+{
+  if (menu_sync_menu_quark == 0)
+    menu_sync_menu_quark = g_quark_from_static_string ("MenuSyncMenu");
+
+  menu_sync_backend->menu_ref (menu);
+  g_object_set_qdata_full (G_OBJECT (menu_shell), menu_sync_menu_quark,
+			   menu, menu_sync_backend->menu_unref);
+
+  /* Follow items being added and removed */
+  if (GTK_IS_MENU_SHELL (menu_shell))
+    menu_watch_shell (menu_shell);
+}
+
+/*
+ * menu_sync_disconnect_menu:
+ * @menu_shell: A GtkMenuShell connected to a native menu
+ *
+ * Undo menu_sync_connect_menu(), and menu_sync_defer_menu() if it was
+ * deferred, for when the native menu is taken over by another shell.
+ */
+void
+menu_sync_disconnect_menu (GtkWidget *menu_shell)
+{
+  if (menu_sync_menu_quark)
+    g_object_set_qdata (G_OBJECT (menu_shell), menu_sync_menu_quark, NULL);
+  if (menu_sync_deferral_quark)
+    g_object_set_qdata (G_OBJECT (menu_shell), menu_sync_deferral_quark,
+			NULL);
+  if (GTK_IS_MENU_SHELL (menu_shell))
+    menu_shell_set_deferred (menu_shell, FALSE);
+}
+
+static void
+menu_sync_attach_deferral (GtkWidget *menu_shell, gpointer menu)
+{
+  if (menu_sync_deferral_quark == 0)
+    menu_sync_deferral_quark = g_quark_from_static_string ("MenuSyncDeferral");
+
+  g_object_set_qdata_full (G_OBJECT (menu_shell), menu_sync_deferral_quark,
+			   menu_sync_backend->menu_defer (menu, menu_shell),
+			   menu_sync_backend->menu_undefer);
+}
+
+/*
+ * menu_sync_defer_menu:
+ * @menu_shell: A GtkMenuShell which has just been connected to @menu
+ * @menu: Its (still empty) native menu
+ *
+ * Leave @menu empty until it's about to be shown, at which point the
+ * backend calls menu_sync_menu_will_open() to fill it in.
+ */
+void
+menu_sync_defer_menu (GtkWidget *menu_shell, gpointer menu)
+{
+  menu_sync_attach_deferral (menu_shell, menu);
+  menu_shell_set_deferred (menu_shell, TRUE);
+  menu_stats_get ()->submenus_deferred++;
+}
+
+/*
+ * menu_sync_postpone:
+ * @menu_shell: A GtkMenuShell which a sync has run out of time for
+ * @menu: Its native menu, however far it has been built
+ *
+ * Leave @menu_shell out of date until it's opened, or pre-warming
+ * gets to it, as with a lazy submenu. Its native menu is left as it
+ * is meanwhile. The backend's deferral is kept after a deferred menu
+ * is built, so that only needs putting back the first time.
+ */
+static void
+menu_sync_postpone (GtkWidget *menu_shell, gpointer menu)
+{
+  if (!menu_sync_deferral_quark ||
+      !g_object_get_qdata (G_OBJECT (menu_shell), menu_sync_deferral_quark))
+    menu_sync_attach_deferral (menu_shell, menu);
+  menu_shell_set_deferred (menu_shell, TRUE);
+  menu_stats_get ()->shells_postponed++;
+}
+
+/*
+ * Native items
+ */
+
+/* Drop @item's shortcut, if it has one registered */
+static void
+menu_sync_item_unregister_shortcut (MenuSyncItem *item)
+{
+  if (!item->shortcut_scope)
+    return;
+  menu_shortcut_unregister (item->accel_closure, item->shortcut_scope);
+  g_object_remove_weak_pointer (item->shortcut_scope,
+				(gpointer*) &item->shortcut_scope);
+  item->shortcut_scope = NULL;
+}
+
+static void
+menu_sync_item_free (gpointer data)
+{
+  MenuSyncItem *item = data;
+
+  menu_sync_item_unregister_shortcut (item);
+  menu_sync_backend->item_unbind (item->native);
+  menu_sync_backend->item_unref (item->native);
+  menu_title_unref (item->title);
+  if (item->accel_closure)
+    g_closure_unref (item->accel_closure);
+  g_slice_free (MenuSyncItem, item);
+}
+
+static MenuSyncItem *
+menu_sync_item_lookup (GtkWidget *menu_item)
+{
+  if (menu_sync_item_quark == 0)
+    return NULL;
+  return g_object_get_qdata (G_OBJECT (menu_item), menu_sync_item_quark);
+}
+
+/*
+ * menu_sync_get_item:
+ * @menu_item: A GtkMenuItem
+ *
+ * Returns: The native item mirroring @menu_item, or NULL.
+ */
+gpointer
+menu_sync_get_item (GtkWidget *menu_item)
+{
+  MenuSyncItem *item = menu_sync_item_lookup (menu_item);
+
+  return item ? item->native : NULL;
+}
+
+/*
+ * menu_sync_item_is_hidden_away:
+ * @menu_item: A GtkMenuItem
+ * @native: Its native item, or NULL
+ *
+ * Whether @native is out of its menu because it's hidden: emulated
+ * hiding on 10.4 takes the item out, and it puts itself back when
+ * it's shown again. One which was taken out along with @menu_item,
+ * perhaps while it was hidden, is only waiting to be put somewhere.
+ */
+static gboolean
+menu_sync_item_is_hidden_away (GtkWidget *menu_item, gpointer native)
+{
+  MenuSyncItem *item = native ? menu_sync_item_lookup (menu_item) : NULL;
+
+  return (item && !item->removed &&
+	  !menu_sync_backend->item_get_menu (native) &&
+	  menu_sync_backend->item_is_hidden (native));
+}
+
+/*
+ * menu_sync_item_set_title:
+ * @item: A mirrored item
+ * @label_text: Its new title, or NULL for none
+ *
+ * Show the interned title for @label_text, sharing the native string
+ * with every other menu item showing the same text.
+ */
+static void
+menu_sync_item_set_title (MenuSyncItem *item, const gchar *label_text)
+{
+  MenuTitle *title;
+
+  /* Separators have no title */
+  if (menu_sync_backend->item_is_separator (item->native))
+    return;
+  title = menu_title_ref (label_text, &menu_sync_backend->titles);
+  if (title != item->title)
+    menu_sync_backend->item_set_title (item->native, title);
+  menu_title_unref (item->title);
+  item->title = title;
+}
+
+static void
+menu_sync_item_update_state (MenuSyncItem *item, GtkWidget *widget)
+{
+  gboolean sensitive;
+  gboolean visible;
+
+  g_object_get (widget,
+		"sensitive", &sensitive,
+		"visible",   &visible,
+		NULL);
+  menu_stats_get ()->native_updates++;
+
+  menu_sync_backend->item_set_enabled (item->native, sensitive);
+  menu_sync_backend->item_set_hidden (item->native, !visible);
+}
+
+static void
+menu_sync_item_update_checked (MenuSyncItem *item, GtkWidget *widget)
+{
+  gboolean active, inconsistent;
+
+  g_object_get (widget,
+		"active", &active,
+		"inconsistent", &inconsistent,
+		NULL);
+  menu_stats_get ()->native_updates++;
+
+  if (inconsistent)
+    menu_sync_backend->item_set_state (item->native, MENU_ITEM_STATE_MIXED);
+  else if (active)
+    menu_sync_backend->item_set_state (item->native, MENU_ITEM_STATE_ON);
+  else
+    menu_sync_backend->item_set_state (item->native, MENU_ITEM_STATE_OFF);
+}
+
+static void
+menu_sync_item_update_submenu (MenuSyncItem *item, GtkWidget *widget)
+{
+  GtkWidget *submenu, *label = NULL;
+  gpointer native_submenu;
+
+  g_return_if_fail (item != NULL);
+  g_return_if_fail (widget != NULL);
+
+  submenu = gtk_menu_item_get_submenu (GTK_MENU_ITEM (widget));
+
+  if (!submenu) {
+    /* If the native item has a submenu but the menu item doesn't,
+       lose the native item's submenu */
+    if (menu_sync_backend->item_get_submenu (item->native))
+      menu_sync_backend->item_set_submenu (item->native, NULL);
+    return;
+  }
+
+  native_submenu = menu_sync_get_menu (submenu);
+  if (native_submenu) {
+    /* Covers no submenu or the wrong submenu on the native item */
+    if (menu_sync_backend->item_get_submenu (item->native) != native_submenu)
+      menu_sync_backend->item_set_submenu (item->native, native_submenu);
+  }
+  else if ((native_submenu =
+	    menu_sync_backend->item_get_submenu (item->native))) {
+    menu_sync_connect_menu (submenu, native_submenu);
+  }
+  else { /* No submenu anywhere, so create one */
+    /* The menu keeps its own reference to the string */
+    MenuTitle *title = menu_title_ref (get_menu_label_text (widget, &label),
+				       &menu_sync_backend->titles);
+
+    native_submenu = menu_sync_backend->menu_new (title);
+    menu_title_unref (title);
+
+    menu_sync_connect_menu (submenu, native_submenu);
+    if (menu_state_get_lazy_submenus ())
+      menu_sync_defer_menu (submenu, native_submenu);
+
+    /* Connect the new menu to the passed-in item (which lives in the
+       parent menu). This drops any pre-existing submenu. */
+    menu_sync_backend->item_set_submenu (item->native, native_submenu);
+    /* The shell and the item hold it now */
+    menu_sync_backend->menu_unref (native_submenu);
+  }
+  /* And push the GTK menu into the submenu (unless it's deferred
+     until it's opened) */
+  menu_sync_shell (submenu, native_submenu, FALSE);
+}
+
+static void
+menu_sync_item_update_label (MenuSyncItem *item, GtkWidget *widget)
+{
+  g_return_if_fail (item != NULL);
+  g_return_if_fail (widget != NULL);
+
+  menu_stats_get ()->native_updates++;
+  menu_sync_item_set_title (item, get_menu_label_text (widget, NULL));
+}
+
+/*
+ * menu_sync_item_update_accelerator:
+ * @item: A mirrored item
+ *
+ * Show the shortcut of @item's accel closure as its key equivalent.
+ *
+ * Important note: this doesn't do anything to actually change key
+ * handling. Its goal is to get the native menu to display the
+ * correct accelerator as part of a menu item. Actual accelerator
+ * handling depends on gtk_osxapplication_use_quartz_accelerators, so
+ * this is more cosmetic than it may appear.
+ */
+static void
+menu_sync_item_update_accelerator (MenuSyncItem *item, GtkWidget *widget)
+{
+  GClosure *closure = item->accel_closure;
+
+  menu_stats_get ()->native_updates++;
+  if (closure) {
+    GtkAccelKey *key = menu_accel_lookup (closure);
+
+    if (key            &&
+	key->accel_key &&
+	key->accel_flags & GTK_ACCEL_VISIBLE) {
+      GObject *scope = menu_shortcut_get_scope (widget);
+      const MenuShortcut *shortcut;
+
+      /* Moved to another menubar */
+      if (item->shortcut_scope != scope) {
+	menu_sync_item_unregister_shortcut (item);
+	item->shortcut_scope = scope;
+	g_object_add_weak_pointer (scope, (gpointer*) &item->shortcut_scope);
+      }
+      shortcut = menu_shortcut_register (closure, widget, scope,
+					 key->accel_key,
+					 key->accel_mods,
+					 menu_shortcut_quartz_modifiers);
+      /* Either the key can't be a key equivalent, or another item
+	 earlier in the menus has the same shortcut. */
+      if (shortcut->key_equivalent == 0 || shortcut->owner != closure)
+	menu_sync_backend->item_set_key_equivalent (item->native, 0, 0);
+      else
+	menu_sync_backend->item_set_key_equivalent (item->native,
+						    shortcut->key_equivalent,
+						    shortcut->modifiers);
+      return;
+    }
+    menu_sync_item_unregister_shortcut (item);
+  }
+
+  /*  otherwise, clear the menu shortcut  */
+  menu_sync_backend->item_set_key_equivalent (item->native, 0, 0);
+}
+
+static void menu_sync_item_flush_updates (GtkWidget       *menu_item,
+					  MenuUpdateFlags  flags);
+
+/*
+ * The MenuAccelFunc: the accelerator shown by @widget's accel label
+ * has changed.
+ */
+static void
+menu_sync_item_accel_changed (GtkWidget *widget)
+{
+  menu_trace_accel (widget);
+  menu_update_queue (widget, MENU_UPDATE_ACCEL,
+		     menu_sync_item_flush_updates);
+}
+
+static void
+menu_sync_item_update_accel_closure (MenuSyncItem *item, GtkWidget *widget)
+{
+  GtkWidget *label;
+
+  get_menu_label_text (widget, &label);
+
+  if (item->accel_closure) {
+    menu_sync_item_unregister_shortcut (item);
+    g_closure_unref (item->accel_closure);
+    item->accel_closure = NULL;
+  }
+
+  /* The getter hands us a reference */
+  if (GTK_IS_ACCEL_LABEL (label))
+    g_object_get (label, "accel-closure", &item->accel_closure, NULL);
+
+  /* One accel-changed handler per group finds us by closure */
+  menu_accel_watch (widget, item->accel_closure,
+		    menu_sync_item_accel_changed);
+
+  menu_sync_item_update_accelerator (item, widget);
+}
+
+/*
+ * menu_sync_item_flush_updates:
+ * @menu_item: A GtkMenuItem with queued updates
+ * @flags: The updates
+ *
+ * The MenuUpdateFlushFunc for menu_update_queue().
+ */
+static void
+menu_sync_item_flush_updates (GtkWidget       *menu_item,
+			      MenuUpdateFlags  flags)
+{
+  MenuSyncItem *item = menu_sync_item_lookup (menu_item);
+
+  /* It may have been disconnected since */
+  if (!item)
+    return;
+
+  if (flags & MENU_UPDATE_STATE)
+    menu_sync_item_update_state (item, menu_item);
+  if (flags & MENU_UPDATE_CHECKED)
+    menu_sync_item_update_checked (item, menu_item);
+  if (flags & MENU_UPDATE_LABEL)
+    menu_sync_item_update_label (item, menu_item);
+  if (flags & MENU_UPDATE_ACCEL_CLOSURE)
+    menu_sync_item_update_accel_closure (item, menu_item);
+  else if (flags & MENU_UPDATE_ACCEL)
+    menu_sync_item_update_accelerator (item, menu_item);
+}
+
+/* The other properties are watched by menu_update_watch() */
+static void
+menu_sync_item_notify_submenu (GObject    *object,
+			       GParamSpec *pspec,
+			       gpointer    data)
+{
+  GtkWidget *parent = gtk_widget_get_parent (GTK_WIDGET (object));
+  MenuSyncItem *item = menu_sync_item_lookup (GTK_WIDGET (object));
+
+  menu_stats_get ()->notifies_received++;
+  if (menu_state_is_frozen ()) {
+    /* The parent's reconcile on thaw will pick it up */
+    if (GTK_IS_MENU_SHELL (parent))
+      menu_state_record_frozen (parent);
+    return;
+  }
+  if (GTK_IS_MENU_SHELL (parent))
+    menu_shell_mark_dirty (parent);
+  if (item)
+    menu_sync_item_update_submenu (item, GTK_WIDGET (object));
+}
+
+/*
+ * menu_sync_item_connect:
+ * @menu_item: A GtkMenuItem
+ * @item: Its new native item, which @menu_item takes over
+ * @label: @menu_item's label
+ *
+ * Attach @item to @menu_item, dropping any item it had before, and
+ * watch @menu_item for changes.
+ */
+static void
+menu_sync_item_connect (GtkWidget    *menu_item,
+			MenuSyncItem *item,
+			GtkWidget    *label)
+{
+  MenuSyncItem *old_item = menu_sync_item_lookup (menu_item);
+
+  if (old_item == item)
+    return;
+
+  if (menu_sync_item_quark == 0)
+    menu_sync_item_quark = g_quark_from_static_string ("MenuSyncItem");
+
+  g_object_set_qdata_full (G_OBJECT (menu_item), menu_sync_item_quark,
+			   item, menu_sync_item_free);
+
+  /* The handler finds the item itself, so one is enough */
+  if (!old_item)
+    g_signal_connect (menu_item, "notify::submenu",
+		      G_CALLBACK (menu_sync_item_notify_submenu), NULL);
+  menu_update_watch (menu_item, label, menu_sync_item_flush_updates);
+}
+
+static void
+menu_sync_item_sync (GtkWidget *menu_item)
+{
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  MenuSyncItem *item = menu_sync_item_lookup (menu_item);
+
+  stats->items_visited++;
+  stats->last_sync_items_visited++;
+  item->removed = FALSE;
+  /* Everything but the label is brought up to date here, so most of
+     what's queued for this item would be redundant. */
+  if (menu_update_take (menu_item) & MENU_UPDATE_LABEL)
+    menu_sync_item_update_label (item, menu_item);
+  menu_sync_item_update_state (item, menu_item);
+
+  if (GTK_IS_CHECK_MENU_ITEM (menu_item))
+    menu_sync_item_update_checked (item, menu_item);
+
+  if (!GTK_IS_SEPARATOR_MENU_ITEM (menu_item))
+    menu_sync_item_update_accel_closure (item, menu_item);
+
+  if (gtk_menu_item_get_submenu (GTK_MENU_ITEM (menu_item)) ||
+      menu_sync_backend->item_get_submenu (item->native))
+    menu_sync_item_update_submenu (item, menu_item);
+}
+
+/* The closure a native item invokes to activate @menu_item */
+static GClosure *
+menu_sync_item_action_new (GtkWidget *menu_item)
+{
+  GClosure *menu_action =
+    g_cclosure_new_object_swap (G_CALLBACK (gtk_menu_item_activate),
+				G_OBJECT (menu_item));
+  g_closure_set_marshal (menu_action, g_cclosure_marshal_VOID__VOID);
+  return menu_action;
+}
+
+/*
+ * menu_sync_item_disconnect:
+ * @menu_item: A mirrored GtkMenuItem
+ *
+ * Undo menu_sync_item_connect() and everything the syncs since have
+ * hooked up, for when the native item is being handed to another
+ * item.
+ *
+ * Returns: The item, which the caller now owns.
+ */
+static MenuSyncItem *
+menu_sync_item_disconnect (GtkWidget *menu_item)
+{
+  MenuSyncItem *item = menu_sync_item_lookup (menu_item);
+  GtkWidget *label = NULL;
+
+  get_menu_label_text (menu_item, &label);
+  g_signal_handlers_disconnect_by_func (menu_item,
+					menu_sync_item_notify_submenu,
+					NULL);
+  menu_update_unwatch (menu_item, label);
+  menu_update_take (menu_item);
+  if (!menu_sync_backend->item_is_separator (item->native)) {
+    menu_accel_watch (menu_item, NULL, menu_sync_item_accel_changed);
+    /* Otherwise the new item's closure would conflict with it */
+    menu_sync_item_unregister_shortcut (item);
+  }
+  return g_object_steal_qdata (G_OBJECT (menu_item), menu_sync_item_quark);
+}
+
+/*
+ * menu_sync_item_new:
+ * @menu_item: The GtkMenuItem to mirror
+ *
+ * Create a native item (or a separator) for @menu_item and connect
+ * the two, but don't put it in a menu.
+ *
+ * Returns: The new item, owned by @menu_item.
+ */
+static gpointer
+menu_sync_item_new (GtkWidget *menu_item)
+{
+  MenuSyncItem *item = g_slice_new0 (MenuSyncItem);
+  GtkWidget *label = NULL;
+
+  if (GTK_IS_SEPARATOR_MENU_ITEM (menu_item)) {
+    item->native = menu_sync_backend->separator_new ();
+    DEBUG ("\ta separator\n");
+  } else {
+    const gchar *label_text = get_menu_label_text (menu_item, &label);
+
+    item->title = menu_title_ref (label_text, &menu_sync_backend->titles);
+    item->native =
+      menu_sync_backend->item_new (item->title,
+				   menu_sync_item_action_new (menu_item));
+    DEBUG ("\tan item\n");
+  }
+  /* Connect the GtkMenuItem and the native item so that we can notice
+     changes to accel/label/submenu etc. */
+  menu_sync_item_connect (menu_item, item, label);
+  return item->native;
+}
+
+/*
+ * menu_sync_add_item:
+ * @menu: A native menu
+ * @menu_item: A GtkMenuItem to mirror in it
+ * @index: Where to put it, or -1 for the end
+ *
+ * Mirror @menu_item in @menu, which needn't mirror its parent; this
+ * is how items are put in the application menu. Any native item
+ * @menu_item had before is replaced.
+ */
+void
+menu_sync_add_item (gpointer menu, GtkWidget *menu_item, gint index)
+{
+  gpointer native = menu_sync_get_item (menu_item);
+
+  DEBUG ("add %s separator ? %d\n",
+	 get_menu_label_text (menu_item, NULL),
+	 GTK_IS_SEPARATOR_MENU_ITEM (menu_item));
+
+  if (native) {
+    DEBUG ("\tItem exists\n");
+    menu_sync_backend->item_remove_from_menu (native,
+					      menu_sync_backend->item_get_menu (native));
+  }
+
+  native = menu_sync_item_new (menu_item);
+
+  if (index >= 0 && index < (gint) menu_sync_backend->menu_n_items (menu))
+    menu_sync_backend->menu_insert (menu, native, index);
+  else
+    menu_sync_backend->menu_insert (menu, native,
+				    menu_sync_backend->menu_n_items (menu));
+
+  menu_sync_item_sync (menu_item);
+}
+
+/*
+ * The native side of menu_diff_apply(). Detached items are about to
+ * be re-inserted by a move, so hold on to them in between.
+ */
+static void
+menu_sync_diff_remove (gpointer menu, gpointer key, guint index,
+		       gboolean detach)
+{
+  if (detach)
+    menu_sync_backend->item_ref (key);
+  menu_sync_backend->menu_remove (menu, index);
+}
+
+static void
+menu_sync_diff_insert (gpointer menu, gpointer key, guint index,
+		       gboolean moved)
+{
+  menu_sync_backend->menu_insert (menu, key, index);
+  if (moved)
+    menu_sync_backend->item_unref (key);
+}
+
+static const MenuDiffFuncs menu_sync_diff_funcs = {
+  menu_sync_diff_remove,
+  menu_sync_diff_insert
+};
+
+static void
+wanted_append (GPtrArray *wanted, GHashTable *wanted_set, gpointer item)
+{
+  g_ptr_array_add (wanted, item);
+  g_hash_table_insert (wanted_set, item, item);
+}
+
+typedef struct {
+  gpointer menu;
+  gpointer window_item;
+  gpointer help_item;
+} IndexContext;
+
+/*
+ * The MenuIndexMirroredFunc. The Window and Help menus are left out
+ * because they're always at the end of the menubar, wherever their
+ * GtkMenuItems are.
+ */
+static gboolean
+menu_sync_is_mirrored (GtkWidget *menu_item, gpointer data)
+{
+  IndexContext *context = (IndexContext*) data;
+  gpointer native = menu_sync_get_item (menu_item);
+
+  return (native &&
+	  menu_sync_backend->item_get_menu (native) == context->menu &&
+	  native != context->window_item &&
+	  native != context->help_item);
+}
+
+/*
+ * menu_sync_submenu_is_complete:
+ * @menu_item: A GtkMenuItem which has just been synced
+ *
+ * Returns: FALSE if @menu_item's submenu was only marked reconciled,
+ * so the shell holding @menu_item can't be marked synced either.
+ */
+static gboolean
+menu_sync_submenu_is_complete (GtkWidget *menu_item)
+{
+  GtkWidget *submenu = GTK_IS_MENU_ITEM (menu_item) ?
+    gtk_menu_item_get_submenu (GTK_MENU_ITEM (menu_item)) : NULL;
+
+  return !submenu || !menu_shell_state_get (submenu)->incomplete;
+}
+
+/*
+ * menu_sync_reconcile:
+ * @menu_shell: The GtkMenuShell to mirror
+ * @menu: The native menu mirroring it
+ * @toplevel: Whether @menu is the menubar, whose 0th item is the app
+ * menu
+ *
+ * Bring @menu into line with @menu_shell. We work out what the native
+ * menu ought to contain, let menu_diff compute the fewest removes,
+ * inserts, and moves to get it there, play those back, and then sync
+ * each item's state.
+ *
+ * Returns: FALSE if an item with a submenu was passed over, so that
+ * its submenu wasn't synced, or a submenu is itself incomplete.
+ */
+static gboolean
+menu_sync_reconcile (GtkWidget *menu_shell,
+		     gpointer   menu,
+		     gboolean   toplevel)
+{
+  const MenuBackend *backend = menu_sync_backend;
+  gpointer app_item = NULL, window_item = NULL, help_item = NULL;
+  gboolean have_window = FALSE, have_help = FALSE;
+  GPtrArray *current, *wanted, *synced;
+  GHashTable *wanted_set;
+  GList *children;
+  GList *l;
+  GArray *script;
+  guint index, count, n_submenus = 0, n_reached = 0;
+  gboolean complete;
+  IndexContext context;
+
+  if (GTK_IS_MENU_BAR (menu_shell))
+    backend->menubar_special (menu, &app_item, &window_item, &help_item);
+
+  count = backend->menu_n_items (menu);
+  current = g_ptr_array_sized_new (count);
+  for (index = 0; index < count; index++)
+    g_ptr_array_add (current, backend->menu_item_at (menu, index));
+
+  wanted = g_ptr_array_sized_new (count + 1);
+  wanted_set = g_hash_table_new (NULL, NULL);
+  synced = g_ptr_array_new ();
+
+  if (toplevel && count > 0)
+    //Keep the 0th menu item on the menu bar
+    wanted_append (wanted, wanted_set, g_ptr_array_index (current, 0));
+
+  /* Now iterate over the menu shell and work out what it wants */
+  children = gtk_container_get_children (GTK_CONTAINER (menu_shell));
+  for (l = children; l; l = l->next) {
+    GtkWidget *menu_item = (GtkWidget*) l->data;
+    gpointer native = menu_sync_get_item (menu_item);
+    gpointer native_menu = native ? backend->item_get_menu (native) : NULL;
+    gboolean has_submenu = (GTK_IS_MENU_ITEM (menu_item) &&
+			    gtk_menu_item_get_submenu (GTK_MENU_ITEM (menu_item)));
+
+    if (has_submenu)
+      n_submenus++;
+    if (native_menu && native_menu != menu)
+      /* This item has been moved to another menu; skip it */
+      continue;
+    if (menu_sync_item_is_hidden_away (menu_item, native))
+      /* Emulated hiding on 10.4 takes the item out of the menu; it
+	 will put itself back when it's shown again. */
+      continue;
+    /* These hold whether or not the item was mirrored somewhere
+       else before */
+    if (GTK_IS_SEPARATOR_MENU_ITEM (menu_item) && GTK_IS_MENU_BAR (menu_shell))
+      /* Don't want separators on the menubar */
+      continue;
+
+    if (GTK_IS_TEAROFF_MENU_ITEM (menu_item))
+      /*Don't want tearoff items at all */
+      continue;
+
+    if (g_object_get_data (G_OBJECT (menu_item), "gtk-empty-menu-item"))
+      /* Nor blank items. */
+      continue;
+
+    if (!native)
+      /*OK, this must be a new one. Make it. */
+      native = menu_sync_item_new (menu_item);
+    g_ptr_array_add (synced, menu_item);
+    if (has_submenu)
+      n_reached++;
+    /* The Window and Help menus go at the end, below */
+    if (native == window_item) {
+      have_window = TRUE;
+      continue;
+    }
+    if (native == help_item) {
+      have_help = TRUE;
+      continue;
+    }
+    if (!g_hash_table_lookup (wanted_set, native))
+      wanted_append (wanted, wanted_set, native);
+  }
+
+  /* Keep the items that didn't come from the menu shell: the app,
+     window, and help menus if we made them, and anything that the
+     platform put there itself, like the window list on the Window
+     menu. */
+  for (index = 0; index < count; index++) {
+    gpointer item = g_ptr_array_index (current, index);
+    if (item == window_item) {
+      have_window = TRUE;
+      continue;
+    }
+    if (item == help_item) {
+      have_help = TRUE;
+      continue;
+    }
+    if (g_hash_table_lookup (wanted_set, item))
+      continue;
+    if (item == app_item || !backend->item_is_mirror (item))
+      wanted_append (wanted, wanted_set, item);
+  }
+  if (have_window)
+    wanted_append (wanted, wanted_set, window_item);
+  if (have_help)
+    wanted_append (wanted, wanted_set, help_item);
+
+  script = menu_diff_compute (current->pdata, current->len,
+			      wanted->pdata, wanted->len);
+  menu_diff_apply (script, &menu_sync_diff_funcs, menu);
+  DEBUG ("%d items, %d edits\n", wanted->len, script->len);
+
+  complete = n_reached == n_submenus;
+  for (index = 0; index < synced->len; index++) {
+    GtkWidget *menu_item = g_ptr_array_index (synced, index);
+
+    menu_sync_item_sync (menu_item);
+    if (!menu_sync_submenu_is_complete (menu_item))
+      complete = FALSE;
+  }
+
+  context.menu = menu;
+  context.window_item = window_item;
+  context.help_item = help_item;
+  menu_index_rebuild (menu_shell, children, menu_sync_is_mirrored, &context,
+		      toplevel && count > 0 ? 1 : 0);
+  g_list_free (children);
+
+  g_array_free (script, TRUE);
+  g_ptr_array_free (current, TRUE);
+  g_ptr_array_free (wanted, TRUE);
+  g_ptr_array_free (synced, TRUE);
+  g_hash_table_destroy (wanted_set);
+  return complete;
+}
+
+/*
+ * menu_sync_submenus:
+ * @menu_shell: A GtkMenuShell whose own items are up to date
+ *
+ * Descend into the submenus of @menu_shell's items without touching
+ * the items themselves. Submenus with nothing changed beneath them
+ * return straight away.
+ *
+ * Returns: FALSE if an item with a submenu isn't mirrored, so that
+ * its submenu couldn't be synced, or a submenu is itself incomplete.
+ */
+static gboolean
+menu_sync_submenus (GtkWidget *menu_shell)
+{
+  GList *children, *l;
+  gboolean complete = TRUE;
+
+  children = gtk_container_get_children (GTK_CONTAINER (menu_shell));
+  for (l = children; l; l = l->next) {
+    GtkWidget *menu_item = (GtkWidget*) l->data;
+    MenuSyncItem *item;
+
+    if (!GTK_IS_MENU_ITEM (menu_item) ||
+	!gtk_menu_item_get_submenu (GTK_MENU_ITEM (menu_item)))
+      continue;
+    item = menu_sync_item_lookup (menu_item);
+    if (item)
+      menu_sync_item_update_submenu (item, menu_item);
+    if (!item || !menu_sync_submenu_is_complete (menu_item))
+      complete = FALSE;
+  }
+  g_list_free (children);
+  return complete;
+}
+
+/*
+ * menu_sync_shell:
+ * @menu_shell: The GtkMenuShell to mirror
+ * @menu: The native menu mirroring it
+ * @toplevel: Whether @menu is the menubar, whose 0th item is the app
+ * menu
+ *
+ * Sync @menu and the native menus below it with @menu_shell and its
+ * submenus. Only the shells that have changed since they were last
+ * synced (see menu_state.h) are reconciled, and subtrees in which
+ * nothing has changed aren't visited at all.
+ *
+ * With a sync budget, the sync is a slice of work which stops going
+ * into submenus once the budget has run out, postponing them (see
+ * menu_sync_postpone()) for pre-warming to finish in later main loop
+ * iterations, or the user to open. @menu_shell itself is always
+ * synced.
+ *
+ * A submenu below an item which isn't mirrored (one whose native item
+ * is still in another menu, say) can't be reached, so a shell with
+ * one is only marked reconciled, not synced, and the next sync comes
+ * back to it. Deferred and postponed submenus don't count: they're
+ * built when they're opened or pre-warmed.
+ */
+void
+menu_sync_shell (GtkWidget *menu_shell,
+		 gpointer   menu,
+		 gboolean   toplevel)
+{
+  static guint depth = 0;
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  gboolean complete;
+
+  if (depth == 0) {
+    stats->syncs++;
+    stats->last_sync_shells_visited = 0;
+    stats->last_sync_items_visited = 0;
+  }
+  if (menu_shell_state_get (menu_shell)->deferred ||
+      !menu_shell_needs_sync (menu_shell, menu))
+    return;
+  /* The shell we were asked for is always done, so that each slice
+     gets somewhere; it's the ones below that wait. */
+  if (depth > 0 && menu_state_slice_expired ()) {
+    menu_sync_postpone (menu_shell, menu);
+    return;
+  }
+
+  if (depth == 0)
+    menu_state_begin_slice ();
+  ++depth;
+  stats->shells_visited++;
+  stats->last_sync_shells_visited++;
+  if (menu_shell_is_dirty (menu_shell, menu))
+    complete = menu_sync_reconcile (menu_shell, menu, toplevel);
+  else
+    complete = menu_sync_submenus (menu_shell);
+  if (complete)
+    menu_shell_mark_synced (menu_shell, menu);
+  else
+    menu_shell_mark_reconciled (menu_shell, menu);
+  if (--depth == 0)
+    menu_state_end_slice ();
+}
+
+/*
+ * menu_sync_move_to:
+ * @menu: A native menu
+ * @item: One of its items
+ * @index: Where @item ought to be, once it's been taken out
+ */
+static void
+menu_sync_move_to (gpointer menu, gpointer item, guint index)
+{
+  const MenuBackend *backend = menu_sync_backend;
+
+  backend->item_ref (item);
+  backend->menu_remove (menu, backend->menu_index_of (menu, item));
+  backend->menu_insert (menu, item, index);
+  backend->item_unref (item);
+}
+
+/*
+ * menu_sync_menubar:
+ * @menubar: A GtkMenuBar
+ * @menu: The native menubar mirroring it
+ *
+ * Sync @menu with @menubar, as menu_sync_shell() does, and then make
+ * sure that the Help menu is last and the Window menu next to last.
+ */
+void
+menu_sync_menubar (GtkWidget *menubar, gpointer menu)
+{
+  const MenuBackend *backend = menu_sync_backend;
+  gpointer app_item = NULL, window_item = NULL, help_item = NULL;
+  guint n;
+
+  menu_sync_shell (menubar, menu, TRUE);
+  if (!backend->menubar_special (menu, &app_item, &window_item, &help_item))
+    return;
+
+  n = backend->menu_n_items (menu);
+  if (help_item &&
+      backend->item_get_menu (help_item) == menu &&
+      backend->menu_index_of (menu, help_item) < (gint) n - 1)
+    menu_sync_move_to (menu, help_item, n - 1);
+  if (window_item && n >= 2 &&
+      backend->item_get_menu (window_item) == menu &&
+      backend->menu_index_of (menu, window_item) != (gint) n - 2)
+    menu_sync_move_to (menu, window_item, n - 2);
+}
+
+/*
+ * menu_sync_insert_child:
+ * @menu_shell: A mirrored GtkMenuShell
+ * @menu: The native menu mirroring it
+ * @menu_item: An item just added to @menu_shell
+ * @position: Where it was added, or -1 for the end
+ *
+ * Put @menu_item straight into @menu at the right place, using
+ * @menu_shell's index (see menu_index.h). That only works if the
+ * menu was in sync before @menu_item arrived, and we check that the
+ * item we're going after really is where the index thinks it is, so
+ * an index which has got out of step is noticed and dropped.
+ *
+ * Returns: TRUE if it worked, FALSE if the menu needs a full sync.
+ */
+gboolean
+menu_sync_insert_child (GtkWidget *menu_shell,
+			gpointer   menu,
+			GtkWidget *menu_item,
+			gint       position)
+{
+  const MenuBackend *backend = menu_sync_backend;
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  GtkWidget *previous;
+  gpointer native = menu_sync_get_item (menu_item);
+  gpointer native_menu = native ? backend->item_get_menu (native) : NULL;
+  gpointer previous_item;
+  gpointer app_item = NULL, window_item = NULL, help_item = NULL;
+  gboolean mirrored = TRUE;
+  gint index;
+
+  if (menu_shell_state_get (menu_shell)->deferred ||
+      menu_shell_is_dirty (menu_shell, menu))
+    return FALSE;
+
+  backend->menubar_special (menu, &app_item, &window_item, &help_item);
+  if (native && (native == window_item || native == help_item))
+    /* These have to go at the end */
+    goto fallback;
+
+  /* The same tests as menu_sync_reconcile() makes */
+  if (native && native_menu == menu)
+    goto fallback;
+  if (native_menu || menu_sync_item_is_hidden_away (menu_item, native))
+    mirrored = FALSE;
+  else if ((GTK_IS_SEPARATOR_MENU_ITEM (menu_item) &&
+	    GTK_IS_MENU_BAR (menu_shell)) ||
+	   GTK_IS_TEAROFF_MENU_ITEM (menu_item) ||
+	   g_object_get_data (G_OBJECT (menu_item), "gtk-empty-menu-item"))
+    mirrored = FALSE;
+
+  index = menu_index_insert (menu_shell, menu_item, position, mirrored,
+			     &previous);
+  if (index < 0)
+    goto fallback;
+  if (!mirrored)
+    return TRUE;
+
+  /* The Window and Help menus may have been designated since the
+     index was built, so don't go after those either. */
+  previous_item = previous ? menu_sync_get_item (previous) : NULL;
+  if (index > (gint) backend->menu_n_items (menu) ||
+      (previous_item &&
+       (previous_item == window_item || previous_item == help_item)) ||
+      (previous &&
+       (index == 0 ||
+	backend->menu_item_at (menu, index - 1) != previous_item))) {
+    DEBUG ("index out of step at %d\n", index);
+    menu_index_invalidate (menu_shell);
+    goto fallback;
+  }
+
+  if (!native)
+    native = menu_sync_item_new (menu_item);
+  backend->menu_insert (menu, native, index);
+  menu_sync_item_sync (menu_item);
+  stats->items_inserted_in_place++;
+  return TRUE;
+
+ fallback:
+  stats->insert_fallbacks++;
+  return FALSE;
+}
+
+/*
+ * menu_sync_remove_child:
+ * @menu_shell: A mirrored GtkMenuShell
+ * @menu: The native menu mirroring it
+ * @menu_item: An item just removed from @menu_shell
+ *
+ * Take @menu_item's native item out of @menu.
+ *
+ * Returns: TRUE if @menu is still in sync, FALSE if it wasn't to
+ * begin with.
+ */
+gboolean
+menu_sync_remove_child (GtkWidget *menu_shell,
+			gpointer   menu,
+			GtkWidget *menu_item)
+{
+  MenuSyncItem *item = menu_sync_item_lookup (menu_item);
+
+  if (item) {
+    menu_sync_backend->item_remove_from_menu (item->native, menu);
+    item->removed = TRUE;
+  }
+  menu_index_remove (menu_shell, menu_item);
+  return !menu_shell_is_dirty (menu_shell, menu);
+}
+
+/*
+ * menu_sync_menu_will_open:
+ * @menu_shell: The GtkMenuShell whose native menu is about to be shown
+ *
+ * Called by the backend when a native menu is about to open (or be
+ * searched for a key equivalent). A deferred submenu is built now,
+ * for the first time; after that it's kept in sync like any other,
+ * and this just catches up on anything outstanding.
+ */
+void
+menu_sync_menu_will_open (GtkWidget *menu_shell)
+{
+  gpointer menu = menu_sync_get_menu (menu_shell);
+  MenuShellState *state = menu_shell_state_get (menu_shell);
+
+  g_return_if_fail (menu != NULL);
+
+  menu_trace_menu_open (menu_shell);
+  if (state->deferred) {
+    DEBUG ("materializing %p\n", menu);
+    menu_shell_set_deferred (menu_shell, FALSE);
+    menu_stats_get ()->submenus_materialized++;
+  }
+  menu_sync_shell (menu_shell, menu, FALSE);
+}
+
+/*
+ * menu_sync_warm:
+ * @menu_shell: A mirrored submenu
+ *
+ * Sync @menu_shell, and build it and any submenus below it which are
+ * still deferred.
+ *
+ * Returns: TRUE if there was anything to do.
+ */
+static gboolean
+menu_sync_warm (GtkWidget *menu_shell)
+{
+  gpointer menu = menu_sync_get_menu (menu_shell);
+  gboolean worked = FALSE;
+  GList *children, *l;
+
+  if (!menu)
+    return FALSE;
+  if (menu_shell_state_get (menu_shell)->deferred) {
+    menu_sync_menu_will_open (menu_shell);
+    worked = TRUE;
+  }
+  else if (menu_shell_needs_sync (menu_shell, menu)) {
+    gboolean changed = menu_shell_has_changed (menu_shell, menu);
+
+    menu_sync_shell (menu_shell, menu, FALSE);
+    /* A shell left incomplete only counts if it had changed, or
+       pre-warming would come back to it forever */
+    worked = changed || !menu_shell_needs_sync (menu_shell, menu);
+  }
+  /* The sync has done everything else below here */
+  if (menu_state_n_deferred () == 0)
+    return worked;
+
+  children = gtk_container_get_children (GTK_CONTAINER (menu_shell));
+  for (l = children; l; l = l->next) {
+    GtkWidget *submenu = GTK_IS_MENU_ITEM (l->data) ?
+      gtk_menu_item_get_submenu (GTK_MENU_ITEM (l->data)) : NULL;
+
+    if (submenu && menu_sync_warm (submenu))
+      worked = TRUE;
+    /* Having got somewhere, leave the rest for the next pass if the
+       slice is used up */
+    if (worked && menu_state_slice_expired ())
+      break;
+  }
+  g_list_free (children);
+  return worked;
+}
+
+/*
+ * menu_sync_prewarm:
+ * @menubar: A GtkMenuBar
+ * @menu_item: One of its items, or NULL
+ *
+ * The MenuPrewarmFunc: bring @menu_item's submenu up to date,
+ * building it if it's deferred, or if @menu_item is NULL, the
+ * menubar's own items. Menubars which aren't mirrored (those of the
+ * windows in a shared group which don't have the native menubar) are
+ * passed over.
+ *
+ * Returns: TRUE if there was anything to do.
+ */
+gboolean
+menu_sync_prewarm (GtkWidget *menubar, GtkWidget *menu_item)
+{
+  gpointer menu = menu_sync_get_menu (menubar);
+  GtkWidget *submenu;
+  gboolean changed;
+
+  if (!menu)
+    return FALSE;
+  if (menu_item) {
+    submenu = GTK_IS_MENU_ITEM (menu_item) ?
+      gtk_menu_item_get_submenu (GTK_MENU_ITEM (menu_item)) : NULL;
+    return submenu && menu_sync_warm (submenu);
+  }
+
+  if (!menu_shell_needs_sync (menubar, menu))
+    return FALSE;
+  changed = menu_shell_has_changed (menubar, menu);
+  menu_sync_menubar (menubar, menu);
+  return changed || !menu_shell_needs_sync (menubar, menu);
+}
+
+/*
+ * The MenuShareFuncs for handing a shared menubar's native items over
+ * from one window's GtkMenuBar to another's. @data collects the
+ * shells which will need a sync afterwards.
+ */
+static void
+menu_sync_rebind (GtkWidget *from, GtkWidget *to, gpointer data)
+{
+  MenuSyncItem *item = menu_sync_item_lookup (from);
+  GtkWidget *label = NULL;
+
+  if (!item || menu_sync_get_item (to))
+    return;
+
+  item = menu_sync_item_disconnect (from);
+  if (!menu_sync_backend->item_is_separator (item->native))
+    menu_sync_backend->item_set_action (item->native,
+					menu_sync_item_action_new (to));
+  get_menu_label_text (to, &label);
+  menu_sync_item_connect (to, item, label);
+
+  /* The sync leaves the label alone unless it's been changed, but
+     the two windows may well differ there */
+  menu_sync_item_update_label (item, to);
+  menu_sync_item_sync (to);
+  menu_stats_get ()->shared_items_rebound++;
+}
+
+static void menu_sync_release_shell (GtkWidget *menu_shell);
+
+/*
+ * menu_sync_release_item:
+ * @menu_item: An item of a menubar which has lost its native menubar
+ *
+ * Let go of @menu_item's native item, if it still has one, and those
+ * of the submenu beneath it. The native items are left where they
+ * are, for the next sync of the menus they're in to take out.
+ */
+static void
+menu_sync_release_item (GtkWidget *menu_item)
+{
+  GtkWidget *submenu;
+
+  if (menu_sync_item_lookup (menu_item))
+    menu_sync_item_free (menu_sync_item_disconnect (menu_item));
+  submenu = GTK_IS_MENU_ITEM (menu_item) ?
+    gtk_menu_item_get_submenu (GTK_MENU_ITEM (menu_item)) : NULL;
+  if (submenu && menu_sync_get_menu (submenu))
+    menu_sync_release_shell (submenu);
+}
+
+static void
+menu_sync_release_shell (GtkWidget *menu_shell)
+{
+  GList *children, *l;
+
+  children = gtk_container_get_children (GTK_CONTAINER (menu_shell));
+  for (l = children; l; l = l->next)
+    menu_sync_release_item ((GtkWidget*) l->data);
+  g_list_free (children);
+  menu_sync_disconnect_menu (menu_shell);
+  menu_index_invalidate (menu_shell);
+}
+
+static void
+menu_sync_rebind_shell (GtkWidget *from, GtkWidget *to,
+			gboolean complete, gpointer data)
+{
+  GSList **dirty = (GSList**) data;
+  gpointer menu = menu_sync_get_menu (from);
+  gboolean deferred;
+  GList *children, *l;
+
+  if (!menu || menu_sync_get_menu (to))
+    return;
+
+  deferred = menu_shell_state_get (from)->deferred;
+  complete = complete && !menu_shell_is_dirty (from, menu);
+  menu_sync_backend->menu_ref (menu);
+  menu_sync_disconnect_menu (from);
+  menu_sync_connect_menu (to, menu);
+  menu_sync_backend->menu_unref (menu);
+  menu_index_invalidate (from);
+  menu_index_invalidate (to);
+
+  /* Whatever wasn't handed over is @to's to make, and goes from the
+     native menu at its sync; @from shouldn't hold on to it */
+  if (!complete) {
+    children = gtk_container_get_children (GTK_CONTAINER (from));
+    for (l = children; l; l = l->next)
+      menu_sync_release_item ((GtkWidget*) l->data);
+    g_list_free (children);
+  }
+
+  if (deferred)
+    menu_sync_defer_menu (to, menu);
+  else if (complete)
+    menu_shell_mark_synced (to, menu);
+  else
+    *dirty = g_slist_prepend (*dirty, to);
+}
+
+static const MenuShareFuncs menu_sync_share_funcs = {
+  menu_sync_rebind,
+  menu_sync_rebind_shell
+};
+
+/*
+ * menu_sync_switch_menubar:
+ * @from: The GtkMenuBar a shared native menubar is mirroring
+ * @to: Another window's GtkMenuBar, built from the same layout
+ *
+ * Make the native menubar mirror @to instead, handing each native
+ * item over to @to's matching item (see menu_share.h) and syncing
+ * only what differs. The native items which weren't handed over are
+ * let go of, so @from is left with none.
+ */
+void
+menu_sync_switch_menubar (GtkWidget *from, GtkWidget *to)
+{
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  gpointer menu = menu_sync_get_menu (from);
+  GSList *dirty = NULL, *l;
+
+  g_return_if_fail (menu != NULL);
+
+  menu_sync_backend->menu_ref (menu);
+  menu_share_pair (from, to, &menu_sync_share_funcs, &dirty);
+
+  /* Only now, so that a shell marked synced above doesn't hide a
+     dirty one beneath it */
+  for (l = dirty; l; l = l->next)
+    menu_shell_mark_dirty ((GtkWidget*) l->data);
+  stats->shared_shells_resynced += g_slist_length (dirty);
+  stats->shared_switches++;
+  g_slist_free (dirty);
+
+  menu_sync_menubar (to, menu);
+  menu_sync_backend->menu_unref (menu);
+}
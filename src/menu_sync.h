@@ -0,0 +1,62 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __MENU_SYNC_H__
+#define __MENU_SYNC_H__
+
+#include <gtk/gtk.h>
+#include "menu_backend.h"
+
+/*
+ * The engine which mirrors GtkMenuShells into native menus: it
+ * connects each shell and item to its native counterpart, reconciles
+ * a shell's native menu with its children (menu_diff.h), keeps the
+ * items' state, labels and key equivalents up to date
+ * (menu_update.h), and hands native items between windows sharing a
+ * menubar (menu_share.h). It only touches the native menus through
+ * the MenuBackend set with menu_sync_set_backend().
+ */
+
+void menu_sync_set_backend (const MenuBackend *backend);
+const MenuBackend *menu_sync_get_backend (void);
+
+gpointer menu_sync_get_menu (GtkWidget *menu_shell);
+void menu_sync_connect_menu (GtkWidget *menu_shell, gpointer menu);
+void menu_sync_disconnect_menu (GtkWidget *menu_shell);
+void menu_sync_defer_menu (GtkWidget *menu_shell, gpointer menu);
+
+gpointer menu_sync_get_item (GtkWidget *menu_item);
+void menu_sync_add_item (gpointer menu, GtkWidget *menu_item, gint index);
+
+void menu_sync_shell (GtkWidget *menu_shell, gpointer menu,
+		      gboolean toplevel);
+void menu_sync_menubar (GtkWidget *menubar, gpointer menu);
+gboolean menu_sync_insert_child (GtkWidget *menu_shell, gpointer menu,
+				 GtkWidget *menu_item, gint position);
+gboolean menu_sync_remove_child (GtkWidget *menu_shell, gpointer menu,
+				 GtkWidget *menu_item);
+
+void menu_sync_menu_will_open (GtkWidget *menu_shell);
+gboolean menu_sync_prewarm (GtkWidget *menubar, GtkWidget *menu_item);
+void menu_sync_switch_menubar (GtkWidget *from, GtkWidget *to);
+
+#endif /* __MENU_SYNC_H__ */
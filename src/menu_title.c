@@ -0,0 +1,135 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#include <string.h>
+#include "menu_title.h"
+#include "menu_stats.h"
+
+/* Every live title by content, and by the last address it was
+   looked up with */
+static GHashTable *menu_title_by_text = NULL;
+static GHashTable *menu_title_by_address = NULL;
+static guint64 menu_title_bytes = 0;
+
+/* The size of the cache goes into the stats as it changes, rather
+   than being counted there, so that resetting them doesn't lose it */
+static void
+menu_title_update_size (void)
+{
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+
+  stats->titles_interned = g_hash_table_size (menu_title_by_text);
+  stats->title_bytes = menu_title_bytes;
+}
+
+static guint
+menu_title_hash (gconstpointer key)
+{
+  return ((const MenuTitle*) key)->hash;
+}
+
+static gboolean
+menu_title_equal (gconstpointer a, gconstpointer b)
+{
+  const MenuTitle *ta = a, *tb = b;
+
+  return ta->hash == tb->hash && !strcmp (ta->utf8, tb->utf8);
+}
+
+/*
+ * menu_title_ref:
+ * @utf8: The title's text. NULL is taken as the empty string.
+ * @funcs: Makes and frees the native string, if it has to be made
+ *
+ * Returns: The interned title for @utf8, with a new reference. Its
+ * native string is valid until the reference is dropped with
+ * menu_title_unref().
+ */
+MenuTitle *
+menu_title_ref (const gchar *utf8, const MenuTitleFuncs *funcs)
+{
+  GtkOSXApplicationMenuStats *stats = menu_stats_get ();
+  MenuTitle *title, key;
+
+  if (!utf8)
+    utf8 = "";
+  if (!menu_title_by_text) {
+    menu_title_by_text = g_hash_table_new (menu_title_hash, menu_title_equal);
+    menu_title_by_address = g_hash_table_new (NULL, NULL);
+  }
+
+  ++stats->title_lookups;
+  title = g_hash_table_lookup (menu_title_by_address, utf8);
+  if (title && !strcmp (title->utf8, utf8)) {
+    ++stats->title_address_hits;
+    ++title->ref_count;
+    return title;
+  }
+
+  key.utf8 = (gchar*) utf8;
+  key.hash = g_str_hash (utf8);
+  title = g_hash_table_lookup (menu_title_by_text, &key);
+  if (title)
+    ++stats->title_text_hits;
+  else {
+    title = g_slice_new0 (MenuTitle);
+    title->utf8 = g_strdup (utf8);
+    title->hash = key.hash;
+    title->funcs = funcs;
+    title->native = funcs->create (utf8);
+    g_hash_table_insert (menu_title_by_text, title, title);
+    ++stats->title_conversions;
+    menu_title_bytes += strlen (utf8) + 1;
+    menu_title_update_size ();
+  }
+  /* Each title has at most one address, so freeing it can clear it */
+  if (title->last_utf8 &&
+      g_hash_table_lookup (menu_title_by_address, title->last_utf8) == title)
+    g_hash_table_remove (menu_title_by_address, title->last_utf8);
+  title->last_utf8 = utf8;
+  g_hash_table_insert (menu_title_by_address, (gpointer) utf8, title);
+  ++title->ref_count;
+  return title;
+}
+
+/*
+ * menu_title_unref:
+ * @title: A title from menu_title_ref(), or NULL
+ *
+ * Drop a reference to @title, freeing it and its native string with
+ * the last one.
+ */
+void
+menu_title_unref (MenuTitle *title)
+{
+  if (!title || --title->ref_count > 0)
+    return;
+
+  g_hash_table_remove (menu_title_by_text, title);
+  if (g_hash_table_lookup (menu_title_by_address, title->last_utf8) == title)
+    g_hash_table_remove (menu_title_by_address, title->last_utf8);
+  menu_title_bytes -= strlen (title->utf8) + 1;
+  menu_title_update_size ();
+  title->funcs->destroy (title->native);
+  g_free (title->utf8);
+  g_slice_free (MenuTitle, title);
+}
@@ -0,0 +1,61 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __MENU_TITLE_H__
+#define __MENU_TITLE_H__
+
+#include <glib.h>
+
+/*
+ * Interned menu titles. The same labels turn up over and over, in
+ * every window's menubar and on every refresh, so each distinct title
+ * is converted to a native string once and shared. An entry lives as
+ * long as some native item holds a reference to it.
+ *
+ * Lookups try the address of the UTF-8 text first: a label hands out
+ * the same pointer until its text changes, so a refresh of an
+ * unchanged label finds its entry without hashing. A match there is
+ * confirmed with strcmp(), since the address may have been reused
+ * for other text. Failing that, the text is hashed and looked up by
+ * content.
+ */
+typedef struct {
+  /* Makes the native string for @utf8, owning a reference to it */
+  gpointer (*create) (const gchar *utf8);
+  /* Drops the reference create() returned */
+  void (*destroy) (gpointer native);
+} MenuTitleFuncs;
+
+typedef struct {
+  gchar *utf8;
+  guint hash;
+  guint ref_count;
+  gpointer native;
+  /* The last caller's pointer to the text, for the fast path */
+  const gchar *last_utf8;
+  const MenuTitleFuncs *funcs;
+} MenuTitle;
+
+MenuTitle *menu_title_ref (const gchar *utf8, const MenuTitleFuncs *funcs);
+void menu_title_unref (MenuTitle *title);
+
+#endif /* __MENU_TITLE_H__ */
@@ -0,0 +1,751 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "menu_trace.h"
+#include "getlabel.h"
+#include "menu_state.h"
+#include "menu_stats.h"
+#include "menu_update.h"
+
+static FILE *menu_trace_file = NULL;
+static guint64 menu_trace_last_ns = 0;
+
+/*
+ * Widget numbers are never reused, even across traces, so that a
+ * widget numbered before the current trace started can be told apart
+ * and described again.
+ */
+static GQuark menu_trace_id_quark = 0;
+static guint menu_trace_next_id = 1;
+static guint menu_trace_first_id = 1;
+
+/*
+ * Writing
+ */
+
+static void
+menu_trace_put_uint (guint64 value)
+{
+  do {
+    guchar byte = value & 0x7f;
+
+    value >>= 7;
+    putc (value ? byte | 0x80 : byte, menu_trace_file);
+  } while (value);
+}
+
+static void
+menu_trace_put_int (gint value)
+{
+  menu_trace_put_uint (value < 0 ? ((guint64) -(value + 1) << 1) | 1
+		       : (guint64) value << 1);
+}
+
+static void
+menu_trace_put_string (const gchar *string)
+{
+  gsize length = string ? strlen (string) : 0;
+
+  menu_trace_put_uint (length);
+  fwrite (string, 1, length, menu_trace_file);
+}
+
+/* Start a record of @type */
+static void
+menu_trace_begin (MenuTraceType type)
+{
+  guint64 now = menu_stats_now_ns ();
+
+  putc (type, menu_trace_file);
+  menu_trace_put_uint (now - menu_trace_last_ns);
+  menu_trace_last_ns = now;
+}
+
+/*
+ * Describing widgets
+ */
+
+static void menu_trace_item_notify (GObject *object, GParamSpec *pspec,
+				    gpointer data);
+static void menu_trace_label_notify (GObject *object, GParamSpec *pspec,
+				     GtkWidget *menu_item);
+static void menu_trace_submenu_notify (GObject *object, GParamSpec *pspec,
+				       gpointer data);
+
+static guint
+menu_trace_get_id (GtkWidget *widget)
+{
+  if (!widget || menu_trace_id_quark == 0)
+    return 0;
+  return GPOINTER_TO_UINT (g_object_get_qdata (G_OBJECT (widget),
+					       menu_trace_id_quark));
+}
+
+static gboolean
+menu_trace_find_closure (GtkAccelKey *key, GClosure *closure, gpointer data)
+{
+  return closure == data;
+}
+
+/*
+ * menu_trace_get_accel:
+ * @menu_item: A GtkMenuItem
+ * @key: Returns the key its label shows, or 0
+ * @mods: Returns the modifiers
+ *
+ * Returns: Whether @menu_item's label shows an accel closure.
+ */
+static gboolean
+menu_trace_get_accel (GtkWidget *menu_item, guint *key, guint *mods)
+{
+  GtkWidget *label = NULL;
+  GClosure *closure = NULL;
+
+  *key = *mods = 0;
+  get_menu_label_text (menu_item, &label);
+  if (GTK_IS_ACCEL_LABEL (label))
+    g_object_get (label, "accel-closure", &closure, NULL);
+  if (!closure)
+    return FALSE;
+  /* Looked up directly, as menu_accel_lookup() would start indexing
+     groups that the mirror hasn't needed yet */
+  if (gtk_accel_group_from_accel_closure (closure)) {
+    GtkAccelKey *accel_key =
+      gtk_accel_group_find (gtk_accel_group_from_accel_closure (closure),
+			    menu_trace_find_closure, closure);
+
+    if (accel_key && accel_key->accel_flags & GTK_ACCEL_VISIBLE) {
+      *key = accel_key->accel_key;
+      *mods = accel_key->accel_mods;
+    }
+  }
+  g_closure_unref (closure);
+  return TRUE;
+}
+
+static guint
+menu_trace_get_state (GtkWidget *menu_item)
+{
+  guint state = 0;
+
+  if (gtk_widget_get_sensitive (menu_item))
+    state |= MENU_TRACE_SENSITIVE;
+  if (gtk_widget_get_visible (menu_item))
+    state |= MENU_TRACE_VISIBLE;
+  if (GTK_IS_CHECK_MENU_ITEM (menu_item)) {
+    if (gtk_check_menu_item_get_active (GTK_CHECK_MENU_ITEM (menu_item)))
+      state |= MENU_TRACE_ACTIVE;
+    if (gtk_check_menu_item_get_inconsistent (GTK_CHECK_MENU_ITEM (menu_item)))
+      state |= MENU_TRACE_INCONSISTENT;
+  }
+  return state;
+}
+
+static MenuTraceKind
+menu_trace_get_kind (GtkWidget *widget)
+{
+  if (GTK_IS_MENU_BAR (widget))
+    return MENU_TRACE_MENUBAR;
+  if (GTK_IS_MENU_SHELL (widget))
+    return MENU_TRACE_MENU;
+  if (GTK_IS_SEPARATOR_MENU_ITEM (widget))
+    return MENU_TRACE_SEPARATOR;
+  if (GTK_IS_TEAROFF_MENU_ITEM (widget))
+    return MENU_TRACE_TEAROFF;
+  if (GTK_IS_RADIO_MENU_ITEM (widget))
+    return MENU_TRACE_RADIO_MENU_ITEM;
+  if (GTK_IS_CHECK_MENU_ITEM (widget))
+    return MENU_TRACE_CHECK_MENU_ITEM;
+  return MENU_TRACE_MENU_ITEM;
+}
+
+/* Number @widget, and watch it if it hasn't been seen before */
+static guint
+menu_trace_new_id (GtkWidget *widget)
+{
+  guint id = menu_trace_next_id++;
+
+  if (menu_trace_id_quark == 0)
+    menu_trace_id_quark = g_quark_from_static_string ("MenuTraceId");
+  if (menu_trace_get_id (widget) == 0 && GTK_IS_MENU_ITEM (widget)) {
+    GtkWidget *label = NULL;
+    static const gchar *notifies[] = {
+      "notify::sensitive", "notify::visible",
+      "notify::active", "notify::inconsistent"
+    };
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS (notifies); i++)
+      g_signal_connect (widget, notifies[i],
+			G_CALLBACK (menu_trace_item_notify), NULL);
+    g_signal_connect (widget, "notify::submenu",
+		      G_CALLBACK (menu_trace_submenu_notify), NULL);
+    get_menu_label_text (widget, &label);
+    if (label) {
+      g_signal_connect_object (label, "notify::label",
+			       G_CALLBACK (menu_trace_label_notify),
+			       widget, 0);
+      g_signal_connect_object (label, "notify::accel-closure",
+			       G_CALLBACK (menu_trace_label_notify),
+			       widget, 0);
+    }
+  }
+  g_object_set_qdata (G_OBJECT (widget), menu_trace_id_quark,
+		      GUINT_TO_POINTER (id));
+  return id;
+}
+
+/*
+ * menu_trace_define:
+ * @widget: A menu shell or menu item, or NULL
+ * @again: Describe it and everything below it even if they've been
+ * described already
+ *
+ * Write the SHELL and ITEM records for @widget and anything below it
+ * which this trace hasn't seen, children first.
+ *
+ * Returns: @widget's number, or 0 for NULL.
+ */
+static guint
+menu_trace_define (GtkWidget *widget, gboolean again)
+{
+  guint id = menu_trace_get_id (widget);
+
+  if (!widget)
+    return 0;
+  if (id >= menu_trace_first_id && !again)
+    return id;
+  if (id < menu_trace_first_id)
+    id = menu_trace_new_id (widget);
+
+  if (GTK_IS_MENU_SHELL (widget)) {
+    GList *children = gtk_container_get_children (GTK_CONTAINER (widget));
+    GArray *ids = g_array_new (FALSE, FALSE, sizeof (guint));
+    GList *l;
+    guint i;
+
+    for (l = children; l; l = l->next)
+      if (GTK_IS_MENU_ITEM (l->data)) {
+	guint child = menu_trace_define (l->data, again);
+
+	g_array_append_val (ids, child);
+      }
+    g_list_free (children);
+    menu_trace_begin (MENU_TRACE_SHELL);
+    menu_trace_put_uint (id);
+    menu_trace_put_uint (menu_trace_get_kind (widget));
+    menu_trace_put_uint (ids->len);
+    for (i = 0; i < ids->len; i++)
+      menu_trace_put_uint (g_array_index (ids, guint, i));
+    g_array_free (ids, TRUE);
+  }
+  else if (GTK_IS_MENU_ITEM (widget)) {
+    GtkWidget *submenu = gtk_menu_item_get_submenu (GTK_MENU_ITEM (widget));
+    guint submenu_id = menu_trace_define (submenu, again);
+    guint state = menu_trace_get_state (widget), key, mods;
+
+    if (menu_trace_get_accel (widget, &key, &mods))
+      state |= MENU_TRACE_HAS_ACCEL;
+    menu_trace_begin (MENU_TRACE_ITEM);
+    menu_trace_put_uint (id);
+    menu_trace_put_uint (menu_trace_get_kind (widget));
+    menu_trace_put_uint (state);
+    menu_trace_put_string (get_menu_label_text (widget, NULL));
+    menu_trace_put_uint (key);
+    menu_trace_put_uint (mods);
+    menu_trace_put_uint (submenu_id);
+  }
+  return id;
+}
+
+/*
+ * Recording
+ */
+
+/*
+ * menu_trace_start:
+ * @file_name: Where to write the trace
+ *
+ * Start recording, replacing any trace being recorded already.
+ *
+ * Returns: FALSE if @file_name couldn't be opened.
+ */
+gboolean
+menu_trace_start (const gchar *file_name)
+{
+  FILE *file = fopen (file_name, "wb");
+
+  if (!file) {
+    g_warning ("Can't write a menu trace to %s", file_name);
+    return FALSE;
+  }
+  menu_trace_stop ();
+  menu_trace_file = file;
+  fwrite (MENU_TRACE_MAGIC, 1, strlen (MENU_TRACE_MAGIC), file);
+  putc (MENU_TRACE_VERSION, file);
+  menu_trace_last_ns = menu_stats_now_ns ();
+  menu_trace_first_id = menu_trace_next_id;
+  return TRUE;
+}
+
+void
+menu_trace_stop (void)
+{
+  if (!menu_trace_file)
+    return;
+  fclose (menu_trace_file);
+  menu_trace_file = NULL;
+}
+
+gboolean
+menu_trace_is_recording (void)
+{
+  return menu_trace_file != NULL;
+}
+
+static void
+menu_trace_notify (GtkWidget *menu_item, MenuUpdateFlags flags)
+{
+  guint state = menu_trace_get_state (menu_item), key, mods;
+
+  if (menu_trace_get_accel (menu_item, &key, &mods))
+    state |= MENU_TRACE_HAS_ACCEL;
+  menu_trace_begin (MENU_TRACE_NOTIFY);
+  menu_trace_put_uint (menu_trace_get_id (menu_item));
+  menu_trace_put_uint (flags);
+  menu_trace_put_uint (state);
+  if (flags & MENU_UPDATE_LABEL)
+    menu_trace_put_string (get_menu_label_text (menu_item, NULL));
+  if (flags & MENU_UPDATE_ACCEL_CLOSURE) {
+    menu_trace_put_uint (key);
+    menu_trace_put_uint (mods);
+  }
+}
+
+static void
+menu_trace_item_notify (GObject *object, GParamSpec *pspec, gpointer data)
+{
+  if (!menu_trace_file ||
+      menu_trace_get_id (GTK_WIDGET (object)) < menu_trace_first_id)
+    return;
+  if (!strcmp (pspec->name, "active") || !strcmp (pspec->name, "inconsistent"))
+    menu_trace_notify (GTK_WIDGET (object), MENU_UPDATE_CHECKED);
+  else
+    menu_trace_notify (GTK_WIDGET (object), MENU_UPDATE_STATE);
+}
+
+static void
+menu_trace_label_notify (GObject *object, GParamSpec *pspec,
+			 GtkWidget *menu_item)
+{
+  if (!menu_trace_file || menu_trace_get_id (menu_item) < menu_trace_first_id)
+    return;
+  if (!strcmp (pspec->name, "label"))
+    menu_trace_notify (menu_item, MENU_UPDATE_LABEL);
+  else
+    menu_trace_notify (menu_item, MENU_UPDATE_ACCEL_CLOSURE);
+}
+
+static void
+menu_trace_submenu_notify (GObject *object, GParamSpec *pspec, gpointer data)
+{
+  GtkWidget *menu_item = GTK_WIDGET (object);
+  guint submenu;
+
+  if (!menu_trace_file || menu_trace_get_id (menu_item) < menu_trace_first_id)
+    return;
+  submenu =
+    menu_trace_define (gtk_menu_item_get_submenu (GTK_MENU_ITEM (menu_item)),
+		       FALSE);
+  menu_trace_begin (MENU_TRACE_SUBMENU);
+  menu_trace_put_uint (menu_trace_get_id (menu_item));
+  menu_trace_put_uint (submenu);
+}
+
+/*
+ * menu_trace_parent_set:
+ *
+ * Record a call of the MenuWatchFunc.
+ */
+void
+menu_trace_parent_set (GtkWidget *menu_item, GtkWidget *old_parent,
+		       GtkWidget *new_parent, gint position)
+{
+  guint id, old_id, new_id;
+
+  if (!menu_trace_file)
+    return;
+  /* The item first, as a new parent's description would include it */
+  id = menu_trace_define (menu_item, FALSE);
+  old_id = menu_trace_define (old_parent, FALSE);
+  new_id = menu_trace_define (new_parent, FALSE);
+  menu_trace_begin (MENU_TRACE_PARENT_SET);
+  menu_trace_put_uint (id);
+  menu_trace_put_uint (old_id);
+  menu_trace_put_uint (new_id);
+  menu_trace_put_int (position);
+}
+
+/*
+ * menu_trace_accel:
+ * @menu_item: A mirrored item whose accelerator has changed
+ */
+void
+menu_trace_accel (GtkWidget *menu_item)
+{
+  guint id, key, mods;
+
+  if (!menu_trace_file)
+    return;
+  id = menu_trace_define (menu_item, FALSE);
+  menu_trace_get_accel (menu_item, &key, &mods);
+  menu_trace_begin (MENU_TRACE_ACCEL);
+  menu_trace_put_uint (id);
+  menu_trace_put_uint (key);
+  menu_trace_put_uint (mods);
+}
+
+/*
+ * menu_trace_set_menu_bar:
+ * @menubar: The GtkMenuBar being set
+ * @layout: Its layout, for a shared menubar, or NULL
+ *
+ * Record gtk_osxapplication_set_menu_bar() or
+ * gtk_osxapplication_set_shared_menu_bar().
+ */
+void
+menu_trace_set_menu_bar (GtkWidget *menubar, gpointer layout)
+{
+  static GHashTable *layouts = NULL;
+  guint id, layout_id = 0;
+
+  if (!menu_trace_file)
+    return;
+  id = menu_trace_define (menubar, TRUE);
+  /* Layouts are only told apart, so they're numbered too */
+  if (layout) {
+    if (!layouts)
+      layouts = g_hash_table_new (NULL, NULL);
+    layout_id = GPOINTER_TO_UINT (g_hash_table_lookup (layouts, layout));
+    if (!layout_id) {
+      layout_id = g_hash_table_size (layouts) + 1;
+      g_hash_table_insert (layouts, layout, GUINT_TO_POINTER (layout_id));
+    }
+  }
+  menu_trace_begin (MENU_TRACE_SET_MENU_BAR);
+  menu_trace_put_uint (id);
+  menu_trace_put_uint (layout_id);
+  /* The big events are where it's worth having the trace on disk
+     should the application not get as far as stopping it */
+  fflush (menu_trace_file);
+}
+
+/*
+ * menu_trace_sync_menubar:
+ * @menubar: The GtkMenuBar of the application menubar
+ *
+ * Record gtk_osxapplication_sync_menubar(). Everything is described
+ * again, as it was changed behind our backs.
+ */
+void
+menu_trace_sync_menubar (GtkWidget *menubar)
+{
+  guint id;
+
+  if (!menu_trace_file)
+    return;
+  id = menu_trace_define (menubar, TRUE);
+  menu_trace_begin (MENU_TRACE_SYNC_MENUBAR);
+  menu_trace_put_uint (id);
+  fflush (menu_trace_file);
+}
+
+/*
+ * menu_trace_focus:
+ * @menubar: The GtkMenuBar of a window taking focus
+ */
+void
+menu_trace_focus (GtkWidget *menubar)
+{
+  guint id;
+
+  if (!menu_trace_file)
+    return;
+  id = menu_trace_define (menubar, FALSE);
+  menu_trace_begin (MENU_TRACE_FOCUS);
+  menu_trace_put_uint (id);
+}
+
+/*
+ * menu_trace_menu_open:
+ * @menu_shell: A mirrored menu about to open
+ *
+ * A deferred menu hasn't been watched, so it's described again.
+ */
+void
+menu_trace_menu_open (GtkWidget *menu_shell)
+{
+  guint id;
+
+  if (!menu_trace_file)
+    return;
+  id = menu_trace_define (menu_shell,
+			  menu_shell_state_get (menu_shell)->deferred);
+  menu_trace_begin (MENU_TRACE_MENU_OPEN);
+  menu_trace_put_uint (id);
+}
+
+void
+menu_trace_freeze (void)
+{
+  if (menu_trace_file)
+    menu_trace_begin (MENU_TRACE_FREEZE);
+}
+
+void
+menu_trace_thaw (void)
+{
+  if (menu_trace_file)
+    menu_trace_begin (MENU_TRACE_THAW);
+}
+
+/*
+ * Reading
+ */
+
+struct _MenuTraceReader {
+  FILE *file;
+  gchar *file_name;
+  /* The file's size, which no string in it can be longer than */
+  guint64 size;
+  guint64 time;
+};
+
+#define MENU_TRACE_ERROR (g_quark_from_static_string ("menu-trace-error"))
+
+static gboolean
+menu_trace_get_uint (MenuTraceReader *reader, guint64 *value)
+{
+  guint shift = 0;
+  int byte;
+
+  *value = 0;
+  do {
+    if ((byte = getc (reader->file)) == EOF || shift > 63)
+      return FALSE;
+    *value |= (guint64) (byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return TRUE;
+}
+
+static gboolean
+menu_trace_get_uint32 (MenuTraceReader *reader, guint *value)
+{
+  guint64 value64;
+
+  if (!menu_trace_get_uint (reader, &value64) || value64 > G_MAXUINT)
+    return FALSE;
+  *value = value64;
+  return TRUE;
+}
+
+static gboolean
+menu_trace_get_string (MenuTraceReader *reader, gchar **string)
+{
+  guint length;
+  long position;
+
+  if (!menu_trace_get_uint32 (reader, &length))
+    return FALSE;
+  /* A damaged length mustn't get as far as g_malloc() */
+  position = ftell (reader->file);
+  if (position < 0 || (guint64) position > reader->size ||
+      length > reader->size - (guint64) position)
+    return FALSE;
+  *string = g_malloc (length + 1);
+  (*string)[length] = '\0';
+  return fread (*string, 1, length, reader->file) == length;
+}
+
+/*
+ * menu_trace_reader_open:
+ * @file_name: A trace written by menu_trace_start()
+ * @error: Return location for an error
+ *
+ * Returns: A reader for the trace, or NULL if it can't be read.
+ */
+MenuTraceReader *
+menu_trace_reader_open (const gchar *file_name, GError **error)
+{
+  MenuTraceReader *reader;
+  gchar magic[sizeof (MENU_TRACE_MAGIC)] = "";
+  FILE *file = fopen (file_name, "rb");
+  struct stat st;
+
+  if (!file) {
+    g_set_error (error, MENU_TRACE_ERROR, 0, "Can't open %s", file_name);
+    return NULL;
+  }
+  if (fread (magic, 1, strlen (MENU_TRACE_MAGIC), file) !=
+      strlen (MENU_TRACE_MAGIC) ||
+      strcmp (magic, MENU_TRACE_MAGIC) != 0 ||
+      getc (file) != MENU_TRACE_VERSION) {
+    g_set_error (error, MENU_TRACE_ERROR, 0,
+		 "%s isn't a version %d menu trace", file_name,
+		 MENU_TRACE_VERSION);
+    fclose (file);
+    return NULL;
+  }
+  reader = g_new0 (MenuTraceReader, 1);
+  reader->file = file;
+  reader->file_name = g_strdup (file_name);
+  if (fstat (fileno (file), &st) == 0)
+    reader->size = st.st_size;
+  return reader;
+}
+
+/*
+ * menu_trace_reader_next:
+ * @reader: A MenuTraceReader
+ * @record: Filled in with the next record; clear it with
+ * menu_trace_record_clear() when done with it
+ * @error: Return location for an error
+ *
+ * Returns: FALSE at the end of the trace, or if it's damaged, when
+ * @error is set.
+ */
+gboolean
+menu_trace_reader_next (MenuTraceReader *reader, MenuTraceRecord *record,
+			GError **error)
+{
+  guint64 delta, position = 0;
+  guint kind = 0, n = 0, i;
+  gboolean ok = TRUE;
+  int type;
+
+  memset (record, 0, sizeof (*record));
+  if ((type = getc (reader->file)) == EOF)
+    return FALSE;
+  if (type < MENU_TRACE_SHELL || type >= MENU_TRACE_N_TYPES ||
+      !menu_trace_get_uint (reader, &delta)) {
+    g_set_error (error, MENU_TRACE_ERROR, 0, "%s: bad record at %ld",
+		 reader->file_name, ftell (reader->file));
+    return FALSE;
+  }
+  reader->time += delta;
+  record->type = type;
+  record->time = reader->time;
+
+  if (type != MENU_TRACE_FREEZE && type != MENU_TRACE_THAW)
+    ok = menu_trace_get_uint32 (reader, &record->id);
+  switch (type) {
+  case MENU_TRACE_SHELL:
+    ok = (ok && menu_trace_get_uint32 (reader, &kind) &&
+	  menu_trace_get_uint32 (reader, &n));
+    record->kind = kind;
+    record->children = g_array_new (FALSE, FALSE, sizeof (guint));
+    for (i = 0; ok && i < n; i++) {
+      guint child;
+
+      ok = menu_trace_get_uint32 (reader, &child);
+      g_array_append_val (record->children, child);
+    }
+    break;
+  case MENU_TRACE_ITEM:
+    ok = (ok && menu_trace_get_uint32 (reader, &kind) &&
+	  menu_trace_get_uint32 (reader, &record->state) &&
+	  menu_trace_get_string (reader, &record->label) &&
+	  menu_trace_get_uint32 (reader, &record->key) &&
+	  menu_trace_get_uint32 (reader, &record->mods) &&
+	  menu_trace_get_uint32 (reader, &record->submenu));
+    record->kind = kind;
+    break;
+  case MENU_TRACE_PARENT_SET:
+    ok = (ok && menu_trace_get_uint32 (reader, &record->old_parent) &&
+	  menu_trace_get_uint32 (reader, &record->new_parent) &&
+	  menu_trace_get_uint (reader, &position));
+    record->position = (position & 1) ? -(gint) (position >> 1) - 1
+      : (gint) (position >> 1);
+    break;
+  case MENU_TRACE_NOTIFY:
+    ok = (ok && menu_trace_get_uint32 (reader, &record->flags) &&
+	  menu_trace_get_uint32 (reader, &record->state));
+    if (ok && record->flags & MENU_UPDATE_LABEL)
+      ok = menu_trace_get_string (reader, &record->label);
+    if (ok && record->flags & MENU_UPDATE_ACCEL_CLOSURE)
+      ok = (menu_trace_get_uint32 (reader, &record->key) &&
+	    menu_trace_get_uint32 (reader, &record->mods));
+    break;
+  case MENU_TRACE_ACCEL:
+    ok = (ok && menu_trace_get_uint32 (reader, &record->key) &&
+	  menu_trace_get_uint32 (reader, &record->mods));
+    break;
+  case MENU_TRACE_SUBMENU:
+    ok = ok && menu_trace_get_uint32 (reader, &record->submenu);
+    break;
+  case MENU_TRACE_SET_MENU_BAR:
+    ok = ok && menu_trace_get_uint32 (reader, &record->layout);
+    break;
+  default:
+    break;
+  }
+  if (!ok) {
+    g_set_error (error, MENU_TRACE_ERROR, 0, "%s: truncated %s record",
+		 reader->file_name, menu_trace_type_name (type));
+    menu_trace_record_clear (record);
+  }
+  return ok;
+}
+
+void
+menu_trace_reader_close (MenuTraceReader *reader)
+{
+  fclose (reader->file);
+  g_free (reader->file_name);
+  g_free (reader);
+}
+
+void
+menu_trace_record_clear (MenuTraceRecord *record)
+{
+  g_free (record->label);
+  record->label = NULL;
+  if (record->children)
+    g_array_free (record->children, TRUE);
+  record->children = NULL;
+}
+
+const gchar *
+menu_trace_type_name (MenuTraceType type)
+{
+  static const gchar *names[] = {
+    NULL, "shell", "item", "parent_set", "notify", "accel", "submenu",
+    "set_menu_bar", "sync_menubar", "focus", "menu_open", "freeze", "thaw"
+  };
+
+  g_return_val_if_fail (type > 0 && type < MENU_TRACE_N_TYPES, NULL);
+  return names[type];
+}
@@ -0,0 +1,133 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __MENU_TRACE_H__
+#define __MENU_TRACE_H__
+
+#include <gtk/gtk.h>
+
+/*
+ * A recording of everything on the GTK+ side that the menu mirror
+ * reacts to, so that a session can be replayed against the sync
+ * engine somewhere else (bench-replay does it on the in-memory
+ * backend). Each widget gets a number the first time it's seen and
+ * is described then: a SHELL record lists a shell's children, an
+ * ITEM record gives an item's type, state, label, shortcut and
+ * submenu, always after the records for the widgets it refers to.
+ * The events follow, referring to widgets by number. A shell is
+ * described again, with everything below it, when the whole menubar
+ * is synced or a deferred submenu is built, as it may have changed
+ * without our hearing of it.
+ *
+ * The file is MENU_TRACE_MAGIC and a version byte, then the records:
+ * a type byte, the nanoseconds since the previous record, and the
+ * fields for that type, all as unsigned LEB128 numbers (positions
+ * zigzag-encoded) and strings as a length and that many bytes.
+ */
+#define MENU_TRACE_MAGIC "GOMT"
+#define MENU_TRACE_VERSION 1
+
+typedef enum {
+  MENU_TRACE_SHELL = 1,		/* id kind n_children children... */
+  MENU_TRACE_ITEM,		/* id kind state label key mods submenu */
+  MENU_TRACE_PARENT_SET,	/* id old_parent new_parent position */
+  MENU_TRACE_NOTIFY,		/* id flags state [label] [key mods] */
+  MENU_TRACE_ACCEL,		/* id key mods */
+  MENU_TRACE_SUBMENU,		/* id submenu */
+  MENU_TRACE_SET_MENU_BAR,	/* id layout */
+  MENU_TRACE_SYNC_MENUBAR,	/* id */
+  MENU_TRACE_FOCUS,		/* id */
+  MENU_TRACE_MENU_OPEN,		/* id */
+  MENU_TRACE_FREEZE,
+  MENU_TRACE_THAW,
+  MENU_TRACE_N_TYPES
+} MenuTraceType;
+
+typedef enum {
+  MENU_TRACE_MENUBAR,
+  MENU_TRACE_MENU,
+  MENU_TRACE_MENU_ITEM,
+  MENU_TRACE_CHECK_MENU_ITEM,
+  MENU_TRACE_RADIO_MENU_ITEM,
+  MENU_TRACE_SEPARATOR,
+  MENU_TRACE_TEAROFF
+} MenuTraceKind;
+
+/* An item's state */
+#define MENU_TRACE_SENSITIVE	(1 << 0)
+#define MENU_TRACE_VISIBLE	(1 << 1)
+#define MENU_TRACE_ACTIVE	(1 << 2)
+#define MENU_TRACE_INCONSISTENT	(1 << 3)
+/* Its label shows an accel closure */
+#define MENU_TRACE_HAS_ACCEL	(1 << 4)
+
+/*
+ * One record, as read back. Widget numbers start at 1; 0 is none.
+ * A NOTIFY's flags are the MenuUpdateFlags of what changed, and it
+ * only has a label for MENU_UPDATE_LABEL and a shortcut for
+ * MENU_UPDATE_ACCEL_CLOSURE.
+ */
+typedef struct {
+  MenuTraceType type;
+  /* Nanoseconds since the trace started */
+  guint64 time;
+  guint id;
+  MenuTraceKind kind;
+  guint state;
+  guint flags;
+  gchar *label;
+  guint key;
+  guint mods;
+  guint submenu;
+  guint old_parent;
+  guint new_parent;
+  gint position;
+  guint layout;
+  GArray *children;
+} MenuTraceRecord;
+
+gboolean menu_trace_start (const gchar *file_name);
+void menu_trace_stop (void);
+gboolean menu_trace_is_recording (void);
+
+void menu_trace_parent_set (GtkWidget *menu_item, GtkWidget *old_parent,
+			    GtkWidget *new_parent, gint position);
+void menu_trace_accel (GtkWidget *menu_item);
+void menu_trace_set_menu_bar (GtkWidget *menubar, gpointer layout);
+void menu_trace_sync_menubar (GtkWidget *menubar);
+void menu_trace_focus (GtkWidget *menubar);
+void menu_trace_menu_open (GtkWidget *menu_shell);
+void menu_trace_freeze (void);
+void menu_trace_thaw (void);
+
+typedef struct _MenuTraceReader MenuTraceReader;
+
+MenuTraceReader *menu_trace_reader_open (const gchar *file_name,
+					 GError **error);
+gboolean menu_trace_reader_next (MenuTraceReader *reader,
+				 MenuTraceRecord *record,
+				 GError **error);
+void menu_trace_reader_close (MenuTraceReader *reader);
+void menu_trace_record_clear (MenuTraceRecord *record);
+const gchar *menu_trace_type_name (MenuTraceType type);
+
+#endif /* __MENU_TRACE_H__ */
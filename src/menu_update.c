@@ -0,0 +1,274 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#include <string.h>
+#include "menu_update.h"
+#include "menu_state.h"
+#include "menu_stats.h"
+
+static GQuark menu_update_quark = 0;
+
+/* The items with pending updates, each holding a reference, and the
+   idle handler that will flush them. */
+static GPtrArray *menu_update_pending = NULL;
+static guint menu_update_idle_id = 0;
+static MenuUpdateFlushFunc menu_update_flush_func = NULL;
+
+/*
+ * The properties which need the native item updating, and what they
+ * need. Each is connected as its own notify detail, so GObject only
+ * calls us for these rather than for every property that changes on
+ * a mirrored widget, and the handler finds its entry from the detail
+ * quark of the emission instead of comparing names.
+ */
+typedef struct {
+  const gchar *detailed_signal;
+  MenuUpdateFlags flags;
+  GQuark detail;
+} MenuUpdateNotify;
+
+static MenuUpdateNotify menu_update_item_notifies[] = {
+  { "notify::sensitive", MENU_UPDATE_STATE },
+  { "notify::visible", MENU_UPDATE_STATE },
+  { "notify::active", MENU_UPDATE_CHECKED },
+  { "notify::inconsistent", MENU_UPDATE_CHECKED }
+};
+
+static MenuUpdateNotify menu_update_label_notifies[] = {
+  { "notify::label", MENU_UPDATE_LABEL },
+  { "notify::accel-closure", MENU_UPDATE_ACCEL_CLOSURE }
+};
+
+static MenuUpdateFlags
+menu_update_get_flags (GtkWidget *menu_item)
+{
+  return (MenuUpdateFlags)
+    GPOINTER_TO_UINT (g_object_get_qdata (G_OBJECT (menu_item),
+					  menu_update_quark));
+}
+
+static void
+menu_update_set_flags (GtkWidget *menu_item, MenuUpdateFlags flags)
+{
+  g_object_set_qdata (G_OBJECT (menu_item), menu_update_quark,
+		      GUINT_TO_POINTER (flags));
+}
+
+static gboolean
+menu_update_idle (gpointer data)
+{
+  menu_update_idle_id = 0;
+  /* Thawing flushes */
+  if (!menu_state_is_frozen ())
+    menu_update_flush ();
+  return FALSE;
+}
+
+/*
+ * menu_update_queue:
+ * @menu_item: The GtkMenuItem which has changed
+ * @flags: What has changed
+ * @flush_func: Applies an item's collected changes to its native item
+ *
+ * Record that @menu_item's native item needs updating, and make sure
+ * that a flush is scheduled.
+ */
+void
+menu_update_queue (GtkWidget *menu_item, MenuUpdateFlags flags,
+		   MenuUpdateFlushFunc flush_func)
+{
+  MenuUpdateFlags pending;
+
+  if (menu_update_quark == 0)
+    menu_update_quark = g_quark_from_static_string ("MenuUpdateFlags");
+
+  menu_update_flush_func = flush_func;
+  pending = menu_update_get_flags (menu_item);
+  if (pending == 0) {
+    if (!menu_update_pending)
+      menu_update_pending = g_ptr_array_new ();
+    g_ptr_array_add (menu_update_pending, g_object_ref (menu_item));
+  }
+  else
+    menu_stats_get ()->updates_coalesced++;
+  menu_update_set_flags (menu_item, pending | flags);
+
+  /* Ahead of redrawing, so that the menus catch up with whatever the
+     application did in the same iteration. */
+  if (menu_update_idle_id == 0)
+    menu_update_idle_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+					   menu_update_idle, NULL, NULL);
+}
+
+/*
+ * menu_update_take:
+ * @menu_item: A GtkMenuItem
+ *
+ * Claim @menu_item's pending updates, for when it's about to be
+ * brought completely up to date anyway. It stays in the queue, but
+ * with nothing to do.
+ *
+ * Returns: The updates that were pending.
+ */
+MenuUpdateFlags
+menu_update_take (GtkWidget *menu_item)
+{
+  MenuUpdateFlags flags;
+
+  if (menu_update_quark == 0)
+    return 0;
+  flags = menu_update_get_flags (menu_item);
+  if (flags)
+    menu_update_set_flags (menu_item, 0);
+  return flags;
+}
+
+/*
+ * menu_update_flush:
+ *
+ * Apply all of the pending updates now. Call this before anything
+ * that relies on the native menus being current, like a key
+ * equivalent lookup.
+ */
+void
+menu_update_flush (void)
+{
+  GPtrArray *pending = menu_update_pending;
+  guint i;
+
+  if (!pending || pending->len == 0)
+    return;
+
+  /* A flush can cause more changes (e.g. a resync); those go into a
+     fresh queue. */
+  menu_update_pending = NULL;
+  menu_stats_get ()->update_flushes++;
+  for (i = 0; i < pending->len; i++) {
+    GtkWidget *menu_item = g_ptr_array_index (pending, i);
+    MenuUpdateFlags flags = menu_update_take (menu_item);
+
+    if (flags && menu_update_flush_func)
+      menu_update_flush_func (menu_item, flags);
+    g_object_unref (menu_item);
+  }
+  g_ptr_array_free (pending, TRUE);
+}
+
+static MenuUpdateFlags
+menu_update_notify_flags (gpointer instance, const MenuUpdateNotify *notifies,
+			  guint n_notifies)
+{
+  GSignalInvocationHint *hint = g_signal_get_invocation_hint (instance);
+  guint i;
+
+  for (i = 0; i < n_notifies; i++)
+    if (notifies[i].detail == hint->detail)
+      return notifies[i].flags;
+  return 0;
+}
+
+static void
+menu_update_item_notify (GObject    *object,
+			 GParamSpec *pspec,
+			 gpointer    data)
+{
+  MenuUpdateFlags flags =
+    menu_update_notify_flags (object, menu_update_item_notifies,
+			      G_N_ELEMENTS (menu_update_item_notifies));
+
+  menu_stats_get ()->notifies_received++;
+  if (flags)
+    menu_update_queue (GTK_WIDGET (object), flags, menu_update_flush_func);
+}
+
+static void
+menu_update_label_notify (GtkWidget  *menu_item,
+			  GParamSpec *pspec,
+			  GObject    *label)
+{
+  MenuUpdateFlags flags =
+    menu_update_notify_flags (label, menu_update_label_notifies,
+			      G_N_ELEMENTS (menu_update_label_notifies));
+
+  menu_stats_get ()->notifies_received++;
+  if (flags)
+    menu_update_queue (menu_item, flags, menu_update_flush_func);
+}
+
+static void
+menu_update_connect (gpointer instance, MenuUpdateNotify *notifies,
+		     guint n_notifies, GCallback handler, gpointer data,
+		     GConnectFlags connect_flags)
+{
+  guint i;
+
+  for (i = 0; i < n_notifies; i++) {
+    if (notifies[i].detail == 0)
+      notifies[i].detail =
+	g_quark_from_static_string (notifies[i].detailed_signal
+				    + strlen ("notify::"));
+    g_signal_connect_data (instance, notifies[i].detailed_signal, handler,
+			   data, NULL, connect_flags);
+  }
+}
+
+/*
+ * menu_update_watch:
+ * @menu_item: A GtkMenuItem being mirrored
+ * @label: The label inside it, or NULL
+ * @flush_func: Applies an item's collected changes to its native item
+ *
+ * Queue an update for @menu_item whenever one of the properties its
+ * native item reflects changes. Submenus aren't covered; each mirror
+ * watches notify::submenu itself. Watching an item again replaces the
+ * old connections.
+ */
+void
+menu_update_watch (GtkWidget *menu_item, GtkWidget *label,
+		   MenuUpdateFlushFunc flush_func)
+{
+  menu_update_unwatch (menu_item, label);
+  menu_update_flush_func = flush_func;
+  menu_update_connect (menu_item, menu_update_item_notifies,
+		       G_N_ELEMENTS (menu_update_item_notifies),
+		       G_CALLBACK (menu_update_item_notify), NULL, 0);
+  if (label)
+    menu_update_connect (label, menu_update_label_notifies,
+			 G_N_ELEMENTS (menu_update_label_notifies),
+			 G_CALLBACK (menu_update_label_notify), menu_item,
+			 G_CONNECT_SWAPPED);
+}
+
+/*
+ * menu_update_unwatch:
+ * @menu_item: A GtkMenuItem passed to menu_update_watch()
+ * @label: The label that was passed with it, or NULL
+ */
+void
+menu_update_unwatch (GtkWidget *menu_item, GtkWidget *label)
+{
+  g_signal_handlers_disconnect_by_func (menu_item, menu_update_item_notify,
+					NULL);
+  if (label)
+    g_signal_handlers_disconnect_by_func (label, menu_update_label_notify,
+					  menu_item);
+}
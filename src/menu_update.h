@@ -0,0 +1,57 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __MENU_UPDATE_H__
+#define __MENU_UPDATE_H__
+
+#include <gtk/gtk.h>
+
+/*
+ * Property changes on mirrored menu items are queued rather than
+ * pushed to the native item straight away. Each item collects dirty
+ * bits, and the whole queue is flushed once per main loop iteration
+ * from an idle handler. The flush reads the widget's properties as
+ * they are then, so any number of changes to an item in between
+ * (sensitivity flipping back and forth as actions are updated, say)
+ * cost a single native update.
+ */
+typedef enum {
+  MENU_UPDATE_STATE         = 1 << 0, /* sensitive, visible */
+  MENU_UPDATE_CHECKED       = 1 << 1, /* active, inconsistent */
+  MENU_UPDATE_LABEL         = 1 << 2,
+  MENU_UPDATE_ACCEL_CLOSURE = 1 << 3,
+  MENU_UPDATE_ACCEL         = 1 << 4  /* the key equivalent alone */
+} MenuUpdateFlags;
+
+typedef void (*MenuUpdateFlushFunc) (GtkWidget *menu_item,
+				     MenuUpdateFlags flags);
+
+void menu_update_queue (GtkWidget *menu_item, MenuUpdateFlags flags,
+			MenuUpdateFlushFunc flush_func);
+MenuUpdateFlags menu_update_take (GtkWidget *menu_item);
+void menu_update_flush (void);
+
+void menu_update_watch (GtkWidget *menu_item, GtkWidget *label,
+			MenuUpdateFlushFunc flush_func);
+void menu_update_unwatch (GtkWidget *menu_item, GtkWidget *label);
+
+#endif /* __MENU_UPDATE_H__ */
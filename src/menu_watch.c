@@ -0,0 +1,181 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#include "menu_watch.h"
+#include "menu_stats.h"
+
+#if GTK_CHECK_VERSION(3,2,0)
+#define MENU_WATCH_USE_SIGNALS 1
+#endif
+
+static GQuark menu_watch_quark = 0;
+static MenuWatchFunc menu_watch_func = NULL;
+
+gboolean
+menu_watch_is_watched (GtkWidget *menu_shell)
+{
+  return (menu_watch_quark != 0 &&
+	  g_object_get_qdata (G_OBJECT (menu_shell), menu_watch_quark) != NULL);
+}
+
+static void
+menu_watch_changed (GtkWidget *menu_item,
+		    GtkWidget *old_parent,
+		    GtkWidget *new_parent,
+		    gint       position)
+{
+  if (menu_watch_func)
+    menu_watch_func (menu_item, old_parent, new_parent, position);
+}
+
+#ifdef MENU_WATCH_USE_SIGNALS
+
+static void
+menu_watch_insert (GtkMenuShell *menu_shell, GtkWidget *child,
+		   gint position, gpointer data)
+{
+  menu_stats_get ()->parent_set_checks++;
+  if (GTK_IS_MENU_ITEM (child))
+    menu_watch_changed (child, NULL, GTK_WIDGET (menu_shell), position);
+}
+
+static void
+menu_watch_remove (GtkContainer *menu_shell, GtkWidget *child,
+		   gpointer data)
+{
+  menu_stats_get ()->parent_set_checks++;
+  if (GTK_IS_MENU_ITEM (child))
+    menu_watch_changed (child, GTK_WIDGET (menu_shell),
+			gtk_widget_get_parent (child), -1);
+}
+
+#else /* !MENU_WATCH_USE_SIGNALS */
+
+static gulong emission_hook_id    = 0;
+static gint   emission_hook_count = 0;
+
+/*
+ * parent_set_emission_hook:
+ * @ihint: The signal hint confgigured when the signal was created.
+ * @n_param_values: The number of parameters passed in param_values
+ * @param_values: A GValue[] containing the parameters
+ * data: A gpointer to pass to the signal handler
+ *
+ * Runs for every parent-set in the application, so get out quickly
+ * unless a watched shell is involved.
+ */
+static gboolean
+parent_set_emission_hook (GSignalInvocationHint *ihint,
+			  guint                  n_param_values,
+			  const GValue          *param_values,
+			  gpointer               data)
+{
+  GtkWidget *instance = (GtkWidget*) g_value_get_object (param_values);
+  GtkWidget *old_parent, *new_parent;
+
+  menu_stats_get ()->parent_set_checks++;
+  if (!GTK_IS_MENU_ITEM (instance))
+    return TRUE;
+
+  old_parent = (GtkWidget*) g_value_get_object (param_values + 1);
+  new_parent = gtk_widget_get_parent (instance);
+  if ((old_parent && menu_watch_is_watched (old_parent)) ||
+      (new_parent && menu_watch_is_watched (new_parent))) {
+    gint position = -1;
+    /* parent-set doesn't say where, so look it up. It's a walk down
+       a list, but there's nothing native about it. */
+    if (new_parent && menu_watch_is_watched (new_parent)) {
+      GList *children = gtk_container_get_children (GTK_CONTAINER (new_parent));
+      position = g_list_index (children, instance);
+      g_list_free (children);
+    }
+    menu_watch_changed (instance, old_parent, new_parent, position);
+  }
+  return TRUE;
+}
+
+#endif /* MENU_WATCH_USE_SIGNALS */
+
+/* A watched shell has been finalized */
+static void
+menu_watch_unwatch (gpointer data, GObject *where_the_object_was)
+{
+#ifndef MENU_WATCH_USE_SIGNALS
+  if (--emission_hook_count > 0)
+    return;
+  g_signal_remove_emission_hook (g_signal_lookup ("parent-set",
+						  GTK_TYPE_WIDGET),
+				 emission_hook_id);
+  emission_hook_id = 0;
+#endif
+}
+
+/*
+ * menu_watch_set_func:
+ * @func: Called whenever a menu item joins or leaves a watched shell
+ *
+ * There's only the one menubar mirror, so only one function.
+ */
+void
+menu_watch_set_func (MenuWatchFunc func)
+{
+  menu_watch_func = func;
+}
+
+/*
+ * menu_watch_shell:
+ * @menu_shell: A GtkMenuShell which is being mirrored
+ *
+ * Start watching @menu_shell's children, until it's finalized. The
+ * MenuWatchFunc is told where in the new parent an item was put, or
+ * -1 if it was appended.
+ * Watching a shell more than once does nothing.
+ */
+void
+menu_watch_shell (GtkWidget *menu_shell)
+{
+  g_return_if_fail (GTK_IS_MENU_SHELL (menu_shell));
+
+  if (menu_watch_quark == 0)
+    menu_watch_quark = g_quark_from_static_string ("MenuWatch");
+  if (menu_watch_is_watched (menu_shell))
+    return;
+  g_object_set_qdata (G_OBJECT (menu_shell), menu_watch_quark,
+		      GINT_TO_POINTER (TRUE));
+  g_object_weak_ref (G_OBJECT (menu_shell), menu_watch_unwatch, NULL);
+
+#ifdef MENU_WATCH_USE_SIGNALS
+  g_signal_connect (menu_shell, "insert",
+		    G_CALLBACK (menu_watch_insert), NULL);
+  g_signal_connect (menu_shell, "remove",
+		    G_CALLBACK (menu_watch_remove), NULL);
+#else
+  if (emission_hook_id == 0)
+    emission_hook_id =
+      g_signal_add_emission_hook (g_signal_lookup ("parent-set",
+						   GTK_TYPE_WIDGET),
+				  0,
+				  parent_set_emission_hook,
+				  NULL, NULL);
+  emission_hook_count++;
+#endif
+}
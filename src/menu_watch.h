@@ -0,0 +1,47 @@
+/* GTK+ Integration with platform-specific application-wide features
+ * such as the OS X menubar and application delegate concepts.
+ *
+ * Copyright © 2010 John Ralls
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; version 2.1
+ * of the License.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef __MENU_WATCH_H__
+#define __MENU_WATCH_H__
+
+#include <gtk/gtk.h>
+
+/*
+ * Notice menu items being added to or removed from the mirrored menu
+ * shells, and only those. With GTK+ 3.2 and later that's done with
+ * each watched shell's own insert and remove signals, so reparenting
+ * any other widget costs nothing. Older GTK+ has no signal for
+ * gtk_menu_shell_insert(), so there it falls back to a single
+ * parent-set emission hook, installed while any shell is watched,
+ * which discards everything that isn't a menu item moving into or
+ * out of a watched shell as cheaply as it can.
+ */
+typedef void (*MenuWatchFunc) (GtkWidget *menu_item,
+			       GtkWidget *old_parent,
+			       GtkWidget *new_parent,
+			       gint       position);
+
+void menu_watch_set_func (MenuWatchFunc func);
+void menu_watch_shell (GtkWidget *menu_shell);
+gboolean menu_watch_is_watched (GtkWidget *menu_shell);
+
+#endif /* __MENU_WATCH_H__ */
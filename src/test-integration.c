@@ -724,7 +724,11 @@ main (int argc, char **argv)
     }
   }
 #endif //GTKOSXAPPLICATION
+#ifdef GTKOSXAPPLICATION
+  gtk_osxapplication_load_accel_map(theApp, "accel_map");
+#else
   gtk_accel_map_load("accel_map");
+#endif //GTKOSXAPPLICATION
   gtk_main ();
 #ifdef GTKOSXAPPLICATION
   g_object_unref(theApp);